@@ -3869,15 +3869,17 @@ class RB3Dashboard:
     def update_pico_device(self, ip, status):
         """Update Pico device in tree"""
         now = time.time()
+        # Older firmware sends no link score
+        state = "WEAK LINK" if status.get('link_alert') else "ONLINE"
         if ip not in self.devices:
             self.pico_tree.insert("", "end", iid=ip,
                                  values=(ip, status.get('name', 'Unknown'),
                                         status.get('usb_status', '?'),
-                                        f"{status.get('wifi_signal', 0)} dBm", "ONLINE"))
+                                        f"{status.get('wifi_signal', 0)} dBm", state))
         self.devices[ip] = {"last_seen": now, "data": status}
         self.pico_tree.set(ip, "usb", status.get('usb_status', '?'))
         self.pico_tree.set(ip, "signal", f"{status.get('wifi_signal', 0)} dBm")
-        self.pico_tree.set(ip, "status", "ONLINE")
+        self.pico_tree.set(ip, "status", state)
 
     def cleanup_devices(self):
         """Periodic cleanup of offline Pico devices"""
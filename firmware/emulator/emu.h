@@ -0,0 +1,189 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Internals
+ *
+ * Shared state between the emulator shims. The firmware sources never
+ * include this header; they only see the SDK stand-ins in include/.
+ */
+
+#ifndef _EMU_H_
+#define _EMU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stagekit_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU_FLASH_SIZE      (2 * 1024 * 1024)   // Pico W
+
+//--------------------------------------------------------------------
+// Configuration (from the command line)
+//--------------------------------------------------------------------
+
+typedef struct {
+    uint8_t mac[6];             // Reported by cyw43_wifi_get_mac()
+    uint16_t port_offset;       // Added to every local UDP port
+    uint32_t ip;                // Bridge address, network order (0 = host address)
+    uint32_t netmask;           // Network order (0 = from host interface or /24)
+    int32_t rssi;               // Reported by cyw43_wifi_get_rssi()
+    int32_t roam_rssi;          // Second access point for roaming (0 = none)
+    bool stagekit;              // Virtual Stage Kit plugged in at boot
+    bool show_kit;              // Print the virtual Stage Kit state on change
+    uint32_t usb_latency_us;    // Virtual control transfer duration
+    const char *ssid;           // Pretend WiFi network
+    char **argv;                // For watchdog "reboots"
+
+    // Capture replay (see emu_replay.c)
+    const char *replay_path;    // pcap/pcapng to replay (NULL = live network)
+    const char *timeline_path;  // Write the Stage Kit timeline here
+    const char *golden_path;    // Compare against this timeline
+    uint32_t tolerance_ms;      // Allowed timing difference per divergence
+    uint32_t replay_tail_ms;    // Keep running after the last packet
+
+    const char *trace_path;     // Write a trace dump here on exit (see emu_trace.c)
+    const char *flash_path;     // Back the simulated flash with this file (see emu_flash.c)
+    const char *link_trace_path; // Run the link-quality estimator on this trace and exit
+} emu_config_t;
+
+extern emu_config_t emu_config;
+
+//--------------------------------------------------------------------
+// Background Work
+//--------------------------------------------------------------------
+
+/**
+ * Re-exec the emulator as a reset would restart the firmware
+ *
+ * @param watchdog Report the restart through watchdog_caused_reboot()
+ */
+void emu_reboot(const char *reason, bool watchdog) __attribute__((noreturn));
+
+/**
+ * Run alarms, timers, lwIP callbacks and the watchdog until the given
+ * time (us since boot). Called from every sleep - the emulator's
+ * equivalent of interrupts firing while the main loop waits.
+ */
+void emu_service(uint64_t until_us);
+
+/**
+ * Like emu_service(), but return as soon as a datagram is waiting for
+ * cyw43_arch_poll() (poll build's cyw43_arch_wait_for_work_until)
+ */
+void emu_wait_for_work(uint64_t until_us);
+
+/**
+ * Wait up to timeout_us for datagrams on the UDP PCBs and dispatch
+ * them to their receive callbacks
+ */
+void emu_lwip_poll(uint64_t timeout_us);
+
+/**
+ * Wait up to timeout_us for a datagram without dispatching it
+ *
+ * @return true if one is waiting
+ */
+bool emu_lwip_wait(uint64_t timeout_us);
+
+/**
+ * Close all UDP sockets (before a watchdog re-exec)
+ */
+void emu_lwip_shutdown(void);
+
+/**
+ * Bring the emulated netif up with the configured address
+ */
+void emu_netif_up(void);
+
+/**
+ * Take the emulated netif down
+ */
+void emu_netif_down(void);
+
+/**
+ * Deliver a datagram to the PCB bound to dst_port (replay mode)
+ *
+ * @return false if nothing listens on that port
+ */
+bool emu_lwip_inject(uint32_t src_addr, uint16_t src_port, uint16_t dst_port,
+                     const uint8_t *data, uint16_t len);
+
+/**
+ * Check whether a PCB with a receive callback is bound to port
+ */
+bool emu_lwip_listening(uint16_t port);
+
+/**
+ * Plug/unplug the virtual Stage Kit (takes effect on the next tuh_task)
+ */
+void emu_stagekit_set_plugged(bool plugged);
+
+//--------------------------------------------------------------------
+// Capture Replay
+//--------------------------------------------------------------------
+
+/**
+ * Load a capture and switch the emulator to a virtual clock
+ *
+ * @return false if the file is unreadable or holds no RB3E packets
+ */
+bool emu_replay_load(const char *path);
+
+/**
+ * Inject every captured packet that is due; finishes the run (exits)
+ * after the last packet plus the tail time
+ *
+ * @param horizon_us Latest time the caller wants to advance to
+ * @return Time of the next packet, or horizon_us if that is sooner
+ */
+uint64_t emu_replay_step(uint64_t horizon_us);
+
+/**
+ * Record a virtual Stage Kit state change
+ */
+void emu_replay_kit_changed(const stagekit_state_t *state);
+
+/**
+ * Print the report, write/compare timelines
+ *
+ * @return Exit code: 0 = pass, 1 = diverged from golden, 2 = error
+ */
+int emu_replay_finish(void);
+
+//--------------------------------------------------------------------
+// Trace Dumps
+//--------------------------------------------------------------------
+
+/**
+ * Start the firmware trace recorder if --trace was given and arrange
+ * for the dump to be written on exit
+ */
+void emu_trace_start(void);
+
+/**
+ * Exit cleanly if SIGINT/SIGTERM arrived (called from emu_service)
+ */
+void emu_trace_poll(void);
+
+/**
+ * Stop the recorder and write everything it holds as an RB3T dump
+ */
+bool emu_trace_write(const char *path);
+
+//--------------------------------------------------------------------
+// Link-Quality Traces
+//--------------------------------------------------------------------
+
+/**
+ * Run the link-quality estimator over a synthetic trace (no firmware)
+ *
+ * @return Exit code: 0 = every expectation held, 1 = one failed, 2 = error
+ */
+int emu_link_trace_run(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_H_ */
@@ -0,0 +1,261 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator CYW43 Shim
+ *
+ * "Joining WiFi" brings the netif up straight away with the configured
+ * address, or the host's first non-loopback IPv4 address. The network
+ * has one access point at --rssi, plus a second one at --roam-rssi if
+ * given; scans report both at once.
+ */
+
+#include "emu.h"
+#include "pico/cyw43_arch.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+// Rough cost of one control ioctl (LED write, RSSI read) over the gSPI bus
+#define EMU_CYW43_IOCTL_US      100
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+cyw43_t cyw43_state;
+
+static int link_status = CYW43_LINK_DOWN;
+static bool led_on = false;
+
+// Access points of the emulated network (02:00:00:00:00:01 and :02)
+#define EMU_AP_COUNT            2
+static int joined_ap = 0;
+
+//--------------------------------------------------------------------
+// Network Interface
+//--------------------------------------------------------------------
+
+// First non-loopback IPv4 interface, or loopback if there is none
+static void host_address(uint32_t *addr, uint32_t *netmask)
+{
+    struct ifaddrs *list = NULL;
+
+    *addr = htonl(INADDR_LOOPBACK);
+    *netmask = htonl(0xff000000u);
+
+    if (getifaddrs(&list) != 0) {
+        return;
+    }
+
+    for (struct ifaddrs *ifa = list; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET ||
+            ifa->ifa_netmask == NULL) {
+            continue;
+        }
+
+        uint32_t a = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr;
+        if ((ntohl(a) >> 24) == 127) {
+            continue;
+        }
+
+        *addr = a;
+        *netmask = ((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr.s_addr;
+        break;
+    }
+
+    freeifaddrs(list);
+}
+
+void emu_netif_up(void)
+{
+    struct netif *netif = &cyw43_state.netif[CYW43_ITF_STA];
+    ip4_addr_t addr, netmask, gw;
+
+    if (emu_config.ip != 0) {
+        addr.addr = emu_config.ip;
+        netmask.addr = emu_config.netmask != 0 ? emu_config.netmask : htonl(0xffffff00u);
+    } else {
+        host_address(&addr.addr, &netmask.addr);
+        if (emu_config.netmask != 0) {
+            netmask.addr = emu_config.netmask;
+        }
+    }
+    gw.addr = (addr.addr & netmask.addr) | htonl(1);
+
+    netif_set_addr(netif, &addr, &netmask, &gw);
+    netif_set_link_up(netif);
+    netif_set_up(netif);
+    link_status = CYW43_LINK_UP;
+}
+
+void emu_netif_down(void)
+{
+    struct netif *netif = &cyw43_state.netif[CYW43_ITF_STA];
+
+    netif_set_down(netif);
+    netif_set_link_down(netif);
+    link_status = CYW43_LINK_DOWN;
+}
+
+//--------------------------------------------------------------------
+// CYW43 Arch
+//--------------------------------------------------------------------
+
+int cyw43_arch_init_with_country(uint32_t country)
+{
+    (void)country;
+    memset(&cyw43_state, 0, sizeof(cyw43_state));
+    netif_set_default(&cyw43_state.netif[CYW43_ITF_STA]);
+    return 0;
+}
+
+void cyw43_arch_enable_sta_mode(void)
+{
+}
+
+static void ap_bssid(int ap, uint8_t bssid[6])
+{
+    static const uint8_t base[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    memcpy(bssid, base, 6);
+    bssid[5] = (uint8_t)(ap + 1);
+}
+
+static int32_t ap_rssi(int ap)
+{
+    return ap == 0 ? emu_config.rssi : emu_config.roam_rssi;
+}
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth)
+{
+    (void)pw;
+    (void)auth;
+
+    if (emu_config.ssid != NULL && strcmp(ssid, emu_config.ssid) != 0) {
+        link_status = CYW43_LINK_NONET;
+        return 0;
+    }
+
+    joined_ap = 0;
+    emu_netif_up();
+    return 0;
+}
+
+int cyw43_arch_wifi_connect_bssid_async(const char *ssid, const uint8_t *bssid,
+                                        const char *pw, uint32_t auth)
+{
+    for (int ap = 0; ap < EMU_AP_COUNT; ap++) {
+        uint8_t candidate[6];
+        ap_bssid(ap, candidate);
+        if (memcmp(candidate, bssid, 6) == 0 && ap_rssi(ap) != 0) {
+            int status = cyw43_arch_wifi_connect_async(ssid, pw, auth);
+            joined_ap = ap;
+            return status;
+        }
+    }
+    link_status = CYW43_LINK_NONET;
+    return 0;
+}
+
+// Blocks the caller like the synchronous SPI transaction on hardware
+static void ioctl_busy(void)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = EMU_CYW43_IOCTL_US * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+void cyw43_arch_gpio_put(unsigned int wl_gpio, bool value)
+{
+    (void)wl_gpio;
+    ioctl_busy();
+    led_on = value;
+}
+
+void cyw43_arch_poll(void)
+{
+#if PICO_CYW43_ARCH_POLL
+    emu_lwip_poll(0);
+#endif
+}
+
+void cyw43_arch_wait_for_work_until(absolute_time_t until)
+{
+    emu_wait_for_work(to_us_since_boot(until));
+}
+
+//--------------------------------------------------------------------
+// CYW43 Driver
+//--------------------------------------------------------------------
+
+int cyw43_wifi_pm(cyw43_t *self, uint32_t pm)
+{
+    (void)self;
+    (void)pm;
+    return 0;
+}
+
+int cyw43_wifi_get_mac(cyw43_t *self, int itf, uint8_t mac[6])
+{
+    (void)self;
+    (void)itf;
+    memcpy(mac, emu_config.mac, 6);
+    return 0;
+}
+
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi)
+{
+    (void)self;
+    ioctl_busy();
+    *rssi = ap_rssi(joined_ap);
+    return 0;
+}
+
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6])
+{
+    (void)self;
+    ap_bssid(joined_ap, bssid);
+    return 0;
+}
+
+int cyw43_wifi_scan(cyw43_t *self, cyw43_wifi_scan_options_t *opts, void *env,
+                    int (*result_cb)(void *, const cyw43_ev_scan_result_t *))
+{
+    (void)self;
+    (void)opts;
+
+    for (int ap = 0; ap < EMU_AP_COUNT; ap++) {
+        if (ap_rssi(ap) == 0) {
+            continue;
+        }
+        cyw43_ev_scan_result_t result;
+        memset(&result, 0, sizeof(result));
+        ap_bssid(ap, result.bssid);
+        result.ssid_len = (uint8_t)strnlen(emu_config.ssid, sizeof(result.ssid));
+        memcpy(result.ssid, emu_config.ssid, result.ssid_len);
+        result.channel = 6;
+        result.rssi = (int16_t)ap_rssi(ap);
+        result_cb(env, &result);
+    }
+    return 0;
+}
+
+bool cyw43_wifi_scan_active(cyw43_t *self)
+{
+    (void)self;
+    return false;
+}
+
+int cyw43_wifi_leave(cyw43_t *self, int itf)
+{
+    (void)self;
+    (void)itf;
+    emu_netif_down();
+    return 0;
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf)
+{
+    (void)self;
+    (void)itf;
+    return link_status;
+}
@@ -0,0 +1,175 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Simulated Flash
+ *
+ * flash_ops.h on a RAM (or --flash file) copy of a 2 MB NOR flash:
+ *   - erase sets whole sectors to 0xFF, program can only clear bits,
+ *     so programming a page that was not erased is caught and reported
+ *   - misaligned erase/program is a firmware bug and stops the emulator
+ *   - each operation blocks the whole emulator for the typical W25Q16
+ *     erase/program time, as on hardware where it stalls code fetch
+ *
+ * With --flash the image survives the re-exec that follows an install,
+ * and can be compared with the uploaded file afterwards.
+ */
+
+#include "emu.h"
+#include "flash_ops.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+//--------------------------------------------------------------------
+// Constants
+//--------------------------------------------------------------------
+
+#define EMU_FLASH_ERASE_US      45000   // Sector erase, typical
+#define EMU_FLASH_PROGRAM_US    400     // Page program, typical
+#define EMU_IMAGE_SIZE          (640 * 1024)    // Pretend size of the running firmware
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+static uint8_t *flash = NULL;
+static uint32_t unerased_writes = 0;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+static void flash_fail(const char *what, uint32_t offset, uint32_t len)
+{
+    fprintf(stderr, "EmuFlash: %s at 0x%X, %u bytes\n", what, offset, len);
+    exit(2);
+}
+
+// Blocks without servicing alarms or sockets - interrupts are off
+static void flash_busy(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static uint8_t *flash_map(void)
+{
+    if (flash != NULL) {
+        return flash;
+    }
+
+    if (emu_config.flash_path == NULL) {
+        flash = malloc(EMU_FLASH_SIZE);
+        if (flash == NULL) {
+            flash_fail("Out of memory", 0, EMU_FLASH_SIZE);
+        }
+        memset(flash, 0xFF, EMU_FLASH_SIZE);
+        return flash;
+    }
+
+    // A new file starts erased; an existing one keeps its contents
+    int fd = open(emu_config.flash_path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror("EmuFlash: open");
+        exit(2);
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < EMU_FLASH_SIZE) {
+        uint8_t erased[FLASH_OPS_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (off_t at = size; at < EMU_FLASH_SIZE; at += sizeof(erased)) {
+            if (pwrite(fd, erased, sizeof(erased), at) != (ssize_t)sizeof(erased)) {
+                perror("EmuFlash: write");
+                exit(2);
+            }
+        }
+    }
+
+    flash = mmap(NULL, EMU_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (flash == MAP_FAILED) {
+        perror("EmuFlash: mmap");
+        exit(2);
+    }
+    printf("EmuFlash: %u KB backed by %s\n", EMU_FLASH_SIZE / 1024, emu_config.flash_path);
+    return flash;
+}
+
+static void check_range(const char *op, uint32_t offset, uint32_t len, uint32_t unit)
+{
+    if (offset % unit != 0 || len % unit != 0) {
+        flash_fail(op, offset, len);
+    }
+    if (offset > EMU_FLASH_SIZE || len > EMU_FLASH_SIZE - offset) {
+        flash_fail(op, offset, len);
+    }
+}
+
+//--------------------------------------------------------------------
+// flash_ops.h
+//--------------------------------------------------------------------
+
+uint32_t flash_ops_size(void)
+{
+    return EMU_FLASH_SIZE;
+}
+
+uint32_t flash_ops_image_end(void)
+{
+    return EMU_IMAGE_SIZE;
+}
+
+const uint8_t *flash_ops_read(uint32_t offset)
+{
+    return flash_map() + offset;
+}
+
+void flash_ops_erase(uint32_t offset, uint32_t len)
+{
+    check_range("Misaligned erase", offset, len, FLASH_OPS_SECTOR_SIZE);
+
+    TRACE_BEGIN(TRACE_TRACK_FLASH, TRACE_EV_FLASH_ERASE, offset / FLASH_OPS_SECTOR_SIZE);
+    memset(flash_map() + offset, 0xFF, len);
+    flash_busy(EMU_FLASH_ERASE_US * (len / FLASH_OPS_SECTOR_SIZE));
+    TRACE_END(TRACE_TRACK_FLASH, TRACE_EV_FLASH_ERASE, len);
+}
+
+void flash_ops_program(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    check_range("Misaligned program", offset, len, FLASH_OPS_PAGE_SIZE);
+
+    TRACE_BEGIN(TRACE_TRACK_FLASH, TRACE_EV_FLASH_PROG, offset / FLASH_OPS_SECTOR_SIZE);
+    uint8_t *to = flash_map() + offset;
+    bool unerased = false;
+    for (uint32_t i = 0; i < len; i++) {
+        if ((to[i] & data[i]) != data[i]) {
+            unerased = true;
+        }
+        to[i] &= data[i];   // NOR: programming only clears bits
+    }
+    if (unerased && unerased_writes++ < 8) {
+        printf("EmuFlash: Program over unerased flash at 0x%X\n", offset);
+    }
+    flash_busy(EMU_FLASH_PROGRAM_US * (len / FLASH_OPS_PAGE_SIZE));
+    TRACE_END(TRACE_TRACK_FLASH, TRACE_EV_FLASH_PROG, len);
+}
+
+void flash_ops_install(uint32_t src, uint32_t len)
+{
+    check_range("Misaligned install", src, len, FLASH_OPS_SECTOR_SIZE);
+
+    uint8_t *base = flash_map();
+    memmove(base, base + src, len);
+    flash_busy((EMU_FLASH_ERASE_US + EMU_FLASH_PROGRAM_US * (FLASH_OPS_SECTOR_SIZE / FLASH_OPS_PAGE_SIZE)) *
+               (len / FLASH_OPS_SECTOR_SIZE));
+    if (emu_config.flash_path != NULL) {
+        msync(base, EMU_FLASH_SIZE, MS_SYNC);
+    }
+
+    printf("EmuFlash: Installed %u bytes from 0x%X\n", len, src);
+    emu_reboot("Firmware installed", false);
+}
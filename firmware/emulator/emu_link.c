@@ -0,0 +1,192 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Link-Quality Traces
+ *
+ * Feeds a synthetic trace through the firmware's link-quality estimator
+ * (link_quality.c, unmodified) on a virtual clock, updating it every
+ * 100 ms as network_link_task() does, and checks the expectations the
+ * trace states. tools/rb3e_link_trace.py writes such traces.
+ *
+ * Trace file, one event per line, times in ms and never decreasing:
+ *   <ms> rssi <dBm>
+ *   <ms> alive
+ *   <ms> stagekit
+ *   <ms> send ok|fail
+ *   <ms> expect alert|ok            In / not in the alert state
+ *   <ms> expect score <min> <max>   Combined score in range
+ *   <ms> expect alerts|roams <n>    Alerts raised / roam scans asked for so far
+ * Blank lines and lines starting with # are ignored.
+ */
+
+#include "emu.h"
+#include "link_quality.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINK_TRACE_STEP_MS      100     // network_link_task() update rate
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+static uint32_t next_update_ms = 0;
+static uint32_t events = 0;
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+static void update(uint32_t now_ms)
+{
+    switch (link_quality_update(now_ms, LINK_ALERT_SCORE, LINK_ROAM_SCORE)) {
+        case LINK_ACTION_ALERT:
+            printf("%9.1f s  score %3u  alert\n", now_ms / 1000.0, link_quality_score());
+            break;
+        case LINK_ACTION_RECOVERED:
+            printf("%9.1f s  score %3u  recovered\n", now_ms / 1000.0, link_quality_score());
+            break;
+        case LINK_ACTION_ROAM:
+            // A trace has no access points to find
+            printf("%9.1f s  score %3u  roam scan\n", now_ms / 1000.0, link_quality_score());
+            link_quality_note_roam(false);
+            break;
+        default:
+            break;
+    }
+}
+
+// Run every update due up to and including now_ms
+static void advance(uint32_t now_ms)
+{
+    while (next_update_ms <= now_ms) {
+        update(next_update_ms);
+        next_update_ms += LINK_TRACE_STEP_MS;
+    }
+}
+
+static const char *component(uint8_t score, char buf[4])
+{
+    if (score == CTRL_LINK_NO_DATA) {
+        return "--";
+    }
+    snprintf(buf, 4, "%u", score);
+    return buf;
+}
+
+static void check(uint32_t now_ms, bool ok, const char *what)
+{
+    ctrl_link_t link;
+    char b[4][4];
+    link_quality_get_stats(&link);
+
+    checks++;
+    if (!ok) {
+        failures++;
+    }
+    printf("%9.1f s  score %3u  expect %s: %s (rssi %s, alive %s, jitter %s, sends %s)\n",
+           now_ms / 1000.0, link.score, what, ok ? "ok" : "FAILED",
+           component(link.rssi_score, b[0]), component(link.alive_score, b[1]),
+           component(link.jitter_score, b[2]), component(link.send_score, b[3]));
+}
+
+// Returns false on a malformed expectation
+static bool expect(uint32_t now_ms, const char *args)
+{
+    char what[16];
+    long a = 0, b = 0;
+    int n = sscanf(args, "%15s %ld %ld", what, &a, &b);
+    ctrl_link_t link;
+    link_quality_get_stats(&link);
+
+    if (n == 1 && strcmp(what, "alert") == 0) {
+        check(now_ms, link.alert, "alert");
+    } else if (n == 1 && strcmp(what, "ok") == 0) {
+        check(now_ms, !link.alert, "ok");
+    } else if (n == 3 && strcmp(what, "score") == 0) {
+        char desc[32];
+        snprintf(desc, sizeof(desc), "score %ld-%ld", a, b);
+        check(now_ms, link.score >= a && link.score <= b, desc);
+    } else if (n == 2 && (strcmp(what, "alerts") == 0 || strcmp(what, "roams") == 0)) {
+        char desc[32];
+        uint32_t count = what[0] == 'a' ? link.alerts : link.roam_scans;
+        snprintf(desc, sizeof(desc), "%s %ld (got %u)", what, a, count);
+        check(now_ms, count == (uint32_t)a, desc);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+int emu_link_trace_run(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 2;
+    }
+
+    link_quality_restart();
+
+    char line[256];
+    int line_no = 0;
+    uint32_t now_ms = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+
+        unsigned long t;
+        char event[16];
+        int used = 0;
+        if (sscanf(p, "%lu %15s %n", &t, event, &used) < 2 || t < now_ms) {
+            fprintf(stderr, "%s:%d: bad line or time goes backwards\n", path, line_no);
+            fclose(f);
+            return 2;
+        }
+        now_ms = (uint32_t)t;
+        const char *args = p + used;
+
+        advance(now_ms);
+
+        bool ok = true;
+        if (strcmp(event, "rssi") == 0) {
+            link_quality_note_rssi(strtol(args, NULL, 0));
+        } else if (strcmp(event, "alive") == 0) {
+            link_quality_note_alive(now_ms);
+        } else if (strcmp(event, "stagekit") == 0) {
+            link_quality_note_stagekit(now_ms);
+        } else if (strcmp(event, "send") == 0) {
+            ok = strncmp(args, "ok", 2) == 0 || strncmp(args, "fail", 4) == 0;
+            link_quality_note_send(strncmp(args, "ok", 2) == 0);
+        } else if (strcmp(event, "expect") == 0) {
+            ok = expect(now_ms, args);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%d: unknown event: %s", path, line_no, p);
+            fclose(f);
+            return 2;
+        }
+        events++;
+    }
+    fclose(f);
+
+    ctrl_link_t link;
+    link_quality_get_stats(&link);
+    printf("\nLink trace: %u events over %.1f s, final score %u, %u alerts, %u roam scans\n",
+           events, now_ms / 1000.0, link.score, link.alerts, link.roam_scans);
+    printf("Expectations: %u checked, %u failed\n", checks, failures);
+    printf("Result: %s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
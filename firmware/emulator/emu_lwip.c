@@ -0,0 +1,648 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator lwIP Shim
+ *
+ * The lwIP raw UDP API used by network.c, backed by host sockets.
+ * Local ports are shifted by --port-offset so many emulated bridges can
+ * share one host; destination ports are left alone, so telemetry still
+ * goes to the dashboard's port 21071.
+ *
+ * With --ip, each PCB binds that address plus a second "broadcast
+ * catcher" socket on the wildcard address, which only accepts datagrams
+ * sent to a broadcast address. Several instances can then share the
+ * real ports on loopback aliases (127.0.0.2, 127.0.0.3, ...).
+ */
+
+#define _GNU_SOURCE
+#include "emu.h"
+#include "pico/stdlib.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/timeouts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+//--------------------------------------------------------------------
+// Constants
+//--------------------------------------------------------------------
+
+#define EMU_MAX_PCBS            8
+#define EMU_MAX_TIMEOUTS        8
+#define EMU_MAX_DATAGRAM        1500
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+const ip_addr_t ip_addr_any = { 0 };
+const ip_addr_t ip_addr_broadcast = { 0xffffffffu };
+
+struct netif *netif_default = NULL;
+
+static struct udp_pcb *pcb_list = NULL;
+
+#if PICO_CYW43_ARCH_POLL
+// Poll build: replayed datagrams wait here for cyw43_arch_poll(), like
+// frames sitting in the radio until the main loop's network slot
+typedef struct emu_queued {
+    struct emu_queued *next;
+    uint32_t src_addr;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t len;
+    uint8_t data[];
+} emu_queued_t;
+
+static emu_queued_t *queue_head = NULL;
+static emu_queued_t *queue_tail = NULL;
+#endif
+
+typedef struct {
+    sys_timeout_handler handler;
+    void *arg;
+    alarm_id_t alarm;
+} emu_timeout_t;
+
+static emu_timeout_t timeouts[EMU_MAX_TIMEOUTS];
+
+//--------------------------------------------------------------------
+// Addresses
+//--------------------------------------------------------------------
+
+char *ip4addr_ntoa_r(const ip4_addr_t *addr, char *buf, int buflen)
+{
+    struct in_addr in = { .s_addr = addr->addr };
+    if (inet_ntop(AF_INET, &in, buf, (socklen_t)buflen) == NULL) {
+        return NULL;
+    }
+    return buf;
+}
+
+char *ip4addr_ntoa(const ip4_addr_t *addr)
+{
+    static char str[INET_ADDRSTRLEN];
+    return ip4addr_ntoa_r(addr, str, sizeof(str));
+}
+
+static bool is_broadcast(uint32_t addr)
+{
+    if (addr == 0xffffffffu) {
+        return true;
+    }
+    if (netif_default != NULL && netif_default->netmask.addr != 0xffffffffu) {
+        return addr == (netif_default->ip_addr.addr | ~netif_default->netmask.addr);
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------
+// Packet Buffers
+//--------------------------------------------------------------------
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    (void)layer;
+    (void)type;
+
+    // Header and payload in one block, like a PBUF_RAM
+    struct pbuf *p = malloc(sizeof(struct pbuf) + length);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    p->next = NULL;
+    p->payload = (uint8_t *)(p + 1);
+    p->tot_len = length;
+    p->len = length;
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    if (p == NULL) {
+        return 0;
+    }
+    free(p);
+    return 1;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset)
+{
+    if (p == NULL || offset >= p->len) {
+        return 0;
+    }
+    if (len > p->len - offset) {
+        len = p->len - offset;
+    }
+    memcpy(dataptr, (const uint8_t *)p->payload + offset, len);
+    return len;
+}
+
+err_t pbuf_take(struct pbuf *p, const void *dataptr, u16_t len)
+{
+    if (p == NULL || len > p->len) {
+        return ERR_ARG;
+    }
+    memcpy(p->payload, dataptr, len);
+    return ERR_OK;
+}
+
+//--------------------------------------------------------------------
+// Network Interface
+//--------------------------------------------------------------------
+
+void netif_set_link_callback(struct netif *netif, netif_status_callback_fn link_callback)
+{
+    netif->link_callback = link_callback;
+}
+
+void netif_set_status_callback(struct netif *netif, netif_status_callback_fn status_callback)
+{
+    netif->status_callback = status_callback;
+}
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw)
+{
+    netif->ip_addr = *ipaddr;
+    netif->netmask = *netmask;
+    netif->gw = *gw;
+}
+
+void netif_set_up(struct netif *netif)
+{
+    if (!netif->up) {
+        netif->up = true;
+        if (netif->status_callback) {
+            netif->status_callback(netif);
+        }
+    }
+}
+
+void netif_set_down(struct netif *netif)
+{
+    if (netif->up) {
+        netif->up = false;
+        if (netif->status_callback) {
+            netif->status_callback(netif);
+        }
+    }
+}
+
+void netif_set_link_up(struct netif *netif)
+{
+    if (!netif->link_up) {
+        netif->link_up = true;
+        if (netif->link_callback) {
+            netif->link_callback(netif);
+        }
+    }
+}
+
+void netif_set_link_down(struct netif *netif)
+{
+    if (netif->link_up) {
+        netif->link_up = false;
+        if (netif->link_callback) {
+            netif->link_callback(netif);
+        }
+    }
+}
+
+void netif_set_default(struct netif *netif)
+{
+    netif_default = netif;
+}
+
+//--------------------------------------------------------------------
+// Timeouts
+//--------------------------------------------------------------------
+
+static int64_t sys_timeout_alarm_cb(alarm_id_t id, void *user_data)
+{
+    emu_timeout_t *t = (emu_timeout_t *)user_data;
+    sys_timeout_handler handler = t->handler;
+    void *arg = t->arg;
+    (void)id;
+
+    // One-shot: free the slot first so the handler can re-arm itself
+    t->handler = NULL;
+    t->alarm = 0;
+    handler(arg);
+    return 0;
+}
+
+void sys_timeout(uint32_t msecs, sys_timeout_handler handler, void *arg)
+{
+    for (int i = 0; i < EMU_MAX_TIMEOUTS; i++) {
+        if (timeouts[i].handler == NULL) {
+            timeouts[i].handler = handler;
+            timeouts[i].arg = arg;
+            timeouts[i].alarm = add_alarm_in_ms(msecs, sys_timeout_alarm_cb, &timeouts[i], true);
+            if (timeouts[i].alarm <= 0) {
+                timeouts[i].handler = NULL;
+                printf("Emulator: No alarm slot for sys_timeout\n");
+            }
+            return;
+        }
+    }
+    printf("Emulator: sys_timeout table full\n");
+}
+
+void sys_untimeout(sys_timeout_handler handler, void *arg)
+{
+    for (int i = 0; i < EMU_MAX_TIMEOUTS; i++) {
+        if (timeouts[i].handler == handler && timeouts[i].arg == arg) {
+            cancel_alarm(timeouts[i].alarm);
+            timeouts[i].handler = NULL;
+            timeouts[i].alarm = 0;
+            return;     // lwIP removes the first match only
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// UDP
+//--------------------------------------------------------------------
+
+static int open_socket(uint32_t addr, u16_t port, bool reuse, bool pktinfo)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    if (reuse) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (pktinfo) {
+        setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &one, sizeof(one));
+    }
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = addr;
+    sa.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void close_sockets(struct udp_pcb *pcb)
+{
+    if (pcb->fd >= 0) {
+        close(pcb->fd);
+        pcb->fd = -1;
+    }
+    if (pcb->bcast_fd >= 0) {
+        close(pcb->bcast_fd);
+        pcb->bcast_fd = -1;
+    }
+}
+
+struct udp_pcb *udp_new(void)
+{
+    int count = 0;
+    for (struct udp_pcb *p = pcb_list; p != NULL; p = p->next) {
+        count++;
+    }
+    if (count >= EMU_MAX_PCBS) {
+        return NULL;    // MEMP_NUM_UDP_PCB exhausted
+    }
+
+    struct udp_pcb *pcb = calloc(1, sizeof(struct udp_pcb));
+    if (pcb == NULL) {
+        return NULL;
+    }
+
+    pcb->fd = -1;
+    pcb->bcast_fd = -1;
+    pcb->next = pcb_list;
+    pcb_list = pcb;
+    return pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    for (struct udp_pcb **pp = &pcb_list; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == pcb) {
+            *pp = pcb->next;
+            break;
+        }
+    }
+    close_sockets(pcb);
+    free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    close_sockets(pcb);
+
+    // Replay: packets come from the capture, never the host network
+    if (emu_config.replay_path != NULL) {
+        pcb->local_port = port;
+        return ERR_OK;
+    }
+
+    u16_t local_port = (u16_t)(port + emu_config.port_offset);
+    uint32_t addr = ipaddr != NULL ? ipaddr->addr : 0;
+
+    // A configured bridge address stands in for "any" (our only interface)
+    if (addr == 0 && emu_config.ip != 0) {
+        addr = emu_config.ip;
+    }
+
+    pcb->fd = open_socket(addr, local_port, addr != 0, false);
+    if (pcb->fd < 0) {
+        printf("Emulator: bind %s:%u failed: %s\n",
+               inet_ntoa((struct in_addr){ .s_addr = addr }), local_port, strerror(errno));
+        return ERR_USE;
+    }
+
+    if (addr != 0) {
+        pcb->bcast_fd = open_socket(0, local_port, true, true);
+        if (pcb->bcast_fd < 0) {
+            printf("Emulator: broadcast bind on port %u failed: %s\n",
+                   local_port, strerror(errno));
+        }
+    }
+
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    if (netif_default == NULL || !netif_is_up(netif_default)) {
+        return ERR_RTE;
+    }
+    if (is_broadcast(dst_ip->addr) && !(pcb->so_options & SOF_BROADCAST)) {
+        return ERR_VAL;
+    }
+
+    if (emu_config.replay_path != NULL) {
+        return ERR_OK;
+    }
+
+    // lwIP binds an unbound PCB to an ephemeral port on first send
+    if (pcb->fd < 0) {
+        pcb->fd = open_socket(emu_config.ip, 0, false, false);
+        if (pcb->fd < 0) {
+            return ERR_MEM;
+        }
+    }
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = dst_ip->addr;
+    sa.sin_port = htons(dst_port);
+
+    if (sendto(pcb->fd, p->payload, p->len, 0, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        return errno == ENOBUFS || errno == EAGAIN ? ERR_MEM : ERR_RTE;
+    }
+    return ERR_OK;
+}
+
+static bool pcb_exists(const struct udp_pcb *pcb)
+{
+    for (struct udp_pcb *p = pcb_list; p != NULL; p = p->next) {
+        if (p == pcb) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read one datagram and hand it to the PCB's receive callback
+static void dispatch_datagram(struct udp_pcb *pcb, int fd, bool broadcast_only)
+{
+    uint8_t buffer[EMU_MAX_DATAGRAM];
+    uint8_t control[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    struct sockaddr_in from;
+    struct iovec iov = { .iov_base = buffer, .iov_len = sizeof(buffer) };
+    struct msghdr msg = {
+        .msg_name = &from,
+        .msg_namelen = sizeof(from),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control)
+    };
+
+    ssize_t n = recvmsg(fd, &msg, 0);
+    if (n < 0) {
+        return;
+    }
+
+    if (broadcast_only) {
+        uint32_t dst = 0;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_PKTINFO) {
+                struct in_pktinfo info;
+                memcpy(&info, CMSG_DATA(c), sizeof(info));
+                dst = info.ipi_addr.s_addr;
+            }
+        }
+        if (!is_broadcast(dst)) {
+            return;     // Unicast for another instance on this host
+        }
+    }
+
+    if (pcb->recv == NULL) {
+        return;
+    }
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)n, PBUF_POOL);
+    if (p == NULL) {
+        return;
+    }
+    memcpy(p->payload, buffer, (size_t)n);
+
+    ip_addr_t addr;
+    addr.addr = from.sin_addr.s_addr;
+
+    // Callback owns the pbuf
+    pcb->recv(pcb->recv_arg, pcb, p, &addr, ntohs(from.sin_port));
+}
+
+// Hand a datagram to the PCB bound to dst_port
+static bool deliver(uint32_t src_addr, uint16_t src_port, uint16_t dst_port,
+                    const uint8_t *data, uint16_t len)
+{
+    for (struct udp_pcb *pcb = pcb_list; pcb != NULL; pcb = pcb->next) {
+        if (pcb->local_port != dst_port || pcb->recv == NULL) {
+            continue;
+        }
+
+        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_POOL);
+        if (p == NULL) {
+            return false;
+        }
+        memcpy(p->payload, data, len);
+
+        ip_addr_t addr;
+        addr.addr = src_addr;
+        pcb->recv(pcb->recv_arg, pcb, p, &addr, src_port);
+        return true;
+    }
+    return false;
+}
+
+// Collect the sockets of every PCB for ppoll()
+static int collect_fds(struct pollfd *fds, struct udp_pcb **owners)
+{
+    int count = 0;
+
+    for (struct udp_pcb *p = pcb_list; p != NULL && count < EMU_MAX_PCBS * 2 - 1; p = p->next) {
+        if (p->fd >= 0) {
+            fds[count].fd = p->fd;
+            fds[count].events = POLLIN;
+            owners[count++] = p;
+        }
+        if (p->bcast_fd >= 0) {
+            fds[count].fd = p->bcast_fd;
+            fds[count].events = POLLIN;
+            owners[count++] = p;
+        }
+    }
+    return count;
+}
+
+void emu_lwip_poll(uint64_t timeout_us)
+{
+    struct pollfd fds[EMU_MAX_PCBS * 2];
+    struct udp_pcb *owners[EMU_MAX_PCBS * 2];
+
+#if PICO_CYW43_ARCH_POLL
+    while (queue_head != NULL) {
+        emu_queued_t *q = queue_head;
+        queue_head = q->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        deliver(q->src_addr, q->src_port, q->dst_port, q->data, q->len);
+        free(q);
+    }
+    if (emu_config.replay_path != NULL) {
+        return;
+    }
+#endif
+
+    int count = collect_fds(fds, owners);
+    struct timespec ts = {
+        .tv_sec = (time_t)(timeout_us / 1000000),
+        .tv_nsec = (long)(timeout_us % 1000000) * 1000
+    };
+
+    if (ppoll(fds, (nfds_t)count, &ts, NULL) <= 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!(fds[i].revents & POLLIN)) {
+            continue;
+        }
+
+        // An earlier callback may have removed or rebound this PCB
+        struct udp_pcb *pcb = owners[i];
+        if (!pcb_exists(pcb)) {
+            continue;
+        }
+        if (fds[i].fd == pcb->fd) {
+            dispatch_datagram(pcb, pcb->fd, false);
+        } else if (fds[i].fd == pcb->bcast_fd) {
+            dispatch_datagram(pcb, pcb->bcast_fd, true);
+        }
+    }
+}
+
+bool emu_lwip_wait(uint64_t timeout_us)
+{
+    struct pollfd fds[EMU_MAX_PCBS * 2];
+    struct udp_pcb *owners[EMU_MAX_PCBS * 2];
+
+#if PICO_CYW43_ARCH_POLL
+    if (queue_head != NULL) {
+        return true;
+    }
+#endif
+    if (emu_config.replay_path != NULL) {
+        return false;
+    }
+
+    int count = collect_fds(fds, owners);
+    struct timespec ts = {
+        .tv_sec = (time_t)(timeout_us / 1000000),
+        .tv_nsec = (long)(timeout_us % 1000000) * 1000
+    };
+    return ppoll(fds, (nfds_t)count, &ts, NULL) > 0;
+}
+
+bool emu_lwip_listening(uint16_t port)
+{
+    for (struct udp_pcb *p = pcb_list; p != NULL; p = p->next) {
+        if (p->local_port == port && p->recv != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool emu_lwip_inject(uint32_t src_addr, uint16_t src_port, uint16_t dst_port,
+                     const uint8_t *data, uint16_t len)
+{
+#if PICO_CYW43_ARCH_POLL
+    if (!emu_lwip_listening(dst_port)) {
+        return false;
+    }
+
+    emu_queued_t *q = malloc(sizeof(*q) + len);
+    if (q == NULL) {
+        return false;
+    }
+    q->next = NULL;
+    q->src_addr = src_addr;
+    q->src_port = src_port;
+    q->dst_port = dst_port;
+    q->len = len;
+    memcpy(q->data, data, len);
+
+    if (queue_tail != NULL) {
+        queue_tail->next = q;
+    } else {
+        queue_head = q;
+    }
+    queue_tail = q;
+    return true;
+#else
+    return deliver(src_addr, src_port, dst_port, data, len);
+#endif
+}
+
+void emu_lwip_shutdown(void)
+{
+    while (pcb_list != NULL) {
+        udp_remove(pcb_list);
+    }
+}
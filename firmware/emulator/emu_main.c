@@ -0,0 +1,248 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Entry Point
+ *
+ * Runs the unmodified firmware (main.c is compiled with
+ * -Dmain=firmware_main) against the SDK stand-ins in this directory.
+ *
+ * Usage: rb3e_emulator [options]
+ *   --mac <aa:bb:cc:dd:ee:ff>  MAC reported in telemetry (default derived from --port-offset)
+ *   --port-offset <n>          Add n to the local ports 21070/21071
+ *   --ip <addr>                Bridge address (default: host address)
+ *   --netmask <mask>           Subnet mask for broadcasts (default: from host / 255.255.255.0)
+ *   --rssi <dBm>               Reported WiFi RSSI (default -55)
+ *   --roam-rssi <dBm>          Add a second access point at this RSSI
+ *   --ssid <name>              Pretend network name (default "emulator")
+ *   --usb-latency <us>         Virtual control transfer time (default 1000)
+ *   --no-stagekit              Boot with the Stage Kit unplugged
+ *   --show-kit                 Print the virtual Stage Kit state on change
+ *
+ * Capture replay (virtual clock, exits when done - see emu_replay.c):
+ *   --replay <capture>         pcap/pcapng of RB3E traffic to replay
+ *   --timeline <file>          Write the resulting Stage Kit timeline
+ *   --golden <file>            Compare against a stored timeline (exit 1 on divergence)
+ *   --tolerance <ms>           Allowed timing difference (default 20)
+ *   --tail <ms>                Keep running after the last packet (default 1000)
+ *
+ *   --trace <file>             Record trace events, write an RB3T dump on exit
+ *   --flash <file>             Keep the simulated flash (OTA staging) in this file
+ *   --link-trace <file>        Run the link-quality estimator on a synthetic trace and exit
+ */
+
+#include "emu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+
+int firmware_main(void);
+
+emu_config_t emu_config = {
+    .mac = { 0x28, 0xcd, 0xc1, 0xee, 0x00, 0x00 },
+    .port_offset = 0,
+    .ip = 0,
+    .netmask = 0,
+    .rssi = -55,
+    .roam_rssi = 0,
+    .stagekit = true,
+    .show_kit = false,
+    .usb_latency_us = 1000,
+    .ssid = "emulator",
+    .argv = NULL,
+    .replay_path = NULL,
+    .timeline_path = NULL,
+    .golden_path = NULL,
+    .tolerance_ms = 20,
+    .replay_tail_ms = 1000,
+    .trace_path = NULL,
+    .flash_path = NULL,
+    .link_trace_path = NULL
+};
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  --mac <aa:bb:cc:dd:ee:ff>  MAC reported in telemetry\n");
+    printf("  --port-offset <n>          Add n to the local ports %d/%d\n", 21070, 21071);
+    printf("  --ip <addr>                Bridge address (default: host address)\n");
+    printf("  --netmask <mask>           Subnet mask for broadcasts\n");
+    printf("  --rssi <dBm>               Reported WiFi RSSI (default %d)\n", (int)emu_config.rssi);
+    printf("  --roam-rssi <dBm>          Add a second access point at this RSSI\n");
+    printf("  --ssid <name>              Pretend network name (default \"%s\")\n", emu_config.ssid);
+    printf("  --usb-latency <us>         Virtual control transfer time (default %u)\n",
+           (unsigned)emu_config.usb_latency_us);
+    printf("  --no-stagekit              Boot with the Stage Kit unplugged\n");
+    printf("  --show-kit                 Print the virtual Stage Kit state on change\n");
+    printf("\nCapture replay (virtual clock, exits when done):\n");
+    printf("  --replay <capture>         pcap/pcapng of RB3E traffic to replay\n");
+    printf("  --timeline <file>          Write the resulting Stage Kit timeline\n");
+    printf("  --golden <file>            Compare against a stored timeline (exit 1 on divergence)\n");
+    printf("  --tolerance <ms>           Allowed timing difference (default %u)\n",
+           (unsigned)emu_config.tolerance_ms);
+    printf("  --tail <ms>                Keep running after the last packet (default %u)\n",
+           (unsigned)emu_config.replay_tail_ms);
+    printf("\n  --trace <file>             Record trace events, write an RB3T dump on exit\n");
+    printf("  --flash <file>             Keep the simulated flash (OTA staging) in this file\n");
+    printf("  --link-trace <file>        Run the link-quality estimator on a synthetic trace and exit\n");
+    printf("\nSIGUSR1 unplugs the Stage Kit, SIGUSR2 plugs it back in.\n");
+}
+
+static bool parse_mac(const char *str, uint8_t mac[6])
+{
+    unsigned int b[6];
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (b[i] > 0xff) {
+            return false;
+        }
+        mac[i] = (uint8_t)b[i];
+    }
+    return true;
+}
+
+static bool parse_addr(const char *str, uint32_t *addr)
+{
+    struct in_addr in;
+    if (inet_pton(AF_INET, str, &in) != 1) {
+        return false;
+    }
+    *addr = in.s_addr;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        { "mac",         required_argument, NULL, 'm' },
+        { "port-offset", required_argument, NULL, 'o' },
+        { "ip",          required_argument, NULL, 'i' },
+        { "netmask",     required_argument, NULL, 'n' },
+        { "rssi",        required_argument, NULL, 'r' },
+        { "roam-rssi",   required_argument, NULL, 'A' },
+        { "ssid",        required_argument, NULL, 's' },
+        { "usb-latency", required_argument, NULL, 'u' },
+        { "no-stagekit", no_argument,       NULL, 'N' },
+        { "show-kit",    no_argument,       NULL, 'k' },
+        { "replay",      required_argument, NULL, 'R' },
+        { "timeline",    required_argument, NULL, 'T' },
+        { "golden",      required_argument, NULL, 'G' },
+        { "tolerance",   required_argument, NULL, 't' },
+        { "tail",        required_argument, NULL, 'a' },
+        { "trace",       required_argument, NULL, 'x' },
+        { "flash",       required_argument, NULL, 'f' },
+        { "link-trace",  required_argument, NULL, 'L' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    bool mac_set = false;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'm':
+                if (!parse_mac(optarg, emu_config.mac)) {
+                    fprintf(stderr, "Invalid MAC: %s\n", optarg);
+                    return 1;
+                }
+                mac_set = true;
+                break;
+            case 'o': {
+                long offset = strtol(optarg, NULL, 0);
+                if (offset < 0 || offset > 65535 - 21071) {
+                    fprintf(stderr, "Invalid port offset: %s\n", optarg);
+                    return 1;
+                }
+                emu_config.port_offset = (uint16_t)offset;
+                break;
+            }
+            case 'i':
+                if (!parse_addr(optarg, &emu_config.ip)) {
+                    fprintf(stderr, "Invalid address: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                if (!parse_addr(optarg, &emu_config.netmask)) {
+                    fprintf(stderr, "Invalid netmask: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                emu_config.rssi = (int32_t)strtol(optarg, NULL, 0);
+                break;
+            case 'A':
+                emu_config.roam_rssi = (int32_t)strtol(optarg, NULL, 0);
+                break;
+            case 's':
+                emu_config.ssid = optarg;
+                break;
+            case 'u':
+                emu_config.usb_latency_us = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'N':
+                emu_config.stagekit = false;
+                break;
+            case 'k':
+                emu_config.show_kit = true;
+                break;
+            case 'R':
+                emu_config.replay_path = optarg;
+                break;
+            case 'T':
+                emu_config.timeline_path = optarg;
+                break;
+            case 'G':
+                emu_config.golden_path = optarg;
+                break;
+            case 't':
+                emu_config.tolerance_ms = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                emu_config.replay_tail_ms = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'x':
+                emu_config.trace_path = optarg;
+                break;
+            case 'f':
+                emu_config.flash_path = optarg;
+                break;
+            case 'L':
+                emu_config.link_trace_path = optarg;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    // Distinct default MAC per instance: 28:cd:c1:ee:<offset>
+    if (!mac_set) {
+        uint32_t id = emu_config.ip != 0 ? ntohl(emu_config.ip) : emu_config.port_offset;
+        emu_config.mac[4] = (uint8_t)(id >> 8);
+        emu_config.mac[5] = (uint8_t)id;
+    }
+
+    emu_config.argv = argv;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (emu_config.link_trace_path != NULL) {
+        return emu_link_trace_run(emu_config.link_trace_path);
+    }
+
+    if (emu_config.golden_path != NULL && emu_config.replay_path == NULL) {
+        fprintf(stderr, "--golden needs --replay\n");
+        return 2;
+    }
+    if (emu_config.replay_path != NULL && !emu_replay_load(emu_config.replay_path)) {
+        return 2;
+    }
+
+    emu_stagekit_set_plugged(emu_config.stagekit);
+    emu_trace_start();
+
+    return firmware_main();
+}
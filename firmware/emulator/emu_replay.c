@@ -0,0 +1,766 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Capture Replay
+ *
+ * Replays a packet capture (pcap or pcapng, e.g. from tcpdump/Wireshark)
+ * of RB3E traffic through the firmware on a virtual clock, records what
+ * the virtual Stage Kit shows, and optionally compares that timeline
+ * against a stored golden one.
+ *
+ * The clock only advances when the firmware sleeps, so a whole song
+ * replays in well under its real length and every run gives the same
+ * timeline. Captured packets keep their relative timing and source
+ * addresses (the source arbiter sees the original senders).
+ *
+ * Timeline file, one line per Stage Kit state change:
+ *   <time_ms> <blue> <green> <yellow> <red> <strobe> <fog>
+ * with the four banks in hex and time relative to the first packet.
+ */
+
+#include "emu.h"
+#include "pico/stdlib.h"
+#include "rb3e_protocol.h"
+#include "stagekit_state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Constants
+//--------------------------------------------------------------------
+
+#define REPLAY_LEAD_US          500000  // Listener up to first packet (kit enumerates)
+#define REPLAY_MAX_PAYLOAD      1472
+
+#define PCAP_MAGIC_US           0xa1b2c3d4u
+#define PCAP_MAGIC_NS           0xa1b23c4du
+#define PCAPNG_SHB              0x0a0d0d0au
+#define PCAPNG_IDB              0x00000001u
+#define PCAPNG_SPB              0x00000003u
+#define PCAPNG_EPB              0x00000006u
+
+#define LINKTYPE_NULL           0
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW            101
+#define LINKTYPE_LINUX_SLL      113
+#define LINKTYPE_IPV4           228
+#define LINKTYPE_LINUX_SLL2     276
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+typedef struct {
+    uint64_t time_us;           // Relative to the first packet
+    uint32_t src_addr;          // Network order
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t len;
+    uint8_t *data;
+} replay_packet_t;
+
+typedef struct {
+    uint64_t time_us;
+    stagekit_state_t state;
+} timeline_entry_t;
+
+typedef struct {
+    timeline_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} timeline_t;
+
+// Latency is matched per output field (four banks, strobe, fog): each
+// input that should change a field waits here until the kit shows it
+#define REPLAY_FIELDS           (SK_BANK_COUNT + 2)
+
+typedef struct {
+    uint64_t time_us;           // Injected at
+    uint32_t change_seq;        // Kit changes seen before injection
+    uint8_t value;
+} pending_t;
+
+typedef struct {
+    pending_t *entries;
+    size_t head;
+    size_t count;
+} pending_fifo_t;
+
+static replay_packet_t *packets = NULL;
+static size_t packet_count = 0;
+static size_t packet_capacity = 0;
+static size_t next_packet = 0;
+
+static bool started = false;
+static uint64_t base_us = 0;            // Virtual time of the first packet
+
+static timeline_t timeline;
+static stagekit_state_t kit_state;
+
+static pending_fifo_t pending[REPLAY_FIELDS];
+static uint32_t change_seq = 0;
+
+static uint64_t *latencies = NULL;
+static size_t latency_count = 0;
+
+static struct {
+    uint32_t stagekit;
+    uint32_t scenes;
+    uint32_t other;
+    uint32_t undelivered;
+    uint32_t coalesced;         // Overwritten by a newer input before any kit update
+    uint32_t dropped;           // Kit updated other fields but never showed it
+    uint32_t unsolicited;       // Kit changes no input asked for
+} stats;
+
+//--------------------------------------------------------------------
+// Capture Parsing
+//--------------------------------------------------------------------
+
+static uint32_t rd32(const uint8_t *p, bool swap)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t rd16(const uint8_t *p, bool swap)
+{
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return swap ? __builtin_bswap16(v) : v;
+}
+
+static uint16_t rd16_be(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Keep UDP/IPv4 datagrams to the bridge ports
+static void add_frame(uint32_t linktype, uint64_t time_ns, const uint8_t *frame, size_t len)
+{
+    size_t off;
+    uint16_t ethertype = 0x0800;
+
+    switch (linktype) {
+        case LINKTYPE_NULL:
+            off = 4;
+            break;
+        case LINKTYPE_ETHERNET:
+            if (len < 14) {
+                return;
+            }
+            ethertype = rd16_be(frame + 12);
+            off = 14;
+            if (ethertype == 0x8100 && len >= 18) {    // VLAN tag
+                ethertype = rd16_be(frame + 16);
+                off = 18;
+            }
+            break;
+        case LINKTYPE_RAW:
+        case LINKTYPE_IPV4:
+            off = 0;
+            break;
+        case LINKTYPE_LINUX_SLL:
+            if (len < 16) {
+                return;
+            }
+            ethertype = rd16_be(frame + 14);
+            off = 16;
+            break;
+        case LINKTYPE_LINUX_SLL2:
+            if (len < 20) {
+                return;
+            }
+            ethertype = rd16_be(frame);
+            off = 20;
+            break;
+        default:
+            return;
+    }
+
+    if (ethertype != 0x0800 || len < off + 20) {
+        return;
+    }
+
+    const uint8_t *ip = frame + off;
+    size_t ihl = (size_t)(ip[0] & 0x0f) * 4;
+    if ((ip[0] >> 4) != 4 || ip[9] != 17 || ihl < 20 || len < off + ihl + 8) {
+        return;
+    }
+    if ((rd16_be(ip + 6) & 0x3fff) != 0) {
+        return;     // Fragment - RB3E packets are far smaller than the MTU
+    }
+
+    const uint8_t *udp = ip + ihl;
+    uint16_t dst_port = rd16_be(udp + 2);
+    uint16_t udp_len = rd16_be(udp + 4);
+    if (dst_port != RB3E_LISTEN_PORT && dst_port != RB3E_TELEMETRY_PORT) {
+        return;
+    }
+    if (udp_len < 8 || off + ihl + udp_len > len || udp_len - 8 > REPLAY_MAX_PAYLOAD) {
+        return;
+    }
+
+    if (packet_count == packet_capacity) {
+        packet_capacity = packet_capacity ? packet_capacity * 2 : 1024;
+        packets = realloc(packets, packet_capacity * sizeof(replay_packet_t));
+    }
+
+    replay_packet_t *pkt = &packets[packet_count++];
+    pkt->time_us = time_ns / 1000;
+    memcpy(&pkt->src_addr, ip + 12, 4);
+    pkt->src_port = rd16_be(udp);
+    pkt->dst_port = dst_port;
+    pkt->len = (uint16_t)(udp_len - 8);
+    pkt->data = malloc(pkt->len ? pkt->len : 1);
+    memcpy(pkt->data, udp + 8, pkt->len);
+}
+
+static bool load_pcap(const uint8_t *buf, size_t size)
+{
+    uint32_t magic;
+    memcpy(&magic, buf, 4);
+
+    bool swap = (magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS));
+    bool nanos = (magic == PCAP_MAGIC_NS || magic == __builtin_bswap32(PCAP_MAGIC_NS));
+    if (size < 24) {
+        return false;
+    }
+
+    uint32_t linktype = rd32(buf + 20, swap) & 0x0fffffff;
+    size_t pos = 24;
+
+    while (pos + 16 <= size) {
+        uint64_t sec = rd32(buf + pos, swap);
+        uint64_t frac = rd32(buf + pos + 4, swap);
+        uint32_t caplen = rd32(buf + pos + 8, swap);
+        pos += 16;
+        if (pos + caplen > size) {
+            break;
+        }
+        add_frame(linktype, sec * 1000000000ull + (nanos ? frac : frac * 1000), buf + pos, caplen);
+        pos += caplen;
+    }
+    return true;
+}
+
+static bool load_pcapng(const uint8_t *buf, size_t size)
+{
+    uint32_t linktypes[16];
+    uint64_t tick_ns[16];
+    int interfaces = 0;
+    bool swap = false;
+    size_t pos = 0;
+
+    while (pos + 12 <= size) {
+        uint32_t type = rd32(buf + pos, swap);
+
+        if (type == PCAPNG_SHB) {
+            uint32_t bom;
+            memcpy(&bom, buf + pos + 8, 4);
+            swap = (bom != 0x1a2b3c4d);
+            interfaces = 0;     // Interface IDs restart per section
+        }
+
+        uint32_t block_len = rd32(buf + pos + 4, swap);
+        if (block_len < 12 || pos + block_len > size) {
+            break;
+        }
+        const uint8_t *body = buf + pos + 8;
+        size_t body_len = block_len - 12;
+
+        if (type == PCAPNG_IDB && body_len >= 8 && interfaces < 16) {
+            linktypes[interfaces] = rd16(body, swap);
+            tick_ns[interfaces] = 1000;     // Default if_tsresol = 6 (microseconds)
+
+            // Options: look for if_tsresol (code 9)
+            size_t opt = 8;
+            while (opt + 4 <= body_len) {
+                uint16_t code = rd16(body + opt, swap);
+                uint16_t olen = rd16(body + opt + 2, swap);
+                if (code == 0) {
+                    break;
+                }
+                if (code == 9 && olen >= 1 && opt + 4 < body_len) {
+                    uint8_t res = body[opt + 4];
+                    if (!(res & 0x80) && res <= 9) {
+                        uint64_t ns = 1;
+                        for (int i = res; i < 9; i++) {
+                            ns *= 10;
+                        }
+                        tick_ns[interfaces] = ns;
+                    }
+                }
+                opt += 4 + (size_t)((olen + 3) & ~3);
+            }
+            interfaces++;
+        } else if (type == PCAPNG_EPB && body_len >= 20) {
+            uint32_t ifid = rd32(body, swap);
+            uint64_t ts = ((uint64_t)rd32(body + 4, swap) << 32) | rd32(body + 8, swap);
+            uint32_t caplen = rd32(body + 12, swap);
+            if ((int)ifid < interfaces && 20 + caplen <= body_len) {
+                add_frame(linktypes[ifid], ts * tick_ns[ifid], body + 20, caplen);
+            }
+        } else if (type == PCAPNG_SPB && body_len >= 4 && interfaces > 0) {
+            // No timestamp - only usable if the capture has nothing else
+            uint32_t len = rd32(body, swap);
+            if (4 + len <= body_len) {
+                add_frame(linktypes[0], 0, body + 4, len);
+            }
+        }
+
+        pos += block_len;
+    }
+    return true;
+}
+
+static int compare_packet_time(const void *a, const void *b)
+{
+    const replay_packet_t *pa = a;
+    const replay_packet_t *pb = b;
+    if (pa->time_us != pb->time_us) {
+        return pa->time_us < pb->time_us ? -1 : 1;
+    }
+    return pa < pb ? -1 : 1;
+}
+
+//--------------------------------------------------------------------
+// Timelines
+//--------------------------------------------------------------------
+
+static void timeline_add(timeline_t *tl, uint64_t time_us, const stagekit_state_t *state)
+{
+    if (tl->count == tl->capacity) {
+        tl->capacity = tl->capacity ? tl->capacity * 2 : 1024;
+        tl->entries = realloc(tl->entries, tl->capacity * sizeof(timeline_entry_t));
+    }
+    tl->entries[tl->count].time_us = time_us;
+    tl->entries[tl->count].state = *state;
+    tl->count++;
+}
+
+static bool timeline_write(const timeline_t *tl, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "# RB3E Stage Kit timeline: time_ms blue green yellow red strobe fog\n");
+    for (size_t i = 0; i < tl->count; i++) {
+        const timeline_entry_t *e = &tl->entries[i];
+        fprintf(f, "%llu.%03u %02x %02x %02x %02x %u %u\n",
+                (unsigned long long)(e->time_us / 1000), (unsigned)(e->time_us % 1000),
+                e->state.banks[SK_BANK_BLUE], e->state.banks[SK_BANK_GREEN],
+                e->state.banks[SK_BANK_YELLOW], e->state.banks[SK_BANK_RED],
+                e->state.strobe, e->state.fog);
+    }
+
+    fclose(f);
+    return true;
+}
+
+static bool timeline_read(timeline_t *tl, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[128];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        double ms;
+        unsigned int b, g, y, r, strobe, fog;
+        if (sscanf(line, "%lf %x %x %x %x %u %u", &ms, &b, &g, &y, &r, &strobe, &fog) != 7) {
+            fprintf(stderr, "%s:%d: malformed timeline entry\n", path, line_no);
+            fclose(f);
+            return false;
+        }
+
+        stagekit_state_t s = {
+            .banks = { (uint8_t)b, (uint8_t)g, (uint8_t)y, (uint8_t)r },
+            .strobe = (uint8_t)strobe,
+            .fog = (uint8_t)fog
+        };
+        timeline_add(tl, (uint64_t)(ms * 1000.0 + 0.5), &s);
+    }
+
+    fclose(f);
+    return true;
+}
+
+static void format_state(char *buf, size_t len, const stagekit_state_t *s)
+{
+    snprintf(buf, len, "B=%02x G=%02x Y=%02x R=%02x strobe=%u fog=%u",
+             s->banks[SK_BANK_BLUE], s->banks[SK_BANK_GREEN],
+             s->banks[SK_BANK_YELLOW], s->banks[SK_BANK_RED], s->strobe, s->fog);
+}
+
+// Walk both timelines as step functions (all off before the first
+// entry) and report every span where they differ for longer than the
+// tolerance. Returns the number of such divergences.
+static int timeline_compare(const timeline_t *golden, const timeline_t *actual, uint64_t tolerance_us)
+{
+    static const stagekit_state_t off = { { 0 }, 0, 0 };
+    const stagekit_state_t *g = &off;
+    const stagekit_state_t *a = &off;
+    size_t gi = 0, ai = 0;
+    int divergences = 0;
+    uint64_t diverged_us = 0;
+
+    bool differing = false;
+    uint64_t span_start = 0;
+    stagekit_state_t span_golden, span_actual;
+
+    while (gi < golden->count || ai < actual->count) {
+        uint64_t tg = gi < golden->count ? golden->entries[gi].time_us : UINT64_MAX;
+        uint64_t ta = ai < actual->count ? actual->entries[ai].time_us : UINT64_MAX;
+        uint64_t t = tg < ta ? tg : ta;
+
+        while (gi < golden->count && golden->entries[gi].time_us == t) {
+            g = &golden->entries[gi++].state;
+        }
+        while (ai < actual->count && actual->entries[ai].time_us == t) {
+            a = &actual->entries[ai++].state;
+        }
+
+        bool differ = !stagekit_state_equal(g, a);
+        if (differ && !differing) {
+            differing = true;
+            span_start = t;
+            span_golden = *g;
+            span_actual = *a;
+        } else if (!differ && differing) {
+            differing = false;
+            uint64_t span = t - span_start;
+            if (span > tolerance_us) {
+                char gs[64], as[64];
+                format_state(gs, sizeof(gs), &span_golden);
+                format_state(as, sizeof(as), &span_actual);
+                printf("  %10.3f ms for %8.3f ms: expected %s, got %s\n",
+                       span_start / 1000.0, span / 1000.0, gs, as);
+                divergences++;
+                diverged_us += span;
+            }
+        }
+    }
+
+    if (differing) {
+        char gs[64], as[64];
+        format_state(gs, sizeof(gs), &span_golden);
+        format_state(as, sizeof(as), &span_actual);
+        printf("  %10.3f ms to the end: expected %s, got %s\n", span_start / 1000.0, gs, as);
+        divergences++;
+    }
+
+    if (divergences > 0) {
+        printf("  %d divergence(s), %.3f ms total\n", divergences, diverged_us / 1000.0);
+    }
+    return divergences;
+}
+
+//--------------------------------------------------------------------
+// Latency
+//--------------------------------------------------------------------
+
+static uint8_t field_value(const stagekit_state_t *s, int field)
+{
+    if (field < SK_BANK_COUNT) {
+        return s->banks[field];
+    }
+    return field == SK_BANK_COUNT ? s->strobe : s->fog;
+}
+
+// Queue the fields an input sets. A repeat of a value that is still
+// pending is queued again, so latency is measured from the newest request.
+static void expect_fields(uint64_t time_us, const stagekit_state_t *set, const bool touched[REPLAY_FIELDS])
+{
+    for (int f = 0; f < REPLAY_FIELDS; f++) {
+        pending_fifo_t *q = &pending[f];
+        uint8_t value = field_value(set, f);
+
+        if (!touched[f] || (q->count == 0 && value == field_value(&kit_state, f))) {
+            continue;   // No visible change - nothing to wait for
+        }
+
+        q->entries[q->head + q->count].time_us = time_us;
+        q->entries[q->head + q->count].change_seq = change_seq;
+        q->entries[q->head + q->count].value = value;
+        q->count++;
+    }
+}
+
+// Queue the visible effect of one input packet
+static void model_input(uint64_t time_us, const replay_packet_t *pkt)
+{
+    uint8_t left, right;
+    stagekit_state_t set;
+    bool touched[REPLAY_FIELDS];
+
+    if (pkt->dst_port != RB3E_LISTEN_PORT) {
+        stats.other++;
+        return;
+    }
+
+    if (rb3e_parse_stagekit(pkt->data, pkt->len, &left, &right)) {
+        stats.stagekit++;
+
+        // Fields the command sets come out equal from two different bases
+        stagekit_state_t a = { { 0 }, 0, 0 };
+        stagekit_state_t b = { { 0xff, 0xff, 0xff, 0xff }, 4, 1 };
+        stagekit_state_apply(&a, left, right);
+        stagekit_state_apply(&b, left, right);
+        for (int f = 0; f < REPLAY_FIELDS; f++) {
+            touched[f] = (field_value(&a, f) == field_value(&b, f));
+        }
+        set = a;
+    } else if (rb3e_parse_scene(pkt->data, pkt->len, &set)) {
+        stats.scenes++;
+        for (int f = 0; f < REPLAY_FIELDS; f++) {
+            touched[f] = true;
+        }
+    } else {
+        stats.other++;
+        return;
+    }
+
+    expect_fields(time_us, &set, touched);
+}
+
+// Match a kit change against the newest input that asked for it (an
+// older input with the same value was superseded in between)
+static bool match_field(int field, uint8_t value, uint64_t time_us)
+{
+    pending_fifo_t *q = &pending[field];
+
+    for (size_t i = q->count; i-- > 0; ) {
+        const pending_t *match = &q->entries[q->head + i];
+        if (match->value != value) {
+            continue;
+        }
+
+        latencies[latency_count++] = time_us - match->time_us;
+
+        // Older inputs for this field were never shown
+        for (size_t k = 0; k < i; k++) {
+            if (match->change_seq > q->entries[q->head + k].change_seq) {
+                stats.dropped++;
+            } else {
+                stats.coalesced++;
+            }
+        }
+
+        q->head += i + 1;
+        q->count -= i + 1;
+        return true;
+    }
+    return false;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_ms(double p)
+{
+    size_t i = (size_t)(p * (double)(latency_count - 1) + 0.5);
+    return latencies[i] / 1000.0;
+}
+
+static void print_latency(void)
+{
+    printf("Latency (input to kit): %zu changes", latency_count);
+    if (latency_count > 0) {
+        qsort(latencies, latency_count, sizeof(uint64_t), compare_u64);
+        printf(", p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+               percentile_ms(0.50), percentile_ms(0.90), percentile_ms(0.99),
+               latencies[latency_count - 1] / 1000.0);
+    }
+    printf("\n");
+    size_t never_shown = 0;
+    for (int f = 0; f < REPLAY_FIELDS; f++) {
+        never_shown += pending[f].count;
+    }
+    printf("  %u coalesced, %u dropped, %zu still pending at the end, %u not from input\n",
+           stats.coalesced, stats.dropped, never_shown, stats.unsolicited);
+
+    // Log2 buckets from 0.25 ms, like rb3e_probe's histogram
+    if (latency_count > 0) {
+        uint64_t edge_us = 250;
+        size_t i = 0;
+        while (i < latency_count) {
+            size_t n = 0;
+            while (i < latency_count && latencies[i] < edge_us) {
+                n++;
+                i++;
+            }
+            if (n > 0) {
+                printf("  < %8.2f ms %8zu\n", edge_us / 1000.0, n);
+            }
+            edge_us *= 2;
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Emulator API
+//--------------------------------------------------------------------
+
+bool emu_replay_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = malloc(size > 0 ? (size_t)size : 1);
+    if (size < 4 || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: unreadable capture\n", path);
+        fclose(f);
+        free(buf);
+        return false;
+    }
+    fclose(f);
+
+    uint32_t magic;
+    memcpy(&magic, buf, 4);
+
+    bool ok;
+    if (magic == PCAPNG_SHB) {
+        ok = load_pcapng(buf, (size_t)size);
+    } else if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+               magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+        ok = load_pcap(buf, (size_t)size);
+    } else {
+        fprintf(stderr, "%s: not a pcap or pcapng capture\n", path);
+        ok = false;
+    }
+    free(buf);
+
+    if (!ok) {
+        return false;
+    }
+    if (packet_count == 0) {
+        fprintf(stderr, "%s: no RB3E packets (UDP to %d/%d)\n", path,
+                RB3E_LISTEN_PORT, RB3E_TELEMETRY_PORT);
+        return false;
+    }
+
+    // Captures from several interfaces can interleave out of order
+    qsort(packets, packet_count, sizeof(replay_packet_t), compare_packet_time);
+    uint64_t first = packets[0].time_us;
+    for (size_t i = 0; i < packet_count; i++) {
+        packets[i].time_us -= first;
+    }
+
+    // A scene can queue one entry per field
+    for (int f = 0; f < REPLAY_FIELDS; f++) {
+        pending[f].entries = malloc(packet_count * sizeof(pending_t));
+    }
+    latencies = malloc(packet_count * REPLAY_FIELDS * sizeof(uint64_t));
+
+    printf("Replay: %zu packets over %.3f s from %s\n", packet_count,
+           packets[packet_count - 1].time_us / 1e6, path);
+    return true;
+}
+
+uint64_t emu_replay_step(uint64_t horizon_us)
+{
+    uint64_t now = time_us_64();
+
+    // Start once the firmware listens on the StageKit port
+    if (!started) {
+        if (!emu_lwip_listening(RB3E_LISTEN_PORT)) {
+            return horizon_us;
+        }
+        started = true;
+        base_us = now + REPLAY_LEAD_US;
+        printf("Emulator: Replay starts at %llu ms\n", (unsigned long long)(base_us / 1000));
+    }
+
+    while (next_packet < packet_count && base_us + packets[next_packet].time_us <= now) {
+        const replay_packet_t *pkt = &packets[next_packet++];
+        model_input(now - base_us, pkt);
+        if (!emu_lwip_inject(pkt->src_addr, pkt->src_port, pkt->dst_port, pkt->data, pkt->len)) {
+            stats.undelivered++;
+        }
+    }
+
+    uint64_t end_us = base_us + packets[packet_count - 1].time_us +
+                      (uint64_t)emu_config.replay_tail_ms * 1000;
+    if (next_packet == packet_count && now >= end_us) {
+        exit(emu_replay_finish());
+    }
+
+    uint64_t next = next_packet < packet_count ? base_us + packets[next_packet].time_us : end_us;
+    return next < horizon_us ? next : horizon_us;
+}
+
+void emu_replay_kit_changed(const stagekit_state_t *state)
+{
+    stagekit_state_t before = kit_state;
+    kit_state = *state;
+    if (!started) {
+        return;
+    }
+
+    uint64_t t = time_us_64();
+    uint64_t rel = t > base_us ? t - base_us : 0;
+    timeline_add(&timeline, rel, state);
+
+    bool solicited = false;
+    for (int f = 0; f < REPLAY_FIELDS; f++) {
+        uint8_t value = field_value(state, f);
+        if (value != field_value(&before, f) && match_field(f, value, rel)) {
+            solicited = true;
+        }
+    }
+    if (!solicited) {
+        stats.unsolicited++;
+    }
+    change_seq++;
+}
+
+int emu_replay_finish(void)
+{
+    printf("\n");
+    printf("Replay finished: %zu packets (%u StageKit, %u scenes, %u other, %u undelivered)\n",
+           packet_count, stats.stagekit, stats.scenes, stats.other, stats.undelivered);
+    printf("Timeline: %zu state changes over %.3f s\n", timeline.count,
+           (time_us_64() - base_us) / 1e6);
+    print_latency();
+
+    if (emu_config.timeline_path != NULL && !timeline_write(&timeline, emu_config.timeline_path)) {
+        return 2;
+    }
+
+    if (emu_config.golden_path == NULL) {
+        return 0;
+    }
+
+    timeline_t golden = { 0 };
+    if (!timeline_read(&golden, emu_config.golden_path)) {
+        return 2;
+    }
+
+    printf("Golden: %zu state changes, tolerance %u ms\n", golden.count, emu_config.tolerance_ms);
+    int divergences = timeline_compare(&golden, &timeline, (uint64_t)emu_config.tolerance_ms * 1000);
+    printf("Result: %s\n", divergences == 0 ? "PASS" : "FAIL");
+    return divergences == 0 ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Virtual Stage Kit
+ *
+ * A TinyUSB host stand-in with one Santroller Stage Kit on the root
+ * port. Control transfers complete asynchronously on a later tuh_task()
+ * call, like the real host stack, and SET_REPORTs drive a shadow state
+ * that can be printed as it changes (--show-kit).
+ *
+ * SIGUSR1 unplugs the kit, SIGUSR2 plugs it back in.
+ */
+
+#include "emu.h"
+#include "tusb.h"
+#include "host/hcd.h"
+#include "pico/stdlib.h"
+#include "usb_host.h"
+#include "stagekit_state.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+//--------------------------------------------------------------------
+// Constants
+//--------------------------------------------------------------------
+
+#define EMU_STAGEKIT_ADDR       1
+#define EMU_ENUMERATE_US        200000  // Attach to tuh_mount_cb()
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+static bool host_inited = false;
+static bool plugged = false;
+static bool mounted = false;
+static bool mount_pending = false;
+static uint64_t mount_time_us = 0;
+
+static volatile sig_atomic_t plug_request = -1;     // From signal handlers
+
+// One control transfer in flight (EP0 is not pipelined)
+static bool xfer_pending = false;
+static uint64_t xfer_done_us = 0;
+static tuh_xfer_t xfer;
+static tusb_control_request_t xfer_setup;
+static uint8_t xfer_data[8];
+
+static stagekit_state_t kit_state;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+static void on_sigusr(int sig)
+{
+    plug_request = (sig == SIGUSR2);
+}
+
+static void schedule_mount(void)
+{
+    if (plugged && host_inited && !mounted) {
+        mount_pending = true;
+        mount_time_us = time_us_64() + EMU_ENUMERATE_US;
+    }
+}
+
+static void unmount(void)
+{
+    mount_pending = false;
+    xfer_pending = false;
+
+    if (mounted) {
+        mounted = false;
+        memset(&kit_state, 0, sizeof(kit_state));
+        if (emu_config.replay_path != NULL) {
+            emu_replay_kit_changed(&kit_state);
+        }
+        tuh_umount_cb(EMU_STAGEKIT_ADDR);
+    }
+}
+
+static void print_kit_state(void)
+{
+    printf("StageKit: B=%02x G=%02x Y=%02x R=%02x strobe=%u fog=%u\n",
+           kit_state.banks[SK_BANK_BLUE], kit_state.banks[SK_BANK_GREEN],
+           kit_state.banks[SK_BANK_YELLOW], kit_state.banks[SK_BANK_RED],
+           kit_state.strobe, kit_state.fog);
+}
+
+// What the Santroller firmware does with the request
+static xfer_result_t device_handle_control(const tusb_control_request_t *setup, const uint8_t *data)
+{
+    if (setup->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+        setup->bRequest == SK_HID_SET_REPORT) {
+        if (setup->wLength < 4 || data == NULL || data[1] != 0x5A) {
+            return XFER_RESULT_STALLED;
+        }
+
+        stagekit_state_t before = kit_state;
+        stagekit_state_apply(&kit_state, data[2], data[3]);
+
+        if (!stagekit_state_equal(&before, &kit_state)) {
+            if (emu_config.show_kit) {
+                print_kit_state();
+            }
+            if (emu_config.replay_path != NULL) {
+                emu_replay_kit_changed(&kit_state);
+            }
+        }
+        return XFER_RESULT_SUCCESS;
+    }
+
+    if (setup->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD &&
+        setup->bRequest == TUSB_REQ_CLEAR_FEATURE) {
+        return XFER_RESULT_SUCCESS;
+    }
+
+    return XFER_RESULT_STALLED;
+}
+
+//--------------------------------------------------------------------
+// Emulator API
+//--------------------------------------------------------------------
+
+void emu_stagekit_set_plugged(bool plug)
+{
+    static bool handlers_installed = false;
+    if (!handlers_installed) {
+        signal(SIGUSR1, on_sigusr);
+        signal(SIGUSR2, on_sigusr);
+        handlers_installed = true;
+    }
+
+    if (plug == plugged) {
+        return;
+    }
+
+    plugged = plug;
+    printf("Emulator: Stage Kit %s\n", plug ? "plugged in" : "unplugged");
+
+    if (plug) {
+        schedule_mount();
+    } else {
+        unmount();
+    }
+}
+
+//--------------------------------------------------------------------
+// TinyUSB Host API
+//--------------------------------------------------------------------
+
+bool tusb_init(void)
+{
+    return tuh_init(0);
+}
+
+bool tuh_init(uint8_t rhport)
+{
+    (void)rhport;
+    host_inited = true;
+    schedule_mount();
+    return true;
+}
+
+bool tuh_deinit(uint8_t rhport)
+{
+    (void)rhport;
+    unmount();
+    host_inited = false;
+    return true;
+}
+
+bool tuh_inited(void)
+{
+    return host_inited;
+}
+
+void tuh_task(void)
+{
+    if (plug_request >= 0) {
+        bool plug = plug_request != 0;
+        plug_request = -1;
+        emu_stagekit_set_plugged(plug);
+    }
+
+    if (!host_inited) {
+        return;
+    }
+
+    uint64_t now = time_us_64();
+
+    if (mount_pending && now >= mount_time_us) {
+        mount_pending = false;
+        mounted = true;
+        tuh_mount_cb(EMU_STAGEKIT_ADDR);
+    }
+
+    if (xfer_pending && now >= xfer_done_us) {
+        xfer_pending = false;
+        xfer.result = device_handle_control(&xfer_setup, xfer.buffer != NULL ? xfer_data : NULL);
+        xfer.actual_len = xfer.result == XFER_RESULT_SUCCESS ? xfer_setup.wLength : 0;
+
+        if (xfer.complete_cb) {
+            tuh_xfer_t done = xfer;
+            done.setup = &xfer_setup;
+            xfer.complete_cb(&done);
+        }
+    }
+}
+
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t *vid, uint16_t *pid)
+{
+    if (!mounted || daddr != EMU_STAGEKIT_ADDR) {
+        return false;
+    }
+    *vid = SANTROLLER_VID;
+    *pid = SANTROLLER_PID;
+    return true;
+}
+
+uint8_t tuh_descriptor_get_device_sync(uint8_t daddr, void *buffer, uint16_t len)
+{
+    if (!mounted || daddr != EMU_STAGEKIT_ADDR) {
+        return XFER_RESULT_FAILED;
+    }
+
+    tusb_desc_device_t desc = {
+        .bLength = sizeof(tusb_desc_device_t),
+        .bDescriptorType = 0x01,
+        .bcdUSB = 0x0200,
+        .bMaxPacketSize0 = 64,
+        .idVendor = SANTROLLER_VID,
+        .idProduct = SANTROLLER_PID,
+        .bcdDevice = SANTROLLER_STAGEKIT_BCD,
+        .bNumConfigurations = 1
+    };
+
+    memcpy(buffer, &desc, len < sizeof(desc) ? len : sizeof(desc));
+    return XFER_RESULT_SUCCESS;
+}
+
+bool tuh_control_xfer(tuh_xfer_t *x)
+{
+    if (!mounted || x->daddr != EMU_STAGEKIT_ADDR || xfer_pending) {
+        return false;
+    }
+
+    // Copy everything - the caller's xfer struct is on its stack
+    xfer = *x;
+    xfer_setup = *x->setup;
+    memset(xfer_data, 0, sizeof(xfer_data));
+    if (x->buffer != NULL) {
+        uint16_t len = xfer_setup.wLength < sizeof(xfer_data) ? xfer_setup.wLength : sizeof(xfer_data);
+        memcpy(xfer_data, x->buffer, len);
+    }
+
+    xfer_pending = true;
+    xfer_done_us = time_us_64() + emu_config.usb_latency_us;
+    return true;
+}
+
+bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr)
+{
+    (void)ep_addr;
+    if (daddr == EMU_STAGEKIT_ADDR) {
+        xfer_pending = false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------
+// HCD Events (port reset)
+//--------------------------------------------------------------------
+
+void hcd_event_device_remove(uint8_t rhport, bool in_isr)
+{
+    (void)rhport;
+    (void)in_isr;
+    unmount();
+}
+
+void hcd_event_device_attach(uint8_t rhport, bool in_isr)
+{
+    (void)rhport;
+    (void)in_isr;
+    schedule_mount();
+}
@@ -0,0 +1,109 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Storage Stand-ins
+ *
+ * LittleFS is not emulated (the simulated flash in emu_flash.c only
+ * serves OTA): the filesystem always "mounts" and the WiFi settings
+ * come from the command line, so boot never falls into AP setup mode.
+ */
+
+#include "emu.h"
+#include "littlefs_hal.h"
+#include "config_parser.h"
+#include "ap_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// LittleFS HAL
+//--------------------------------------------------------------------
+
+lfs_t* littlefs_init(void)
+{
+    return NULL;
+}
+
+int littlefs_mount(void)
+{
+    return 0;
+}
+
+int littlefs_format_and_mount(void)
+{
+    return 0;
+}
+
+void littlefs_unmount(void)
+{
+}
+
+lfs_t* littlefs_get(void)
+{
+    return NULL;
+}
+
+int littlefs_is_mounted(void)
+{
+    return 1;
+}
+
+uint32_t littlefs_get_flash_size(void)
+{
+    return EMU_FLASH_SIZE;
+}
+
+uint32_t littlefs_get_fs_offset(void)
+{
+    return EMU_FLASH_SIZE - LFS_PLAN_IMPORT_SIZE(EMU_FLASH_SIZE) - LFS_PLAN_SIZE(EMU_FLASH_SIZE);
+}
+
+uint32_t littlefs_get_fs_size(void)
+{
+    return LFS_PLAN_SIZE(EMU_FLASH_SIZE);
+}
+
+void littlefs_get_info(ctrl_fs_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->mounted = 1;
+    out->offset = littlefs_get_fs_offset();
+    out->size = littlefs_get_fs_size();
+    if (LFS_PLAN_IMPORT_SIZE(EMU_FLASH_SIZE)) {
+        out->import_offset = EMU_FLASH_SIZE - LFS_PLAN_IMPORT_SIZE(EMU_FLASH_SIZE);
+        out->import_size = LFS_PLAN_IMPORT_SIZE(EMU_FLASH_SIZE);
+    }
+}
+
+//--------------------------------------------------------------------
+// Config Parser
+//--------------------------------------------------------------------
+
+int config_file_exists(void)
+{
+    return 1;
+}
+
+int config_load_wifi(wifi_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    snprintf(config->ssid, sizeof(config->ssid), "%s", emu_config.ssid);
+    snprintf(config->password, sizeof(config->password), "emulator");
+    config->valid = 1;
+    return 0;
+}
+
+int config_create_default(void)
+{
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// AP Setup Mode
+//--------------------------------------------------------------------
+
+void run_ap_setup_mode(void)
+{
+    // Unreachable - config_load_wifi() always succeeds
+    printf("Emulator: AP setup mode is not emulated\n");
+    exit(1);
+}
@@ -0,0 +1,357 @@
+/*
+ * RB3E StageKit Bridge - Linux Emulator Time, Alarms and Watchdog
+ *
+ * The firmware runs on one host thread. Anything that is an interrupt
+ * on the Pico (alarms, repeating timers, lwIP receive callbacks) runs
+ * from inside sleep_us()/sleep_ms(), which the main loop calls every
+ * iteration, so the "interrupt" ordering seen by the firmware matches
+ * hardware closely enough for protocol and recovery testing.
+ *
+ * The poll build (rb3e_emulator_poll, PICO_CYW43_ARCH_POLL) keeps
+ * datagrams out of sleeps: they reach lwIP only in cyw43_arch_poll(),
+ * and cyw43_arch_wait_for_work_until() wakes early when one is waiting.
+ * lwIP timeouts stay alarms in both builds.
+ */
+
+#include "emu.h"
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//--------------------------------------------------------------------
+// Constants
+//--------------------------------------------------------------------
+
+#define EMU_MAX_ALARMS          16
+#define EMU_WATCHDOG_ENV        "RB3E_EMU_WATCHDOG_REBOOT"
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+typedef struct {
+    alarm_id_t id;              // 0 = free slot
+    uint64_t target_us;
+    alarm_callback_t callback;
+    void *user_data;
+} emu_alarm_t;
+
+static uint64_t boot_ns = 0;
+static uint64_t virtual_us = 0;        // Replay clock (only moves in sleeps)
+static emu_alarm_t alarms[EMU_MAX_ALARMS];
+static alarm_id_t next_alarm_id = 1;
+static bool in_service = false;
+
+static bool watchdog_enabled = false;
+static uint32_t watchdog_timeout_ms = 0;
+static uint64_t watchdog_deadline_us = 0;
+static int watchdog_rebooted = -1;     // -1 = not read from the environment yet
+
+//--------------------------------------------------------------------
+// Time
+//--------------------------------------------------------------------
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t time_us_64(void)
+{
+    if (emu_config.replay_path != NULL) {
+        return virtual_us;
+    }
+    if (boot_ns == 0) {
+        boot_ns = monotonic_ns();
+    }
+    return (monotonic_ns() - boot_ns) / 1000;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+void sleep_until(absolute_time_t t)
+{
+    emu_service(t);
+}
+
+void sleep_us(uint64_t us)
+{
+    emu_service(time_us_64() + us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    emu_service(time_us_64() + (uint64_t)ms * 1000);
+}
+
+//--------------------------------------------------------------------
+// Alarms
+//--------------------------------------------------------------------
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    if (time <= time_us_64() && !fire_if_past) {
+        return 0;
+    }
+
+    for (int i = 0; i < EMU_MAX_ALARMS; i++) {
+        if (alarms[i].id == 0) {
+            alarms[i].id = next_alarm_id++;
+            if (next_alarm_id <= 0) {
+                next_alarm_id = 1;
+            }
+            alarms[i].target_us = time;
+            alarms[i].callback = callback;
+            alarms[i].user_data = user_data;
+            return alarms[i].id;
+        }
+    }
+
+    return -1;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    for (int i = 0; i < EMU_MAX_ALARMS; i++) {
+        if (alarm_id > 0 && alarms[i].id == alarm_id) {
+            alarms[i].id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fire every due alarm once; returns the earliest remaining target
+static uint64_t run_alarms(uint64_t horizon_us)
+{
+    uint64_t now = time_us_64();
+
+    for (int i = 0; i < EMU_MAX_ALARMS; i++) {
+        if (alarms[i].id == 0 || alarms[i].target_us > now) {
+            continue;
+        }
+
+        alarm_id_t id = alarms[i].id;
+        uint64_t target = alarms[i].target_us;
+        int64_t ret = alarms[i].callback(id, alarms[i].user_data);
+
+        // The callback may have cancelled itself or reused the slot
+        if (alarms[i].id != id) {
+            continue;
+        }
+
+        if (ret < 0) {
+            alarms[i].target_us = target + (uint64_t)(-ret);    // From the scheduled time
+        } else if (ret > 0) {
+            alarms[i].target_us = time_us_64() + (uint64_t)ret; // From now
+        } else {
+            alarms[i].id = 0;
+        }
+    }
+
+    uint64_t next = horizon_us;
+    for (int i = 0; i < EMU_MAX_ALARMS; i++) {
+        if (alarms[i].id != 0 && alarms[i].target_us < next) {
+            next = alarms[i].target_us;
+        }
+    }
+    return next;
+}
+
+//--------------------------------------------------------------------
+// Repeating Timers
+//--------------------------------------------------------------------
+
+static int64_t repeating_timer_cb(alarm_id_t id, void *user_data)
+{
+    repeating_timer_t *rt = (repeating_timer_t *)user_data;
+    (void)id;
+
+    if (!rt->callback(rt)) {
+        rt->alarm_id = 0;
+        return 0;
+    }
+
+    // Negative delay = start-to-start, positive = end-to-start (as the SDK)
+    return rt->delay_us;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out)
+{
+    if (delay_us == 0) {
+        delay_us = 1;
+    }
+
+    out->delay_us = delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+
+    uint64_t first = delay_us < 0 ? (uint64_t)(-delay_us) : (uint64_t)delay_us;
+    out->alarm_id = add_alarm_in_us(first, repeating_timer_cb, out, true);
+    return out->alarm_id > 0;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+    bool cancelled = false;
+    if (timer->alarm_id > 0) {
+        cancelled = cancel_alarm(timer->alarm_id);
+        timer->alarm_id = 0;
+    }
+    return cancelled;
+}
+
+//--------------------------------------------------------------------
+// Watchdog
+//--------------------------------------------------------------------
+
+void emu_reboot(const char *reason, bool watchdog)
+{
+    printf("Emulator: %s - rebooting\n", reason);
+    fflush(stdout);
+
+    emu_lwip_shutdown();
+    if (emu_config.trace_path != NULL) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.watchdog", emu_config.trace_path);
+        emu_trace_write(path);
+    }
+    setenv(EMU_WATCHDOG_ENV, watchdog ? "1" : "0", 1);
+    execv("/proc/self/exe", emu_config.argv);
+
+    perror("Emulator: re-exec failed");
+    exit(1);
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+    (void)pause_on_debug;
+    watchdog_timeout_ms = delay_ms;
+    watchdog_deadline_us = time_us_64() + (uint64_t)delay_ms * 1000;
+    watchdog_enabled = true;
+}
+
+void watchdog_update(void)
+{
+    if (watchdog_enabled) {
+        watchdog_deadline_us = time_us_64() + (uint64_t)watchdog_timeout_ms * 1000;
+    }
+}
+
+bool watchdog_caused_reboot(void)
+{
+    if (watchdog_rebooted < 0) {
+        const char *env = getenv(EMU_WATCHDOG_ENV);
+        watchdog_rebooted = (env != NULL && env[0] == '1');
+        unsetenv(EMU_WATCHDOG_ENV);
+    }
+    return watchdog_rebooted != 0;
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+{
+    (void)pc;
+    (void)sp;
+    watchdog_timeout_ms = delay_ms;
+    watchdog_deadline_us = time_us_64() + (uint64_t)delay_ms * 1000;
+    watchdog_enabled = true;
+}
+
+//--------------------------------------------------------------------
+// Background Work
+//--------------------------------------------------------------------
+
+// Run "interrupts" until until_us; with wake_on_network, return early
+// once a datagram is waiting (poll build only)
+static void service(uint64_t until_us, bool wake_on_network)
+{
+    // A callback that sleeps just waits - "interrupts" do not nest
+    if (in_service) {
+        uint64_t now = time_us_64();
+        if (emu_config.replay_path != NULL) {
+            virtual_us = until_us > now ? until_us : now;
+        } else if (until_us > now) {
+            usleep((useconds_t)(until_us - now));
+        }
+        return;
+    }
+
+    in_service = true;
+    watchdog_caused_reboot();   // Latch the flag before the environment is reused
+    emu_trace_poll();
+
+    // Replay: jump straight to the next alarm or captured packet
+    if (emu_config.replay_path != NULL) {
+        while (virtual_us < until_us) {
+            if (watchdog_enabled && virtual_us >= watchdog_deadline_us) {
+                printf("Emulator: Watchdog timeout during replay\n");
+                exit(2);
+            }
+
+            uint64_t next = run_alarms(until_us);
+            if (watchdog_enabled && watchdog_deadline_us < next) {
+                next = watchdog_deadline_us;
+            }
+            next = emu_replay_step(next);
+            if (wake_on_network && emu_lwip_wait(0)) {
+                break;
+            }
+            if (next > virtual_us) {
+                virtual_us = next < until_us ? next : until_us;
+            }
+        }
+        run_alarms(until_us);
+        in_service = false;
+        return;
+    }
+
+    do {
+        // Checked first: a host stall (SIGSTOP, debugger) must not be
+        // hidden by a timer callback that feeds the watchdog late
+        if (watchdog_enabled && time_us_64() >= watchdog_deadline_us) {
+            emu_reboot("Watchdog timeout", true);
+        }
+
+        uint64_t next = run_alarms(until_us);
+        if (watchdog_enabled && watchdog_deadline_us < next) {
+            next = watchdog_deadline_us;
+        }
+
+        uint64_t now = time_us_64();
+        uint64_t timeout_us = next > now ? next - now : 0;
+#if PICO_CYW43_ARCH_POLL
+        if (wake_on_network) {
+            if (emu_lwip_wait(timeout_us)) {
+                break;
+            }
+        } else if (timeout_us > 0) {
+            usleep((useconds_t)timeout_us);
+        }
+#else
+        (void)wake_on_network;
+        emu_lwip_poll(timeout_us);
+#endif
+    } while (time_us_64() < until_us);
+
+    in_service = false;
+}
+
+void emu_service(uint64_t until_us)
+{
+    service(until_us, false);
+}
+
+void emu_wait_for_work(uint64_t until_us)
+{
+    service(until_us, true);
+}
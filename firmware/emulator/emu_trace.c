@@ -0,0 +1,109 @@
+/*
+ * RB3E StageKit Bridge - Emulator Trace Dumps
+ *
+ * --trace <file> starts the firmware's trace recorder at boot and writes
+ * the same RB3T dump rb3e_ctl produces when the emulator exits (end of a
+ * replay, Ctrl+C or SIGTERM). A watchdog reboot saves the run so far to
+ * <file>.watchdog before the re-exec. Convert with tools/rb3e_trace2json.py.
+ */
+
+#include "emu.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+static volatile sig_atomic_t stop_requested = 0;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void write_at_exit(void)
+{
+    emu_trace_write(emu_config.trace_path);
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void emu_trace_start(void)
+{
+    if (emu_config.trace_path == NULL) {
+        return;
+    }
+
+    if (!trace_start(CTRL_TRACE_MODE_RING)) {
+        fprintf(stderr, "Emulator: Tracing is compiled out (RB3E_TRACE=0)\n");
+        return;
+    }
+
+    atexit(write_at_exit);
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+}
+
+void emu_trace_poll(void)
+{
+    if (stop_requested) {
+        printf("\nEmulator: Stopping\n");
+        exit(0);
+    }
+}
+
+bool emu_trace_write(const char *path)
+{
+    static uint8_t names[CTRL_MAX_PAYLOAD];
+    ctrl_trace_status_t status;
+    ctrl_trace_file_t header;
+
+    trace_stop();
+    trace_get_status(&status);
+
+    memcpy(header.magic, CTRL_TRACE_FILE_MAGIC, sizeof(header.magic));
+    header.version = CTRL_TRACE_FILE_VERSION;
+    header.names_length = trace_get_names(names, sizeof(names));
+    header.count = status.count;
+    header.overwritten = status.overwritten;
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(names, header.names_length, 1, f) == 1;
+
+    ctrl_trace_event_t events[256];
+    uint32_t index = 0;
+    uint16_t n;
+    while (ok && (n = trace_read(index, events, 256)) > 0) {
+        ok = fwrite(events, sizeof(ctrl_trace_event_t), n, f) == n;
+        index += n;
+    }
+
+    if (fclose(f) != 0 || !ok) {
+        perror(path);
+        return false;
+    }
+
+    printf("Emulator: Wrote %lu trace events to %s", (unsigned long)status.count, path);
+    if (status.overwritten > 0) {
+        printf(" (%lu older events overwritten)", (unsigned long)status.overwritten);
+    }
+    printf("\n");
+    return true;
+}
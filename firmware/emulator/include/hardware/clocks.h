@@ -0,0 +1,23 @@
+/*
+ * Clock stand-in for the Linux bridge emulator
+ *
+ * Reports the RP2040's default system clock, so cycle figures derived
+ * from the microsecond timer are in the same unit as on a Pico W.
+ */
+
+#ifndef _EMU_HARDWARE_CLOCKS_H_
+#define _EMU_HARDWARE_CLOCKS_H_
+
+#include <stdint.h>
+
+enum clock_index {
+    clk_sys = 5,
+};
+
+static inline uint32_t clock_get_hz(enum clock_index clk_index)
+{
+    (void)clk_index;
+    return 125000000;
+}
+
+#endif /* _EMU_HARDWARE_CLOCKS_H_ */
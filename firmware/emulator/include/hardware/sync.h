@@ -0,0 +1,16 @@
+/*
+ * Interrupt masking stand-in for the Linux bridge emulator
+ *
+ * "Interrupts" only run from sleep calls on the firmware thread, so
+ * masking them is a no-op.
+ */
+
+#ifndef _EMU_HARDWARE_SYNC_H_
+#define _EMU_HARDWARE_SYNC_H_
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+#endif /* _EMU_HARDWARE_SYNC_H_ */
@@ -0,0 +1,27 @@
+/*
+ * Watchdog stand-in for the Linux bridge emulator
+ *
+ * A watchdog that is not fed in time re-executes the emulator, which is
+ * the closest thing to a chip reset.
+ */
+
+#ifndef _EMU_HARDWARE_WATCHDOG_H_
+#define _EMU_HARDWARE_WATCHDOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void watchdog_update(void);
+bool watchdog_caused_reboot(void);
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_HARDWARE_WATCHDOG_H_ */
@@ -0,0 +1,22 @@
+/*
+ * TinyUSB HCD events for the Linux bridge emulator
+ */
+
+#ifndef _EMU_HOST_HCD_H_
+#define _EMU_HOST_HCD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hcd_event_device_attach(uint8_t rhport, bool in_isr);
+void hcd_event_device_remove(uint8_t rhport, bool in_isr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_HOST_HCD_H_ */
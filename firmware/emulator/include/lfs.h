@@ -0,0 +1,11 @@
+/*
+ * LittleFS stand-in for the Linux bridge emulator (types only - the
+ * emulator takes its WiFi settings from the command line)
+ */
+
+#ifndef _EMU_LFS_H_
+#define _EMU_LFS_H_
+
+typedef struct lfs lfs_t;
+
+#endif /* _EMU_LFS_H_ */
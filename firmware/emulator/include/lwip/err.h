@@ -0,0 +1,19 @@
+/*
+ * lwIP error codes for the Linux bridge emulator
+ */
+
+#ifndef _EMU_LWIP_ERR_H_
+#define _EMU_LWIP_ERR_H_
+
+typedef signed char err_t;
+
+#define ERR_OK      0
+#define ERR_MEM     -1
+#define ERR_BUF     -2
+#define ERR_RTE     -4
+#define ERR_USE     -8
+#define ERR_VAL     -6
+#define ERR_ABRT    -13
+#define ERR_ARG     -16
+
+#endif /* _EMU_LWIP_ERR_H_ */
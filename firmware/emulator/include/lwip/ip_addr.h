@@ -0,0 +1,53 @@
+/*
+ * lwIP IPv4 addresses for the Linux bridge emulator
+ *
+ * Addresses are kept in network byte order, as in lwIP.
+ */
+
+#ifndef _EMU_LWIP_IP_ADDR_H_
+#define _EMU_LWIP_IP_ADDR_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+// a.b.c.d stored in network byte order (little-endian host)
+#define IP_ADDR4(ipaddr, a, b, c, d) \
+    ((ipaddr)->addr = ((uint32_t)((d) & 0xff) << 24) | ((uint32_t)((c) & 0xff) << 16) | \
+                      ((uint32_t)((b) & 0xff) << 8) | (uint32_t)((a) & 0xff))
+#define IP4_ADDR(ipaddr, a, b, c, d)    IP_ADDR4(ipaddr, a, b, c, d)
+
+#define ip_addr_copy(dest, src)         ((dest) = (src))
+#define ip_addr_cmp(a, b)               ((a)->addr == (b)->addr)
+#define ip4_addr_get_u32(a)             ((a)->addr)
+#define ip4_addr_set_u32(a, v)          ((a)->addr = (v))
+#define ip_2_ip4(a)                     (a)
+#define IP_IS_V4(a)                     1
+
+extern const ip_addr_t ip_addr_any;
+extern const ip_addr_t ip_addr_broadcast;
+#define IP_ADDR_ANY                     (&ip_addr_any)
+#define IP_ADDR_BROADCAST               (&ip_addr_broadcast)
+
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+char *ip4addr_ntoa_r(const ip4_addr_t *addr, char *buf, int buflen);
+#define ipaddr_ntoa(a)                  ip4addr_ntoa(a)
+#define ipaddr_ntoa_r(a, b, l)          ip4addr_ntoa_r(a, b, l)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_LWIP_IP_ADDR_H_ */
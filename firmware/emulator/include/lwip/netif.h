@@ -0,0 +1,50 @@
+/*
+ * lwIP network interface for the Linux bridge emulator
+ */
+
+#ifndef _EMU_LWIP_NETIF_H_
+#define _EMU_LWIP_NETIF_H_
+
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct netif;
+typedef void (*netif_status_callback_fn)(struct netif *netif);
+
+struct netif {
+    ip4_addr_t ip_addr;
+    ip4_addr_t netmask;
+    ip4_addr_t gw;
+    bool up;
+    bool link_up;
+    netif_status_callback_fn status_callback;
+    netif_status_callback_fn link_callback;
+};
+
+extern struct netif *netif_default;
+
+#define netif_ip4_addr(n)       ((const ip4_addr_t *)&(n)->ip_addr)
+#define netif_ip4_netmask(n)    ((const ip4_addr_t *)&(n)->netmask)
+#define netif_ip4_gw(n)         ((const ip4_addr_t *)&(n)->gw)
+#define netif_is_up(n)          ((n)->up)
+#define netif_is_link_up(n)     ((n)->link_up)
+
+void netif_set_link_callback(struct netif *netif, netif_status_callback_fn link_callback);
+void netif_set_status_callback(struct netif *netif, netif_status_callback_fn status_callback);
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw);
+void netif_set_up(struct netif *netif);
+void netif_set_down(struct netif *netif);
+void netif_set_link_up(struct netif *netif);
+void netif_set_link_down(struct netif *netif);
+void netif_set_default(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_LWIP_NETIF_H_ */
@@ -0,0 +1,48 @@
+/*
+ * lwIP packet buffers for the Linux bridge emulator
+ *
+ * Every pbuf is a single contiguous buffer (no chains).
+ */
+
+#ifndef _EMU_LWIP_PBUF_H_
+#define _EMU_LWIP_PBUF_H_
+
+#include <stdint.h>
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PBUF_TRANSPORT,
+    PBUF_IP,
+    PBUF_LINK,
+    PBUF_RAW
+} pbuf_layer;
+
+typedef enum {
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf *p);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+err_t pbuf_take(struct pbuf *p, const void *dataptr, u16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_LWIP_PBUF_H_ */
@@ -0,0 +1,23 @@
+/*
+ * lwIP timeouts for the Linux bridge emulator
+ */
+
+#ifndef _EMU_LWIP_TIMEOUTS_H_
+#define _EMU_LWIP_TIMEOUTS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*sys_timeout_handler)(void *arg);
+
+void sys_timeout(uint32_t msecs, sys_timeout_handler handler, void *arg);
+void sys_untimeout(sys_timeout_handler handler, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_LWIP_TIMEOUTS_H_ */
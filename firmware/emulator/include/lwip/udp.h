@@ -0,0 +1,51 @@
+/*
+ * lwIP raw UDP API for the Linux bridge emulator
+ *
+ * Each PCB is backed by a host UDP socket. Receive callbacks are
+ * dispatched from sleep_ms()/sleep_us() on the firmware thread.
+ */
+
+#ifndef _EMU_LWIP_UDP_H_
+#define _EMU_LWIP_UDP_H_
+
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOF_REUSEADDR   0x04
+#define SOF_BROADCAST   0x20
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb {
+    int so_options;
+    int fd;                 // Bound to the bridge address (or any)
+    int bcast_fd;           // Catches broadcasts when bound to a single address
+    u16_t local_port;
+    udp_recv_fn recv;
+    void *recv_arg;
+    struct udp_pcb *next;
+};
+
+struct udp_pcb *udp_new(void);
+void udp_remove(struct udp_pcb *pcb);
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port);
+
+#define ip_set_option(pcb, opt)     ((pcb)->so_options |= (opt))
+#define ip_reset_option(pcb, opt)   ((pcb)->so_options &= ~(opt))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_LWIP_UDP_H_ */
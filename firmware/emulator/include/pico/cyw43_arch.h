@@ -0,0 +1,88 @@
+/*
+ * CYW43 stand-in for the Linux bridge emulator
+ *
+ * Joining "WiFi" always succeeds and brings up a netif with the host's
+ * (or the configured) address. The LED is tracked but not shown.
+ */
+
+#ifndef _EMU_CYW43_ARCH_H_
+#define _EMU_CYW43_ARCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/netif.h"
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CYW43_WL_GPIO_LED_PIN       0
+#define CYW43_ITF_STA               0
+#define CYW43_ITF_AP                1
+#define CYW43_COUNTRY_USA           0
+
+#define CYW43_AUTH_OPEN             0
+#define CYW43_AUTH_WPA2_AES_PSK     0x00400004
+#define CYW43_AUTH_WPA2_MIXED_PSK   0x00400006
+
+#define CYW43_LINK_DOWN             0
+#define CYW43_LINK_JOIN             1
+#define CYW43_LINK_NOIP             2
+#define CYW43_LINK_UP               3
+#define CYW43_LINK_FAIL             (-1)
+#define CYW43_LINK_NONET            (-2)
+#define CYW43_LINK_BADAUTH          (-3)
+
+#define CYW43_NO_POWERSAVE_MODE     0
+#define CYW43_PERFORMANCE_PM        1
+#define cyw43_pm_value(mode, pm2_sleep_ret_ms, li_beacon_period, li_dtim_period, li_assoc) \
+    ((uint32_t)(mode))
+
+typedef struct {
+    struct netif netif[2];
+} cyw43_t;
+
+typedef struct {
+    uint32_t _empty;
+} cyw43_wifi_scan_options_t;
+
+// Only the fields the firmware reads
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid_len;
+    uint8_t ssid[32];
+    uint16_t channel;
+    uint8_t auth_mode;
+    int16_t rssi;
+} cyw43_ev_scan_result_t;
+
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init_with_country(uint32_t country);
+void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth);
+int cyw43_arch_wifi_connect_bssid_async(const char *ssid, const uint8_t *bssid,
+                                        const char *pw, uint32_t auth);
+void cyw43_arch_gpio_put(unsigned int wl_gpio, bool value);
+void cyw43_arch_poll(void);
+void cyw43_arch_wait_for_work_until(absolute_time_t until);
+
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
+
+int cyw43_wifi_pm(cyw43_t *self, uint32_t pm);
+int cyw43_wifi_get_mac(cyw43_t *self, int itf, uint8_t mac[6]);
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi);
+int cyw43_wifi_leave(cyw43_t *self, int itf);
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]);
+int cyw43_wifi_scan(cyw43_t *self, cyw43_wifi_scan_options_t *opts, void *env,
+                    int (*result_cb)(void *, const cyw43_ev_scan_result_t *));
+bool cyw43_wifi_scan_active(cyw43_t *self);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_CYW43_ARCH_H_ */
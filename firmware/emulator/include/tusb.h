@@ -0,0 +1,120 @@
+/*
+ * TinyUSB host stand-in for the Linux bridge emulator
+ *
+ * Only the pieces usb_host.c uses. The one attached device is the
+ * virtual Stage Kit in emu_stagekit.c.
+ */
+
+#ifndef _EMU_TUSB_H_
+#define _EMU_TUSB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    XFER_RESULT_SUCCESS = 0,
+    XFER_RESULT_FAILED,
+    XFER_RESULT_STALLED,
+    XFER_RESULT_TIMEOUT,
+    XFER_RESULT_INVALID
+} xfer_result_t;
+
+enum {
+    TUSB_REQ_RCPT_DEVICE = 0,
+    TUSB_REQ_RCPT_INTERFACE,
+    TUSB_REQ_RCPT_ENDPOINT,
+    TUSB_REQ_RCPT_OTHER
+};
+
+enum {
+    TUSB_REQ_TYPE_STANDARD = 0,
+    TUSB_REQ_TYPE_CLASS,
+    TUSB_REQ_TYPE_VENDOR,
+    TUSB_REQ_TYPE_INVALID
+};
+
+enum {
+    TUSB_DIR_OUT = 0,
+    TUSB_DIR_IN = 1
+};
+
+enum {
+    TUSB_REQ_GET_STATUS = 0,
+    TUSB_REQ_CLEAR_FEATURE = 1
+};
+
+enum {
+    TUSB_REQ_FEATURE_EDPT_HALT = 0
+};
+
+typedef struct __attribute__((packed)) {
+    union {
+        struct __attribute__((packed)) {
+            uint8_t recipient : 5;
+            uint8_t type : 2;
+            uint8_t direction : 1;
+        } bmRequestType_bit;
+        uint8_t bmRequestType;
+    };
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} tusb_control_request_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+typedef struct tuh_xfer_s tuh_xfer_t;
+typedef void (*tuh_xfer_cb_t)(tuh_xfer_t *xfer);
+
+struct tuh_xfer_s {
+    uint8_t daddr;
+    uint8_t ep_addr;
+    xfer_result_t result;
+    uint32_t actual_len;
+    const tusb_control_request_t *setup;
+    uint8_t *buffer;
+    tuh_xfer_cb_t complete_cb;
+    uintptr_t user_data;
+};
+
+bool tusb_init(void);
+bool tuh_init(uint8_t rhport);
+bool tuh_deinit(uint8_t rhport);
+bool tuh_inited(void);
+void tuh_task(void);
+
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t *vid, uint16_t *pid);
+uint8_t tuh_descriptor_get_device_sync(uint8_t daddr, void *buffer, uint16_t len);
+bool tuh_control_xfer(tuh_xfer_t *xfer);
+bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr);
+
+// Application callbacks (implemented in usb_host.c)
+void tuh_mount_cb(uint8_t daddr);
+void tuh_umount_cb(uint8_t daddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EMU_TUSB_H_ */
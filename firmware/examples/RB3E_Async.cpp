@@ -0,0 +1,273 @@
+
+#include "RB3E_Async.h"
+
+#include <chrono>
+
+std::coroutine_handle<> RB3E_Task::FinalAwaiter::await_suspend( handle_type handle ) noexcept {
+  promise_type& promise = handle.promise();
+  if( promise.continuation ) {
+    return promise.continuation;
+  }
+
+  // Spawned: nobody awaits us, the loop frees the frame
+  if( promise.owner ) {
+    promise.owner->TaskFinished( handle );
+  }
+  return std::noop_coroutine();
+};
+
+RB3E_AsyncTransfer::RB3E_AsyncTransfer( RB3E_EventLoop& loop ) : m_loop( loop ) {
+  m_complete = false;
+  m_result = 0;
+};
+
+void RB3E_AsyncTransfer::Complete( int result ) {
+  if( m_complete ) {
+    return;
+  }
+  m_complete = true;
+  m_result = result;
+
+  if( m_waiter ) {
+    std::coroutine_handle<> waiter = m_waiter;
+    m_waiter = nullptr;
+    m_loop.Post( waiter );
+  }
+};
+
+void RB3E_AsyncTransfer::Reset() {
+  m_complete = false;
+  m_result = 0;
+  m_waiter = nullptr;
+};
+
+bool RB3E_AsyncTransfer::IsComplete() {
+  return m_complete;
+};
+
+int RB3E_AsyncTransfer::GetResult() {
+  return m_result;
+};
+
+RB3E_EventLoop::RB3E_EventLoop() {
+  m_stop = false;
+  m_timer_order = 0;
+};
+
+RB3E_EventLoop::~RB3E_EventLoop() {
+  // Destroying a root frame also destroys any nested task it is awaiting
+  for( void* address : m_tasks ) {
+    std::coroutine_handle<>::from_address( address ).destroy();
+  }
+};
+
+void RB3E_EventLoop::Spawn( RB3E_Task task ) {
+  RB3E_Task::handle_type handle = task.m_handle;
+  task.m_handle = nullptr;
+  if( !handle ) {
+    return;
+  }
+
+  handle.promise().owner = this;
+  m_tasks.insert( handle.address() );
+  this->Post( handle );
+};
+
+size_t RB3E_EventLoop::GetTaskCount() {
+  return m_tasks.size();
+};
+
+void RB3E_EventLoop::TaskFinished( RB3E_Task::handle_type handle ) {
+  m_tasks.erase( handle.address() );
+  handle.destroy();
+};
+
+void RB3E_EventLoop::Stop() {
+  m_stop = true;
+};
+
+int64_t RB3E_EventLoop::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+};
+
+RB3E_EventLoop::TimerAwaiter RB3E_EventLoop::Sleep( const uint32_t ms ) {
+  return TimerAwaiter{ *this, Now() + (int64_t)ms * 1000000 };
+};
+
+RB3E_EventLoop::TimerAwaiter RB3E_EventLoop::SleepUntil( const int64_t deadline_ns ) {
+  return TimerAwaiter{ *this, deadline_ns };
+};
+
+RB3E_EventLoop::YieldAwaiter RB3E_EventLoop::Yield() {
+  return YieldAwaiter{ *this };
+};
+
+RB3E_EventLoop::EventAwaiter RB3E_EventLoop::NextEvent( RB3E_Network& net, const int type ) {
+  return EventAwaiter{ *this, net, type, 0 };
+};
+
+void RB3E_EventLoop::Post( std::coroutine_handle<> waiter ) {
+  m_ready.push_back( waiter );
+};
+
+void RB3E_EventLoop::AddTimer( const int64_t deadline_ns, std::coroutine_handle<> waiter ) {
+  m_timers.push( Timer{ deadline_ns, m_timer_order++, waiter } );
+};
+
+void RB3E_EventLoop::AddEventWaiter( EventAwaiter& awaiter, std::coroutine_handle<> waiter ) {
+  for( NetworkWatch& watch : m_networks ) {
+    if( watch.net == &awaiter.net ) {
+      watch.waiters.push_back( EventWaiter{ &awaiter, waiter } );
+      return;
+    }
+  }
+
+  // First wait on this receiver - from now on the loop reads it
+  m_networks.push_back( NetworkWatch() );
+  m_networks.back().net = &awaiter.net;
+  m_networks.back().waiters.push_back( EventWaiter{ &awaiter, waiter } );
+};
+
+void RB3E_EventLoop::WatchFd( const int fd, const short events, std::function<void( short )> callback ) {
+  for( FdWatch& watch : m_fds ) {
+    if( watch.fd == fd ) {
+      watch.events = events;
+      watch.callback = std::move( callback );
+      return;
+    }
+  }
+  m_fds.push_back( FdWatch{ fd, events, std::move( callback ) } );
+};
+
+void RB3E_EventLoop::UnwatchFd( const int fd ) {
+  for( size_t i = 0; i < m_fds.size(); i++ ) {
+    if( m_fds[ i ].fd == fd ) {
+      m_fds.erase( m_fds.begin() + i );
+      return;
+    }
+  }
+};
+
+// Everything posted before this call; anything posted while running waits for the next pass
+void RB3E_EventLoop::RunReady() {
+  m_running.swap( m_ready );
+  while( !m_running.empty() ) {
+    std::coroutine_handle<> waiter = m_running.front();
+    m_running.pop_front();
+    waiter.resume();
+  }
+};
+
+// Only timers already queued when the pass starts, so Sleep( 0 ) in a loop cannot starve the rest
+void RB3E_EventLoop::RunTimers() {
+  const int64_t now_ns = Now();
+  const uint64_t last_order = m_timer_order;
+  while( !m_timers.empty() && m_timers.top().deadline_ns <= now_ns && m_timers.top().order < last_order ) {
+    std::coroutine_handle<> waiter = m_timers.top().waiter;
+    m_timers.pop();
+    waiter.resume();
+  }
+};
+
+// Read every queued event and resume the scripts waiting for its type.
+// Each script runs before the next Poll(), so the getters are still its event's.
+void RB3E_EventLoop::DispatchNetwork( NetworkWatch& watch ) {
+  while( watch.net->Poll() ) {
+    uint8_t type = watch.net->GetEventType();
+
+    watch.resuming.clear();
+    for( size_t i = 0; i < watch.waiters.size(); ) {
+      EventWaiter& w = watch.waiters[ i ];
+      if( w.awaiter->type == RB3E_ANY_EVENT || w.awaiter->type == type ) {
+        w.awaiter->result = type;
+        watch.resuming.push_back( w );
+        watch.waiters[ i ] = watch.waiters.back();
+        watch.waiters.pop_back();
+      } else {
+        i++;
+      }
+    }
+
+    // Scripts resumed here may wait on this receiver again - that is the next event
+    for( size_t i = 0; i < watch.resuming.size(); i++ ) {
+      watch.resuming[ i ].waiter.resume();
+    }
+  }
+};
+
+bool RB3E_EventLoop::HasWork() {
+  if( !m_ready.empty() || !m_timers.empty() || !m_fds.empty() ) {
+    return true;
+  }
+  for( NetworkWatch& watch : m_networks ) {
+    if( !watch.waiters.empty() ) {
+      return true;
+    }
+  }
+  return false;
+};
+
+bool RB3E_EventLoop::Run() {
+  m_stop = false;
+
+  while( !m_stop && !m_tasks.empty() ) {
+    this->RunReady();
+    this->RunTimers();
+    if( m_stop || m_tasks.empty() ) {
+      break;
+    }
+    if( !this->HasWork() ) {
+      MSG_RB3E_NETWORK_ERROR( "Event loop : " << m_tasks.size() << " task(s) waiting on nothing." );
+      return false;
+    }
+
+    // Sleep until the next timer, event or fd - not at all if something is ready
+    int64_t wait_ns = -1;
+    if( !m_ready.empty() ) {
+      wait_ns = 0;
+    } else if( !m_timers.empty() ) {
+      wait_ns = std::max( (int64_t)0, m_timers.top().deadline_ns - Now() );
+    }
+
+    // Watches added by scripts resumed below are picked up next pass
+    const size_t network_count = m_networks.size();
+    m_pollfds.clear();
+    for( NetworkWatch& watch : m_networks ) {
+      m_pollfds.push_back( { watch.net->GetSocket(), POLLIN, 0 } );
+    }
+    for( FdWatch& watch : m_fds ) {
+      m_pollfds.push_back( { watch.fd, watch.events, 0 } );
+    }
+
+    struct timespec timeout;
+    timeout.tv_sec = wait_ns / 1000000000;
+    timeout.tv_nsec = wait_ns % 1000000000;
+    int ready = ppoll( m_pollfds.data(), m_pollfds.size(), wait_ns < 0 ? NULL : &timeout, NULL );
+    if( ready <= 0 ) {
+      continue;
+    }
+
+    for( size_t i = 0; i < network_count; i++ ) {
+      if( m_pollfds[ i ].revents & POLLIN ) {
+        this->DispatchNetwork( m_networks[ i ] );
+      }
+    }
+
+    // Look callbacks up by fd - one may unwatch another
+    for( size_t i = network_count; i < m_pollfds.size(); i++ ) {
+      if( m_pollfds[ i ].revents == 0 ) {
+        continue;
+      }
+      for( FdWatch& watch : m_fds ) {
+        if( watch.fd == m_pollfds[ i ].fd ) {
+          std::function<void( short )> callback = watch.callback;
+          callback( m_pollfds[ i ].revents );
+          break;
+        }
+      }
+    }
+  }
+
+  return true;
+};
@@ -0,0 +1,237 @@
+#ifndef RB3E_ASYNC_H
+#define RB3E_ASYNC_H
+
+// C++20 coroutine layer for scripting light effects on one thread.
+//
+// Each effect is an RB3E_Task coroutine. Its frame is allocated once, with
+// no stack per script. RB3E_EventLoop::Run() drives all of them from a
+// single ppoll() loop. A script suspends only at a co_await on:
+//   loop.Sleep( ms ) / loop.SleepUntil( ns )  timer
+//   loop.Yield()                              back of the ready queue
+//   loop.NextEvent( net, type )               next RB3E event from an RB3E_Network receiver
+//   transfer                                  an RB3E_AsyncTransfer completing
+//   SomeOtherEffect( ... )                    a nested RB3E_Task, run to completion
+//
+//   RB3E_Task Chase( RB3E_EventLoop& loop, RB3E_Network& bridge ) {
+//     for( int i = 0; ; i++ ) {
+//       bridge.SendLightEvent( 1 << ( i % 8 ), RB3E_BANK_BLUE );
+//       co_await loop.Sleep( 100 );
+//     }
+//   }
+//
+//   RB3E_Task Follow( RB3E_EventLoop& loop, RB3E_Network& console, RB3E_Network& bridge ) {
+//     for( ;; ) {
+//       co_await loop.NextEvent( console, RB3E_EVENT_STAGEKIT );
+//       bridge.SendLightEvent( console.GetWeightLeft(), console.GetWeightRight() );
+//     }
+//   }
+//
+//   loop.Spawn( Chase( loop, bridge ) );
+//   loop.Spawn( Follow( loop, console, bridge ) );
+//   loop.Run();
+//
+// After NextEvent() resumes, the receiver's getters describe that event
+// until the script suspends again.
+//
+// RB3E_AsyncTransfer is the hook for asynchronous hardware I/O. Submit a
+// transfer (for example a libusb asynchronous control transfer), call
+// Complete() from its callback, and register the library's file
+// descriptors with WatchFd(). Its callback then runs inside the loop.
+
+#include "RB3E_Network.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#define RB3E_ANY_EVENT   -1   // NextEvent() type that matches every event
+
+// StageKit right-channel colour banks ( rb3e_protocol.h SK_LED_* )
+#define RB3E_BANK_BLUE     0x20
+#define RB3E_BANK_GREEN    0x40
+#define RB3E_BANK_YELLOW   0x60
+#define RB3E_BANK_RED      0x80
+
+class RB3E_EventLoop;
+
+class RB3E_Task {
+  public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    // At the end: resume whoever awaited us, or free the frame if the loop owns it
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend( handle_type handle ) noexcept;
+      void await_resume() noexcept {}
+    };
+
+    struct promise_type {
+      std::coroutine_handle<> continuation;
+      RB3E_EventLoop*         owner = nullptr;   // Set by Spawn()
+
+      RB3E_Task get_return_object() { return RB3E_Task( handle_type::from_promise( *this ) ); }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      FinalAwaiter final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+    };
+
+    RB3E_Task( RB3E_Task&& other ) noexcept : m_handle( other.m_handle ) { other.m_handle = nullptr; }
+    RB3E_Task( const RB3E_Task& ) = delete;
+    RB3E_Task& operator=( const RB3E_Task& ) = delete;
+    ~RB3E_Task() {
+      if( m_handle ) {
+        m_handle.destroy();
+      }
+    }
+
+    // co_await a task: start it now and carry on when it finishes
+    bool await_ready() { return !m_handle || m_handle.done(); }
+    std::coroutine_handle<> await_suspend( std::coroutine_handle<> caller ) {
+      m_handle.promise().continuation = caller;
+      return m_handle;
+    }
+    void await_resume() {}
+
+  private:
+    friend class RB3E_EventLoop;
+    explicit RB3E_Task( handle_type handle ) : m_handle( handle ) {}
+
+    handle_type m_handle;
+};
+
+// One-shot completion for asynchronous I/O. Complete() may be called from
+// any callback on the loop thread; the waiting script resumes from the ready
+// queue, never inside the callback. Reset() before reuse.
+class RB3E_AsyncTransfer {
+  public:
+    explicit RB3E_AsyncTransfer( RB3E_EventLoop& loop );
+
+    void Complete( int result );
+    void Reset();
+    bool IsComplete();
+    int  GetResult();
+
+    bool await_ready() { return m_complete; }
+    void await_suspend( std::coroutine_handle<> waiter ) { m_waiter = waiter; }
+    int  await_resume() { return m_result; }
+
+  private:
+    RB3E_EventLoop&         m_loop;
+    bool                    m_complete;
+    int                     m_result;
+    std::coroutine_handle<> m_waiter;
+};
+
+class RB3E_EventLoop {
+  public:
+    struct TimerAwaiter {
+      RB3E_EventLoop& loop;
+      int64_t         deadline_ns;
+
+      bool await_ready() { return false; }   // Even a due timer goes through the queue
+      void await_suspend( std::coroutine_handle<> waiter ) { loop.AddTimer( deadline_ns, waiter ); }
+      void await_resume() {}
+    };
+
+    struct YieldAwaiter {
+      RB3E_EventLoop& loop;
+
+      bool await_ready() { return false; }
+      void await_suspend( std::coroutine_handle<> waiter ) { loop.Post( waiter ); }
+      void await_resume() {}
+    };
+
+    // Resumes with the event's RB3E_EVENT_* type
+    struct EventAwaiter {
+      RB3E_EventLoop& loop;
+      RB3E_Network&   net;
+      int             type;
+      uint8_t         result;
+
+      bool await_ready() { return false; }
+      void await_suspend( std::coroutine_handle<> waiter ) { loop.AddEventWaiter( *this, waiter ); }
+      uint8_t await_resume() { return result; }
+    };
+
+    RB3E_EventLoop();
+    ~RB3E_EventLoop();
+
+    // The loop owns the task from here; it first runs inside Run()
+    void   Spawn( RB3E_Task task );
+    size_t GetTaskCount();
+
+    // Until every spawned task has finished or Stop() is called. Returns
+    // false if tasks remain that nothing can wake ( no timers, events or fds ).
+    bool Run();
+    void Stop();
+
+    TimerAwaiter Sleep( const uint32_t ms );
+    TimerAwaiter SleepUntil( const int64_t deadline_ns );
+    YieldAwaiter Yield();
+    EventAwaiter NextEvent( RB3E_Network& net, const int type = RB3E_ANY_EVENT );
+
+    // External file descriptors ( libusb pollfds etc. ); the callback gets revents
+    void WatchFd( const int fd, const short events, std::function<void( short )> callback );
+    void UnwatchFd( const int fd );
+
+    // Steady clock, the time base for SleepUntil()
+    static int64_t Now();
+
+    void Post( std::coroutine_handle<> waiter );
+
+  private:
+    friend struct RB3E_Task::FinalAwaiter;
+
+    struct Timer {
+      int64_t                 deadline_ns;
+      uint64_t                order;     // FIFO for equal deadlines
+      std::coroutine_handle<> waiter;
+
+      bool operator>( const Timer& other ) const {
+        return deadline_ns != other.deadline_ns ? deadline_ns > other.deadline_ns : order > other.order;
+      }
+    };
+
+    struct EventWaiter {
+      EventAwaiter*           awaiter;
+      std::coroutine_handle<> waiter;
+    };
+
+    struct NetworkWatch {
+      RB3E_Network*            net;
+      std::vector<EventWaiter> waiters;
+      std::vector<EventWaiter> resuming;   // Swapped in while dispatching, keeps its capacity
+    };
+
+    struct FdWatch {
+      int                         fd;
+      short                       events;
+      std::function<void( short )> callback;
+    };
+
+    void AddTimer( const int64_t deadline_ns, std::coroutine_handle<> waiter );
+    void AddEventWaiter( EventAwaiter& awaiter, std::coroutine_handle<> waiter );
+    void TaskFinished( RB3E_Task::handle_type handle );
+    void RunReady();
+    void RunTimers();
+    void DispatchNetwork( NetworkWatch& watch );
+    bool HasWork();
+
+    bool                                   m_stop;
+    std::unordered_set<void*>              m_tasks;   // Frames of spawned tasks still running
+    std::deque<std::coroutine_handle<>>    m_ready;
+    std::deque<std::coroutine_handle<>>    m_running;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+    uint64_t                               m_timer_order;
+    std::deque<NetworkWatch>               m_networks;   // Deque - watches stay put while scripts add more
+    std::vector<FdWatch>                   m_fds;
+    std::vector<struct pollfd>             m_pollfds;
+};
+
+#endif
@@ -5,6 +5,12 @@ RB3E_Network::RB3E_Network() {
   m_is_sender = false;
   m_network_socket = -1;
   m_data_buffer_last_size = 0;
+  m_realtime = false;
+
+  m_timestamp_option = 0;
+  m_arrival_ns = 0;
+  m_read_ns = 0;
+  memset( &m_queue_histogram, 0, sizeof( m_queue_histogram ) );
 
   m_event_type_last = 0;
   m_game_state      = 0;
@@ -68,6 +74,8 @@ bool RB3E_Network::StartReceiver( std::string& source_ip, uint16_t listening_por
 
   MSG_RB3E_NETWORK_INFO( "Network socket created.  Listening port = " << listening_port );
 
+  this->EnableTimestamps();
+
   // Save expected source ip
   m_expected_source_ip = inet_addr( source_ip.c_str() );
 
@@ -110,7 +118,7 @@ bool RB3E_Network::StartSender( std::string& target_ip, uint16_t target_port ) {
     MSG_RB3E_NETWORK_INFO( "Network socket created.  Target = " << target_ip << " : " << target_port );
   }  
 
-  
+  this->EnableTimestamps();
   m_is_sender = true;
 
   return true;
@@ -126,20 +134,228 @@ void RB3E_Network::Stop() {
   m_is_sender = false;
 };
 
+// Applies to the calling thread only ( sched_* with pid 0 ), socket options to the current socket
+bool RB3E_Network::EnableRealtime( const RB3E_RealtimeConfig& config ) {
+  bool ok = true;
+
+  if( m_network_socket == -1 ) {
+    MSG_RB3E_NETWORK_ERROR( "Start the socket before enabling real-time mode." );
+    return false;
+  }
+
+  // Preallocate everything Poll() may grow, so the receive path never calls malloc
+  m_song_name.reserve( RB3E_NETWORK_MAX_DATA );
+  m_song_artist.reserve( RB3E_NETWORK_MAX_DATA );
+  m_song_name_short.reserve( RB3E_NETWORK_MAX_DATA );
+
+  if( config.rcvbuf_bytes > 0 ) {
+    if( setsockopt( m_network_socket, SOL_SOCKET, SO_RCVBUF, &config.rcvbuf_bytes, sizeof( config.rcvbuf_bytes ) ) == -1 ) {
+      MSG_RB3E_NETWORK_ERROR( "Failed to set SO_RCVBUF." );
+      ok = false;
+    }
+  }
+
+  if( config.busy_poll_us > 0 ) {
+#ifdef SO_BUSY_POLL
+    if( setsockopt( m_network_socket, SOL_SOCKET, SO_BUSY_POLL, &config.busy_poll_us, sizeof( config.busy_poll_us ) ) == -1 ) {
+      MSG_RB3E_NETWORK_ERROR( "Failed to set SO_BUSY_POLL ( needs CAP_NET_ADMIN to raise above net.core.busy_read )." );
+      ok = false;
+    }
+#else
+    MSG_RB3E_NETWORK_INFO( "SO_BUSY_POLL not available on this platform." );
+#endif
+  }
+
+  if( config.cpu >= 0 ) {
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    CPU_SET( config.cpu, &cpus );
+    if( sched_setaffinity( 0, sizeof( cpus ), &cpus ) == -1 ) {
+      MSG_RB3E_NETWORK_ERROR( "Failed to pin receive thread to CPU " << config.cpu << "." );
+      ok = false;
+    }
+  }
+
+  if( config.lock_memory ) {
+    if( mlockall( MCL_CURRENT | MCL_FUTURE ) == -1 ) {
+      MSG_RB3E_NETWORK_ERROR( "Failed to lock memory ( mlockall )." );
+      ok = false;
+    } else {
+      // Fault in stack the receive path may use later
+      volatile uint8_t stack_prefault[ 64 * 1024 ];
+      memset( (void*)stack_prefault, 0, sizeof( stack_prefault ) );
+    }
+  }
+
+  if( config.priority > 0 ) {
+    struct sched_param param;
+    memset( &param, 0, sizeof( param ) );
+    param.sched_priority = config.priority;
+    if( sched_setscheduler( 0, SCHED_FIFO, &param ) == -1 ) {
+      MSG_RB3E_NETWORK_ERROR( "Failed to set SCHED_FIFO priority " << config.priority << "." );
+      ok = false;
+    }
+  }
+
+  m_realtime = ok;
+  MSG_RB3E_NETWORK_INFO( "Real-time mode " << ( ok ? "enabled." : "partially enabled." ) );
+
+  return ok;
+};
+
+bool RB3E_Network::IsRealtime() {
+  return m_realtime;
+};
+
+// Ask the kernel to stamp datagrams on arrival - software RX stamps are CLOCK_REALTIME like our read time
+void RB3E_Network::EnableTimestamps() {
+  m_timestamp_option = 0;
+
+#if defined( SO_TIMESTAMPING ) && defined( SOF_TIMESTAMPING_RX_SOFTWARE )
+  int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  if( setsockopt( m_network_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof( flags ) ) == 0 ) {
+    m_timestamp_option = SO_TIMESTAMPING;
+    return;
+  }
+#endif
+
+#ifdef SO_TIMESTAMPNS
+  int enable = 1;
+  if( setsockopt( m_network_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof( enable ) ) == 0 ) {
+    m_timestamp_option = SO_TIMESTAMPNS;
+    return;
+  }
+#endif
+
+  MSG_RB3E_NETWORK_INFO( "Kernel receive timestamps not available - using read time." );
+};
+
+// recvmsg() with the arrival timestamp from the control messages; updates the queueing delay histogram
+int RB3E_Network::ReceiveDatagram( uint8_t* buffer, const size_t buffer_size, struct sockaddr_in* from ) {
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = buffer_size;
+
+  // Sized for struct scm_timestamping ( three timespecs ) - no allocation per packet
+  uint8_t control[ CMSG_SPACE( 3 * sizeof( struct timespec ) ) ];
+
+  struct msghdr msg;
+  memset( &msg, 0, sizeof( msg ) );
+  msg.msg_name = from;
+  msg.msg_namelen = from ? sizeof( *from ) : 0;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof( control );
+
+  int received = recvmsg( m_network_socket, &msg, MSG_DONTWAIT );
+  if( received < 0 ) {
+    return received;
+  }
+
+  struct timespec now;
+  clock_gettime( CLOCK_REALTIME, &now );
+  m_read_ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+  m_arrival_ns = 0;
+
+  for( struct cmsghdr* cmsg = CMSG_FIRSTHDR( &msg ); cmsg != NULL; cmsg = CMSG_NXTHDR( &msg, cmsg ) ) {
+    if( cmsg->cmsg_level != SOL_SOCKET ) {
+      continue;
+    }
+
+    struct timespec stamp = { 0, 0 };
+#if defined( SO_TIMESTAMPING ) && defined( SCM_TIMESTAMPING )
+    if( cmsg->cmsg_type == SCM_TIMESTAMPING ) {
+      memcpy( &stamp, CMSG_DATA( cmsg ), sizeof( stamp ) );  // [ 0 ] = software stamp
+    }
+#endif
+#ifdef SO_TIMESTAMPNS
+    if( cmsg->cmsg_type == SCM_TIMESTAMPNS ) {
+      memcpy( &stamp, CMSG_DATA( cmsg ), sizeof( stamp ) );
+    }
+#endif
+    if( stamp.tv_sec != 0 || stamp.tv_nsec != 0 ) {
+      m_arrival_ns = (uint64_t)stamp.tv_sec * 1000000000ull + stamp.tv_nsec;
+    }
+  }
+
+  if( m_arrival_ns != 0 && m_read_ns >= m_arrival_ns ) {
+    uint64_t delay_ns = m_read_ns - m_arrival_ns;
+    uint64_t delay_us = delay_ns / 1000;
+    int bucket = 0;
+    while( delay_us != 0 && bucket < RB3E_HISTOGRAM_BUCKETS - 1 ) {
+      delay_us >>= 1;
+      bucket++;
+    }
+    m_queue_histogram.buckets[ bucket ]++;
+    m_queue_histogram.count++;
+    m_queue_histogram.sum_ns += delay_ns;
+    if( delay_ns > m_queue_histogram.max_ns ) {
+      m_queue_histogram.max_ns = delay_ns;
+    }
+  }
+
+  return received;
+};
+
+bool RB3E_Network::HasKernelTimestamps() {
+  return m_timestamp_option != 0;
+};
+
+uint64_t RB3E_Network::GetArrivalTimeNs() {
+  return m_arrival_ns;
+};
+
+uint64_t RB3E_Network::GetReadTimeNs() {
+  return m_read_ns;
+};
+
+int64_t RB3E_Network::GetQueueDelayNs() {
+  return m_arrival_ns ? (int64_t)( m_read_ns - m_arrival_ns ) : 0;
+};
+
+const RB3E_DelayHistogram& RB3E_Network::GetQueueDelayHistogram() {
+  return m_queue_histogram;
+};
+
+void RB3E_Network::ResetQueueDelayHistogram() {
+  memset( &m_queue_histogram, 0, sizeof( m_queue_histogram ) );
+};
+
+void RB3E_Network::DumpQueueDelayHistogram() {
+  const RB3E_DelayHistogram& h = m_queue_histogram;
+
+  std::cout << "Socket queueing delay : " << h.count << " packets";
+  if( h.count == 0 ) {
+    std::cout << std::endl;
+    return;
+  }
+  std::cout << ", mean " << ( h.sum_ns / h.count / 1000.0 ) << " us, max " << ( h.max_ns / 1000.0 ) << " us" << std::endl;
+
+  for( int i = 0; i < RB3E_HISTOGRAM_BUCKETS; i++ ) {
+    if( h.buckets[ i ] == 0 ) {
+      continue;
+    }
+    uint64_t lo = ( i == 0 ) ? 0 : ( 1ull << ( i - 1 ) );
+    std::ostringstream label;
+    if( i == RB3E_HISTOGRAM_BUCKETS - 1 ) {
+      label << ">= " << lo << " us";
+    } else {
+      label << lo << "-" << ( 1ull << i ) << " us";
+    }
+    std::cout << "  " << std::left << std::setw( 18 ) << label.str() << std::right
+              << std::setw( 10 ) << h.buckets[ i ] << std::endl;
+  }
+};
+
 bool RB3E_Network::Poll() {
   if( m_is_sender || m_network_socket == -1 ) {
     return false;
   }
   
   struct sockaddr_in senders_address;
-  socklen_t senders_address_length = sizeof( senders_address );
-
-  m_data_buffer_last_size = recvfrom( m_network_socket,
-                                      m_data_buffer,
-                                      sizeof( m_data_buffer ),
-                                      MSG_DONTWAIT,
-                                      (struct sockaddr*)& senders_address,
-                                      &senders_address_length );
+
+  m_data_buffer_last_size = this->ReceiveDatagram( m_data_buffer, sizeof( m_data_buffer ), &senders_address );
  
   if( m_data_buffer_last_size < 1 ) {
     return false;
@@ -256,6 +472,128 @@ bool RB3E_Network::SendLightEvent( const uint8_t left_weight, const uint8_t righ
   return ( sent != m_data_buffer_last_size );
 };
 
+// Complete Stage Kit state in one datagram - the bridge sends only the commands that change something
+bool RB3E_Network::SendSceneEvent( const RB3E_EventScene& scene ) {
+  if( !m_is_sender || m_network_socket == -1 ) {
+    return false;
+  }
+
+  m_data_buffer[ 0 ] = 0x52; // R
+  m_data_buffer[ 1 ] = 0x42; // B
+  m_data_buffer[ 2 ] = 0x33; // 3
+  m_data_buffer[ 3 ] = 0x45; // E
+  m_data_buffer[ 4 ] = 0x00; // Protocol version
+  m_data_buffer[ 5 ] = RB3E_EVENT_SCENE; // Event type
+  m_data_buffer[ 6 ] = sizeof( scene ); // Payload size
+  m_data_buffer[ 7 ] = 0x00; // Platform
+  memcpy( &m_data_buffer[ 8 ], &scene, sizeof( scene ) );
+
+  m_data_buffer_last_size = 8 + sizeof( scene );
+
+  int sent = sendto( m_network_socket, m_data_buffer, m_data_buffer_last_size, 0, (sockaddr*)&m_target_address, sizeof( m_target_address ) );
+
+  return ( sent == m_data_buffer_last_size );
+};
+
+bool RB3E_Network::SendRaw( const uint8_t* data, const size_t length ) {
+  if( !m_is_sender || m_network_socket == -1 ) {
+    return false;
+  }
+
+  int sent = sendto( m_network_socket, data, length, 0, (sockaddr*)&m_target_address, sizeof( m_target_address ) );
+
+  return ( sent == (int)length );
+};
+
+bool RB3E_Network::SendRawTo( const uint8_t* data, const size_t length, const struct sockaddr_in& target ) {
+  if( m_network_socket == -1 ) {
+    return false;
+  }
+
+  int sent = sendto( m_network_socket, data, length, 0, (const sockaddr*)&target, sizeof( target ) );
+
+  return ( sent == (int)length );
+};
+
+size_t RB3E_Network::SendRawBatch( RB3E_Datagram* datagrams, const size_t count ) {
+  for( size_t i = 0; i < count; i++ ) {
+    datagrams[ i ].sent = false;
+  }
+  if( m_network_socket == -1 ) {
+    return 0;
+  }
+
+  size_t sent = 0;
+#ifdef __linux__
+  struct mmsghdr messages[ RB3E_SEND_BATCH_MAX ];
+  struct iovec iov[ RB3E_SEND_BATCH_MAX ];
+
+  size_t next = 0;
+  while( next < count ) {
+    size_t chunk = std::min( count - next, (size_t)RB3E_SEND_BATCH_MAX );
+    for( size_t i = 0; i < chunk; i++ ) {
+      const RB3E_Datagram& d = datagrams[ next + i ];
+      iov[ i ].iov_base = (void*)d.data;
+      iov[ i ].iov_len = d.length;
+      memset( &messages[ i ], 0, sizeof( messages[ i ] ) );
+      messages[ i ].msg_hdr.msg_name = (void*)&d.target;
+      messages[ i ].msg_hdr.msg_namelen = sizeof( d.target );
+      messages[ i ].msg_hdr.msg_iov = &iov[ i ];
+      messages[ i ].msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg stops at the first failure - skip that datagram and carry on
+    int done = sendmmsg( m_network_socket, messages, (unsigned int)chunk, 0 );
+    if( done < 0 ) {
+      done = 0;
+    }
+    for( int i = 0; i < done; i++ ) {
+      datagrams[ next + i ].sent = true;
+    }
+    sent += done;
+    next += ( (size_t)done < chunk ) ? done + 1 : chunk;
+  }
+#else
+  for( size_t i = 0; i < count; i++ ) {
+    datagrams[ i ].sent = this->SendRawTo( datagrams[ i ].data, datagrams[ i ].length, datagrams[ i ].target );
+    if( datagrams[ i ].sent ) {
+      sent++;
+    }
+  }
+#endif
+
+  return sent;
+};
+
+// Wait up to timeout_ms for a datagram ( on a sender, replies come back to our ephemeral port )
+// Returns the datagram size, 0 on timeout, -1 on error
+int RB3E_Network::ReceiveRaw( uint8_t* buffer, const size_t buffer_size, const int timeout_ms, struct sockaddr_in* from ) {
+  if( m_network_socket == -1 ) {
+    return -1;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = m_network_socket;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ready = poll( &pfd, 1, timeout_ms );
+  if( ready <= 0 ) {
+    return ready;
+  }
+
+  int received = this->ReceiveDatagram( buffer, buffer_size, from );
+  if( received < 0 ) {
+    MSG_RB3E_NETWORK_ERROR( "Failed to receive raw datagram." );
+  }
+
+  return received;
+};
+
+int RB3E_Network::GetSocket() {
+  return m_network_socket;
+};
+
 bool RB3E_Network::EventWasSongName() {
   return m_event_type_last == RB3E_EVENT_SONG_NAME;
 };
@@ -276,6 +614,10 @@ bool RB3E_Network::EventWasBandInfo() {
   return m_event_type_last == RB3E_EVENT_BAND_INFO;
 };
 
+uint8_t RB3E_Network::GetEventType() {
+  return m_event_type_last;
+};
+
 uint8_t RB3E_Network::GetWeightLeft() {
   return m_weight_left;
 };
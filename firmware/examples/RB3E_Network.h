@@ -0,0 +1,217 @@
+#ifndef RB3E_NETWORK_H
+#define RB3E_NETWORK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <bitset>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+  #include <linux/net_tstamp.h>
+#endif
+
+#ifdef DEBUG
+  #define MSG_RB3E_NETWORK_DEBUG( str ) do { std::cout << "RB3E_Network : DEBUG : " << str << std::endl; } while( false )
+#else
+  #define MSG_RB3E_NETWORK_DEBUG( str ) do { } while ( false )
+#endif
+
+#define MSG_RB3E_NETWORK_INFO( str ) do { std::cout << "RB3E_Network : INFO : " << str << std::endl; } while( false )
+#define MSG_RB3E_NETWORK_ERROR( str ) do { std::cerr << "RB3E_Network : ERROR : " << str << std::endl; } while( false )
+
+// RB3Enhanced network protocol ( see RB3Enhanced rb3enet.h )
+#define RB3E_NETWORK_MAGICKEY      0x52423345  // "RB3E"
+#define RB3E_NETWORK_MAX_DATA      0xFF
+
+#define RB3E_EVENT_ALIVE           0  // content is a string of the RB3E version
+#define RB3E_EVENT_STATE           1  // content is a char - 00=menus, 01=ingame
+#define RB3E_EVENT_SONG_NAME       2  // content is a string of the current song name
+#define RB3E_EVENT_SONG_ARTIST     3  // content is a string of the current song artist
+#define RB3E_EVENT_SONG_SHORTNAME  4  // content is a string of the current shortname
+#define RB3E_EVENT_SCORE           5  // content is a RB3E_EventScore struct
+#define RB3E_EVENT_STAGEKIT        6  // content is a RB3E_EventStagekit struct
+#define RB3E_EVENT_BAND_INFO       7  // content is a RB3E_EventBandInfo struct
+
+// Bridge extensions ( understood by the Pico bridge, never sent by RB3E )
+#define RB3E_EVENT_SCENE           0x80  // content is a RB3E_EventScene struct
+
+typedef struct __attribute__((packed)) {
+  uint32_t ProtocolMagic;
+  uint8_t  ProtocolVersion;
+  uint8_t  PacketType;
+  uint8_t  PacketSize;
+  uint8_t  Platform;
+} RB3E_EventHeader;
+
+typedef struct __attribute__((packed)) {
+  RB3E_EventHeader Header;
+  uint8_t          Data[ RB3E_NETWORK_MAX_DATA ];
+} RB3E_EventPacket;
+
+typedef struct __attribute__((packed)) {
+  uint8_t MemberExists[ 4 ];
+  uint8_t Difficulty[ 4 ];
+  uint8_t TrackType[ 4 ];
+} RB3E_EventBandInfo;
+
+typedef struct __attribute__((packed)) {
+  int32_t TotalScore;
+  int32_t MemberScores[ 4 ];
+  uint8_t Stars;
+} RB3E_EventScore;
+
+typedef struct __attribute__((packed)) {
+  uint8_t LeftChannel;
+  uint8_t RightChannel;
+} RB3E_EventStagekit;
+
+typedef struct __attribute__((packed)) {
+  uint8_t Banks[ 4 ];  // LED pattern for blue, green, yellow, red
+  uint8_t Strobe;      // 0 = off, 1-4 = speed
+  uint8_t Fog;         // 0 = off, 1 = on
+} RB3E_EventScene;
+
+// Socket queueing delay ( kernel arrival to user space read ), log2 buckets in microseconds
+#define RB3E_HISTOGRAM_BUCKETS     24  // bucket 0 = < 1 us, bucket i = [ 2^(i-1), 2^i ) us, last = everything above
+
+struct RB3E_DelayHistogram {
+  uint64_t buckets[ RB3E_HISTOGRAM_BUCKETS ];
+  uint64_t count;
+  uint64_t sum_ns;
+  uint64_t max_ns;
+};
+
+// Opt-in real-time receive ( Linux ) - see RB3E_Network::EnableRealtime()
+struct RB3E_RealtimeConfig {
+  int  cpu          = -1;           // Pin the receive thread to this CPU ( -1 = any )
+  int  priority     = 50;           // SCHED_FIFO priority 1-99 ( 0 = keep normal scheduling )
+  bool lock_memory  = true;         // mlockall() so page faults never stall a receive
+  int  busy_poll_us = 50;           // SO_BUSY_POLL ( 0 = off )
+  int  rcvbuf_bytes = 1024 * 1024;  // SO_RCVBUF ( 0 = keep default )
+};
+
+// Most datagrams SendRawBatch() hands the kernel per system call
+#define RB3E_SEND_BATCH_MAX        64
+
+// One datagram for SendRawBatch()
+struct RB3E_Datagram {
+  const uint8_t*     data;
+  size_t             length;
+  struct sockaddr_in target;
+  bool               sent;      // Set by SendRawBatch()
+};
+
+class RB3E_Network {
+  public:
+    RB3E_Network();
+    ~RB3E_Network();
+
+    bool StartReceiver( std::string& source_ip, uint16_t listening_port );
+    bool StartSender( std::string& target_ip, uint16_t target_port );
+    void Stop();
+
+    bool Poll();
+
+    // Call from the receive thread after StartReceiver() / StartSender().
+    // Needs CAP_SYS_NICE and CAP_IPC_LOCK ( or root ) for the scheduling and memory parts;
+    // every setting is still attempted, false means at least one was refused.
+    bool EnableRealtime( const RB3E_RealtimeConfig& config );
+    bool IsRealtime();
+
+    // Kernel receive timestamps ( SO_TIMESTAMPING / SO_TIMESTAMPNS ) of the last datagram read by
+    // Poll() or ReceiveRaw(). Times are CLOCK_REALTIME ns; arrival is 0 if the kernel gave none.
+    bool     HasKernelTimestamps();
+    uint64_t GetArrivalTimeNs();
+    uint64_t GetReadTimeNs();
+    int64_t  GetQueueDelayNs();
+
+    const RB3E_DelayHistogram& GetQueueDelayHistogram();
+    void     ResetQueueDelayHistogram();
+    void     DumpQueueDelayHistogram();
+
+    bool SendLightEvent( const uint8_t left_weight, const uint8_t right_weight );
+    bool SendSceneEvent( const RB3E_EventScene& scene );
+
+    // Raw datagrams to / from the sender target ( bridge control protocol etc. )
+    bool SendRaw( const uint8_t* data, const size_t length );
+    bool SendRawTo( const uint8_t* data, const size_t length, const struct sockaddr_in& target );
+    int  ReceiveRaw( uint8_t* buffer, const size_t buffer_size, const int timeout_ms, struct sockaddr_in* from = NULL );
+
+    // Many datagrams to many targets with few system calls ( sendmmsg on Linux ).
+    // A datagram the kernel refuses is skipped; returns how many were sent.
+    size_t SendRawBatch( RB3E_Datagram* datagrams, const size_t count );
+
+    // For waiting on several sockets at once ( poll ), -1 when stopped
+    int  GetSocket();
+
+    bool EventWasSongName();
+    bool EventWasArtist();
+    bool EventWasScore();
+    bool EventWasStagekit();
+    bool EventWasBandInfo();
+    uint8_t GetEventType();   // RB3E_EVENT_* of the last event Poll() accepted
+
+    uint8_t  GetWeightLeft();
+    uint8_t  GetWeightRight();
+    uint32_t GetBandScore();
+    uint8_t  GetBandStars();
+
+    bool     PlayerExists( const uint8_t player_id );
+    uint32_t GetPlayerScore( const uint8_t player_id );
+    uint8_t  GetPlayerDifficulty( const uint8_t player_id );
+    uint8_t  GetPlayerTrackType( const uint8_t player_id );
+
+    void DumpData();
+
+  private:
+    void EnableTimestamps();
+    int  ReceiveDatagram( uint8_t* buffer, const size_t buffer_size, struct sockaddr_in* from );
+
+    bool               m_is_sender;
+    int                m_network_socket;
+    uint32_t           m_expected_source_ip;
+    uint32_t           m_target_ip;
+    struct sockaddr_in m_target_address;
+
+    uint8_t            m_data_buffer[ 1024 ];
+    int                m_data_buffer_last_size;
+    bool               m_realtime;
+
+    int                m_timestamp_option;   // SO_TIMESTAMPING, SO_TIMESTAMPNS or 0
+    uint64_t           m_arrival_ns;
+    uint64_t           m_read_ns;
+    RB3E_DelayHistogram m_queue_histogram;
+
+    uint8_t            m_event_type_last;
+    uint8_t            m_game_state;
+    uint8_t            m_weight_left;
+    uint8_t            m_weight_right;
+    uint32_t           m_band_score;
+    uint8_t            m_band_stars;
+
+    uint8_t            m_player_exists[ 4 ];
+    uint32_t           m_player_score[ 4 ];
+    uint8_t            m_player_difficulty[ 4 ];
+    uint8_t            m_player_track_type[ 4 ];
+
+    std::string        m_song_name;
+    std::string        m_song_artist;
+    std::string        m_song_name_short;
+};
+
+#endif
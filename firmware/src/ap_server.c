@@ -22,6 +22,7 @@
 
 #define AP_PASSWORD "rockband"
 #define AP_IP_OCTET 4
+#define AP_WAKE_MS  100     // Longest sleep without network work (watchdog, reboot check)
 
 /* ---------------- Globals ---------------- */
 
@@ -33,6 +34,16 @@ static volatile bool reboot_required = false;
 static char pending_ssid[64];
 static char pending_pass[64];
 
+// Portal timing - noted in lwIP callbacks, printed from the AP loop
+static volatile uint32_t response_count = 0;
+static volatile uint32_t response_last_us = 0;
+static volatile uint32_t response_max_us = 0;
+static volatile uint64_t response_total_us = 0;
+static volatile uint64_t portal_ack_us = 0;     // DHCP ACK the last portal load was timed from
+static volatile uint32_t portal_after_ack_ms = 0;
+static volatile bool portal_timed = false;
+static uint32_t reported_responses = 0;
+
 /* ---------------- HTML ---------------- */
 
 static const char *html_form =
@@ -348,6 +359,45 @@ static bool parse_query(const char *q) {
     return true;
 }
 
+/* ---------------- Portal Timing ---------------- */
+
+// Connection accepted (arg = time_us_32() then) to response acknowledged
+static void note_response_time(void *arg) {
+    uint32_t elapsed = time_us_32() - (uint32_t)(uintptr_t)arg;
+    response_last_us = elapsed;
+    response_total_us += elapsed;
+    if (elapsed > response_max_us) {
+        response_max_us = elapsed;
+    }
+    response_count++;
+}
+
+// The form was requested: the portal is up on the client. Timed once per DHCP lease
+static void note_portal_served(void) {
+    uint64_t ack_us = dhcp_server.last_ack_us;
+    if (ack_us != 0 && ack_us != portal_ack_us) {
+        portal_ack_us = ack_us;
+        portal_after_ack_ms = (uint32_t)((time_us_64() - ack_us) / 1000);
+        portal_timed = true;
+    }
+}
+
+static void report_portal_timing(void) {
+    uint32_t count = response_count;
+    if (count != reported_responses && count > 0) {
+        reported_responses = count;
+        printf("AP: Response in %lu us (avg %lu, max %lu over %lu)\n",
+               (unsigned long)response_last_us,
+               (unsigned long)(response_total_us / count),
+               (unsigned long)response_max_us, (unsigned long)count);
+    }
+    if (portal_timed) {
+        portal_timed = false;
+        printf("AP: Portal page requested %lu ms after DHCP ACK\n",
+               (unsigned long)portal_after_ack_ms);
+    }
+}
+
 /* ---------------- HTTP / TCP ---------------- */
 
 // Detect captive portal probe requests from various OS/browsers
@@ -401,7 +451,14 @@ static bool send_http_204(struct tcp_pcb *pcb) {
     return true;
 }
 
+// Called once per acknowledged chunk; the response is done when nothing
+// is left unsent or unacknowledged
 static err_t http_sent_cb(void *arg, struct tcp_pcb *pcb, u16_t len) {
+    if (arg == NULL || tcp_sndqueuelen(pcb) != 0) {
+        return ERR_OK;
+    }
+    note_response_time(arg);
+    tcp_arg(pcb, NULL);
     tcp_close(pcb);
     return ERR_OK;
 }
@@ -518,9 +575,11 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err
         success = send_http_response(pcb, NULL, "302 Found", redirect_url);
     } else if (strncmp(buf, "GET / ", 6) == 0 || strncmp(buf, "GET /index", 10) == 0) {
         // Main page request
+        note_portal_served();
         success = send_http_response(pcb, html_form, "200 OK", NULL);
     } else {
         // Any other request - serve the form (catch-all for captive portal)
+        note_portal_served();
         success = send_http_response(pcb, html_form, "200 OK", NULL);
     }
 
@@ -539,7 +598,10 @@ static err_t http_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
 
     printf("AP: New HTTP connection from %s\n", ip4addr_ntoa(&pcb->remote_ip));
 
-    // Set up callbacks for this connection
+    // Set up callbacks for this connection; the arg times the response
+    // and is cleared once it is acknowledged, so a start of 0 is taken as 1
+    uint32_t accepted_us = time_us_32();
+    tcp_arg(pcb, (void *)(uintptr_t)(accepted_us ? accepted_us : 1));
     tcp_recv(pcb, http_recv);
     tcp_err(pcb, http_err_cb);
 
@@ -640,23 +702,29 @@ void run_ap_setup_mode(void) {
     cyw43_arch_lwip_end();
 
     while (true) {
-        // CRITICAL: Poll the network stack to process TCP callbacks
-        // Without this, TCP connections may not be handled reliably
+        // Sleep until the CYW43 interrupt or the next lwIP timer, then
+        // process the work at once, so a DNS/DHCP/HTTP exchange no longer
+        // waits for a fixed poll tick. In the threadsafe background build
+        // the work already ran from the IRQ and this is only a wait.
+        cyw43_arch_wait_for_work_until(make_timeout_time_ms(AP_WAKE_MS));
         cyw43_arch_poll();
 
+        report_portal_timing();
+
         if (reboot_required) {
             // Allow time for HTTP response to be sent before rebooting
             printf("AP: Rebooting in 1s...\n");
-            for (int i = 0; i < 50; i++) {
-                cyw43_arch_poll();  // Keep polling during reboot delay
-                sleep_ms(20);
+            absolute_time_t reboot_at = make_timeout_time_ms(1000);
+            while (!time_reached(reboot_at)) {
+                cyw43_arch_wait_for_work_until(reboot_at);
+                cyw43_arch_poll();  // Keep serving during reboot delay
+                watchdog_update();
             }
             watchdog_enable(100, 1);
             while (1);
         }
 
         watchdog_update();
-        sleep_ms(10);  // Reduced from 200ms for more responsive TCP handling
     }
 }
 
@@ -0,0 +1,120 @@
+/*
+ * Board Profile for RB3E StageKit Bridge
+ *
+ * Statistics are written by the main loop only.
+ */
+
+#include "board.h"
+#include "usb_host.h"
+#include "cue_player.h"
+#include "trace.h"
+#include "mem_pool.h"
+#include "littlefs_hal.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include <stdio.h>
+
+#define POOL_BYTES  (MEM_POOL_SMALL_COUNT * MEM_POOL_SMALL_SIZE + \
+                     MEM_POOL_MEDIUM_COUNT * MEM_POOL_MEDIUM_SIZE + \
+                     MEM_POOL_LARGE_COUNT * MEM_POOL_LARGE_SIZE)
+
+_Static_assert(CUE_MAX_ENTRIES <= 0xFFFF, "cue indexes are 16-bit");
+_Static_assert(CUE_DISPATCH_RING_SIZE <= 0xFF && USB_CMD_QUEUE_SIZE <= 0xFF,
+               "ring indexes are 8-bit");
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+#if !BOARD_CYCLE_COUNTER
+uint32_t board_cycles_per_us = 125;
+#endif
+
+static uint32_t scenes = 0;
+static uint32_t scene_cycles = 0;
+static uint32_t scene_cycles_max = 0;
+static uint32_t loop_passes = 0;
+static uint32_t loop_cycles_max = 0;
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void board_init(void)
+{
+    uint32_t clk_khz = clock_get_hz(clk_sys) / 1000;
+
+#if BOARD_CYCLE_COUNTER
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#else
+    board_cycles_per_us = clk_khz / 1000;
+#endif
+
+    printf("Board: %s, %d core%s, %lu MHz, cycles from %s\n",
+#if defined(PICO_RP2350)
+           "pico2_w",
+#elif defined(PICO_RP2040)
+           "pico_w",
+#else
+           "host",
+#endif
+           RB3E_DUAL_CORE ? 2 : 1, RB3E_DUAL_CORE ? "s" : "",
+           (unsigned long)(clk_khz / 1000),
+           BOARD_CYCLE_COUNTER ? "DWT counter" : "us timer");
+    printf("Board: USB queue %d, %d cues, %d trace events, %lu KB pool, %lu KB filesystem\n",
+           USB_CMD_QUEUE_SIZE, CUE_MAX_ENTRIES, TRACE_BUFFER_EVENTS,
+           (unsigned long)(POOL_BYTES / 1024), (unsigned long)(littlefs_get_fs_size() / 1024));
+}
+
+void board_note_scene(uint32_t cycles)
+{
+    scenes++;
+    scene_cycles += cycles;
+    if (cycles > scene_cycles_max) {
+        scene_cycles_max = cycles;
+    }
+}
+
+void board_note_loop(uint32_t cycles)
+{
+    loop_passes++;
+    if (cycles > loop_cycles_max) {
+        loop_cycles_max = cycles;
+    }
+}
+
+void board_get_info(ctrl_board_t *out)
+{
+#if defined(PICO_RP2350)
+    out->board = CTRL_BOARD_PICO2_W;
+#elif defined(PICO_RP2040)
+    out->board = CTRL_BOARD_PICO_W;
+#else
+    out->board = CTRL_BOARD_HOST;
+#endif
+    out->cores = RB3E_DUAL_CORE ? 2 : 1;
+    out->cycle_counter = BOARD_CYCLE_COUNTER;
+    out->reserved = 0;
+    out->sys_clk_khz = clock_get_hz(clk_sys) / 1000;
+    out->usb_queue = USB_CMD_QUEUE_SIZE;
+    out->cue_entries = CUE_MAX_ENTRIES;
+    out->trace_events = TRACE_BUFFER_EVENTS;
+    out->pool_bytes = POOL_BYTES;
+    out->fs_bytes = littlefs_get_fs_size();
+    out->scenes = scenes;
+    out->scene_cycles = scene_cycles;
+    out->scene_cycles_max = scene_cycles_max;
+    out->loop_passes = loop_passes;
+    out->loop_cycles_max = loop_cycles_max;
+}
+
+void board_reset_stats(void)
+{
+    scenes = 0;
+    scene_cycles = 0;
+    scene_cycles_max = 0;
+    loop_passes = 0;
+    loop_cycles_max = 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Board Profile for RB3E StageKit Bridge
+ *
+ * The pico_w and pico2_w builds share one code base; the pico2_w profile
+ * (CMakeLists.txt) spends the RP2350's extra SRAM on deeper queues, a
+ * larger cue list and trace buffer, and runs the supervisor on core 1.
+ * This module reports which profile is running and times main loop work
+ * in CPU cycles, so the two targets can be compared directly
+ * (tools/rb3e_arch_bench.py).
+ *
+ * The RP2350's Cortex-M33 has a DWT cycle counter. The RP2040's
+ * Cortex-M0+ has none, so there cycles are the microsecond timer scaled
+ * by the system clock - the same unit, at 1 us resolution.
+ */
+
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#if defined(PICO_RP2350)
+#include "hardware/structs/m33.h"
+#else
+#include "pico/stdlib.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+
+// Supervisor checks on core 1 (RB3E_DUAL_CORE build option)
+#ifndef RB3E_DUAL_CORE
+#define RB3E_DUAL_CORE          0
+#endif
+
+#if defined(PICO_RP2350)
+#define BOARD_CYCLE_COUNTER     1
+#else
+#define BOARD_CYCLE_COUNTER     0
+#endif
+
+//--------------------------------------------------------------------
+// Cycle Counter
+//--------------------------------------------------------------------
+
+#if !BOARD_CYCLE_COUNTER
+extern uint32_t board_cycles_per_us;
+#endif
+
+/**
+ * Current cycle count (wraps; subtract two readings for a duration)
+ */
+static inline uint32_t board_cycles(void)
+{
+#if BOARD_CYCLE_COUNTER
+    return m33_hw->dwt_cyccnt;
+#else
+    return time_us_32() * board_cycles_per_us;
+#endif
+}
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Start the cycle counter and print the profile - call early in boot
+ */
+void board_init(void);
+
+/**
+ * Record the cost of one scene apply
+ *
+ * @param cycles board_cycles() difference across the apply
+ */
+void board_note_scene(uint32_t cycles);
+
+/**
+ * Record the cost of one main loop pass
+ */
+void board_note_loop(uint32_t cycles);
+
+/**
+ * Fill the profile and cycle statistics
+ */
+void board_get_info(ctrl_board_t *out);
+
+/**
+ * Clear the cycle statistics
+ */
+void board_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOARD_H_ */
@@ -0,0 +1,146 @@
+/*
+ * Console Liveness Watch for RB3E StageKit Bridge
+ *
+ * The ALIVE period is learned from the console's own beats, so a slow
+ * sender is not declared lost between two of them.
+ */
+
+#include "console_watch.h"
+#include <stdio.h>
+
+#define ALIVE_MIN_PERIOD_MS     100     // Intervals outside this are not a cadence
+#define ALIVE_MAX_PERIOD_MS     30000
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+// Receive callback
+static volatile uint32_t alive_last_ms = 0;
+static volatile uint32_t alive_period_ms = 0;   // 0 = not learned
+static volatile uint16_t alive_intervals = 0;
+static volatile uint8_t game_state = CTRL_CONSOLE_UNKNOWN;
+static volatile uint32_t state_change_ms = 0;
+
+// Main loop
+static uint16_t trust_from = 0;         // alive_intervals when ALIVE was last lost
+static bool holding = false;            // Inside a quiet gap the timeout would have ended
+static uint32_t holds = 0;
+static uint32_t timeout_blackouts = 0;
+static uint32_t menu_blackouts = 0;
+static uint32_t alive_lost_blackouts = 0;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+// Enough beats since ALIVE was last lost to know its period
+static bool alive_trusted(void)
+{
+    return (uint16_t)(alive_intervals - trust_from) >= ALIVE_TRUST_INTERVALS && alive_period_ms != 0;
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void console_watch_note_alive(uint32_t now_ms)
+{
+    if (alive_last_ms != 0) {
+        uint32_t interval = now_ms - alive_last_ms;
+        if (interval >= ALIVE_MIN_PERIOD_MS && interval <= ALIVE_MAX_PERIOD_MS) {
+            if (alive_period_ms == 0) {
+                alive_period_ms = interval;
+            } else if (interval < alive_period_ms * 2) {
+                // Gaps with missed beats in them do not stretch the period
+                alive_period_ms += ((int32_t)interval - (int32_t)alive_period_ms) / 4;
+            }
+            if (alive_intervals < UINT16_MAX) {
+                alive_intervals++;
+            }
+        }
+    }
+    // 0 marks "none yet", so a beat at boot time 0 is taken as 1 ms
+    alive_last_ms = now_ms ? now_ms : 1;
+}
+
+void console_watch_note_state(bool in_game, uint32_t now_ms)
+{
+    uint8_t state = in_game ? CTRL_CONSOLE_IN_GAME : CTRL_CONSOLE_MENUS;
+    if (state != game_state) {
+        game_state = state;
+        state_change_ms = now_ms;
+    }
+}
+
+console_verdict_t console_watch_check(uint32_t now_ms, uint32_t quiet_ms,
+                                      uint32_t safety_timeout_ms, uint32_t alive_timeout_ms)
+{
+    uint32_t period = alive_period_ms;
+    uint32_t since_alive = now_ms - alive_last_ms;
+    bool live = false;
+
+    if (alive_trusted()) {
+        uint32_t lost_ms = period * ALIVE_MISSED_BEATS;
+        if (lost_ms < alive_timeout_ms) {
+            lost_ms = alive_timeout_ms;
+        }
+        live = since_alive <= lost_ms;
+
+        // Neither ALIVE nor StageKit for that long: the console is gone.
+        // Fresh beats are needed to trust ALIVE again; until then the timeout applies
+        if (!live && quiet_ms > lost_ms) {
+            trust_from = alive_intervals;
+            holding = false;
+            alive_lost_blackouts++;
+            printf("Console: ALIVE lost (%lu ms) - blackout\n", (unsigned long)since_alive);
+            return CONSOLE_BLACKOUT_ALIVE_LOST;
+        }
+    }
+
+    // Back to the menus since the lights were last driven
+    if (game_state == CTRL_CONSOLE_MENUS &&
+        (int32_t)(state_change_ms - (now_ms - quiet_ms)) >= 0) {
+        holding = false;
+        menu_blackouts++;
+        printf("Console: Back in menus - blackout\n");
+        return CONSOLE_BLACKOUT_MENUS;
+    }
+
+    if (quiet_ms <= safety_timeout_ms) {
+        holding = false;
+        return CONSOLE_KEEP;
+    }
+
+    // Silence in a song from a console that is still beating
+    if (live && game_state != CTRL_CONSOLE_MENUS) {
+        if (!holding) {
+            holding = true;
+            holds++;
+        }
+        return CONSOLE_KEEP;
+    }
+
+    holding = false;
+    timeout_blackouts++;
+    return CONSOLE_BLACKOUT_TIMEOUT;
+}
+
+void console_watch_get_stats(ctrl_console_t *out)
+{
+    out->game_state = game_state;
+    out->alive_trusted = alive_trusted() ? 1 : 0;
+    out->alive_period_ms = (uint16_t)alive_period_ms;
+    out->holds = holds;
+    out->timeout_blackouts = timeout_blackouts;
+    out->menu_blackouts = menu_blackouts;
+    out->alive_lost_blackouts = alive_lost_blackouts;
+}
+
+void console_watch_reset_stats(void)
+{
+    holds = 0;
+    timeout_blackouts = 0;
+    menu_blackouts = 0;
+    alive_lost_blackouts = 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Console Liveness Watch for RB3E StageKit Bridge
+ *
+ * The safety timeout alone cannot tell a quiet passage from a dead
+ * console: it blacks the kit out after a few seconds of a slow song,
+ * and it leaves the lights up for the same few seconds after the
+ * console went back to the menus or off the network. The console's
+ * ALIVE beats and STATE events answer that:
+ *   - in game with ALIVE arriving on its usual cadence, quiet is part
+ *     of the song and the lights are held
+ *   - a switch to the menus after the last StageKit packet blacks the
+ *     kit out at once, and so do ALIVE and StageKit both stopping for
+ *     a few ALIVE periods
+ *   - a sender without an ALIVE cadence keeps the plain safety timeout
+ *
+ * The note functions run in the UDP receive callback and write only
+ * their own fields; console_watch_check() runs in the main loop.
+ */
+
+#ifndef _CONSOLE_WATCH_H_
+#define _CONSOLE_WATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Watch Constants
+//--------------------------------------------------------------------
+
+#define ALIVE_TIMEOUT_MS        3000    // Default for CTRL_PARAM_ALIVE_TIMEOUT_MS
+#define ALIVE_MISSED_BEATS      3       // ALIVE is lost after this many periods (or the param)
+#define ALIVE_TRUST_INTERVALS   2       // Intervals seen before the cadence counts
+
+//--------------------------------------------------------------------
+// Types
+//--------------------------------------------------------------------
+
+typedef enum {
+    CONSOLE_KEEP = 0,           // Leave the lights as they are
+    CONSOLE_BLACKOUT_TIMEOUT,   // Quiet past the safety timeout, no live console to hold for
+    CONSOLE_BLACKOUT_MENUS,     // Console went to the menus
+    CONSOLE_BLACKOUT_ALIVE_LOST // Console stopped sending ALIVE (and StageKit)
+} console_verdict_t;
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Record an ALIVE packet from the active source
+ */
+void console_watch_note_alive(uint32_t now_ms);
+
+/**
+ * Record a STATE packet from the active source
+ *
+ * @param in_game true in a song, false in the menus
+ */
+void console_watch_note_state(bool in_game, uint32_t now_ms);
+
+/**
+ * Decide whether lit lights should stay on
+ *
+ * Call every main loop pass while the lights are on and no cue list
+ * is running.
+ *
+ * @param quiet_ms Time since the last StageKit or scene packet
+ * @param safety_timeout_ms CTRL_PARAM_SAFETY_TIMEOUT_MS
+ * @param alive_timeout_ms CTRL_PARAM_ALIVE_TIMEOUT_MS
+ * @return CONSOLE_KEEP, or why to black the kit out now
+ */
+console_verdict_t console_watch_check(uint32_t now_ms, uint32_t quiet_ms,
+                                      uint32_t safety_timeout_ms, uint32_t alive_timeout_ms);
+
+/**
+ * Fill the console state and blackout counters
+ */
+void console_watch_get_stats(ctrl_console_t *out);
+
+/**
+ * Clear the blackout counters
+ */
+void console_watch_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CONSOLE_WATCH_H_ */
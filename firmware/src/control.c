@@ -0,0 +1,600 @@
+/*
+ * Control Protocol Handler for RB3E StageKit Bridge
+ *
+ * Dispatch is a table indexed directly by message ID, so every request
+ * costs one bounds check and one lookup regardless of how many
+ * messages exist.
+ */
+
+#include "control.h"
+#include "params.h"
+#include "test_pattern.h"
+#include "cue_player.h"
+#include "network.h"
+#include "usb_host.h"
+#include "supervisor.h"
+#include "source_arbiter.h"
+#include "trace.h"
+#include "mem_pool.h"
+#include "ota.h"
+#include "radio_ctrl.h"
+#include "board.h"
+#include "littlefs_hal.h"
+#include "link_quality.h"
+#include "console_watch.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+static uint32_t request_count = 0;
+
+// Deferred to control_task() - written by the network callback
+static volatile bool pattern_pending = false;
+static ctrl_test_pattern_t pending_pattern;
+static volatile bool reset_stats_pending = false;
+static volatile bool cue_go_pending = false;
+static ctrl_cue_go_t pending_cue_go;
+static volatile bool cue_stop_pending = false;
+
+//--------------------------------------------------------------------
+// Message Handlers
+//--------------------------------------------------------------------
+
+// Handlers return a CTRL_STATUS_* code and may fill resp/resp_len
+typedef uint8_t (*ctrl_handler_fn)(const uint8_t *payload, uint16_t len,
+                                   uint8_t *resp, uint16_t *resp_len);
+
+static uint8_t handle_ping(const uint8_t *payload, uint16_t len,
+                           uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_param_get(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    ctrl_param_id_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    ctrl_param_t param;
+    if (!params_describe(req.id, &param)) {
+        return CTRL_STATUS_BAD_PARAM;
+    }
+
+    memcpy(resp, &param, sizeof(param));
+    *resp_len = sizeof(param);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_param_set(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    ctrl_param_value_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    uint8_t status = params_set(req.id, req.value);
+    if (status != CTRL_STATUS_OK) {
+        return status;
+    }
+
+    // Echo the stored value so the client sees what took effect
+    ctrl_param_t param;
+    params_describe(req.id, &param);
+    memcpy(resp, &param, sizeof(param));
+    *resp_len = sizeof(param);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_param_list(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    uint16_t out = 0;
+
+    for (int i = 0; i < params_count(); i++) {
+        if (out + sizeof(ctrl_param_t) > CTRL_MAX_PAYLOAD) {
+            break;
+        }
+        ctrl_param_t param;
+        params_describe(params_id_at(i), &param);
+        memcpy(resp + out, &param, sizeof(param));
+        out += sizeof(param);
+    }
+
+    *resp_len = out;
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_get_state(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    const network_stats_t *net = network_get_stats();
+    const usb_stats_t *usb = usb_get_stats();
+    const usb_recovery_stats_t *rec = usb_get_recovery_stats();
+
+    ctrl_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.stagekit = *usb_get_stagekit_state();
+    state.usb_connected = usb_stagekit_connected() ? 1 : 0;
+    state.test_pattern = test_pattern_active();
+    state.uptime_ms = to_ms_since_boot(get_absolute_time());
+    state.wifi_rssi = net->wifi_rssi;
+    state.packets_received = net->packets_received;
+    state.packets_processed = net->packets_processed;
+    state.packets_invalid = net->packets_invalid;
+    state.telemetry_sent = net->telemetry_sent;
+    state.discovery_received = net->discovery_received;
+    state.usb_commands_sent = usb->commands_sent;
+    state.usb_commands_dropped = usb->commands_dropped;
+    state.usb_xfer_timeouts = rec->xfer_timeouts;
+    state.usb_xfer_errors = rec->xfer_errors;
+    state.control_requests = request_count;
+    state.scenes_applied = usb->scenes_applied;
+    state.scene_commands_saved = usb->scene_commands_saved;
+    state.packets_rejected = net->packets_rejected;
+    state.active_source = source_arbiter_active();
+    state.source_switches = source_arbiter_switches();
+    state.probes_answered = net->probes_answered;
+#if PICO_CYW43_ARCH_POLL
+    state.cyw43_arch = CTRL_CYW43_ARCH_POLL;
+#else
+    state.cyw43_arch = CTRL_CYW43_ARCH_BACKGROUND;
+#endif
+    radio_ctrl_get_stats(&state.radio);
+    board_get_info(&state.board);
+    littlefs_get_info(&state.fs);
+    link_quality_get_stats(&state.link);
+    console_watch_get_stats(&state.console);
+
+    memcpy(resp, &state, sizeof(state));
+    *resp_len = sizeof(state);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_test_pattern(const uint8_t *payload, uint16_t len,
+                                   uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    if (pattern_pending) {
+        return CTRL_STATUS_BUSY;
+    }
+
+    ctrl_test_pattern_t req;
+    memcpy(&req, payload, sizeof(req));
+    if (req.pattern > CTRL_PATTERN_ALL_ON) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    pending_pattern = req;
+    pattern_pending = true;
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_reset_stats(const uint8_t *payload, uint16_t len,
+                                  uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+    reset_stats_pending = true;
+    return CTRL_STATUS_OK;
+}
+
+// Cue list upload runs here; playback control is deferred
+static uint8_t handle_cue_begin(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_cue_begin_t req;
+    memcpy(&req, payload, sizeof(req));
+    return cue_player_begin(req.count);
+}
+
+static uint8_t handle_cue_data(const uint8_t *payload, uint16_t len,
+                               uint8_t *resp, uint16_t *resp_len)
+{
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_cue_data_t req;
+    memcpy(&req, payload, sizeof(req));
+    if (req.count > CTRL_CUE_MAX_PER_PACKET ||
+        len < sizeof(req) + req.count * sizeof(ctrl_cue_t)) {
+        return CTRL_STATUS_BAD_LENGTH;
+    }
+
+    // Payload is not aligned - copy before handing over
+    ctrl_cue_t cues[CTRL_CUE_MAX_PER_PACKET];
+    memcpy(cues, payload + sizeof(req), req.count * sizeof(ctrl_cue_t));
+    return cue_player_write(req.index, cues, req.count);
+}
+
+static uint8_t handle_cue_commit(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_cue_commit_t req;
+    memcpy(&req, payload, sizeof(req));
+    return cue_player_commit(req.crc32);
+}
+
+static uint8_t handle_cue_go(const uint8_t *payload, uint16_t len,
+                             uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_cue_status_t status;
+    cue_player_get_status(&status);
+    if (status.state == CTRL_CUE_STATE_EMPTY) {
+        return CTRL_STATUS_NOT_READY;
+    }
+
+    memcpy(&pending_cue_go, payload, sizeof(pending_cue_go));
+    cue_stop_pending = false;
+    cue_go_pending = true;
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_cue_stop(const uint8_t *payload, uint16_t len,
+                               uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+    cue_go_pending = false;
+    cue_stop_pending = true;
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_cue_status(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    ctrl_cue_status_t status;
+    cue_player_get_status(&status);
+    memcpy(resp, &status, sizeof(status));
+    *resp_len = sizeof(status);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_source_list(const uint8_t *payload, uint16_t len,
+                                  uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    ctrl_source_t sources[SOURCE_MAX_TRACKED];
+    int count = source_arbiter_list(sources, SOURCE_MAX_TRACKED);
+    memcpy(resp, sources, count * sizeof(ctrl_source_t));
+    *resp_len = count * sizeof(ctrl_source_t);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_source_priority(const uint8_t *payload, uint16_t len,
+                                      uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_source_priority_t req;
+    memcpy(&req, payload, sizeof(req));
+    if (req.addr == 0) {
+        return CTRL_STATUS_BAD_PARAM;
+    }
+    return source_arbiter_set_priority(req.addr, req.priority) ?
+           CTRL_STATUS_OK : CTRL_STATUS_BUSY;
+}
+
+static uint8_t handle_trace_status(const uint8_t *payload, uint16_t len,
+                                   uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    ctrl_trace_status_t status;
+    trace_get_status(&status);
+    memcpy(resp, &status, sizeof(status));
+    *resp_len = sizeof(status);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_trace_control(const uint8_t *payload, uint16_t len,
+                                    uint8_t *resp, uint16_t *resp_len)
+{
+    ctrl_trace_control_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    if (req.action == CTRL_TRACE_START) {
+        if (req.mode > CTRL_TRACE_MODE_ONESHOT) {
+            return CTRL_STATUS_BAD_PARAM;
+        }
+        if (!trace_start(req.mode)) {
+            return CTRL_STATUS_NOT_READY;
+        }
+    } else if (req.action == CTRL_TRACE_STOP) {
+        trace_stop();
+    } else {
+        return CTRL_STATUS_BAD_PARAM;
+    }
+    return handle_trace_status(payload, len, resp, resp_len);
+}
+
+static uint8_t handle_trace_read(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+
+    ctrl_trace_status_t status;
+    trace_get_status(&status);
+    if (status.running) {
+        return CTRL_STATUS_BUSY;
+    }
+
+    ctrl_trace_read_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    ctrl_trace_event_t events[CTRL_TRACE_MAX_PER_PACKET];
+    req.count = trace_read(req.index, events, CTRL_TRACE_MAX_PER_PACKET);
+    memcpy(resp, &req, sizeof(req));
+    memcpy(resp + sizeof(req), events, req.count * sizeof(ctrl_trace_event_t));
+    *resp_len = sizeof(req) + req.count * sizeof(ctrl_trace_event_t);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_trace_names(const uint8_t *payload, uint16_t len,
+                                  uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    *resp_len = trace_get_names(resp, CTRL_MAX_PAYLOAD);
+    return *resp_len ? CTRL_STATUS_OK : CTRL_STATUS_OUT_OF_RANGE;
+}
+
+static uint8_t handle_pool_stats(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    ctrl_pool_t pools[MEM_POOL_CLASS_COUNT];
+    mem_pool_get_stats(pools);
+    memcpy(resp, pools, sizeof(pools));
+    *resp_len = sizeof(pools);
+    return CTRL_STATUS_OK;
+}
+
+// Firmware update: chunks are copied here, flash is written by ota_task()
+static uint8_t handle_ota_begin(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+
+    ctrl_ota_begin_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    ctrl_ota_status_t status;
+    uint8_t result = ota_begin(&req, &status);
+    memcpy(resp, &status, sizeof(status));
+    *resp_len = sizeof(status);
+    return result;
+}
+
+static uint8_t handle_ota_data(const uint8_t *payload, uint16_t len,
+                               uint8_t *resp, uint16_t *resp_len)
+{
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_ota_data_t req;
+    memcpy(&req, payload, sizeof(req));
+    if (len < sizeof(req) + req.length) {
+        return CTRL_STATUS_BAD_LENGTH;
+    }
+    return ota_write(req.offset, payload + sizeof(req), req.length, req.crc32);
+}
+
+static uint8_t handle_ota_commit(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+
+    ctrl_ota_commit_t req;
+    memcpy(&req, payload, sizeof(req));
+    return ota_commit(req.install != 0);
+}
+
+static uint8_t handle_ota_status(const uint8_t *payload, uint16_t len,
+                                 uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+
+    ctrl_ota_status_t status;
+    ota_get_status(&status);
+    memcpy(resp, &status, sizeof(status));
+    *resp_len = sizeof(status);
+    return CTRL_STATUS_OK;
+}
+
+static uint8_t handle_ota_abort(const uint8_t *payload, uint16_t len,
+                                uint8_t *resp, uint16_t *resp_len)
+{
+    (void)payload;
+    (void)len;
+    (void)resp;
+    *resp_len = 0;
+    return ota_abort();
+}
+
+//--------------------------------------------------------------------
+// Dispatch Table
+//--------------------------------------------------------------------
+
+typedef struct {
+    uint16_t min_len;           // Minimum request payload length
+    ctrl_handler_fn handler;    // NULL = unknown message
+} ctrl_dispatch_t;
+
+static const ctrl_dispatch_t dispatch_table[CTRL_MSG_RESPONSE] = {
+    [CTRL_MSG_PING]         = { 0,                          handle_ping },
+    [CTRL_MSG_PARAM_GET]    = { sizeof(ctrl_param_id_t),    handle_param_get },
+    [CTRL_MSG_PARAM_SET]    = { sizeof(ctrl_param_value_t), handle_param_set },
+    [CTRL_MSG_PARAM_LIST]   = { 0,                          handle_param_list },
+    [CTRL_MSG_GET_STATE]    = { 0,                          handle_get_state },
+    [CTRL_MSG_TEST_PATTERN] = { sizeof(ctrl_test_pattern_t), handle_test_pattern },
+    [CTRL_MSG_RESET_STATS]  = { 0,                          handle_reset_stats },
+    [CTRL_MSG_CUE_BEGIN]    = { sizeof(ctrl_cue_begin_t),   handle_cue_begin },
+    [CTRL_MSG_CUE_DATA]     = { sizeof(ctrl_cue_data_t),    handle_cue_data },
+    [CTRL_MSG_CUE_COMMIT]   = { sizeof(ctrl_cue_commit_t),  handle_cue_commit },
+    [CTRL_MSG_CUE_GO]       = { sizeof(ctrl_cue_go_t),      handle_cue_go },
+    [CTRL_MSG_CUE_STOP]     = { 0,                          handle_cue_stop },
+    [CTRL_MSG_CUE_STATUS]   = { 0,                          handle_cue_status },
+    [CTRL_MSG_SOURCE_LIST]  = { 0,                          handle_source_list },
+    [CTRL_MSG_SOURCE_PRIORITY] = { sizeof(ctrl_source_priority_t), handle_source_priority },
+    [CTRL_MSG_TRACE_CONTROL] = { sizeof(ctrl_trace_control_t), handle_trace_control },
+    [CTRL_MSG_TRACE_STATUS] = { 0,                          handle_trace_status },
+    [CTRL_MSG_TRACE_READ]   = { sizeof(ctrl_trace_read_t),  handle_trace_read },
+    [CTRL_MSG_TRACE_NAMES]  = { 0,                          handle_trace_names },
+    [CTRL_MSG_POOL_STATS]   = { 0,                          handle_pool_stats },
+    [CTRL_MSG_OTA_BEGIN]    = { sizeof(ctrl_ota_begin_t),   handle_ota_begin },
+    [CTRL_MSG_OTA_DATA]     = { sizeof(ctrl_ota_data_t),    handle_ota_data },
+    [CTRL_MSG_OTA_COMMIT]   = { sizeof(ctrl_ota_commit_t),  handle_ota_commit },
+    [CTRL_MSG_OTA_STATUS]   = { 0,                          handle_ota_status },
+    [CTRL_MSG_OTA_ABORT]    = { 0,                          handle_ota_abort },
+};
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+uint16_t control_handle_request(const uint8_t *req, uint16_t len,
+                                uint8_t *resp, uint16_t resp_cap)
+{
+    if (resp_cap < CTRL_MAX_RESPONSE) {
+        return 0;
+    }
+
+    const ctrl_header_t *hdr = (const ctrl_header_t *)req;
+    uint8_t msg_id = hdr->msg_id;
+
+    // Never answer responses - avoids reply loops between bridges
+    if (msg_id & CTRL_MSG_RESPONSE) {
+        return 0;
+    }
+
+    request_count++;
+
+    const uint8_t *payload = req + sizeof(ctrl_header_t);
+    uint16_t payload_len = hdr->length;
+    uint8_t *resp_payload = resp + sizeof(ctrl_header_t);
+    uint16_t resp_len = 0;
+    uint8_t status;
+
+    (void)len;  // Payload length already checked by ctrl_check_header()
+
+    const ctrl_dispatch_t *entry = &dispatch_table[msg_id];
+    if (entry->handler == NULL) {
+        status = CTRL_STATUS_UNKNOWN_MSG;
+    } else if (payload_len < entry->min_len) {
+        status = CTRL_STATUS_BAD_LENGTH;
+    } else {
+        status = entry->handler(payload, payload_len, resp_payload, &resp_len);
+    }
+
+    if (status != CTRL_STATUS_OK) {
+        resp_len = 0;
+    }
+
+    ctrl_build_header((ctrl_header_t *)resp, msg_id | CTRL_MSG_RESPONSE,
+                      hdr->seq, status, resp_len);
+    return sizeof(ctrl_header_t) + resp_len;
+}
+
+void control_task(void)
+{
+    bool work = pattern_pending || cue_stop_pending || cue_go_pending || reset_stats_pending;
+    if (!work) {
+        return;
+    }
+    TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_CONTROL, 0);
+
+    if (pattern_pending) {
+        ctrl_test_pattern_t req = pending_pattern;
+        pattern_pending = false;
+
+        printf("Control: Test pattern %d (step %d ms, duration %d ms)\n",
+               req.pattern, req.step_ms, req.duration_ms);
+        test_pattern_start(req.pattern, req.step_ms, req.duration_ms);
+    }
+
+    if (cue_stop_pending) {
+        cue_stop_pending = false;
+        cue_player_stop();
+    }
+
+    if (cue_go_pending) {
+        ctrl_cue_go_t req = pending_cue_go;
+        cue_go_pending = false;
+
+        uint8_t status = cue_player_go(req.start_ms, req.position_ms);
+        if (status != CTRL_STATUS_OK) {
+            printf("Control: Cue GO failed (status %d)\n", status);
+        }
+    }
+
+    if (reset_stats_pending) {
+        reset_stats_pending = false;
+
+        printf("Control: Resetting statistics\n");
+        network_reset_stats();
+        usb_reset_stats();
+        supervisor_reset_stats();
+        cue_player_reset_stats();
+        source_arbiter_reset_stats();
+        mem_pool_reset_stats();
+        radio_ctrl_reset_stats();
+        board_reset_stats();
+        link_quality_reset_stats();
+        console_watch_reset_stats();
+        request_count = 0;
+    }
+
+    TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_CONTROL, 0);
+}
+
+uint32_t control_get_request_count(void)
+{
+    return request_count;
+}
@@ -0,0 +1,53 @@
+/*
+ * Control Protocol Handler for RB3E StageKit Bridge
+ *
+ * Answers binary control requests (see control_protocol.h) received on
+ * the telemetry port. Requests are answered directly from the network
+ * callback; anything that touches USB is deferred to control_task().
+ */
+
+#ifndef _CONTROL_H_
+#define _CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Largest response: header plus the full parameter list
+#define CTRL_MAX_RESPONSE       (sizeof(ctrl_header_t) + CTRL_MAX_PAYLOAD)
+
+/**
+ * Handle one control request
+ *
+ * Safe to call from the network callback context.
+ *
+ * @param req Request buffer (header already checked with ctrl_check_header)
+ * @param len Request length
+ * @param resp Response buffer
+ * @param resp_cap Response buffer size
+ * @return Response length, or 0 if nothing should be sent
+ */
+uint16_t control_handle_request(const uint8_t *req, uint16_t len,
+                                uint8_t *resp, uint16_t resp_cap);
+
+/**
+ * Run actions deferred by control requests
+ *
+ * Must be called regularly from main loop.
+ */
+void control_task(void);
+
+/**
+ * Get number of control requests handled
+ */
+uint32_t control_get_request_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CONTROL_H_ */
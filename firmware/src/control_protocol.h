@@ -0,0 +1,486 @@
+/*
+ * Bridge Control Protocol Definitions
+ *
+ * Compact binary request/response protocol on the telemetry port (21071).
+ * Shared between the firmware and the Linux host tools.
+ *
+ * Every message starts with a 12-byte header. Requests carry status 0;
+ * responses echo the sequence number and set CTRL_MSG_RESPONSE in msg_id.
+ * Multi-byte fields are little-endian (native on RP2040/RP2350 and x86/ARM hosts).
+ * The magic never starts with '{', so JSON discovery packets are unaffected.
+ */
+
+#ifndef _CONTROL_PROTOCOL_H_
+#define _CONTROL_PROTOCOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stagekit_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Protocol Constants
+//--------------------------------------------------------------------
+
+// Control magic: "RB3C"
+#define CTRL_MAGIC_BYTE0        0x52  // 'R'
+#define CTRL_MAGIC_BYTE1        0x42  // 'B'
+#define CTRL_MAGIC_BYTE2        0x33  // '3'
+#define CTRL_MAGIC_BYTE3        0x43  // 'C'
+
+#define CTRL_PROTOCOL_VERSION   1
+#define CTRL_MAX_PAYLOAD        512
+#define CTRL_MSG_RESPONSE       0x80  // Set in msg_id of responses
+
+// Message IDs
+#define CTRL_MSG_PING           0x01  // -> empty
+#define CTRL_MSG_PARAM_GET      0x02  // ctrl_param_id_t -> ctrl_param_t
+#define CTRL_MSG_PARAM_SET      0x03  // ctrl_param_value_t -> ctrl_param_t
+#define CTRL_MSG_PARAM_LIST     0x04  // -> ctrl_param_t[]
+#define CTRL_MSG_PROBE          0x05  // ctrl_probe_t [+ padding] -> same, bridge timestamps filled
+#define CTRL_MSG_GET_STATE      0x10  // -> ctrl_state_t
+#define CTRL_MSG_TEST_PATTERN   0x20  // ctrl_test_pattern_t -> empty
+#define CTRL_MSG_RESET_STATS    0x21  // -> empty
+#define CTRL_MSG_CUE_BEGIN      0x30  // ctrl_cue_begin_t -> empty (discards the current list, count 0 frees it)
+#define CTRL_MSG_CUE_DATA       0x31  // ctrl_cue_data_t + ctrl_cue_t[] -> empty
+#define CTRL_MSG_CUE_COMMIT     0x32  // ctrl_cue_commit_t -> empty (CRC checked)
+#define CTRL_MSG_CUE_GO         0x33  // ctrl_cue_go_t -> empty
+#define CTRL_MSG_CUE_STOP       0x34  // -> empty
+#define CTRL_MSG_CUE_STATUS     0x35  // -> ctrl_cue_status_t
+#define CTRL_MSG_SOURCE_LIST    0x40  // -> ctrl_source_t[]
+#define CTRL_MSG_SOURCE_PRIORITY 0x41 // ctrl_source_priority_t -> empty
+#define CTRL_MSG_TRACE_CONTROL  0x50  // ctrl_trace_control_t -> ctrl_trace_status_t
+#define CTRL_MSG_TRACE_STATUS   0x51  // -> ctrl_trace_status_t
+#define CTRL_MSG_TRACE_READ     0x52  // ctrl_trace_read_t -> ctrl_trace_read_t + ctrl_trace_event_t[] (stopped only)
+#define CTRL_MSG_TRACE_NAMES    0x53  // -> event count, track count, NUL-terminated names
+#define CTRL_MSG_POOL_STATS     0x60  // -> ctrl_pool_t[] (one per size class, smallest first)
+#define CTRL_MSG_OTA_BEGIN      0x70  // ctrl_ota_begin_t -> ctrl_ota_status_t (same image resumes)
+#define CTRL_MSG_OTA_DATA       0x71  // ctrl_ota_data_t + bytes -> empty (BUSY until the last page is written)
+#define CTRL_MSG_OTA_COMMIT     0x72  // ctrl_ota_commit_t -> empty (verify, then install when quiet)
+#define CTRL_MSG_OTA_STATUS     0x73  // -> ctrl_ota_status_t
+#define CTRL_MSG_OTA_ABORT      0x74  // -> empty
+
+// Response status codes
+#define CTRL_STATUS_OK          0
+#define CTRL_STATUS_UNKNOWN_MSG 1
+#define CTRL_STATUS_BAD_LENGTH  2
+#define CTRL_STATUS_BAD_PARAM   3
+#define CTRL_STATUS_OUT_OF_RANGE 4
+#define CTRL_STATUS_BUSY        5
+#define CTRL_STATUS_BAD_CRC     6
+#define CTRL_STATUS_NOT_READY   7
+#define CTRL_STATUS_NO_MEMORY   8
+
+// Runtime parameter IDs (stable on the wire)
+#define CTRL_PARAM_SAFETY_TIMEOUT_MS        1
+#define CTRL_PARAM_TELEMETRY_INTERVAL_MS    2
+#define CTRL_PARAM_LOOP_DELAY_ACTIVE_US     3
+#define CTRL_PARAM_LOOP_DELAY_IDLE_US       4
+#define CTRL_PARAM_WIFI_CHECK_INTERVAL_MS   5
+#define CTRL_PARAM_USB_XFER_TIMEOUT_MS      6
+#define CTRL_PARAM_SOURCE_LOCK_MS           7
+#define CTRL_PARAM_OTA_QUIET_MS             8
+#define CTRL_PARAM_OTA_INSTALL_QUIET_MS     9
+#define CTRL_PARAM_LINK_ALERT_SCORE         10
+#define CTRL_PARAM_LINK_ROAM_SCORE          11
+#define CTRL_PARAM_ALIVE_TIMEOUT_MS         12
+
+// Test patterns
+#define CTRL_PATTERN_STOP       0   // Stop and turn everything off
+#define CTRL_PATTERN_BANK_CHASE 1   // Each color bank fully on in turn
+#define CTRL_PATTERN_LED_SPIN   2   // Single LED rotating on all banks
+#define CTRL_PATTERN_STROBE     3   // Strobe speeds 1-4 in turn
+#define CTRL_PATTERN_ALL_ON     4   // All banks fully on
+
+// Cue lists
+#define CTRL_CUE_MAX_PER_PACKET 64  // ctrl_cue_t entries per CUE_DATA
+#define CTRL_CUE_WAIT           0x00  // right_weight of a delay-only cue (no command)
+
+// Cue player states
+#define CTRL_CUE_STATE_EMPTY    0   // No list, or upload in progress
+#define CTRL_CUE_STATE_READY    1   // List committed, not playing
+#define CTRL_CUE_STATE_ARMED    2   // Waiting for the GO start time
+#define CTRL_CUE_STATE_PLAYING  3
+
+// Network processing (ctrl_state_t.cyw43_arch, RB3E_CYW43_ARCH build option)
+#define CTRL_CYW43_ARCH_BACKGROUND  0   // lwIP/CYW43 work runs from the radio IRQ
+#define CTRL_CYW43_ARCH_POLL        1   // Only in the main loop's network slots
+
+// Build target (ctrl_board_t.board, PICO_BOARD build option)
+#define CTRL_BOARD_HOST         0   // Emulator
+#define CTRL_BOARD_PICO_W       1   // RP2040
+#define CTRL_BOARD_PICO2_W      2   // RP2350
+
+// Trace recorder
+#define CTRL_TRACE_STOP         0   // ctrl_trace_control_t actions
+#define CTRL_TRACE_START        1   // Clears the buffer
+#define CTRL_TRACE_MODE_RING    0   // Keep the newest events (flight recorder)
+#define CTRL_TRACE_MODE_ONESHOT 1   // Stop when the buffer is full
+#define CTRL_TRACE_BEGIN        'B' // ctrl_trace_event_t types (Chrome Trace phases)
+#define CTRL_TRACE_END          'E'
+#define CTRL_TRACE_INSTANT      'i'
+#define CTRL_TRACE_COUNTER      'C'
+#define CTRL_TRACE_MAX_PER_PACKET 40
+
+// Firmware update
+#define CTRL_OTA_CHUNK          256 // Bytes per OTA_DATA (one flash page; the last may be shorter)
+#define CTRL_OTA_STATE_IDLE     0
+#define CTRL_OTA_STATE_RECEIVING 1  // Chunks arriving, pages written when the lights are quiet
+#define CTRL_OTA_STATE_VERIFYING 2  // Image CRC being checked from flash
+#define CTRL_OTA_STATE_STAGED   3   // Verified, waiting for an install request / quiet moment
+#define CTRL_OTA_STATE_FAILED   4   // Verification failed - BEGIN again
+
+// Trace dump file (rb3e_ctl trace dump, emulator --trace):
+// ctrl_trace_file_t, the TRACE_NAMES payload, then ctrl_trace_event_t[count]
+#define CTRL_TRACE_FILE_MAGIC   "RB3T"
+#define CTRL_TRACE_FILE_VERSION 1
+
+//--------------------------------------------------------------------
+// Message Structures
+//--------------------------------------------------------------------
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic[4];           // "RB3C"
+    uint8_t version;            // CTRL_PROTOCOL_VERSION
+    uint8_t msg_id;             // CTRL_MSG_* (| CTRL_MSG_RESPONSE)
+    uint16_t seq;               // Echoed in the response
+    uint8_t status;             // CTRL_STATUS_* (responses only)
+    uint8_t reserved;
+    uint16_t length;            // Payload length following the header
+} ctrl_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t id;
+} ctrl_param_id_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t id;
+    uint32_t value;
+} ctrl_param_value_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t id;
+    uint32_t value;
+    uint32_t min;
+    uint32_t max;
+} ctrl_param_t;
+
+// Latency probe - echoed from the receive callback, never queued behind other work
+typedef struct __attribute__((packed)) {
+    uint32_t probe_id;          // Chosen by the host, echoed
+    uint64_t host_send_ns;      // Host clock at send, echoed
+    uint64_t bridge_rx_us;      // Bridge uptime on entry to the receive callback
+    uint64_t bridge_tx_us;      // Bridge uptime just before the reply is sent
+} ctrl_probe_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t pattern;            // CTRL_PATTERN_*
+    uint16_t step_ms;           // Time per pattern step (0 = default)
+    uint16_t duration_ms;       // Total run time (0 = until stopped)
+} ctrl_test_pattern_t;
+
+// CYW43 control-plane bus use (radio_ctrl.h). requests - ops ioctls were saved
+typedef struct __attribute__((packed)) {
+    uint32_t requests;          // LED changes and RSSI reads asked for
+    uint32_t ops;               // CYW43 ioctls actually issued
+    uint32_t deferred_passes;   // Loop passes that held queued work back (not idle)
+    uint32_t bus_us;            // Time spent in those ioctls
+    uint32_t bus_max_us;        // Longest single ioctl
+    int8_t led_gpio;            // Status LED pin (-1 = CYW43 LED)
+} ctrl_radio_stats_t;
+
+// Build profile and main loop cost in CPU cycles (board.h)
+typedef struct __attribute__((packed)) {
+    uint8_t board;              // CTRL_BOARD_*
+    uint8_t cores;              // 2 = supervisor runs on core 1
+    uint8_t cycle_counter;      // 1 = hardware counter, 0 = timer us x clock
+    uint8_t reserved;
+    uint32_t sys_clk_khz;
+    uint16_t usb_queue;         // USB_CMD_QUEUE_SIZE
+    uint16_t cue_entries;       // CUE_MAX_ENTRIES
+    uint32_t trace_events;      // TRACE_BUFFER_EVENTS
+    uint32_t pool_bytes;        // mem_pool RAM, all classes
+    uint32_t fs_bytes;          // LittleFS partition
+    uint32_t scenes;            // Scene applies measured
+    uint32_t scene_cycles;      // Total cycles in those applies
+    uint32_t scene_cycles_max;
+    uint32_t loop_passes;
+    uint32_t loop_cycles_max;   // Longest main loop pass
+} ctrl_board_t;
+
+// Filesystem partition and boot mount (littlefs_hal.h)
+typedef struct __attribute__((packed)) {
+    uint8_t mounted;
+    uint8_t imported;           // 1 = the import area held a filesystem at boot
+    uint16_t imported_files;    // Files copied from it
+    uint32_t offset;            // Partition start in flash
+    uint32_t size;              // Partition bytes
+    uint32_t used;              // Bytes in use at mount
+    uint32_t import_offset;     // Import area start (0 = none)
+    uint32_t import_size;
+    uint32_t mount_us;          // Boot mount, including any import
+    uint32_t import_us;         // Of which the import
+} ctrl_fs_t;
+
+// WiFi link-quality estimate (link_quality.h). Scores are 0-100
+#define CTRL_LINK_NO_DATA       0xFF    // Component has no recent input
+typedef struct __attribute__((packed)) {
+    uint8_t score;              // Combined score
+    uint8_t alert;              // 1 = below link_alert_score
+    uint8_t rssi_score;
+    uint8_t alive_score;
+    uint8_t jitter_score;
+    uint8_t send_score;
+    int16_t rssi_dbm;           // Smoothed RSSI
+    uint16_t alive_interval_ms; // Learned ALIVE cadence (0 = not yet)
+    uint16_t alive_loss_pm;     // ALIVE beats missed, per mille
+    uint32_t jitter_us;         // StageKit inter-arrival jitter
+    uint16_t send_fail_pm;      // Telemetry sends failed, per mille
+    uint16_t reserved;
+    uint32_t alerts;            // Drops below the alert score (power save re-disabled)
+    uint32_t roam_scans;        // Scans for a stronger BSSID
+    uint32_t roams;             // Rejoins to a stronger BSSID
+} ctrl_link_t;
+
+// Console liveness and safety blackouts (console_watch.h)
+#define CTRL_CONSOLE_UNKNOWN    0       // No STATE event yet
+#define CTRL_CONSOLE_MENUS      1
+#define CTRL_CONSOLE_IN_GAME    2
+typedef struct __attribute__((packed)) {
+    uint8_t game_state;         // CTRL_CONSOLE_*
+    uint8_t alive_trusted;      // 1 = ALIVE cadence learned (again, after a loss)
+    uint16_t alive_period_ms;   // Learned ALIVE period (0 = none yet)
+    uint32_t holds;             // Quiet gaps held through that the timeout would have blacked out
+    uint32_t timeout_blackouts; // Safety timeout with no live console to hold for
+    uint32_t menu_blackouts;    // Immediate, on a return to the menus
+    uint32_t alive_lost_blackouts; // Immediate, when ALIVE stopped
+} ctrl_console_t;
+
+typedef struct __attribute__((packed)) {
+    stagekit_state_t stagekit;  // Shadow of what the Stage Kit acknowledged
+    uint8_t usb_connected;
+    uint8_t test_pattern;       // Running CTRL_PATTERN_* (0 = none)
+    uint32_t uptime_ms;
+    int32_t wifi_rssi;
+    uint32_t packets_received;
+    uint32_t packets_processed;
+    uint32_t packets_invalid;
+    uint32_t telemetry_sent;
+    uint32_t discovery_received;
+    uint32_t usb_commands_sent;
+    uint32_t usb_commands_dropped;
+    uint32_t usb_xfer_timeouts;
+    uint32_t usb_xfer_errors;
+    uint32_t control_requests;
+    uint32_t scenes_applied;
+    uint32_t scene_commands_saved;
+    uint32_t packets_rejected;  // Dropped by source arbitration
+    uint32_t active_source;     // IPv4 address holding the lock (0 = none)
+    uint32_t probes_answered;
+    uint8_t cyw43_arch;         // CTRL_CYW43_ARCH_*
+    ctrl_radio_stats_t radio;
+    ctrl_board_t board;
+    ctrl_fs_t fs;
+    ctrl_link_t link;
+    ctrl_console_t console;
+    uint32_t source_switches;   // Times the lock moved to another source
+} ctrl_state_t;
+
+// One cue: delay after the previous cue, then a StageKit command
+typedef struct __attribute__((packed)) {
+    uint16_t delta_ms;          // Gaps over 65535 ms use CTRL_CUE_WAIT cues
+    uint8_t left_weight;
+    uint8_t right_weight;       // CTRL_CUE_WAIT = delay only
+} ctrl_cue_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t count;             // Total cues in the list
+} ctrl_cue_begin_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t index;             // Index of the first cue in this packet
+    uint8_t count;              // Cues following (max CTRL_CUE_MAX_PER_PACKET)
+    // ctrl_cue_t cues[count]
+} ctrl_cue_data_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t crc32;             // ctrl_crc32() over all ctrl_cue_t entries
+} ctrl_cue_commit_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t start_ms;          // Bridge uptime to start at (0 = now)
+    uint32_t position_ms;       // List position to start from
+} ctrl_cue_go_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t state;              // CTRL_CUE_STATE_*
+    uint16_t count;             // Cues in the list
+    uint16_t next_index;        // Next cue to fire
+    uint32_t position_ms;       // Playback position
+    uint32_t cues_played;       // Cues handed to USB
+    uint32_t cues_late;         // Sent later than the late threshold
+    uint32_t timer_late_last_us;  // Alarm IRQ lateness vs. schedule (drift)
+    uint32_t timer_late_max_us;
+    uint32_t dispatch_last_us;  // Scheduled time to USB submit
+    uint32_t dispatch_max_us;
+    uint32_t overruns;          // Cues lost because the dispatch ring was full
+} ctrl_cue_status_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t addr;              // IPv4 address, network byte order
+    uint8_t priority;
+    uint8_t active;             // Holds the lock
+    uint32_t accepted;          // Commands that reached the Stage Kit
+    uint32_t rejected;          // Commands dropped while another source held the lock
+    uint32_t idle_ms;           // Time since the last packet
+} ctrl_source_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t addr;              // IPv4 address, network byte order
+    uint8_t priority;           // Higher takes the lock immediately
+} ctrl_source_priority_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t action;             // CTRL_TRACE_STOP / CTRL_TRACE_START
+    uint8_t mode;               // CTRL_TRACE_MODE_* (start only)
+} ctrl_trace_control_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t running;
+    uint8_t mode;               // CTRL_TRACE_MODE_*
+    uint32_t capacity;          // Buffer size in events
+    uint32_t count;             // Events held
+    uint32_t overwritten;       // Oldest events lost in ring mode
+    uint32_t now_us;            // Bridge clock, same base as event times
+} ctrl_trace_status_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t index;             // First event (0 = oldest)
+    uint16_t count;             // Events following (response only)
+} ctrl_trace_read_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;           // Bridge clock, wraps every 71 minutes
+    uint8_t type;               // CTRL_TRACE_BEGIN/END/INSTANT/COUNTER
+    uint8_t track;              // Timeline row
+    uint8_t name;               // Index into the name table
+    uint8_t reserved;
+    uint32_t arg;               // Event-specific value
+} ctrl_trace_event_t;
+
+typedef struct __attribute__((packed)) {
+    char magic[4];              // CTRL_TRACE_FILE_MAGIC
+    uint16_t version;           // CTRL_TRACE_FILE_VERSION
+    uint16_t names_length;      // Bytes of name table following
+    uint32_t count;             // Events following the name table
+    uint32_t overwritten;       // Events lost before the first one
+} ctrl_trace_file_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t block_size;        // Bytes per block
+    uint16_t block_count;
+    uint16_t in_use;
+    uint16_t high_water;        // Most blocks in use at once
+    uint32_t allocs;
+    uint32_t failures;          // Requests no class could serve
+    uint32_t fallbacks;         // Requests served from a larger class
+} ctrl_pool_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t image_size;        // Bytes, written from flash offset 0
+    uint32_t image_crc;         // ctrl_crc32() over the whole image
+    uint32_t family_id;         // UF2 family (0 = not checked)
+} ctrl_ota_begin_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t offset;            // Page aligned, must equal ctrl_ota_status_t.received
+    uint16_t length;            // CTRL_OTA_CHUNK except for the last chunk
+    uint32_t crc32;             // ctrl_crc32() over this chunk
+    // uint8_t data[length]
+} ctrl_ota_data_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t install;            // 1 = install at the next quiet moment, 0 = stage only
+} ctrl_ota_commit_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t state;              // CTRL_OTA_STATE_*
+    uint8_t install_pending;    // Staged image will be installed when the lights are quiet
+    uint32_t image_size;
+    uint32_t image_crc;
+    uint32_t received;          // Next offset the bridge expects
+    uint32_t written;           // Bytes in the staging slot
+    uint32_t slot_offset;       // Staging slot in flash
+    uint32_t slot_size;         // Largest image that can be staged
+    uint32_t busy_replies;      // Chunks refused while a page waited for flash
+    uint32_t deferred_passes;   // Main loop passes that held flash work for the lights
+    uint32_t flash_max_us;      // Longest single erase/program stall
+} ctrl_ota_status_t;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+/**
+ * CRC-32 (IEEE 802.3, reflected) - bitwise, no table
+ *
+ * @param crc Previous value (0 to start)
+ */
+static inline uint32_t ctrl_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * Check if buffer starts with a control protocol header
+ *
+ * @return 1 if valid control message, 0 otherwise
+ */
+static inline int ctrl_check_header(const uint8_t *data, size_t len)
+{
+    if (len < sizeof(ctrl_header_t)) {
+        return 0;
+    }
+
+    const ctrl_header_t *hdr = (const ctrl_header_t *)data;
+    return (data[0] == CTRL_MAGIC_BYTE0 &&
+            data[1] == CTRL_MAGIC_BYTE1 &&
+            data[2] == CTRL_MAGIC_BYTE2 &&
+            data[3] == CTRL_MAGIC_BYTE3 &&
+            hdr->version == CTRL_PROTOCOL_VERSION &&
+            sizeof(ctrl_header_t) + hdr->length <= len);
+}
+
+/**
+ * Fill in a control header
+ */
+static inline void ctrl_build_header(ctrl_header_t *hdr, uint8_t msg_id, uint16_t seq,
+                                     uint8_t status, uint16_t length)
+{
+    hdr->magic[0] = CTRL_MAGIC_BYTE0;
+    hdr->magic[1] = CTRL_MAGIC_BYTE1;
+    hdr->magic[2] = CTRL_MAGIC_BYTE2;
+    hdr->magic[3] = CTRL_MAGIC_BYTE3;
+    hdr->version = CTRL_PROTOCOL_VERSION;
+    hdr->msg_id = msg_id;
+    hdr->seq = seq;
+    hdr->status = status;
+    hdr->reserved = 0;
+    hdr->length = length;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CONTROL_PROTOCOL_H_ */
@@ -0,0 +1,340 @@
+/*
+ * Cue List Player for RB3E StageKit Bridge
+ *
+ * A hardware alarm fires at each cue time and pushes the command into a
+ * small ring; the main loop sends it over USB (TinyUSB is not IRQ safe).
+ * Each alarm is rescheduled relative to the previous scheduled time, not
+ * the time it ran, so IRQ latency never accumulates into drift.
+ */
+
+#include "cue_player.h"
+#include "mem_pool.h"
+#include "rb3e_protocol.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+// Cue list in pool blocks, taken for the uploaded length only
+// (written by the control handler, read by the alarm IRQ)
+#define CUE_BLOCK_ENTRIES   (MEM_POOL_LARGE_SIZE / sizeof(ctrl_cue_t))
+#define CUE_MAX_BLOCKS      ((CUE_MAX_ENTRIES + CUE_BLOCK_ENTRIES - 1) / CUE_BLOCK_ENTRIES)
+
+static ctrl_cue_t *cue_blocks[CUE_MAX_BLOCKS];
+static uint16_t cue_count = 0;
+static volatile uint8_t player_state = CTRL_CUE_STATE_EMPTY;
+
+// Playback (owned by the alarm IRQ while armed/playing)
+static alarm_id_t cue_alarm = 0;
+static volatile uint16_t next_index = 0;
+static absolute_time_t next_due;        // Scheduled time of cue next_index
+static absolute_time_t alarm_time;      // Time the alarm is scheduled for
+static absolute_time_t play_start;      // Time playback (re)started
+static uint32_t play_start_position_ms; // List position at play_start
+
+// Fired cues waiting for USB (single producer IRQ, single consumer main loop)
+typedef struct {
+    uint8_t left_weight;
+    uint8_t right_weight;
+    absolute_time_t due;
+} cue_event_t;
+
+static cue_event_t dispatch_ring[CUE_DISPATCH_RING_SIZE];
+static volatile uint8_t ring_head = 0;  // Written by producer
+static volatile uint8_t ring_tail = 0;  // Written by consumer
+
+static ctrl_cue_status_t stats;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+static inline ctrl_cue_t *cue_at(uint16_t index)
+{
+    return &cue_blocks[index / CUE_BLOCK_ENTRIES][index % CUE_BLOCK_ENTRIES];
+}
+
+static void cue_list_free(void)
+{
+    for (unsigned b = 0; b < CUE_MAX_BLOCKS; b++) {
+        mem_pool_free(cue_blocks[b]);
+        cue_blocks[b] = NULL;
+    }
+    cue_count = 0;
+}
+
+static void ring_push(uint8_t left, uint8_t right, absolute_time_t due)
+{
+    uint8_t next = (ring_head + 1) % CUE_DISPATCH_RING_SIZE;
+    if (next == ring_tail) {
+        stats.overruns++;
+        return;
+    }
+
+    dispatch_ring[ring_head].left_weight = left;
+    dispatch_ring[ring_head].right_weight = right;
+    dispatch_ring[ring_head].due = due;
+    ring_head = next;
+}
+
+// Alarm IRQ - fire every cue due now, then reschedule for the next one
+static int64_t cue_alarm_cb(alarm_id_t id, void *user_data)
+{
+    (void)id;
+    (void)user_data;
+
+    int64_t late_us = absolute_time_diff_us(alarm_time, get_absolute_time());
+    if (late_us < 0) {
+        late_us = 0;
+    }
+    stats.timer_late_last_us = (uint32_t)late_us;
+    if ((uint32_t)late_us > stats.timer_late_max_us) {
+        stats.timer_late_max_us = (uint32_t)late_us;
+    }
+    TRACE_INSTANT(TRACE_TRACK_TIMER, TRACE_EV_CUE_ALARM, (uint32_t)late_us);
+
+    player_state = CTRL_CUE_STATE_PLAYING;
+
+    // Cues with a zero delta share this alarm
+    uint16_t delta_ms;
+    do {
+        const ctrl_cue_t *cue = cue_at(next_index);
+        if (cue->right_weight != CTRL_CUE_WAIT) {
+            ring_push(cue->left_weight, cue->right_weight, next_due);
+        }
+
+        next_index++;
+        if (next_index >= cue_count) {
+            player_state = CTRL_CUE_STATE_READY;
+            cue_alarm = 0;
+            return 0;  // List finished
+        }
+
+        delta_ms = cue_at(next_index)->delta_ms;
+        next_due = delayed_by_ms(next_due, delta_ms);
+    } while (delta_ms == 0);
+
+    // Negative = relative to when this alarm was scheduled
+    int64_t step_us = absolute_time_diff_us(alarm_time, next_due);
+    alarm_time = next_due;
+    return -step_us;
+}
+
+// Cancel the alarm and drop fired cues that were not sent yet
+static void cue_player_halt(void)
+{
+    if (cue_alarm > 0) {
+        cancel_alarm(cue_alarm);
+        cue_alarm = 0;
+    }
+    ring_tail = ring_head;
+
+    if (player_state != CTRL_CUE_STATE_EMPTY) {
+        player_state = CTRL_CUE_STATE_READY;
+    }
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+uint8_t cue_player_begin(uint16_t count)
+{
+    if (cue_player_active()) {
+        return CTRL_STATUS_BUSY;
+    }
+    if (count > CUE_MAX_ENTRIES) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    player_state = CTRL_CUE_STATE_EMPTY;
+    cue_list_free();
+    if (count == 0) {
+        return CTRL_STATUS_OK;  // Just give the memory back
+    }
+
+    unsigned blocks = (count + CUE_BLOCK_ENTRIES - 1) / CUE_BLOCK_ENTRIES;
+    for (unsigned b = 0; b < blocks; b++) {
+        cue_blocks[b] = mem_pool_alloc(CUE_BLOCK_ENTRIES * sizeof(ctrl_cue_t));
+        if (cue_blocks[b] == NULL) {
+            printf("CuePlayer: No pool memory for %d cues\n", count);
+            cue_list_free();
+            return CTRL_STATUS_NO_MEMORY;
+        }
+        memset(cue_blocks[b], 0, CUE_BLOCK_ENTRIES * sizeof(ctrl_cue_t));
+    }
+
+    cue_count = count;
+    return CTRL_STATUS_OK;
+}
+
+uint8_t cue_player_write(uint16_t index, const ctrl_cue_t *cues, uint8_t count)
+{
+    if (cue_player_active()) {
+        return CTRL_STATUS_BUSY;
+    }
+    if ((uint32_t)index + count > cue_count) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        *cue_at(index + i) = cues[i];
+    }
+    return CTRL_STATUS_OK;
+}
+
+uint8_t cue_player_commit(uint32_t crc32)
+{
+    if (cue_player_active()) {
+        return CTRL_STATUS_BUSY;
+    }
+    if (cue_count == 0) {
+        return CTRL_STATUS_NOT_READY;
+    }
+
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < cue_count; i += CUE_BLOCK_ENTRIES) {
+        uint16_t remaining = cue_count - i;
+        uint16_t n = (remaining < CUE_BLOCK_ENTRIES) ? remaining : CUE_BLOCK_ENTRIES;
+        crc = ctrl_crc32(crc, (const uint8_t *)cue_at(i), n * sizeof(ctrl_cue_t));
+    }
+    if (crc != crc32) {
+        printf("CuePlayer: CRC mismatch (got 0x%08lx, expected 0x%08lx)\n",
+               (unsigned long)crc, (unsigned long)crc32);
+        return CTRL_STATUS_BAD_CRC;
+    }
+
+    uint32_t total_ms = 0;
+    for (int i = 0; i < cue_count; i++) {
+        total_ms += cue_at(i)->delta_ms;
+    }
+    printf("CuePlayer: %d cues ready (%lu ms)\n", cue_count, (unsigned long)total_ms);
+
+    player_state = CTRL_CUE_STATE_READY;
+    return CTRL_STATUS_OK;
+}
+
+uint8_t cue_player_go(uint32_t start_ms, uint32_t position_ms)
+{
+    if (player_state == CTRL_CUE_STATE_EMPTY) {
+        return CTRL_STATUS_NOT_READY;
+    }
+
+    cue_player_halt();
+
+    absolute_time_t now = get_absolute_time();
+    absolute_time_t start = start_ms ? from_us_since_boot((uint64_t)start_ms * 1000) : now;
+
+    // Late GO (e.g. delayed by WiFi) - seek forward to stay in sync
+    int64_t behind_us = absolute_time_diff_us(start, now);
+    if (behind_us > 0) {
+        position_ms += (uint32_t)(behind_us / 1000);
+        start = now;
+    }
+
+    // First cue at or after the start position
+    uint32_t cue_ms = 0;
+    uint16_t index = 0;
+    while (index < cue_count) {
+        cue_ms += cue_at(index)->delta_ms;
+        if (cue_ms >= position_ms) {
+            break;
+        }
+        index++;
+    }
+    if (index >= cue_count) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    next_index = index;
+    next_due = delayed_by_ms(start, cue_ms - position_ms);
+    alarm_time = next_due;
+    play_start = start;
+    play_start_position_ms = position_ms;
+    player_state = CTRL_CUE_STATE_ARMED;
+
+    printf("CuePlayer: GO at cue %d (position %lu ms, first cue in %lld us)\n",
+           index, (unsigned long)position_ms,
+           (long long)absolute_time_diff_us(now, next_due));
+
+    cue_alarm = add_alarm_at(next_due, cue_alarm_cb, NULL, true);
+    if (cue_alarm < 0) {
+        printf("CuePlayer: No alarm slot available\n");
+        cue_alarm = 0;
+        player_state = CTRL_CUE_STATE_READY;
+        return CTRL_STATUS_BUSY;
+    }
+
+    return CTRL_STATUS_OK;
+}
+
+void cue_player_stop(void)
+{
+    bool was_active = cue_player_active();
+    cue_player_halt();
+
+    if (was_active) {
+        printf("CuePlayer: Stopped at cue %d\n", next_index);
+        ring_push(0x00, SK_ALL_OFF, get_absolute_time());
+    }
+}
+
+bool cue_player_task(cue_send_fn send)
+{
+    if (ring_tail == ring_head) {
+        return false;
+    }
+
+    const cue_event_t *ev = &dispatch_ring[ring_tail];
+    if (!send(ev->left_weight, ev->right_weight)) {
+        return false;  // USB busy - retry on the next pass
+    }
+    TRACE_INSTANT(TRACE_TRACK_MAIN, TRACE_EV_CUE_DISPATCH,
+                  (ev->left_weight << 8) | ev->right_weight);
+
+    int64_t dispatch_us = absolute_time_diff_us(ev->due, get_absolute_time());
+    if (dispatch_us < 0) {
+        dispatch_us = 0;
+    }
+    stats.cues_played++;
+    stats.dispatch_last_us = (uint32_t)dispatch_us;
+    if ((uint32_t)dispatch_us > stats.dispatch_max_us) {
+        stats.dispatch_max_us = (uint32_t)dispatch_us;
+    }
+    if (dispatch_us > CUE_LATE_THRESHOLD_US) {
+        stats.cues_late++;
+    }
+
+    ring_tail = (ring_tail + 1) % CUE_DISPATCH_RING_SIZE;
+    return true;
+}
+
+bool cue_player_active(void)
+{
+    return player_state == CTRL_CUE_STATE_ARMED ||
+           player_state == CTRL_CUE_STATE_PLAYING;
+}
+
+void cue_player_get_status(ctrl_cue_status_t *out)
+{
+    *out = stats;
+    out->state = player_state;
+    out->count = cue_count;
+    out->next_index = next_index;
+    out->position_ms = 0;
+
+    if (player_state == CTRL_CUE_STATE_PLAYING) {
+        int64_t elapsed_us = absolute_time_diff_us(play_start, get_absolute_time());
+        out->position_ms = play_start_position_ms +
+                           (elapsed_us > 0 ? (uint32_t)(elapsed_us / 1000) : 0);
+    }
+}
+
+void cue_player_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
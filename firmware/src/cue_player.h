@@ -0,0 +1,113 @@
+/*
+ * Cue List Player for RB3E StageKit Bridge
+ *
+ * Plays a pre-uploaded list of timestamped StageKit commands from a
+ * hardware timer alarm, so rehearsed shows do not depend on WiFi timing.
+ * The list is uploaded and started through the control protocol.
+ */
+
+#ifndef _CUE_PLAYER_H_
+#define _CUE_PLAYER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Cue Player Constants
+//--------------------------------------------------------------------
+
+#ifndef CUE_MAX_ENTRIES
+#define CUE_MAX_ENTRIES         1024    // 4 bytes each, held in mem_pool large blocks
+#endif
+#ifndef CUE_DISPATCH_RING_SIZE
+#define CUE_DISPATCH_RING_SIZE  32      // Cues fired by the alarm, waiting for USB
+#endif
+#define CUE_LATE_THRESHOLD_US   5000    // Later than this counts as a late cue
+
+// Sends one StageKit command, returns false if it could not be sent yet
+typedef bool (*cue_send_fn)(uint8_t left_weight, uint8_t right_weight);
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Start a new upload, discarding the current list
+ *
+ * Blocks for the list come from mem_pool; count 0 only frees them.
+ *
+ * @param count Number of cues that will follow
+ * @return CTRL_STATUS_OK, CTRL_STATUS_OUT_OF_RANGE, CTRL_STATUS_NO_MEMORY
+ *         or CTRL_STATUS_BUSY (playing)
+ */
+uint8_t cue_player_begin(uint16_t count);
+
+/**
+ * Store uploaded cues (chunks may arrive in any order or repeat)
+ *
+ * @param index Index of the first cue
+ * @param cues Cue entries
+ * @param count Number of entries
+ * @return CTRL_STATUS_OK, CTRL_STATUS_OUT_OF_RANGE or CTRL_STATUS_BUSY
+ */
+uint8_t cue_player_write(uint16_t index, const ctrl_cue_t *cues, uint8_t count);
+
+/**
+ * Finish an upload
+ *
+ * @param crc32 ctrl_crc32() of the complete list as sent
+ * @return CTRL_STATUS_OK, CTRL_STATUS_BAD_CRC or CTRL_STATUS_BUSY
+ */
+uint8_t cue_player_commit(uint32_t crc32);
+
+/**
+ * Start playback
+ *
+ * A start time in the past seeks forward so playback stays in sync.
+ *
+ * @param start_ms Bridge uptime to start at (0 = now)
+ * @param position_ms List position to start from
+ * @return CTRL_STATUS_OK or CTRL_STATUS_NOT_READY
+ */
+uint8_t cue_player_go(uint32_t start_ms, uint32_t position_ms);
+
+/**
+ * Stop playback and turn the lights off
+ */
+void cue_player_stop(void);
+
+/**
+ * Send cues fired by the timer
+ *
+ * Must be called regularly from main loop.
+ *
+ * @param send Function used to send a command
+ * @return true if a command was sent
+ */
+bool cue_player_task(cue_send_fn send);
+
+/**
+ * Check if a list is armed or playing
+ */
+bool cue_player_active(void);
+
+/**
+ * Get playback status and timing statistics
+ */
+void cue_player_get_status(ctrl_cue_status_t *out);
+
+/**
+ * Reset timing statistics
+ */
+void cue_player_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CUE_PLAYER_H_ */
@@ -11,6 +11,7 @@
 
 #include "dhcpserver.h"
 #include "lwip/udp.h"
+#include "pico/stdlib.h"
 
 // DHCP message types
 #define DHCP_DISCOVER   1
@@ -204,6 +205,7 @@ static void dhcp_recv_cb(void *arg, struct udp_pcb *upcb, struct pbuf *p,
     if (reply_type == DHCP_ACK) {
         memcpy(leases[lease_idx].mac, msg->chaddr, 6);
         leases[lease_idx].expiry = 1;  // Mark as used (simplified)
+        d->last_ack_us = time_us_64();
         // Printf removed to prevent network stack hangs
     }
     
@@ -233,6 +235,7 @@ void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm) {
     // Store configuration
     ip_addr_copy(d->ip, *ip);
     ip_addr_copy(d->nm, *nm);
+    d->last_ack_us = 0;
     
     // Create UDP PCB
     d->udp = udp_new();
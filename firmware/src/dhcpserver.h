@@ -20,6 +20,7 @@ typedef struct _dhcp_server_t {
     ip_addr_t ip;       // Server's own IP (usually 192.168.4.1)
     ip_addr_t nm;       // Netmask (usually 255.255.255.0)
     struct udp_pcb *udp;
+    volatile uint64_t last_ack_us;  // time_us_64() of the last ACK (portal timing)
 } dhcp_server_t;
 
 /**
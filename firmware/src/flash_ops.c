@@ -0,0 +1,125 @@
+/*
+ * Flash Operations for RB3E StageKit Bridge
+ *
+ * RP2040/RP2350 implementation on top of the SDK flash functions.
+ */
+
+#include "flash_ops.h"
+#include "board.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/watchdog.h"
+
+#if RB3E_DUAL_CORE
+#include "pico/multicore.h"
+#endif
+
+_Static_assert(FLASH_OPS_SECTOR_SIZE == FLASH_SECTOR_SIZE, "sector size mismatch");
+_Static_assert(FLASH_OPS_PAGE_SIZE == FLASH_PAGE_SIZE, "page size mismatch");
+
+// End of the image in flash (linker script)
+extern char __flash_binary_end;
+
+// Install copies each sector through here; flash cannot be read while it is written
+static uint8_t install_buffer[FLASH_OPS_SECTOR_SIZE] __attribute__((aligned(4)));
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+// Core 1 (the supervisor in dual-core builds) executes from flash as
+// well, so it waits in a RAM handler while flash is written. Before it
+// has started there is nothing to stop.
+static bool pause_other_core(void)
+{
+#if RB3E_DUAL_CORE
+    if (multicore_lockout_victim_is_initialized(1)) {
+        multicore_lockout_start_blocking();
+        return true;
+    }
+#endif
+    return false;
+}
+
+static void resume_other_core(bool paused)
+{
+#if RB3E_DUAL_CORE
+    if (paused) {
+        multicore_lockout_end_blocking();
+    }
+#else
+    (void)paused;
+#endif
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+uint32_t flash_ops_size(void)
+{
+    return PICO_FLASH_SIZE_BYTES;
+}
+
+uint32_t flash_ops_image_end(void)
+{
+    return (uint32_t)&__flash_binary_end - XIP_BASE;
+}
+
+const uint8_t *flash_ops_read(uint32_t offset)
+{
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+void flash_ops_erase(uint32_t offset, uint32_t len)
+{
+    TRACE_BEGIN(TRACE_TRACK_FLASH, TRACE_EV_FLASH_ERASE, offset / FLASH_OPS_SECTOR_SIZE);
+    bool paused = pause_other_core();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(offset, len);
+    restore_interrupts(ints);
+    resume_other_core(paused);
+    TRACE_END(TRACE_TRACK_FLASH, TRACE_EV_FLASH_ERASE, len);
+}
+
+void flash_ops_program(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    TRACE_BEGIN(TRACE_TRACK_FLASH, TRACE_EV_FLASH_PROG, offset / FLASH_OPS_SECTOR_SIZE);
+    bool paused = pause_other_core();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(offset, data, len);
+    restore_interrupts(ints);
+    resume_other_core(paused);
+    TRACE_END(TRACE_TRACK_FLASH, TRACE_EV_FLASH_PROG, len);
+}
+
+// Everything past this point overwrites the code it would otherwise run,
+// so it stays in RAM and calls nothing that lives in flash: the SDK's
+// flash_range_* functions are RAM-resident, the copy loop is open-coded
+// (memcpy is in flash) and the watchdog and reset are register writes.
+// Core 1 is parked first, while flash still holds the code to do it.
+void __no_inline_not_in_flash_func(flash_ops_install)(uint32_t src, uint32_t len)
+{
+    pause_other_core();
+    save_and_disable_interrupts();
+
+    // The copy takes longer than the watchdog timeout
+    hw_clear_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+
+    for (uint32_t offset = 0; offset < len; offset += FLASH_OPS_SECTOR_SIZE) {
+        const volatile uint8_t *from = (const volatile uint8_t *)(XIP_BASE + src + offset);
+        for (uint32_t i = 0; i < FLASH_OPS_SECTOR_SIZE; i++) {
+            install_buffer[i] = from[i];
+        }
+        flash_range_erase(offset, FLASH_OPS_SECTOR_SIZE);
+        flash_range_program(offset, install_buffer, FLASH_OPS_SECTOR_SIZE);
+    }
+
+    // SYSRESETREQ - boots the new image through the bootrom
+    scb_hw->aircr = (0x05FAu << 16) | (1u << 2);
+    while (true) {
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Flash Operations for RB3E StageKit Bridge
+ *
+ * The only code that erases or programs flash. LittleFS and the OTA
+ * updater both go through here, so the firmware and the emulator's
+ * simulated flash (emulator/emu_flash.c) implement one small API.
+ *
+ * Offsets are from the start of flash, not XIP addresses. Erase and
+ * program stall everything that executes from flash, so callers decide
+ * when they run (see ota.c for the scheduling rules).
+ */
+
+#ifndef _FLASH_OPS_H_
+#define _FLASH_OPS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_OPS_SECTOR_SIZE   4096    // Erase unit
+#define FLASH_OPS_PAGE_SIZE     256     // Program unit
+
+// UF2 family of images this build can install
+#if defined(PICO_RP2350)
+#define FLASH_OPS_UF2_FAMILY    0xe48bff59  // RP2350 ARM secure
+#else
+#define FLASH_OPS_UF2_FAMILY    0xe48bff56  // RP2040
+#endif
+
+/**
+ * Total flash size in bytes
+ */
+uint32_t flash_ops_size(void);
+
+/**
+ * Offset of the first byte after the running firmware image
+ */
+uint32_t flash_ops_image_end(void);
+
+/**
+ * Readable view of flash at offset (memory-mapped)
+ */
+const uint8_t *flash_ops_read(uint32_t offset);
+
+/**
+ * Erase whole sectors (offset and len multiples of FLASH_OPS_SECTOR_SIZE)
+ */
+void flash_ops_erase(uint32_t offset, uint32_t len);
+
+/**
+ * Program whole pages into erased flash (offset and len multiples of
+ * FLASH_OPS_PAGE_SIZE, data in RAM)
+ */
+void flash_ops_program(uint32_t offset, const uint8_t *data, uint32_t len);
+
+/**
+ * Copy len bytes from src over the running firmware at offset 0, then
+ * reset into it. Runs from RAM with interrupts off and never returns.
+ */
+void flash_ops_install(uint32_t src, uint32_t len) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLASH_OPS_H_ */
@@ -0,0 +1,386 @@
+/*
+ * WiFi Link-Quality Estimator for RB3E StageKit Bridge
+ *
+ * All averages are integer EWMAs. Component scores are linear between
+ * a "good" and a "bad" point and clamped to 0-100.
+ */
+
+#include "link_quality.h"
+#include <stddef.h>
+
+// RSSI
+#define RSSI_GOOD_DBM           -60
+#define RSSI_BAD_DBM            -85
+
+// ALIVE cadence
+#define ALIVE_MIN_PERIOD_MS     100     // Learned periods outside this are not a cadence
+#define ALIVE_MAX_PERIOD_MS     10000
+#define ALIVE_LEARN_INTERVALS   3       // Intervals before the cadence is trusted
+#define ALIVE_STALE_BEATS       10      // Longer gaps mean the sender stopped, not loss
+#define ALIVE_LOSS_BAD_PM       400
+
+// StageKit jitter
+#define JITTER_WINDOW_MS        250     // Only intervals this short are compared
+#define JITTER_MIN_SAMPLES      8
+#define JITTER_GOOD_US          20000   // Frame quantization alone comes close
+#define JITTER_BAD_US           60000
+#define STAGEKIT_STALE_MS       5000
+
+// Telemetry sends
+#define SEND_FAIL_BAD_PM        500
+
+// Component weights
+#define WEIGHT_RSSI             20
+#define WEIGHT_ALIVE            40
+#define WEIGHT_JITTER           15
+#define WEIGHT_SEND             25
+
+// The score stays within this of the worst input, so one input that has
+// clearly failed is not averaged away by the others. Jitter also depends
+// on the music, so it only moves the mean
+#define WORST_SPREAD            40
+
+// Roaming only helps when the signal is the problem
+#define ROAM_RSSI_SCORE         50
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+// RSSI (main loop)
+static bool rssi_valid = false;
+static int32_t rssi_x16 = 0;                // Smoothed dBm x16
+
+// ALIVE cadence (receive callback)
+static bool alive_seen = false;
+static uint32_t alive_last_ms = 0;
+static uint32_t alive_period_ms = 0;        // 0 = not learned
+static uint16_t alive_intervals = 0;
+static uint32_t alive_loss_pm = 0;
+
+// StageKit inter-arrival jitter (receive callback)
+static bool stagekit_seen = false;
+static uint32_t stagekit_last_ms = 0;
+static bool stagekit_dense = false;         // Previous interval was inside the window
+static uint32_t stagekit_last_iv_ms = 0;
+static uint32_t jitter_us = 0;
+static uint16_t jitter_samples = 0;
+
+// Telemetry sends (main loop)
+static uint32_t sends = 0;
+static uint32_t send_fail_pm = 0;
+
+// Decisions (main loop)
+static uint8_t score = 100;
+static uint8_t scores[4] = { CTRL_LINK_NO_DATA, CTRL_LINK_NO_DATA,
+                             CTRL_LINK_NO_DATA, CTRL_LINK_NO_DATA };
+static bool alert = false;
+static bool below_alert = false;
+static uint32_t below_alert_ms = 0;
+static bool recovering = false;
+static uint32_t recovering_ms = 0;
+static bool below_roam = false;
+static uint32_t below_roam_ms = 0;
+static bool roam_tried = false;
+static uint32_t roam_ms = 0;
+
+// Statistics
+static uint32_t alerts = 0;
+static uint32_t roam_scans = 0;
+static uint32_t roams = 0;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+// Linear map, good -> 100 and bad -> 0 (either order)
+static uint8_t scale(int32_t value, int32_t good, int32_t bad)
+{
+    int32_t s = (value - bad) * 100 / (good - bad);
+    if (s < 0) {
+        return 0;
+    }
+    return s > 100 ? 100 : (uint8_t)s;
+}
+
+static uint32_t ewma(uint32_t avg, uint32_t sample, int shift)
+{
+    return (uint32_t)((int32_t)avg + ((int32_t)sample - (int32_t)avg) / (1 << shift));
+}
+
+static uint8_t rssi_score(void)
+{
+    if (!rssi_valid) {
+        return CTRL_LINK_NO_DATA;
+    }
+    return scale(rssi_x16 / 16, RSSI_GOOD_DBM, RSSI_BAD_DBM);
+}
+
+static uint8_t alive_score(uint32_t now_ms)
+{
+    if (!alive_seen || alive_period_ms == 0 || alive_intervals < ALIVE_LEARN_INTERVALS) {
+        return CTRL_LINK_NO_DATA;
+    }
+
+    uint32_t gap = now_ms - alive_last_ms;
+    if (gap > alive_period_ms * ALIVE_STALE_BEATS) {
+        return CTRL_LINK_NO_DATA;
+    }
+
+    // A gap still open counts as soon as a beat is overdue, but only up
+    // to half marks: the link may be fine and the sender gone
+    uint32_t loss = alive_loss_pm;
+    if (gap > alive_period_ms * 3 / 2) {
+        uint32_t missed = gap / alive_period_ms;
+        uint32_t pending = missed * 1000 / (missed + 1);
+        if (pending > ALIVE_LOSS_BAD_PM / 2) {
+            pending = ALIVE_LOSS_BAD_PM / 2;
+        }
+        if (pending > loss) {
+            loss = pending;
+        }
+    }
+    return scale((int32_t)loss, 0, ALIVE_LOSS_BAD_PM);
+}
+
+static uint8_t jitter_score(uint32_t now_ms)
+{
+    if (jitter_samples < JITTER_MIN_SAMPLES || now_ms - stagekit_last_ms > STAGEKIT_STALE_MS) {
+        return CTRL_LINK_NO_DATA;
+    }
+    return scale((int32_t)jitter_us, JITTER_GOOD_US, JITTER_BAD_US);
+}
+
+static uint8_t send_score(void)
+{
+    if (sends == 0) {
+        return CTRL_LINK_NO_DATA;
+    }
+    return scale((int32_t)send_fail_pm, 0, SEND_FAIL_BAD_PM);
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void link_quality_restart(void)
+{
+    rssi_valid = false;
+    alive_seen = false;
+    alive_period_ms = 0;
+    alive_intervals = 0;
+    alive_loss_pm = 0;
+    stagekit_seen = false;
+    stagekit_dense = false;
+    jitter_us = 0;
+    jitter_samples = 0;
+    sends = 0;
+    send_fail_pm = 0;
+
+    // The roam backoff survives - a roam is itself a new association
+    score = 100;
+    for (int i = 0; i < 4; i++) {
+        scores[i] = CTRL_LINK_NO_DATA;
+    }
+    alert = false;
+    below_alert = false;
+    recovering = false;
+    below_roam = false;
+}
+
+void link_quality_note_rssi(int32_t dbm)
+{
+    if (dbm == 0) {
+        return;
+    }
+    if (!rssi_valid) {
+        rssi_x16 = dbm * 16;
+        rssi_valid = true;
+    } else {
+        rssi_x16 += (dbm * 16 - rssi_x16) / 4;
+    }
+}
+
+void link_quality_note_alive(uint32_t now_ms)
+{
+    if (alive_seen) {
+        uint32_t iv = now_ms - alive_last_ms;
+
+        if (alive_period_ms == 0) {
+            if (iv >= ALIVE_MIN_PERIOD_MS && iv <= ALIVE_MAX_PERIOD_MS) {
+                alive_period_ms = iv;
+            }
+        } else if (iv <= alive_period_ms * ALIVE_STALE_BEATS) {
+            uint32_t beats = (iv + alive_period_ms / 2) / alive_period_ms;
+
+            // On-time beats refine the period; late ones are loss
+            if (beats == 1) {
+                alive_period_ms = ewma(alive_period_ms, iv, 3);
+                if (alive_period_ms < ALIVE_MIN_PERIOD_MS) {
+                    alive_period_ms = ALIVE_MIN_PERIOD_MS;
+                }
+            }
+            if (beats >= 1) {
+                // Per beat, so the average is the fraction of beats lost
+                for (uint32_t b = 1; b < beats; b++) {
+                    alive_loss_pm = ewma(alive_loss_pm, 1000, 3);
+                }
+                alive_loss_pm = ewma(alive_loss_pm, 0, 3);
+                if (alive_intervals < UINT16_MAX) {
+                    alive_intervals++;
+                }
+            }
+        }
+    }
+
+    alive_last_ms = now_ms;
+    alive_seen = true;
+}
+
+void link_quality_note_stagekit(uint32_t now_ms)
+{
+    if (stagekit_seen) {
+        uint32_t iv = now_ms - stagekit_last_ms;
+
+        // Long gaps are the music; variation between short intervals is the link
+        if (iv < JITTER_WINDOW_MS) {
+            if (stagekit_dense) {
+                uint32_t d = iv > stagekit_last_iv_ms ? iv - stagekit_last_iv_ms
+                                                      : stagekit_last_iv_ms - iv;
+                jitter_us = ewma(jitter_us, d * 1000, 4);
+                if (jitter_samples < UINT16_MAX) {
+                    jitter_samples++;
+                }
+            }
+            stagekit_last_iv_ms = iv;
+            stagekit_dense = true;
+        } else {
+            stagekit_dense = false;
+        }
+    }
+
+    stagekit_last_ms = now_ms;
+    stagekit_seen = true;
+}
+
+void link_quality_note_send(bool ok)
+{
+    send_fail_pm = sends == 0 ? (ok ? 0 : 1000) : ewma(send_fail_pm, ok ? 0 : 1000, 2);
+    sends++;
+}
+
+link_action_t link_quality_update(uint32_t now_ms, uint32_t alert_score, uint32_t roam_score)
+{
+    static const uint8_t weights[4] = { WEIGHT_RSSI, WEIGHT_ALIVE, WEIGHT_JITTER, WEIGHT_SEND };
+    static const bool decisive[4] = { true, true, false, true };
+
+    scores[0] = rssi_score();
+    scores[1] = alive_score(now_ms);
+    scores[2] = jitter_score(now_ms);
+    scores[3] = send_score();
+
+    uint32_t sum = 0;
+    uint32_t weight = 0;
+    uint32_t worst = 100;
+    for (int i = 0; i < 4; i++) {
+        if (scores[i] != CTRL_LINK_NO_DATA) {
+            sum += (uint32_t)scores[i] * weights[i];
+            weight += weights[i];
+            if (decisive[i] && scores[i] < worst) {
+                worst = scores[i];
+            }
+        }
+    }
+    uint32_t mean = weight ? sum / weight : 100;
+    score = (uint8_t)(mean < worst + WORST_SPREAD ? mean : worst + WORST_SPREAD);
+
+    link_action_t action = LINK_ACTION_NONE;
+
+    if (score < alert_score) {
+        if (!below_alert) {
+            below_alert = true;
+            below_alert_ms = now_ms;
+        }
+        if (!alert && now_ms - below_alert_ms >= LINK_ALERT_HOLD_MS) {
+            alert = true;
+            alerts++;
+            action = LINK_ACTION_ALERT;
+        }
+    } else {
+        below_alert = false;
+    }
+
+    if (alert && score >= alert_score + LINK_HYSTERESIS) {
+        if (!recovering) {
+            recovering = true;
+            recovering_ms = now_ms;
+        }
+        if (now_ms - recovering_ms >= LINK_RECOVER_HOLD_MS) {
+            alert = false;
+            action = LINK_ACTION_RECOVERED;
+        }
+    } else {
+        recovering = false;
+    }
+
+    if (roam_score > 0 && score < roam_score && scores[0] < ROAM_RSSI_SCORE) {
+        if (!below_roam) {
+            below_roam = true;
+            below_roam_ms = now_ms;
+        }
+        if (action == LINK_ACTION_NONE && now_ms - below_roam_ms >= LINK_ROAM_HOLD_MS &&
+            (!roam_tried || now_ms - roam_ms >= LINK_ROAM_BACKOFF_MS)) {
+            roam_tried = true;
+            roam_ms = now_ms;
+            roam_scans++;
+            action = LINK_ACTION_ROAM;
+        }
+    } else {
+        below_roam = false;
+    }
+
+    return action;
+}
+
+void link_quality_note_roam(bool roamed)
+{
+    if (roamed) {
+        roams++;
+    }
+}
+
+uint8_t link_quality_score(void)
+{
+    return score;
+}
+
+bool link_quality_alert(void)
+{
+    return alert;
+}
+
+void link_quality_get_stats(ctrl_link_t *out)
+{
+    out->score = score;
+    out->alert = alert ? 1 : 0;
+    out->rssi_score = scores[0];
+    out->alive_score = scores[1];
+    out->jitter_score = scores[2];
+    out->send_score = scores[3];
+    out->rssi_dbm = rssi_valid ? (int16_t)(rssi_x16 / 16) : 0;
+    out->alive_interval_ms = alive_intervals >= ALIVE_LEARN_INTERVALS ? (uint16_t)alive_period_ms : 0;
+    out->alive_loss_pm = (uint16_t)alive_loss_pm;
+    out->jitter_us = jitter_us;
+    out->send_fail_pm = (uint16_t)send_fail_pm;
+    out->reserved = 0;
+    out->alerts = alerts;
+    out->roam_scans = roam_scans;
+    out->roams = roams;
+}
+
+void link_quality_reset_stats(void)
+{
+    alerts = 0;
+    roam_scans = 0;
+    roams = 0;
+}
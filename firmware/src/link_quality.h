@@ -0,0 +1,128 @@
+/*
+ * WiFi Link-Quality Estimator for RB3E StageKit Bridge
+ *
+ * network_check_connection() only notices a link that is already down.
+ * This module scores the link continuously from four inputs, each
+ * mapped to 0-100:
+ *   - RSSI, smoothed
+ *   - ALIVE cadence: the sender's period is learned, and missed beats
+ *     (including a gap still in progress) count as loss
+ *   - StageKit inter-arrival jitter, over dense passages only
+ *   - telemetry send failures
+ * The score is the weighted mean of the inputs that have recent data, so
+ * one quiet input (no song playing) neither helps nor hurts, held within
+ * reach of the worst of them. Roaming is only tried when the RSSI is weak
+ * too - a stronger access point does not help against interference.
+ *
+ * Nothing here touches the radio or the clock - callers pass the time -
+ * so the emulator can run it against synthetic traces (--link-trace).
+ * The note functions for received packets run in the UDP receive
+ * callback and write only their own fields; link_quality_update() runs
+ * in the main loop and only reads them.
+ */
+
+#ifndef _LINK_QUALITY_H_
+#define _LINK_QUALITY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Estimator Constants
+//--------------------------------------------------------------------
+
+#define LINK_ALERT_SCORE        50      // Default for CTRL_PARAM_LINK_ALERT_SCORE
+#define LINK_ROAM_SCORE         30      // Default for CTRL_PARAM_LINK_ROAM_SCORE (0 = never roam)
+#define LINK_HYSTERESIS         10      // Alert clears this far above the alert score
+#define LINK_RECOVER_HOLD_MS    5000    // ... held this long
+#define LINK_ALERT_HOLD_MS      2000    // Score must stay low this long to alert
+#define LINK_ROAM_HOLD_MS       5000    // ... and this long to look for another BSSID
+#define LINK_ROAM_BACKOFF_MS    60000   // Between roam attempts
+#define LINK_ROAM_MARGIN_DB     8       // A BSSID must be this much stronger to rejoin
+
+//--------------------------------------------------------------------
+// Types
+//--------------------------------------------------------------------
+
+typedef enum {
+    LINK_ACTION_NONE = 0,
+    LINK_ACTION_ALERT,          // Fell below the alert score: tell the dashboard, power save off
+    LINK_ACTION_RECOVERED,      // Above alert score + LINK_HYSTERESIS for LINK_RECOVER_HOLD_MS
+    LINK_ACTION_ROAM            // Below the roam score for LINK_ROAM_HOLD_MS: try a stronger BSSID
+} link_action_t;
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Forget the link history (new association); counters are kept
+ */
+void link_quality_restart(void);
+
+/**
+ * Record an RSSI reading (0 = no reading, ignored)
+ */
+void link_quality_note_rssi(int32_t dbm);
+
+/**
+ * Record an ALIVE packet from the active source
+ */
+void link_quality_note_alive(uint32_t now_ms);
+
+/**
+ * Record a StageKit or scene packet from the active source
+ */
+void link_quality_note_stagekit(uint32_t now_ms);
+
+/**
+ * Record the result of a telemetry send
+ */
+void link_quality_note_send(bool ok);
+
+/**
+ * Recompute the score and decide on remediation
+ *
+ * @param alert_score Alert below this score
+ * @param roam_score Roam below this score (0 = never)
+ * @return What the caller should do now (each action is returned once)
+ */
+link_action_t link_quality_update(uint32_t now_ms, uint32_t alert_score, uint32_t roam_score);
+
+/**
+ * Record the outcome of a LINK_ACTION_ROAM
+ *
+ * @param roamed true if the bridge rejoined another BSSID
+ */
+void link_quality_note_roam(bool roamed);
+
+/**
+ * Combined score from the last update (100 until there is data)
+ */
+uint8_t link_quality_score(void);
+
+/**
+ * Whether the link is in the alert state
+ */
+bool link_quality_alert(void);
+
+/**
+ * Fill the estimate and remediation counters
+ */
+void link_quality_get_stats(ctrl_link_t *out);
+
+/**
+ * Clear the remediation counters
+ */
+void link_quality_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LINK_QUALITY_H_ */
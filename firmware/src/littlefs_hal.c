@@ -5,15 +5,16 @@
  */
 
 #include "littlefs_hal.h"
+#include "flash_ops.h"
 #include "pico/stdlib.h"
 #include "hardware/flash.h"
-#include "hardware/sync.h"
+#include "hardware/watchdog.h"
 #include <stdio.h>
 #include <string.h>
 
 /*
  * Flash size detection - use SDK-provided PICO_FLASH_SIZE_BYTES
- * 
+ *
  * The Pico SDK automatically defines PICO_FLASH_SIZE_BYTES based on the
  * board configuration (set via PICO_BOARD in CMake). This is the correct
  * and portable way to detect flash size:
@@ -26,11 +27,14 @@
 
 #define FLASH_TOTAL_SIZE PICO_FLASH_SIZE_BYTES
 
-#if FLASH_TOTAL_SIZE < LFS_FLASH_SIZE
-    #error "LittleFS size exceeds total flash size"
+#if FLASH_TOTAL_SIZE < 2 * LFS_FIRMWARE_RESERVE + LFS_LEGACY_SIZE
+    #error "Flash too small for firmware, OTA slot and LittleFS"
 #endif
 
-#define FLASH_TARGET_OFFSET (FLASH_TOTAL_SIZE - LFS_FLASH_SIZE)
+#define IMPORT_SIZE         LFS_PLAN_IMPORT_SIZE(FLASH_TOTAL_SIZE)
+#define IMPORT_OFFSET       (FLASH_TOTAL_SIZE - IMPORT_SIZE)
+#define FS_SIZE             LFS_PLAN_SIZE(FLASH_TOTAL_SIZE)
+#define FLASH_TARGET_OFFSET (FLASH_TOTAL_SIZE - IMPORT_SIZE - FS_SIZE)
 
 // Read buffer for flash operations - use smaller cache to save RAM
 static uint8_t lfs_read_buffer[256];
@@ -41,13 +45,24 @@ static uint8_t lfs_lookahead_buffer[16];
 static lfs_t lfs;
 static int lfs_mounted = 0;
 
-// HAL: Read a block from flash
+// Import area (mounted only while its files are copied; buffers from the heap)
+static lfs_t import_lfs;
+static char import_path[LFS_NAME_MAX + 1];
+static uint8_t copy_buffer[256];
+
+// Boot mount results
+static uint32_t used_bytes = 0;
+static uint32_t mount_us = 0;
+static uint32_t import_us = 0;
+static bool imported = false;
+static uint16_t imported_files = 0;
+
+// HAL: Read a block from flash (context = partition offset)
 static int lfs_flash_read(const struct lfs_config *c, lfs_block_t block,
                           lfs_off_t off, void *buffer, lfs_size_t size)
 {
-    (void)c;
-    uint32_t flash_addr = XIP_BASE + FLASH_TARGET_OFFSET + (block * LFS_BLOCK_SIZE) + off;
-    memcpy(buffer, (void*)flash_addr, size);
+    uint32_t base = (uint32_t)(uintptr_t)c->context;
+    memcpy(buffer, flash_ops_read(base + (block * LFS_BLOCK_SIZE) + off), size);
     return LFS_ERR_OK;
 }
 
@@ -55,28 +70,16 @@ static int lfs_flash_read(const struct lfs_config *c, lfs_block_t block,
 static int lfs_flash_prog(const struct lfs_config *c, lfs_block_t block,
                           lfs_off_t off, const void *buffer, lfs_size_t size)
 {
-    (void)c;
-    uint32_t flash_offset = FLASH_TARGET_OFFSET + (block * LFS_BLOCK_SIZE) + off;
-
-    // Disable interrupts during flash write
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_program(flash_offset, buffer, size);
-    restore_interrupts(ints);
-
+    uint32_t base = (uint32_t)(uintptr_t)c->context;
+    flash_ops_program(base + (block * LFS_BLOCK_SIZE) + off, buffer, size);
     return LFS_ERR_OK;
 }
 
 // HAL: Erase a block
 static int lfs_flash_erase(const struct lfs_config *c, lfs_block_t block)
 {
-    (void)c;
-    uint32_t flash_offset = FLASH_TARGET_OFFSET + (block * LFS_BLOCK_SIZE);
-
-    // Disable interrupts during flash erase
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(flash_offset, LFS_BLOCK_SIZE);
-    restore_interrupts(ints);
-
+    uint32_t base = (uint32_t)(uintptr_t)c->context;
+    flash_ops_erase(base + (block * LFS_BLOCK_SIZE), LFS_BLOCK_SIZE);
     return LFS_ERR_OK;
 }
 
@@ -89,6 +92,7 @@ static int lfs_flash_sync(const struct lfs_config *c)
 
 // LittleFS configuration
 static const struct lfs_config lfs_cfg = {
+    .context = (void *)(uintptr_t)FLASH_TARGET_OFFSET,
     .read = lfs_flash_read,
     .prog = lfs_flash_prog,
     .erase = lfs_flash_erase,
@@ -97,7 +101,7 @@ static const struct lfs_config lfs_cfg = {
     .read_size = 1,
     .prog_size = FLASH_PAGE_SIZE,  // 256 bytes
     .block_size = LFS_BLOCK_SIZE,
-    .block_count = LFS_BLOCK_COUNT,
+    .block_count = FS_SIZE / LFS_BLOCK_SIZE,
     .cache_size = 256,             // Must match buffer sizes
     .lookahead_size = 16,
     .block_cycles = 500,
@@ -107,6 +111,133 @@ static const struct lfs_config lfs_cfg = {
     .lookahead_buffer = lfs_lookahead_buffer,
 };
 
+// Import area - the legacy 256 KB geometry (tools/generate_config_uf2.py)
+static const struct lfs_config import_cfg = {
+    .context = (void *)(uintptr_t)IMPORT_OFFSET,
+    .read = lfs_flash_read,
+    .prog = lfs_flash_prog,
+    .erase = lfs_flash_erase,
+    .sync = lfs_flash_sync,
+
+    .read_size = 1,
+    .prog_size = FLASH_PAGE_SIZE,
+    .block_size = LFS_BLOCK_SIZE,
+    .block_count = LFS_LEGACY_SIZE / LFS_BLOCK_SIZE,
+    .cache_size = 256,
+    .lookahead_size = 16,
+    .block_cycles = 500,
+};
+
+//--------------------------------------------------------------------
+// Import
+//--------------------------------------------------------------------
+
+// Copy the file at import_path, replacing any file of that name
+static int import_file(void)
+{
+    lfs_file_t src, dst;
+
+    int err = lfs_file_open(&import_lfs, &src, import_path, LFS_O_RDONLY);
+    if (err < 0) {
+        return err;
+    }
+    err = lfs_file_open(&lfs, &dst, import_path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+    if (err < 0) {
+        lfs_file_close(&import_lfs, &src);
+        return err;
+    }
+
+    lfs_ssize_t n;
+    while ((n = lfs_file_read(&import_lfs, &src, copy_buffer, sizeof(copy_buffer))) > 0) {
+        lfs_ssize_t written = lfs_file_write(&lfs, &dst, copy_buffer, n);
+        if (written != n) {
+            n = written < 0 ? written : LFS_ERR_NOSPC;
+            break;
+        }
+        // A full 256 KB import is seconds of erases
+        watchdog_update();
+    }
+
+    lfs_file_close(&import_lfs, &src);
+    err = lfs_file_close(&lfs, &dst);
+    if (n < 0) {
+        return (int)n;
+    }
+    if (err >= 0) {
+        imported_files++;
+    }
+    return err;
+}
+
+// Copy the directory at import_path (len characters, "" = root) recursively
+static int import_tree(size_t len)
+{
+    lfs_dir_t dir;
+    struct lfs_info info;
+
+    int err = lfs_dir_open(&import_lfs, &dir, len ? import_path : "/");
+    if (err < 0) {
+        return err;
+    }
+
+    while ((err = lfs_dir_read(&import_lfs, &dir, &info)) > 0) {
+        if (strcmp(info.name, ".") == 0 || strcmp(info.name, "..") == 0) {
+            continue;
+        }
+
+        size_t name_len = strlen(info.name);
+        if (len + 1 + name_len >= sizeof(import_path)) {
+            err = LFS_ERR_NAMETOOLONG;
+            break;
+        }
+        import_path[len] = '/';
+        memcpy(import_path + len + 1, info.name, name_len + 1);
+
+        if (info.type == LFS_TYPE_DIR) {
+            err = lfs_mkdir(&lfs, import_path);
+            if (err >= 0 || err == LFS_ERR_EXIST) {
+                err = import_tree(len + 1 + name_len);
+            }
+        } else {
+            err = import_file();
+        }
+        import_path[len] = '\0';
+        if (err < 0) {
+            break;
+        }
+    }
+
+    lfs_dir_close(&import_lfs, &dir);
+    return err;
+}
+
+// Merge a filesystem in the import area into the mounted partition,
+// then erase its superblock pair so it is not imported again
+static int import_legacy(void)
+{
+    uint64_t start_us = time_us_64();
+
+    import_path[0] = '\0';
+    int err = import_tree(0);
+    lfs_unmount(&import_lfs);
+    if (err < 0) {
+        printf("LittleFS: Import failed after %u files (error %d) - retried next boot\n",
+               imported_files, err);
+        return err;
+    }
+
+    flash_ops_erase(IMPORT_OFFSET, 2 * LFS_BLOCK_SIZE);
+    imported = true;
+    import_us = (uint32_t)(time_us_64() - start_us);
+    printf("LittleFS: Imported %u files from 0x%X in %lu ms\n",
+           imported_files, IMPORT_OFFSET, (unsigned long)(import_us / 1000));
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
 lfs_t* littlefs_init(void)
 {
     return &lfs;
@@ -122,11 +253,38 @@ uint32_t littlefs_get_fs_offset(void)
     return FLASH_TARGET_OFFSET;
 }
 
+uint32_t littlefs_get_fs_size(void)
+{
+    return FS_SIZE;
+}
+
 int littlefs_mount(void)
 {
+    uint64_t start_us = time_us_64();
+
+    // A firmware image past its reserve would be overwritten by the filesystem
+    if (flash_ops_image_end() > FLASH_TARGET_OFFSET) {
+        printf("LittleFS: Firmware (%lu KB) overlaps the partition at 0x%X - not mounting\n",
+               (unsigned long)(flash_ops_image_end() / 1024), FLASH_TARGET_OFFSET);
+        return LFS_ERR_NOSPC;
+    }
+
     // Try to mount existing filesystem
     int err = lfs_mount(&lfs, &lfs_cfg);
 
+    bool import = (IMPORT_SIZE != 0 && lfs_mount(&import_lfs, &import_cfg) == 0);
+    if (import && err < 0) {
+        // First boot with this layout - the partition holds stale data
+        printf("LittleFS: Creating %u KB partition at 0x%X\n", FS_SIZE / 1024, FLASH_TARGET_OFFSET);
+        err = lfs_format(&lfs, &lfs_cfg);
+        if (err >= 0) {
+            err = lfs_mount(&lfs, &lfs_cfg);
+        }
+        if (err < 0) {
+            lfs_unmount(&import_lfs);
+        }
+    }
+
     if (err < 0) {
         printf("LittleFS: Mount failed (error %d)\n", err);
         printf("LittleFS: Flash size = %u bytes (0x%X)\n", FLASH_TOTAL_SIZE, FLASH_TOTAL_SIZE);
@@ -136,10 +294,20 @@ int littlefs_mount(void)
         return err;
     }
 
+    if (import) {
+        import_legacy();
+    }
+
     lfs_mounted = 1;
+    lfs_ssize_t blocks = lfs_fs_size(&lfs);
+    used_bytes = blocks > 0 ? (uint32_t)blocks * LFS_BLOCK_SIZE : 0;
+    mount_us = (uint32_t)(time_us_64() - start_us);
+
     printf("LittleFS: Mounted successfully\n");
-    printf("LittleFS: Flash size = %u bytes, offset = 0x%X\n", 
+    printf("LittleFS: Flash size = %u bytes, offset = 0x%X\n",
            FLASH_TOTAL_SIZE, FLASH_TARGET_OFFSET);
+    printf("LittleFS: %u KB partition, %lu KB used, mounted in %lu us\n",
+           FS_SIZE / 1024, (unsigned long)(used_bytes / 1024), (unsigned long)mount_us);
     return 0;
 }
 
@@ -182,3 +350,17 @@ int littlefs_is_mounted(void)
 {
     return lfs_mounted;
 }
+
+void littlefs_get_info(ctrl_fs_t *out)
+{
+    out->mounted = lfs_mounted ? 1 : 0;
+    out->imported = imported ? 1 : 0;
+    out->imported_files = imported_files;
+    out->offset = FLASH_TARGET_OFFSET;
+    out->size = FS_SIZE;
+    out->used = used_bytes;
+    out->import_offset = IMPORT_SIZE ? IMPORT_OFFSET : 0;
+    out->import_size = IMPORT_SIZE;
+    out->mount_us = mount_us;
+    out->import_us = import_us;
+}
@@ -2,12 +2,25 @@
  * LittleFS Hardware Abstraction Layer for RP2040/RP2350
  *
  * Provides flash read/write/erase operations for LittleFS
+ *
+ * The partition is sized from the flash size. Below it sit the firmware
+ * and an OTA staging slot of LFS_FIRMWARE_RESERVE each; everything else
+ * goes to the filesystem. The last 256 KB of flash - where earlier
+ * firmware kept a fixed 256 KB filesystem and where config UF2s are
+ * written - then becomes an import area: a filesystem found there at
+ * boot is copied into the partition and erased. That migrates an
+ * existing filesystem and picks up a newly flashed config alike.
+ *
+ * Flash layout:
+ *   2 MB (Pico W)     firmware | OTA slot | LittleFS 256 KB (no import area)
+ *   4 MB (Pico 2 W)   firmware | OTA slot | LittleFS 2 MB | import 256 KB
  */
 
 #ifndef _LITTLEFS_HAL_H_
 #define _LITTLEFS_HAL_H_
 
 #include "lfs.h"
+#include "control_protocol.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -15,10 +28,22 @@ extern "C" {
 #endif
 
 // LittleFS configuration
-// Reserve last 256KB of flash for filesystem
-#define LFS_FLASH_SIZE      (256 * 1024)        // 256KB filesystem
 #define LFS_BLOCK_SIZE      4096                // Flash sector size
-#define LFS_BLOCK_COUNT     (LFS_FLASH_SIZE / LFS_BLOCK_SIZE)
+#define LFS_LEGACY_SIZE     (256 * 1024)        // Fixed partition of earlier firmware / config UF2s
+
+// Firmware image budget (the OTA slot below the filesystem is the same size)
+#ifndef LFS_FIRMWARE_RESERVE
+#define LFS_FIRMWARE_RESERVE (896 * 1024)
+#endif
+
+// Import area for a flash size (0 = the partition is the legacy one)
+#define LFS_PLAN_IMPORT_SIZE(flash_size) \
+    ((flash_size) > 2 * LFS_FIRMWARE_RESERVE + 2 * LFS_LEGACY_SIZE ? LFS_LEGACY_SIZE : 0)
+
+// Filesystem partition for a flash size (ends where the import area starts)
+#define LFS_PLAN_SIZE(flash_size) \
+    (LFS_PLAN_IMPORT_SIZE(flash_size) ? \
+     (flash_size) - 2 * LFS_FIRMWARE_RESERVE - LFS_LEGACY_SIZE : LFS_LEGACY_SIZE)
 
 /**
  * Initialize LittleFS with flash HAL
@@ -30,8 +55,11 @@ lfs_t* littlefs_init(void);
 /**
  * Mount LittleFS filesystem
  *
- * Attempts to mount an existing filesystem. Does NOT auto-format.
- * If mount fails, flash a wifi_config.uf2 to create the filesystem.
+ * Attempts to mount an existing filesystem, then merges a filesystem
+ * found in the import area into it (formatting the partition first if
+ * it holds none yet). Files from the import area replace files with the
+ * same path. An interrupted import leaves the import area intact and
+ * runs again at the next boot. Otherwise does NOT auto-format.
  *
  * @return 0 on success, negative error code on failure
  */
@@ -79,6 +107,18 @@ uint32_t littlefs_get_flash_size(void);
  */
 uint32_t littlefs_get_fs_offset(void);
 
+/**
+ * Get the filesystem partition size
+ *
+ * @return Partition size in bytes
+ */
+uint32_t littlefs_get_fs_size(void);
+
+/**
+ * Get partition layout, usage and boot mount/import results
+ */
+void littlefs_get_info(ctrl_fs_t *out);
+
 #ifdef __cplusplus
 }
 #endif
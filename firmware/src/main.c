@@ -35,20 +35,30 @@
 #include "network.h"
 #include "rb3e_protocol.h"
 #include "ap_server.h"
+#include "supervisor.h"
+#include "params.h"
+#include "control.h"
+#include "test_pattern.h"
+#include "cue_player.h"
+#include "trace.h"
+#include "mem_pool.h"
+#include "ota.h"
+#include "radio_ctrl.h"
+#include "board.h"
+#include "console_watch.h"
 
 //--------------------------------------------------------------------
 // Timing Constants (in milliseconds)
 //--------------------------------------------------------------------
 
-#define WATCHDOG_TIMEOUT_MS     8000    // Reset if frozen for 8 seconds
+#define WATCHDOG_TIMEOUT_MS     8000    // Reset if frozen for 8 seconds (last resort)
+#define MAIN_LOOP_STALL_MS      3000    // Main loop stall -> stop feeding watchdog
+#define USB_STALL_MS            5000    // USB stuck in recovery -> restart host stack
+#define NETWORK_STALL_MS        2000    // lwIP heartbeat missing -> rebind / link bounce
 #define HEARTBEAT_CONNECTED_MS  2000    // LED blink interval when WiFi connected
 #define HEARTBEAT_DISCONNECTED_MS 500   // LED blink interval when WiFi disconnected
-#define TELEMETRY_INTERVAL_MS   5000    // Telemetry broadcast interval
-#define SAFETY_TIMEOUT_MS       5000    // Turn off lights if no packets
 #define USB_RECONNECT_INTERVAL_MS 5000  // USB reconnection check interval
-#define WIFI_CHECK_INTERVAL_MS  10000   // WiFi connection check interval
-#define LOOP_DELAY_ACTIVE_US    100     // 0.1ms when active
-#define LOOP_DELAY_IDLE_US      1000    // 1ms when idle
+// Telemetry, safety timeout, WiFi check and loop delays are runtime params (params.h)
 #define WIFI_MAX_RETRIES        3
 
 //--------------------------------------------------------------------
@@ -59,6 +69,8 @@
 static volatile bool stagekit_command_pending = false;
 static volatile uint8_t pending_left_weight = 0;
 static volatile uint8_t pending_right_weight = 0;
+static volatile bool scene_pending = false;
+static stagekit_state_t pending_scene;
 static wifi_config_t stored_wifi_cfg;
 
 //--------------------------------------------------------------------
@@ -87,6 +99,54 @@ static void on_stagekit_packet(uint8_t left, uint8_t right)
     stagekit_command_pending = true;
 }
 
+static void on_scene_packet(const stagekit_state_t *scene)
+{
+    // Latest scene wins and supersedes any older single command
+    pending_scene = *scene;
+    stagekit_command_pending = false;
+    scene_pending = true;
+}
+
+//--------------------------------------------------------------------
+// Supervisor Hooks
+//--------------------------------------------------------------------
+
+// Service callback for blocking waits (WiFi connect) - keeps USB running
+// and shows the supervisor that the main loop is still making progress
+static void service_blocking_wait(void)
+{
+    usb_host_task();
+    supervisor_kick(SUPERVISOR_MAIN_LOOP);
+}
+
+static bool restart_usb(uint8_t attempt)
+{
+    (void)attempt;
+    usb_host_restart();
+    return true;
+}
+
+// First attempt rebinds the lwIP PCBs, later attempts bounce the CYW43 link
+static bool restart_network(uint8_t attempt)
+{
+    if (attempt == 0) {
+        printf("Network restart: rebinding UDP listeners\n");
+        network_stop_listener();
+        return network_start_listener(on_stagekit_packet);
+    }
+
+    printf("Network restart: bouncing WiFi link\n");
+    wifi_is_connected = false;
+    network_disconnect();
+
+    if (!network_connect_wifi()) {
+        return false;
+    }
+
+    wifi_is_connected = true;
+    return network_start_listener(on_stagekit_packet);
+}
+
 //--------------------------------------------------------------------
 // LED Blink Functions
 //--------------------------------------------------------------------
@@ -95,36 +155,44 @@ static void blink_led_simple(int times, int delay_ms)
 {
     // Simple blink without USB servicing (for early boot)
     for (int i = 0; i < times; i++) {
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+        radio_ctrl_led_set(true);
+        radio_ctrl_flush();
         sleep_ms(delay_ms);
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+        radio_ctrl_led_set(false);
+        radio_ctrl_flush();
         sleep_ms(delay_ms);
     }
 }
 
 static void blink_led(int times, int delay_ms)
 {
+    // Blocks anyway (boot, error paths), so the LED is written straight away
     for (int i = 0; i < times; i++) {
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+        radio_ctrl_led_set(true);
+        radio_ctrl_flush();
         // Service USB and watchdog during LED delays to prevent starvation
         for (int j = 0; j < delay_ms; j++) {
             usb_host_task();
+            network_poll();
             watchdog_update();
             sleep_ms(1);
         }
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+        radio_ctrl_led_set(false);
+        radio_ctrl_flush();
         for (int j = 0; j < delay_ms; j++) {
             usb_host_task();
+            network_poll();
             watchdog_update();
             sleep_ms(1);
         }
     }
 }
 
+// Queued - the CYW43 LED is written in the next idle window
 static void heartbeat_led_toggle(void)
 {
     led_state = !led_state;
-    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, led_state);
+    radio_ctrl_led_set(led_state);
 }
 
 // Error loop - blinks pattern forever
@@ -156,6 +224,11 @@ int main(void)
     printf("Build: " __DATE__ " " __TIME__ "\n");
     printf("==================================================\n");
 	
+    board_init();
+
+    // Shared buffer pool before any subsystem can allocate
+    mem_pool_init();
+
 	// Initialize CYW43 early for LED support
     printf("Initializing CYW43...\n");
     int cyw43_result = cyw43_arch_init_with_country(CYW43_COUNTRY_USA);
@@ -168,6 +241,7 @@ int main(void)
     }
     
     printf("CYW43 initialized OK\n");
+    radio_ctrl_init();
     
     // Signal: CYW43 OK - single blink
     blink_led_simple(1, 100);
@@ -182,12 +256,7 @@ int main(void)
         
         sleep_ms(300);  // Pause before diagnostic
         
-        for (uint32_t i = 0; i < flash_mb; i++) {
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-            sleep_ms(150);
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-            sleep_ms(150);
-        }
+        blink_led_simple((int)flash_mb, 150);
         
         sleep_ms(500);  // Pause after diagnostic before continuing
     }
@@ -196,6 +265,11 @@ int main(void)
     printf("Initializing watchdog (%d ms timeout)...\n", WATCHDOG_TIMEOUT_MS);
     watchdog_enable(WATCHDOG_TIMEOUT_MS, true);
     watchdog_update();
+
+    // Register supervised subsystems (enabled once they are running)
+    supervisor_register(SUPERVISOR_MAIN_LOOP, "Main loop", MAIN_LOOP_STALL_MS, NULL);
+    supervisor_register(SUPERVISOR_USB, "USB", USB_STALL_MS, restart_usb);
+    supervisor_register(SUPERVISOR_NETWORK, "Network", NETWORK_STALL_MS, restart_network);
 	
 	// 2. Initialize LittleFS
     printf("Initializing filesystem...\n");
@@ -205,6 +279,7 @@ int main(void)
 		printf("Filesystem mount failed. Formatting...\n");
 		littlefs_format_and_mount();
 	}
+    ota_init();
 	
 	// 3. Attempt to Load Config
 	bool config_loaded = false;
@@ -233,7 +308,8 @@ int main(void)
     usb_host_init();
 
     // Register USB task as service callback
-    network_set_service_callback(usb_host_task);
+    network_set_service_callback(service_blocking_wait);
+    network_set_scene_callback(on_scene_packet);
 
     // Initialize network
     printf("Initializing network...\n");
@@ -344,17 +420,61 @@ int main(void)
     // Track last discovery count to detect new discoveries
     uint32_t last_discovery_count = 0;
 
+    // Hand watchdog feeding over to the supervisor
+    supervisor_set_enabled(SUPERVISOR_MAIN_LOOP, true);
+    supervisor_set_enabled(SUPERVISOR_USB, true);
+    bool supervisor_running = supervisor_start();
+    if (!supervisor_running) {
+        printf("WARNING: Supervisor timer failed - watchdog fed from main loop\n");
+    }
+
     // Main loop
     while (true) {
         absolute_time_t now = get_absolute_time();
+        uint32_t pass_start = board_cycles();
         bool was_active = false;
 
-        // Feed watchdog
-        watchdog_update();
+        // Main loop liveness (supervisor feeds the watchdog)
+        supervisor_kick(SUPERVISOR_MAIN_LOOP);
+        if (!supervisor_running) {
+            watchdog_update();
+        }
 
         // Process USB tasks
         usb_host_task();
 
+        // Network slot (poll build) - packets received since the last pass
+        // reach their callbacks here, never in the middle of USB work
+        network_poll();
+
+        // Soft-restart any stalled subsystem
+        supervisor_poll();
+
+        // Process pending scene (before any single command that followed it)
+        if (scene_pending) {
+            stagekit_state_t scene;
+
+            uint32_t save = save_and_disable_interrupts();
+            scene_pending = false;
+            scene = pending_scene;
+            restore_interrupts(save);
+
+            was_active = true;
+            last_packet_time = now;
+
+            if (test_pattern_active() != CTRL_PATTERN_STOP) {
+                test_pattern_cancel();
+            }
+
+            TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_APPLY_SCENE, 0);
+            uint32_t apply_start = board_cycles();
+            if (usb_apply_stagekit_scene(&scene) >= 0) {
+                lights_active = true;
+            }
+            board_note_scene(board_cycles() - apply_start);
+            TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_APPLY_SCENE, 0);
+        }
+
         // Process pending StageKit command
         if (stagekit_command_pending) {
             uint8_t left, right;
@@ -368,12 +488,33 @@ int main(void)
             was_active = true;
             last_packet_time = now;
 
+            // Live game data takes over from any running test pattern
+            if (test_pattern_active() != CTRL_PATTERN_STOP) {
+                test_pattern_cancel();
+            }
+
+            TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_APPLY_COMMAND, (left << 8) | right);
             if (usb_stagekit_connected()) {
                 usb_send_stagekit_command(left, right);
                 lights_active = true;
             }
+            TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_APPLY_COMMAND, 0);
+        }
+
+        // Deferred control requests and test patterns
+        control_task();
+        if (usb_stagekit_connected() &&
+            (cue_player_task(usb_send_stagekit_command) ||
+             test_pattern_task(usb_send_stagekit_command))) {
+            was_active = true;
+            last_packet_time = now;
+            lights_active = true;
         }
 
+        // Firmware update flash work, only while the lights are quiet
+        ota_task(cue_player_active() ? 0 :
+                 (uint32_t)(absolute_time_diff_us(last_packet_time, now) / 1000));
+
         // Heartbeat LED - speed indicates WiFi status
         uint32_t heartbeat_interval = wifi_is_connected ? HEARTBEAT_CONNECTED_MS : HEARTBEAT_DISCONNECTED_MS;
         if (absolute_time_diff_us(last_heartbeat_time, now) > (heartbeat_interval * 1000)) {
@@ -385,35 +526,46 @@ int main(void)
         const network_stats_t *stats = network_get_stats();
         if (stats->discovery_received > last_discovery_count) {
             last_discovery_count = stats->discovery_received;
-            // Rapid blink to show discovery received!
+            // Rapid blink to show discovery received! (runs alongside the loop)
             printf("Dashboard discovered! Count: %lu\n", stats->discovery_received);
-            for (int i = 0; i < 5; i++) {
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-                sleep_ms(50);
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-                sleep_ms(50);
-            }
+            radio_ctrl_led_pulse(5, 100);
         }
 
         // Send telemetry
         if (network_wifi_connected() &&
-            absolute_time_diff_us(last_telemetry_time, now) > (TELEMETRY_INTERVAL_MS * 1000)) {
+            absolute_time_diff_us(last_telemetry_time, now) >
+                (int64_t)params_get(CTRL_PARAM_TELEMETRY_INTERVAL_MS) * 1000) {
+            TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_TELEMETRY, 0);
             network_send_telemetry(usb_stagekit_connected());
+            TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_TELEMETRY, 0);
             last_telemetry_time = now;
         }
 
-        // Safety timeout
-        if (lights_active &&
-            absolute_time_diff_us(last_packet_time, now) > (SAFETY_TIMEOUT_MS * 1000)) {
-            if (usb_stagekit_connected()) {
-                usb_stagekit_all_off();
+        // Link-quality score, alerts and roaming
+        network_link_task();
+
+        // Safety timeout (a running cue list holds the lights through quiet gaps,
+        // a live console in a song too; menus or a lost console end them at once)
+        if (lights_active && !cue_player_active()) {
+            console_verdict_t verdict = console_watch_check(
+                to_ms_since_boot(now),
+                (uint32_t)(absolute_time_diff_us(last_packet_time, now) / 1000),
+                params_get(CTRL_PARAM_SAFETY_TIMEOUT_MS),
+                params_get(CTRL_PARAM_ALIVE_TIMEOUT_MS));
+            if (verdict != CONSOLE_KEEP) {
+                TRACE_INSTANT(TRACE_TRACK_MAIN, TRACE_EV_SAFETY_OFF, verdict);
+                if (usb_stagekit_connected()) {
+                    usb_stagekit_all_off();
+                }
+                lights_active = false;
             }
-            lights_active = false;
         }
 
         // WiFi connection check
-        if (absolute_time_diff_us(last_wifi_check_time, now) > (WIFI_CHECK_INTERVAL_MS * 1000)) {
+        if (absolute_time_diff_us(last_wifi_check_time, now) >
+            (int64_t)params_get(CTRL_PARAM_WIFI_CHECK_INTERVAL_MS) * 1000) {
             last_wifi_check_time = now;
+            TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_WIFI_CHECK, 0);
 
             if (network_wifi_connected()) {
                 if (!network_check_connection()) {
@@ -427,7 +579,7 @@ int main(void)
                         network_get_ip_string(ip_str, sizeof(ip_str));
                         printf("Reconnected! IP: %s\n", ip_str);
                         network_start_listener(on_stagekit_packet);
-                        blink_led(2, 100);
+                        radio_ctrl_led_pulse(2, 200);
                     }
                 }
             } else {
@@ -438,19 +590,26 @@ int main(void)
                     network_get_ip_string(ip_str, sizeof(ip_str));
                     printf("Connected! IP: %s\n", ip_str);
                     network_start_listener(on_stagekit_packet);
-                    blink_led(2, 100);
+                    radio_ctrl_led_pulse(2, 200);
                 } else {
                     wifi_fail_reason_t reason = network_get_wifi_fail_reason();
                     printf("WiFi failed (reason=%d)\n", reason);
                 }
             }
+            TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_WIFI_CHECK, 0);
         }
 
-        // Adaptive delay
-        if (was_active || stagekit_command_pending) {
-            sleep_us(LOOP_DELAY_ACTIVE_US);
+        // LED writes and RSSI reads share the SPI bus with WiFi packets;
+        // they go out only on passes with no lighting work
+        bool busy = was_active || stagekit_command_pending || scene_pending;
+        radio_ctrl_task(!busy);
+        board_note_loop(board_cycles() - pass_start);
+
+        // Adaptive delay (poll build: also the main network slot)
+        if (busy) {
+            network_wait_us(params_get(CTRL_PARAM_LOOP_DELAY_ACTIVE_US));
         } else {
-            sleep_us(LOOP_DELAY_IDLE_US);
+            network_wait_us(params_get(CTRL_PARAM_LOOP_DELAY_IDLE_US));
         }
     }
 
@@ -0,0 +1,183 @@
+/*
+ * Fixed-Block Memory Pool for RB3E StageKit Bridge
+ *
+ * Each class is a static array whose free blocks form a singly linked
+ * list through their first word. Free finds the class by address range,
+ * so blocks carry no header.
+ */
+
+#include "mem_pool.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert(MEM_POOL_SMALL_SIZE % 4 == 0 && MEM_POOL_MEDIUM_SIZE % 4 == 0 &&
+               MEM_POOL_LARGE_SIZE % 4 == 0, "pool block sizes must be multiples of 4");
+_Static_assert(MEM_POOL_SMALL_SIZE < MEM_POOL_MEDIUM_SIZE &&
+               MEM_POOL_MEDIUM_SIZE < MEM_POOL_LARGE_SIZE, "pool classes must grow");
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block_t;
+
+typedef struct {
+    uint8_t *storage;
+    uint16_t block_size;
+    uint16_t block_count;
+    pool_block_t *free_list;
+    ctrl_pool_t stats;
+} pool_t;
+
+// An empty class has no storage; its range holds no block and its free list stays NULL
+#if MEM_POOL_SMALL_COUNT > 0
+static uint8_t small_storage[MEM_POOL_SMALL_COUNT * MEM_POOL_SMALL_SIZE] __attribute__((aligned(4)));
+#else
+#define small_storage NULL
+#endif
+#if MEM_POOL_MEDIUM_COUNT > 0
+static uint8_t medium_storage[MEM_POOL_MEDIUM_COUNT * MEM_POOL_MEDIUM_SIZE] __attribute__((aligned(4)));
+#else
+#define medium_storage NULL
+#endif
+static uint8_t large_storage[MEM_POOL_LARGE_COUNT * MEM_POOL_LARGE_SIZE] __attribute__((aligned(4)));
+
+// Smallest first - alloc walks up from the first class that fits
+static pool_t pools[MEM_POOL_CLASS_COUNT] = {
+    [MEM_POOL_SMALL]  = { small_storage,  MEM_POOL_SMALL_SIZE,  MEM_POOL_SMALL_COUNT },
+    [MEM_POOL_MEDIUM] = { medium_storage, MEM_POOL_MEDIUM_SIZE, MEM_POOL_MEDIUM_COUNT },
+    [MEM_POOL_LARGE]  = { large_storage,  MEM_POOL_LARGE_SIZE,  MEM_POOL_LARGE_COUNT },
+};
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void mem_pool_init(void)
+{
+    uint32_t total = 0;
+
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        pool_t *pool = &pools[c];
+
+        pool->free_list = NULL;
+        for (int i = pool->block_count - 1; i >= 0; i--) {
+            pool_block_t *block = (pool_block_t *)(pool->storage + i * pool->block_size);
+            block->next = pool->free_list;
+            pool->free_list = block;
+        }
+
+        memset(&pool->stats, 0, sizeof(pool->stats));
+        pool->stats.block_size = pool->block_size;
+        pool->stats.block_count = pool->block_count;
+        total += pool->block_count * pool->block_size;
+    }
+
+    printf("MemPool: %lu bytes (%d x %d, %d x %d, %d x %d)\n", (unsigned long)total,
+           MEM_POOL_SMALL_COUNT, MEM_POOL_SMALL_SIZE,
+           MEM_POOL_MEDIUM_COUNT, MEM_POOL_MEDIUM_SIZE,
+           MEM_POOL_LARGE_COUNT, MEM_POOL_LARGE_SIZE);
+}
+
+void *mem_pool_alloc(size_t size)
+{
+    pool_t *wanted = NULL;
+
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        pool_t *pool = &pools[c];
+        if (size > pool->block_size) {
+            continue;
+        }
+        if (wanted == NULL) {
+            wanted = pool;
+        }
+
+        uint32_t save = save_and_disable_interrupts();
+        pool_block_t *block = pool->free_list;
+        if (block != NULL) {
+            pool->free_list = block->next;
+            pool->stats.allocs++;
+            pool->stats.in_use++;
+            if (pool->stats.in_use > pool->stats.high_water) {
+                pool->stats.high_water = pool->stats.in_use;
+            }
+            if (pool != wanted) {
+                wanted->stats.fallbacks++;
+            }
+        }
+        restore_interrupts(save);
+
+        if (block != NULL) {
+            return block;
+        }
+    }
+
+    // Nothing fits at all is a caller bug; counted against the largest class
+    if (wanted == NULL) {
+        wanted = &pools[MEM_POOL_CLASS_COUNT - 1];
+    }
+    uint32_t save = save_and_disable_interrupts();
+    wanted->stats.failures++;
+    restore_interrupts(save);
+    return NULL;
+}
+
+void mem_pool_free(void *block)
+{
+    if (block == NULL) {
+        return;
+    }
+
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        pool_t *pool = &pools[c];
+        uint8_t *p = (uint8_t *)block;
+        if (pool->block_count == 0 || p < pool->storage || p >= pool->storage + pool->block_count * pool->block_size) {
+            continue;
+        }
+
+        uint32_t save = save_and_disable_interrupts();
+        pool_block_t *b = (pool_block_t *)block;
+        b->next = pool->free_list;
+        pool->free_list = b;
+        pool->stats.in_use--;
+        restore_interrupts(save);
+        return;
+    }
+
+    printf("MemPool: Free of %p outside the pool ignored\n", block);
+}
+
+void mem_pool_get_stats(ctrl_pool_t *out)
+{
+    uint32_t save = save_and_disable_interrupts();
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        out[c] = pools[c].stats;
+    }
+    restore_interrupts(save);
+}
+
+uint32_t mem_pool_failures(void)
+{
+    uint32_t failures = 0;
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        failures += pools[c].stats.failures;
+    }
+    return failures;
+}
+
+void mem_pool_reset_stats(void)
+{
+    uint32_t save = save_and_disable_interrupts();
+    for (int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        ctrl_pool_t *stats = &pools[c].stats;
+        stats->high_water = stats->in_use;
+        stats->allocs = 0;
+        stats->failures = 0;
+        stats->fallbacks = 0;
+    }
+    restore_interrupts(save);
+}
@@ -0,0 +1,105 @@
+/*
+ * Fixed-Block Memory Pool for RB3E StageKit Bridge
+ *
+ * One RAM budget for buffers that are only needed some of the time (the
+ * uploaded cue list, and future logs / caches), instead of a worst-case
+ * static array per subsystem next to lwIP's heap. Blocks come in three
+ * size classes set at build time; a request takes the smallest class
+ * that fits and falls back to larger ones. The cue list is the only
+ * user and takes large blocks, so the small and medium classes are
+ * empty unless a build opts in with a count.
+ *
+ * Alloc and free are O(1) and safe from IRQ context. The Cortex-M0+ has
+ * no exclusive load/store, so each free-list update runs with interrupts
+ * off for a few instructions rather than under a lock that an IRQ could
+ * spin on.
+ */
+
+#ifndef _MEM_POOL_H_
+#define _MEM_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Configuration (block sizes must be multiples of 4)
+//--------------------------------------------------------------------
+
+#ifndef MEM_POOL_SMALL_SIZE
+#define MEM_POOL_SMALL_SIZE     32
+#endif
+#ifndef MEM_POOL_SMALL_COUNT
+#define MEM_POOL_SMALL_COUNT    0       // Opt-in: no callers yet
+#endif
+
+#ifndef MEM_POOL_MEDIUM_SIZE
+#define MEM_POOL_MEDIUM_SIZE    128
+#endif
+#ifndef MEM_POOL_MEDIUM_COUNT
+#define MEM_POOL_MEDIUM_COUNT   0       // Opt-in: no callers yet
+#endif
+
+#ifndef MEM_POOL_LARGE_SIZE
+#define MEM_POOL_LARGE_SIZE     512     // 128 cues
+#endif
+#ifndef MEM_POOL_LARGE_COUNT
+#define MEM_POOL_LARGE_COUNT    8       // A full cue list - 4 KB
+#endif
+
+typedef enum {
+    MEM_POOL_SMALL = 0,
+    MEM_POOL_MEDIUM,
+    MEM_POOL_LARGE,
+    MEM_POOL_CLASS_COUNT
+} mem_pool_class_t;
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Thread every block onto its class's free list
+ *
+ * Call once at boot, before any subsystem allocates.
+ */
+void mem_pool_init(void);
+
+/**
+ * Take a block of at least size bytes (4-byte aligned)
+ *
+ * @return Block, or NULL if every class that fits is exhausted
+ */
+void *mem_pool_alloc(size_t size);
+
+/**
+ * Return a block to its pool (NULL is ignored)
+ */
+void mem_pool_free(void *block);
+
+/**
+ * Get usage of each size class
+ *
+ * @param out Array of MEM_POOL_CLASS_COUNT entries
+ */
+void mem_pool_get_stats(ctrl_pool_t *out);
+
+/**
+ * Sum of allocation failures over all classes
+ */
+uint32_t mem_pool_failures(void);
+
+/**
+ * Restart high-water marks from current usage and clear the counters
+ */
+void mem_pool_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEM_POOL_H_ */
@@ -6,12 +6,23 @@
 
 #include "network.h"
 #include "rb3e_protocol.h"
+#include "supervisor.h"
+#include "control.h"
+#include "source_arbiter.h"
+#include "trace.h"
+#include "mem_pool.h"
+#include "radio_ctrl.h"
+#include "link_quality.h"
+#include "console_watch.h"
+#include "cue_player.h"
+#include "params.h"
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "hardware/watchdog.h"
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include "lwip/ip_addr.h"
+#include "lwip/timeouts.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -30,10 +41,14 @@ static struct udp_pcb *udp_telemetry = NULL;     // Port 21071 - Discovery & Tel
 
 // Callback for StageKit packets
 static stagekit_packet_cb packet_callback = NULL;
+static scene_packet_cb scene_callback = NULL;
 
 // Callback for servicing other tasks during blocking operations
 static void (*service_callback)(void) = NULL;
 
+// Packets handed to the main loop (ends a poll-mode wait early)
+static volatile uint32_t rx_work_count = 0;
+
 // MAC address storage
 static uint8_t mac_address[6];
 
@@ -43,6 +58,24 @@ static ip_addr_t dashboard_addr;
 static absolute_time_t last_discovery_time;
 #define DISCOVERY_TIMEOUT_MS 30000  // Consider dashboard lost after 30 seconds
 
+// lwIP timer used as the network liveness token for the supervisor
+#define NETWORK_HEARTBEAT_MS 250
+
+// Link-quality remediation (main loop)
+#define LINK_UPDATE_MS 100
+#define LINK_RSSI_MS   1000
+static absolute_time_t link_next_update;
+static absolute_time_t link_next_rssi;
+static bool roam_scanning = false;
+static bool roam_found = false;
+static int32_t roam_rssi;
+static uint8_t roam_bssid[6];
+static uint8_t current_bssid[6];
+
+// Control protocol buffers (only used from the telemetry callback)
+static uint8_t control_request[sizeof(ctrl_header_t) + CTRL_MAX_PAYLOAD];
+static uint8_t control_response[CTRL_MAX_RESPONSE];
+
 //--------------------------------------------------------------------
 // Simple JSON Parser Helper
 //--------------------------------------------------------------------
@@ -82,6 +115,21 @@ static bool json_contains(const char *json, size_t len, const char *key, const c
     return false;
 }
 
+//--------------------------------------------------------------------
+// Liveness Heartbeat
+//--------------------------------------------------------------------
+
+/**
+ * Runs from lwIP timer processing - only fires while the CYW43/lwIP
+ * background context is alive, so it doubles as the liveness token
+ */
+static void network_heartbeat(void *arg)
+{
+    (void)arg;
+    supervisor_kick(SUPERVISOR_NETWORK);
+    sys_timeout(NETWORK_HEARTBEAT_MS, network_heartbeat, NULL);
+}
+
 //--------------------------------------------------------------------
 // UDP Receive Callbacks
 //--------------------------------------------------------------------
@@ -94,32 +142,106 @@ static void udp_stagekit_callback(void *arg, struct udp_pcb *pcb,
 {
     (void)arg;
     (void)pcb;
-    (void)addr;
     (void)port;
 
     if (p == NULL) {
         return;
     }
 
+    TRACE_BEGIN(TRACE_TRACK_NET, TRACE_EV_UDP_STAGEKIT, p->tot_len);
     net_stats.packets_received++;
+    supervisor_kick(SUPERVISOR_NETWORK);
+
+    // Only the active source may drive the lights - drop others before they queue
+    const uint8_t *data = (const uint8_t*)p->payload;
+    if (addr != NULL && IP_IS_V4(addr) &&
+        p->len >= sizeof(rb3e_header_t) && rb3e_check_magic(data)) {
+        uint8_t event_type = ((const rb3e_header_t*)data)->packet_type;
+        if (!source_arbiter_accept(ip4_addr_get_u32(ip_2_ip4(addr)), event_type)) {
+            net_stats.packets_rejected++;
+            TRACE_INSTANT(TRACE_TRACK_NET, TRACE_EV_SOURCE_REJECTED,
+                          ip4_addr_get_u32(ip_2_ip4(addr)));
+            TRACE_END(TRACE_TRACK_NET, TRACE_EV_UDP_STAGEKIT, 0);
+            pbuf_free(p);
+            return;
+        }
+
+        // Link-quality inputs, from the active source only
+        if (event_type == RB3E_EVENT_ALIVE) {
+            link_quality_note_alive(to_ms_since_boot(get_absolute_time()));
+        } else if (event_type == RB3E_EVENT_STAGEKIT || event_type == RB3E_EVENT_SCENE) {
+            link_quality_note_stagekit(to_ms_since_boot(get_absolute_time()));
+        }
+
+        // Console liveness, from the source driving the lights (or any, before one does)
+        uint32_t active = source_arbiter_active();
+        if (active == 0 || active == ip4_addr_get_u32(ip_2_ip4(addr))) {
+            if (event_type == RB3E_EVENT_ALIVE) {
+                console_watch_note_alive(to_ms_since_boot(get_absolute_time()));
+            } else if (event_type == RB3E_EVENT_STATE && p->len > sizeof(rb3e_header_t)) {
+                // Payload is one byte: 0 = menus, 1 = in game
+                console_watch_note_state(data[sizeof(rb3e_header_t)] != 0,
+                                         to_ms_since_boot(get_absolute_time()));
+            }
+        }
+    }
 
     // Process packet if callback is set
     if (packet_callback && p->len >= 10) {
         uint8_t left, right;
 
+        stagekit_state_t scene;
+
         // Parse RB3E StageKit packet
         if (rb3e_parse_stagekit((uint8_t*)p->payload, p->len, &left, &right)) {
             net_stats.packets_processed++;
+            rx_work_count++;
             packet_callback(left, right);
+        } else if (scene_callback &&
+                   rb3e_parse_scene((uint8_t*)p->payload, p->len, &scene)) {
+            net_stats.packets_processed++;
+            rx_work_count++;
+            scene_callback(&scene);
         } else {
             net_stats.packets_invalid++;
         }
     }
 
+    TRACE_END(TRACE_TRACK_NET, TRACE_EV_UDP_STAGEKIT, 0);
+
     // Free the pbuf
     pbuf_free(p);
 }
 
+/**
+ * Answer a latency probe in place
+ *
+ * Copies the request straight into the reply pbuf so the only work between
+ * the two timestamps is one allocation and one copy.
+ */
+static void send_probe_reply(struct udp_pcb *pcb, struct pbuf *p,
+                             const ip_addr_t *addr, u16_t port, uint64_t rx_us)
+{
+    struct pbuf *r = pbuf_alloc(PBUF_TRANSPORT, p->tot_len, PBUF_RAM);
+    if (r == NULL) {
+        return;
+    }
+
+    pbuf_copy_partial(p, r->payload, p->tot_len, 0);
+
+    ctrl_header_t *hdr = (ctrl_header_t *)r->payload;
+    ctrl_probe_t *probe = (ctrl_probe_t *)((uint8_t *)r->payload + sizeof(ctrl_header_t));
+    hdr->msg_id |= CTRL_MSG_RESPONSE;
+    hdr->status = CTRL_STATUS_OK;
+    probe->bridge_rx_us = rx_us;
+    probe->bridge_tx_us = time_us_64();
+
+    // Already in lwIP context - no cyw43_arch_lwip_begin()
+    udp_sendto(pcb, r, addr, port);
+    pbuf_free(r);
+    net_stats.probes_answered++;
+}
+
 /**
  * Callback for telemetry port (21071) - handles discovery packets
  * 
@@ -133,13 +255,52 @@ static void udp_telemetry_callback(void *arg, struct udp_pcb *pcb,
                                     struct pbuf *p, const ip_addr_t *addr, u16_t port)
 {
     (void)arg;
-    (void)pcb;
-    (void)port;
+    uint64_t rx_us = time_us_64();
 
     if (p == NULL || addr == NULL) {
         return;
     }
 
+    // Latency probe - answered before anything else touches the packet
+    if (p->len >= sizeof(ctrl_header_t) + sizeof(ctrl_probe_t) &&
+        p->tot_len <= sizeof(control_request) &&
+        ctrl_check_header((const uint8_t *)p->payload, p->tot_len)) {
+        const ctrl_header_t *hdr = (const ctrl_header_t *)p->payload;
+        if (hdr->msg_id == CTRL_MSG_PROBE && hdr->length >= sizeof(ctrl_probe_t)) {
+            send_probe_reply(pcb, p, addr, port, rx_us);
+            TRACE_INSTANT(TRACE_TRACK_NET, TRACE_EV_PROBE,
+                          ((const ctrl_probe_t *)(hdr + 1))->probe_id);
+            pbuf_free(p);
+            return;
+        }
+    }
+
+    TRACE_BEGIN(TRACE_TRACK_NET, TRACE_EV_UDP_TELEMETRY, p->tot_len);
+
+    // Binary control request - answer straight back to the sender
+    if (p->tot_len <= sizeof(control_request)) {
+        uint16_t len = pbuf_copy_partial(p, control_request, p->tot_len, 0);
+
+        if (ctrl_check_header(control_request, len)) {
+            rx_work_count++;
+            uint16_t resp_len = control_handle_request(control_request, len,
+                                                       control_response,
+                                                       sizeof(control_response));
+            if (resp_len > 0) {
+                struct pbuf *r = pbuf_alloc(PBUF_TRANSPORT, resp_len, PBUF_RAM);
+                if (r) {
+                    memcpy(r->payload, control_response, resp_len);
+                    // Already in lwIP context - no cyw43_arch_lwip_begin()
+                    udp_sendto(pcb, r, addr, port);
+                    pbuf_free(r);
+                }
+            }
+            TRACE_END(TRACE_TRACK_NET, TRACE_EV_UDP_TELEMETRY, 0);
+            pbuf_free(p);
+            return;
+        }
+    }
+
     // Check if this looks like a discovery packet
     // Dashboard sends: {"type":"discovery"} or {"type": "discovery"}
     if (p->len > 0 && p->len < 256) {
@@ -159,6 +320,8 @@ static void udp_telemetry_callback(void *arg, struct udp_pcb *pcb,
         }
     }
 
+    TRACE_END(TRACE_TRACK_NET, TRACE_EV_UDP_TELEMETRY, 0);
+
     // Free the pbuf
     pbuf_free(p);
 }
@@ -188,59 +351,11 @@ static void wifi_status_callback(struct netif *netif)
 }
 
 //--------------------------------------------------------------------
-// Public API Implementation
+// WiFi Join
 //--------------------------------------------------------------------
 
-void network_set_service_callback(void (*callback)(void))
-{
-    service_callback = callback;
-}
-
-bool network_init(const wifi_config_t *config)
-{
-    if (!config || !config->valid) {
-        printf("Network: Invalid WiFi config\n");
-        return false;
-    }
-
-    // Copy config
-    memcpy(&wifi_config, config, sizeof(wifi_config_t));
-
-    // CYW43 is already initialized in main() with country code
-    // No deinit/reinit needed - that was causing a "zombie radio" state
-    // where the SPI bus worked but the RF circuitry wasn't properly configured
-    printf("Network: Configuring WiFi (CYW43 already initialized)...\n");
-
-    // Note: Using pico_cyw43_arch_lwip_threadsafe_background - polling is
-    // handled automatically by background interrupts, no manual poll needed
-
-    // Enable station mode
-    cyw43_arch_enable_sta_mode();
-
-    // Disable power save and boost receive sensitivity:
-    cyw43_wifi_pm(&cyw43_state, cyw43_pm_value(CYW43_NO_POWERSAVE_MODE, 20, 1, 1, 1));
-
-    // Get MAC address
-    cyw43_wifi_get_mac(&cyw43_state, CYW43_ITF_STA, mac_address);
-    printf("Network: MAC = %02x:%02x:%02x:%02x:%02x:%02x\n",
-           mac_address[0], mac_address[1], mac_address[2],
-           mac_address[3], mac_address[4], mac_address[5]);
-
-    // Set callbacks
-    netif_set_link_callback(netif_default, wifi_link_callback);
-    netif_set_status_callback(netif_default, wifi_status_callback);
-
-    // Initialize discovery state
-    dashboard_discovered = false;
-    IP_ADDR4(&dashboard_addr, 0, 0, 0, 0);
-
-    net_state = NETWORK_STATE_DISCONNECTED;
-    printf("Network: Initialized\n");
-
-    return true;
-}
-
-bool network_connect_wifi(void)
+// Join the configured network (a specific access point if bssid is set)
+static bool connect_wifi(const uint8_t *bssid)
 {
     if (net_state == NETWORK_STATE_CONNECTED ||
         net_state == NETWORK_STATE_LISTENING) {
@@ -252,15 +367,24 @@ bool network_connect_wifi(void)
     net_state = NETWORK_STATE_CONNECTING;
 
     // Brief delay for radio readiness before scan
-    // Note: Using threadsafe_background - polling handled automatically
-    sleep_ms(50);
+    network_wait_us(50 * 1000);
 
     // Start async WiFi connection (non-blocking)
-    int result = cyw43_arch_wifi_connect_async(
-        wifi_config.ssid,
-        wifi_config.password,
-        CYW43_AUTH_WPA2_MIXED_PSK
-    );
+    int result;
+    if (bssid != NULL) {
+        result = cyw43_arch_wifi_connect_bssid_async(
+            wifi_config.ssid,
+            bssid,
+            wifi_config.password,
+            CYW43_AUTH_WPA2_MIXED_PSK
+        );
+    } else {
+        result = cyw43_arch_wifi_connect_async(
+            wifi_config.ssid,
+            wifi_config.password,
+            CYW43_AUTH_WPA2_MIXED_PSK
+        );
+    }
 
     if (result != 0) {
         printf("Network: WiFi connect start failed (err=%d)\n", result);
@@ -307,6 +431,7 @@ bool network_connect_wifi(void)
             // Connected successfully with IP!
             wifi_fail_reason = WIFI_FAIL_NONE;
             cyw43_wifi_get_rssi(&cyw43_state, &net_stats.wifi_rssi);
+            cyw43_wifi_get_bssid(&cyw43_state, current_bssid);
             printf("Network: Connected! IP=%s RSSI=%d dBm\n",
                    ip4addr_ntoa(netif_ip4_addr(netif_default)),
                    net_stats.wifi_rssi);
@@ -333,8 +458,8 @@ bool network_connect_wifi(void)
         }
 
         // Status 0-2 means still connecting, keep waiting
-        // Use short sleep (10ms) for responsive USB enumeration during boot
-        sleep_ms(10);
+        // Use short waits (10ms) for responsive USB enumeration during boot
+        network_wait_us(10 * 1000);
     }
 
     // Timeout - clean up driver state and report error
@@ -346,6 +471,151 @@ bool network_connect_wifi(void)
     return false;
 }
 
+//--------------------------------------------------------------------
+// Link-Quality Remediation
+//--------------------------------------------------------------------
+
+// Scan results arrive from the CYW43 driver; keep the strongest other
+// access point of our network
+static int roam_scan_result(void *env, const cyw43_ev_scan_result_t *result)
+{
+    (void)env;
+
+    if (result == NULL || result->ssid_len != strlen(wifi_config.ssid) ||
+        memcmp(result->ssid, wifi_config.ssid, result->ssid_len) != 0 ||
+        memcmp(result->bssid, current_bssid, sizeof(current_bssid)) == 0) {
+        return 0;
+    }
+
+    if (!roam_found || result->rssi > roam_rssi) {
+        roam_found = true;
+        roam_rssi = result->rssi;
+        memcpy(roam_bssid, result->bssid, sizeof(roam_bssid));
+    }
+    return 0;
+}
+
+static void roam_start(void)
+{
+    cyw43_wifi_scan_options_t opts;
+    memset(&opts, 0, sizeof(opts));
+
+    roam_found = false;
+    if (cyw43_wifi_scan(&cyw43_state, &opts, NULL, roam_scan_result) != 0) {
+        printf("Network: Roam scan failed to start\n");
+        link_quality_note_roam(false);
+        return;
+    }
+    roam_scanning = true;
+    printf("Network: Link score %u - scanning for a stronger access point\n",
+           link_quality_score());
+}
+
+// Rejoin through the strongest access point found, if it is clearly better
+static void roam_finish(void)
+{
+    int32_t current = radio_ctrl_rssi() != 0 ? radio_ctrl_rssi() : net_stats.wifi_rssi;
+    roam_scanning = false;
+
+    if (!roam_found || roam_rssi < current + LINK_ROAM_MARGIN_DB) {
+        printf("Network: No stronger access point (best %d dBm, current %d dBm)\n",
+               roam_found ? (int)roam_rssi : 0, (int)current);
+        link_quality_note_roam(false);
+        return;
+    }
+
+    // The rejoin blocks the main loop for up to the connect timeout; a cue
+    // list started during the scan would stall, so wait for the next attempt
+    if (cue_player_active()) {
+        printf("Network: Cue list playing - rejoin deferred\n");
+        link_quality_note_roam(false);
+        return;
+    }
+
+    printf("Network: Rejoining via %02x:%02x:%02x:%02x:%02x:%02x (%d dBm, current %d dBm)\n",
+           roam_bssid[0], roam_bssid[1], roam_bssid[2],
+           roam_bssid[3], roam_bssid[4], roam_bssid[5],
+           (int)roam_rssi, (int)current);
+
+    stagekit_packet_cb callback = packet_callback;
+    network_stop_listener();
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    net_state = NETWORK_STATE_DISCONNECTED;
+
+    // Any access point is better than none; the main loop retries otherwise
+    bool roamed = connect_wifi(roam_bssid);
+    if (!roamed) {
+        connect_wifi(NULL);
+    }
+    if (net_state == NETWORK_STATE_CONNECTED) {
+        network_start_listener(callback);
+    }
+    link_quality_note_roam(roamed);
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void network_set_service_callback(void (*callback)(void))
+{
+    service_callback = callback;
+}
+
+bool network_init(const wifi_config_t *config)
+{
+    if (!config || !config->valid) {
+        printf("Network: Invalid WiFi config\n");
+        return false;
+    }
+
+    // Copy config
+    memcpy(&wifi_config, config, sizeof(wifi_config_t));
+
+    // CYW43 is already initialized in main() with country code
+    // No deinit/reinit needed - that was causing a "zombie radio" state
+    // where the SPI bus worked but the RF circuitry wasn't properly configured
+    printf("Network: Configuring WiFi (CYW43 already initialized)...\n");
+
+    // Threadsafe background build: CYW43 interrupts do the polling. Poll
+    // build (RB3E_CYW43_ARCH=poll): network_poll()/network_wait_us() do
+#if PICO_CYW43_ARCH_POLL
+    printf("Network: Poll mode - network work runs in main loop slots\n");
+#else
+    printf("Network: Background mode - network work runs from the CYW43 IRQ\n");
+#endif
+
+    // Enable station mode
+    cyw43_arch_enable_sta_mode();
+
+    // Disable power save and boost receive sensitivity:
+    cyw43_wifi_pm(&cyw43_state, cyw43_pm_value(CYW43_NO_POWERSAVE_MODE, 20, 1, 1, 1));
+
+    // Get MAC address
+    cyw43_wifi_get_mac(&cyw43_state, CYW43_ITF_STA, mac_address);
+    printf("Network: MAC = %02x:%02x:%02x:%02x:%02x:%02x\n",
+           mac_address[0], mac_address[1], mac_address[2],
+           mac_address[3], mac_address[4], mac_address[5]);
+
+    // Set callbacks
+    netif_set_link_callback(netif_default, wifi_link_callback);
+    netif_set_status_callback(netif_default, wifi_status_callback);
+
+    // Initialize discovery state
+    dashboard_discovered = false;
+    IP_ADDR4(&dashboard_addr, 0, 0, 0, 0);
+
+    net_state = NETWORK_STATE_DISCONNECTED;
+    printf("Network: Initialized\n");
+
+    return true;
+}
+
+bool network_connect_wifi(void)
+{
+    return connect_wifi(NULL);
+}
+
 bool network_start_listener(stagekit_packet_cb callback)
 {
     if (net_state != NETWORK_STATE_CONNECTED) {
@@ -355,6 +625,11 @@ bool network_start_listener(stagekit_packet_cb callback)
 
     packet_callback = callback;
 
+    // New association (or listener restart) - judge the link afresh
+    link_quality_restart();
+    link_next_update = make_timeout_time_ms(LINK_UPDATE_MS);
+    link_next_rssi = link_next_update;
+
     // Acquire LwIP lock for thread safety with background processing
     cyw43_arch_lwip_begin();
 
@@ -416,8 +691,14 @@ bool network_start_listener(stagekit_packet_cb callback)
         }
     }
 
+    // Start liveness heartbeat (restart cleanly if already armed)
+    sys_untimeout(network_heartbeat, NULL);
+    sys_timeout(NETWORK_HEARTBEAT_MS, network_heartbeat, NULL);
+
     cyw43_arch_lwip_end();
 
+    supervisor_set_enabled(SUPERVISOR_NETWORK, true);
+
     net_state = NETWORK_STATE_LISTENING;
     printf("Network: Ready! Listening for StageKit on %d, telemetry on %d\n", 
            RB3E_LISTEN_PORT, RB3E_TELEMETRY_PORT);
@@ -425,11 +706,20 @@ bool network_start_listener(stagekit_packet_cb callback)
     return true;
 }
 
+void network_set_scene_callback(scene_packet_cb callback)
+{
+    scene_callback = callback;
+}
+
 void network_stop_listener(void)
 {
+    supervisor_set_enabled(SUPERVISOR_NETWORK, false);
+
     // Acquire LwIP lock for thread safety
     cyw43_arch_lwip_begin();
 
+    sys_untimeout(network_heartbeat, NULL);
+
     if (udp_listener != NULL) {
         udp_remove(udp_listener);
         udp_listener = NULL;
@@ -452,6 +742,30 @@ void network_stop_listener(void)
     printf("Network: Listener stopped\n");
 }
 
+void network_poll(void)
+{
+#if PICO_CYW43_ARCH_POLL
+    cyw43_arch_poll();
+#endif
+}
+
+void network_wait_us(uint32_t max_us)
+{
+#if PICO_CYW43_ARCH_POLL
+    absolute_time_t until = make_timeout_time_us(max_us);
+    uint32_t work = rx_work_count;
+
+    cyw43_arch_poll();
+    while (rx_work_count == work && !time_reached(until)) {
+        // Sleeps until the radio signals (or until), then runs the work
+        cyw43_arch_wait_for_work_until(until);
+        cyw43_arch_poll();
+    }
+#else
+    sleep_us(max_us);
+#endif
+}
+
 void network_send_telemetry(bool usb_connected)
 {
     if (udp_telemetry == NULL || net_state != NETWORK_STATE_LISTENING) {
@@ -467,25 +781,53 @@ void network_send_telemetry(bool usb_connected)
         }
     }
 
-    // Update RSSI
-    cyw43_wifi_get_rssi(&cyw43_state, &net_stats.wifi_rssi);
+    // RSSI from the last idle-window read (the connect-time value until then);
+    // ask for a fresh one for the next report instead of a blocking ioctl here
+    if (radio_ctrl_rssi() != 0) {
+        net_stats.wifi_rssi = radio_ctrl_rssi();
+    }
+    radio_ctrl_request_rssi();
 
     // Build JSON telemetry (outside of lock - no LwIP calls here)
     char mac_str[18];
     network_get_mac_string(mac_str);
 
-    char json[256];
+    char source_str[16] = "";
+    uint32_t source = source_arbiter_active();
+    if (source != 0) {
+        ip4_addr_t source_addr;
+        ip4_addr_set_u32(&source_addr, source);
+        ip4addr_ntoa_r(&source_addr, source_str, sizeof(source_str));
+    }
+
+    ctrl_pool_t pools[MEM_POOL_CLASS_COUNT];
+    mem_pool_get_stats(pools);
+
+    char json[384];
     int len = snprintf(json, sizeof(json),
         "{\"id\":\"%s\","
         "\"name\":\"Pico %02x:%02x\","
         "\"usb_status\":\"%s\","
         "\"wifi_signal\":%d,"
-        "\"uptime\":%lu}",
+        "\"uptime\":%lu,"
+        "\"active_source\":\"%s\","
+        "\"packets_rejected\":%lu,"
+        "\"pool_high_water\":[%u,%u,%u],"
+        "\"pool_failures\":%lu,"
+        "\"link_quality\":%u,"
+        "\"link_alert\":%s}",
         mac_str,
         mac_address[4], mac_address[5],
         usb_connected ? "Connected" : "Disconnected",
         net_stats.wifi_rssi,
-        to_ms_since_boot(get_absolute_time()) / 1000
+        to_ms_since_boot(get_absolute_time()) / 1000,
+        source_str,
+        (unsigned long)net_stats.packets_rejected,
+        pools[MEM_POOL_SMALL].high_water, pools[MEM_POOL_MEDIUM].high_water,
+        pools[MEM_POOL_LARGE].high_water,
+        (unsigned long)mem_pool_failures(),
+        link_quality_score(),
+        link_quality_alert() ? "true" : "false"
     );
 
     // Acquire LwIP lock for pbuf and UDP operations
@@ -495,6 +837,7 @@ void network_send_telemetry(bool usb_connected)
     struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
     if (p == NULL) {
         cyw43_arch_lwip_end();
+        link_quality_note_send(false);
         return;
     }
 
@@ -528,6 +871,7 @@ void network_send_telemetry(bool usb_connected)
 
     cyw43_arch_lwip_end();
 
+    link_quality_note_send(err == ERR_OK);
     if (err == ERR_OK) {
         net_stats.telemetry_sent++;
         // Debug output (can be removed later)
@@ -543,6 +887,57 @@ void network_send_telemetry(bool usb_connected)
     }
 }
 
+void network_link_task(void)
+{
+    if (net_state != NETWORK_STATE_LISTENING) {
+        return;
+    }
+
+    if (roam_scanning) {
+        if (!cyw43_wifi_scan_active(&cyw43_state)) {
+            roam_finish();
+        }
+        return;
+    }
+
+    // RSSI once a second, read in an idle window by radio_ctrl
+    if (time_reached(link_next_rssi)) {
+        link_next_rssi = make_timeout_time_ms(LINK_RSSI_MS);
+        link_quality_note_rssi(radio_ctrl_rssi());
+        radio_ctrl_request_rssi();
+    }
+
+    if (!time_reached(link_next_update)) {
+        return;
+    }
+    link_next_update = make_timeout_time_ms(LINK_UPDATE_MS);
+
+    switch (link_quality_update(to_ms_since_boot(get_absolute_time()),
+                                params_get(CTRL_PARAM_LINK_ALERT_SCORE),
+                                params_get(CTRL_PARAM_LINK_ROAM_SCORE))) {
+        case LINK_ACTION_ALERT:
+            // Power save should already be off; the driver can re-enable it on a rejoin
+            printf("Network: Link score %u - alerting dashboard, power save off\n",
+                   link_quality_score());
+            cyw43_wifi_pm(&cyw43_state, cyw43_pm_value(CYW43_NO_POWERSAVE_MODE, 20, 1, 1, 1));
+            break;
+        case LINK_ACTION_RECOVERED:
+            printf("Network: Link score %u - recovered\n", link_quality_score());
+            break;
+        case LINK_ACTION_ROAM:
+            if (cue_player_active()) {
+                printf("Network: Link score %u - cue list playing, roam deferred\n",
+                       link_quality_score());
+                link_quality_note_roam(false);
+                break;
+            }
+            roam_start();
+            break;
+        default:
+            break;
+    }
+}
+
 bool network_wifi_connected(void)
 {
     return (net_state == NETWORK_STATE_CONNECTED ||
@@ -559,6 +954,13 @@ const network_stats_t* network_get_stats(void)
     return &net_stats;
 }
 
+void network_reset_stats(void)
+{
+    int32_t rssi = net_stats.wifi_rssi;
+    memset(&net_stats, 0, sizeof(net_stats));
+    net_stats.wifi_rssi = rssi;
+}
+
 char* network_get_ip_string(char *buffer, size_t len)
 {
     if (netif_default != NULL && netif_is_up(netif_default)) {
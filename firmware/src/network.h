@@ -11,6 +11,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "config_parser.h"
+#include "stagekit_state.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,9 @@ typedef enum {
 // Callback for StageKit packets
 typedef void (*stagekit_packet_cb)(uint8_t left_weight, uint8_t right_weight);
 
+// Callback for scene packets (complete Stage Kit state)
+typedef void (*scene_packet_cb)(const stagekit_state_t *scene);
+
 //--------------------------------------------------------------------
 // Network Statistics
 //--------------------------------------------------------------------
@@ -57,8 +61,10 @@ typedef struct {
     uint32_t packets_received;
     uint32_t packets_processed;
     uint32_t packets_invalid;
+    uint32_t packets_rejected;      // Dropped by source arbitration
     uint32_t telemetry_sent;
     uint32_t discovery_received;    // Count of discovery packets received
+    uint32_t probes_answered;       // Latency probes echoed
     int32_t wifi_rssi;
 } network_stats_t;
 
@@ -104,11 +110,37 @@ bool network_connect_wifi(void);
  */
 bool network_start_listener(stagekit_packet_cb callback);
 
+/**
+ * Set callback for scene packets on the StageKit port
+ *
+ * @param callback Function to call when a scene packet is received (NULL to ignore scenes)
+ */
+void network_set_scene_callback(scene_packet_cb callback);
+
 /**
  * Stop UDP listener
  */
 void network_stop_listener(void);
 
+/**
+ * Run pending CYW43/lwIP work (receive callbacks, lwIP timers)
+ *
+ * The main loop's explicit network slot. A no-op in the threadsafe
+ * background build, where the same work runs from the CYW43 IRQ.
+ */
+void network_poll(void);
+
+/**
+ * Wait up to max_us before the next main loop pass
+ *
+ * Background build: a plain sleep. Poll build: services the network
+ * while waiting and returns early once a received packet has queued
+ * work for the main loop, so packet latency stays at one poll.
+ *
+ * @param max_us Longest wait
+ */
+void network_wait_us(uint32_t max_us);
+
 /**
  * Send telemetry to dashboard
  *
@@ -120,6 +152,19 @@ void network_stop_listener(void);
  */
 void network_send_telemetry(bool usb_connected);
 
+/**
+ * Update the link-quality score and act on it (call every main loop pass)
+ *
+ * Below CTRL_PARAM_LINK_ALERT_SCORE the dashboard is alerted through
+ * telemetry and power save is switched off again. Below
+ * CTRL_PARAM_LINK_ROAM_SCORE the bridge scans for another access point
+ * of the same network and rejoins through it if it is clearly stronger;
+ * the scan and the rejoin interrupt traffic for a few seconds. The rejoin
+ * blocks the main loop, so no roam starts or rejoins while a cue list is
+ * armed or playing; it is tried again after LINK_ROAM_BACKOFF_MS.
+ */
+void network_link_task(void);
+
 /**
  * Check if WiFi is connected
  *
@@ -141,6 +186,11 @@ network_state_t network_get_state(void);
  */
 const network_stats_t* network_get_stats(void);
 
+/**
+ * Reset packet counters (RSSI is kept)
+ */
+void network_reset_stats(void);
+
 /**
  * Get WiFi IP address as string
  *
@@ -0,0 +1,296 @@
+/*
+ * Over-the-Air Firmware Update for RB3E StageKit Bridge
+ *
+ * The control callback only validates a chunk and copies it into a
+ * static page buffer. Everything that touches flash runs in
+ * ota_task() from the main loop, one operation per pass, and only when
+ * the lights have been quiet: an erase stalls code execution for tens
+ * of milliseconds. While a page waits, further chunks get BUSY and the
+ * client resends them.
+ */
+
+#include "ota.h"
+#include "flash_ops.h"
+#include "littlefs_hal.h"
+#include "params.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert(CTRL_OTA_CHUNK == FLASH_OPS_PAGE_SIZE, "OTA chunks are whole flash pages");
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+static bool ota_enabled = false;
+static uint32_t slot_offset = 0;
+static uint32_t slot_size = 0;
+
+static volatile uint8_t ota_state = CTRL_OTA_STATE_IDLE;
+static volatile bool install_pending = false;
+static volatile uint32_t session = 0;   // Bumped by BEGIN/ABORT
+static uint32_t image_size = 0;
+static uint32_t image_crc = 0;
+
+// Receive side (control callback) hands one page at a time to ota_task().
+// Static like the install buffer, so a full cue list cannot block an upload
+static uint8_t page_buffer[FLASH_OPS_PAGE_SIZE] __attribute__((aligned(4)));
+static volatile bool page_pending = false;
+static uint32_t page_offset = 0;
+static volatile uint32_t received = 0;
+
+// Flash side (main loop)
+static uint32_t written = 0;
+static uint32_t erased_end = 0;         // Staging bytes erased so far
+static uint32_t verify_offset = 0;
+static uint32_t verify_crc = 0;
+static uint64_t staged_us = 0;
+
+// Statistics
+static uint32_t busy_replies = 0;
+static uint32_t deferred_passes = 0;
+static uint32_t flash_max_us = 0;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+static void note_flash_time(uint64_t start_us)
+{
+    uint32_t elapsed = (uint32_t)(time_us_64() - start_us);
+    if (elapsed > flash_max_us) {
+        flash_max_us = elapsed;
+    }
+}
+
+// One erase or one page program. BEGIN and ABORT are refused while a
+// page is pending, so the session cannot change underneath.
+static void flash_step(void)
+{
+    uint64_t start_us = time_us_64();
+    if (page_offset >= erased_end) {
+        flash_ops_erase(slot_offset + erased_end, FLASH_OPS_SECTOR_SIZE);
+        note_flash_time(start_us);
+        erased_end += FLASH_OPS_SECTOR_SIZE;
+        return;
+    }
+
+    flash_ops_program(slot_offset + page_offset, page_buffer, FLASH_OPS_PAGE_SIZE);
+    note_flash_time(start_us);
+    written = received;
+    page_pending = false;
+}
+
+// CRC of one sector of the staged image per call. A BEGIN can arrive
+// meanwhile; its session number makes the old result go nowhere.
+static void verify_step(void)
+{
+    uint32_t snap = session;
+    uint32_t length = image_size - verify_offset;
+    if (length > FLASH_OPS_SECTOR_SIZE) {
+        length = FLASH_OPS_SECTOR_SIZE;
+    }
+    uint32_t crc = ctrl_crc32(verify_crc, flash_ops_read(slot_offset + verify_offset), length);
+
+    bool done = false;
+    uint32_t save = save_and_disable_interrupts();
+    if (session == snap) {
+        verify_crc = crc;
+        verify_offset += length;
+        done = (verify_offset >= image_size);
+        if (done) {
+            ota_state = (verify_crc == image_crc) ? CTRL_OTA_STATE_STAGED : CTRL_OTA_STATE_FAILED;
+            staged_us = time_us_64();
+        }
+    }
+    restore_interrupts(save);
+
+    if (done && verify_crc == image_crc) {
+        printf("OTA: Image verified, %lu bytes staged\n", (unsigned long)image_size);
+    } else if (done) {
+        printf("OTA: Staged image CRC %08lx, expected %08lx\n",
+               (unsigned long)verify_crc, (unsigned long)image_crc);
+    }
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void ota_init(void)
+{
+    uint32_t below_fs = littlefs_get_fs_offset();
+
+    slot_size = OTA_SLOT_SIZE;
+    if (slot_size == 0) {
+        slot_size = (below_fs / 2) & ~(uint32_t)(FLASH_OPS_SECTOR_SIZE - 1);
+    }
+    slot_offset = below_fs - slot_size;
+
+    uint32_t image_end = flash_ops_image_end();
+    ota_enabled = (slot_size <= below_fs && image_end <= slot_offset);
+
+    if (ota_enabled) {
+        printf("OTA: Staging slot 0x%lX-0x%lX (%lu KB), firmware %lu KB\n",
+               (unsigned long)slot_offset, (unsigned long)(slot_offset + slot_size),
+               (unsigned long)(slot_size / 1024), (unsigned long)(image_end / 1024));
+    } else {
+        printf("OTA: Firmware (%lu KB) overlaps the staging slot at 0x%lX - updates disabled\n",
+               (unsigned long)(image_end / 1024), (unsigned long)slot_offset);
+    }
+}
+
+uint8_t ota_begin(const ctrl_ota_begin_t *req, ctrl_ota_status_t *status)
+{
+    if (!ota_enabled) {
+        return CTRL_STATUS_NOT_READY;
+    }
+    if (req->family_id != 0 && req->family_id != FLASH_OPS_UF2_FAMILY) {
+        return CTRL_STATUS_BAD_PARAM;
+    }
+    if (req->image_size == 0 || req->image_size > slot_size) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    // Same image again - the client is resuming
+    bool same = (req->image_size == image_size && req->image_crc == image_crc);
+    if (same && ota_state != CTRL_OTA_STATE_IDLE && ota_state != CTRL_OTA_STATE_FAILED) {
+        ota_get_status(status);
+        return CTRL_STATUS_OK;
+    }
+
+    if (page_pending) {
+        return CTRL_STATUS_BUSY;
+    }
+
+    session++;
+    image_size = req->image_size;
+    image_crc = req->image_crc;
+    received = 0;
+    written = 0;
+    erased_end = 0;
+    install_pending = false;
+    ota_state = CTRL_OTA_STATE_RECEIVING;
+
+    printf("OTA: Receiving %lu byte image (CRC %08lx)\n",
+           (unsigned long)image_size, (unsigned long)image_crc);
+    ota_get_status(status);
+    return CTRL_STATUS_OK;
+}
+
+uint8_t ota_write(uint32_t offset, const uint8_t *data, uint16_t length, uint32_t crc32)
+{
+    if (ota_state != CTRL_OTA_STATE_RECEIVING) {
+        return CTRL_STATUS_NOT_READY;
+    }
+    if (length == 0 || length > CTRL_OTA_CHUNK || offset + length > image_size) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+    if (offset + length <= received) {
+        return CTRL_STATUS_OK;  // Repeat of an acknowledged chunk
+    }
+    if (offset != received) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+    if (length != CTRL_OTA_CHUNK && offset + length != image_size) {
+        return CTRL_STATUS_BAD_LENGTH;
+    }
+    if (ctrl_crc32(0, data, length) != crc32) {
+        return CTRL_STATUS_BAD_CRC;
+    }
+    if (page_pending) {
+        busy_replies++;
+        return CTRL_STATUS_BUSY;
+    }
+
+    memcpy(page_buffer, data, length);
+    memset(page_buffer + length, 0xFF, FLASH_OPS_PAGE_SIZE - length);
+    page_offset = offset;
+    received = offset + length;
+    page_pending = true;
+    return CTRL_STATUS_OK;
+}
+
+uint8_t ota_commit(bool install)
+{
+    if (ota_state == CTRL_OTA_STATE_VERIFYING || ota_state == CTRL_OTA_STATE_STAGED) {
+        install_pending = install;
+        return CTRL_STATUS_OK;
+    }
+    if (ota_state != CTRL_OTA_STATE_RECEIVING || received != image_size) {
+        return CTRL_STATUS_NOT_READY;
+    }
+    if (page_pending) {
+        return CTRL_STATUS_BUSY;
+    }
+
+    verify_offset = 0;
+    verify_crc = 0;
+    install_pending = install;
+    ota_state = CTRL_OTA_STATE_VERIFYING;
+    return CTRL_STATUS_OK;
+}
+
+uint8_t ota_abort(void)
+{
+    if (page_pending) {
+        return CTRL_STATUS_BUSY;
+    }
+
+    session++;
+    install_pending = false;
+    ota_state = CTRL_OTA_STATE_IDLE;
+    image_size = 0;
+    image_crc = 0;
+    return CTRL_STATUS_OK;
+}
+
+void ota_get_status(ctrl_ota_status_t *out)
+{
+    out->state = ota_state;
+    out->install_pending = install_pending;
+    out->image_size = image_size;
+    out->image_crc = image_crc;
+    out->received = received;
+    out->written = written;
+    out->slot_offset = slot_offset;
+    out->slot_size = ota_enabled ? slot_size : 0;
+    out->busy_replies = busy_replies;
+    out->deferred_passes = deferred_passes;
+    out->flash_max_us = flash_max_us;
+}
+
+void ota_task(uint32_t quiet_ms)
+{
+    switch (ota_state) {
+        case CTRL_OTA_STATE_RECEIVING:
+            if (!page_pending) {
+                return;
+            }
+            if (quiet_ms < params_get(CTRL_PARAM_OTA_QUIET_MS)) {
+                deferred_passes++;
+                return;
+            }
+            flash_step();
+            break;
+
+        case CTRL_OTA_STATE_VERIFYING:
+            verify_step();
+            break;
+
+        case CTRL_OTA_STATE_STAGED:
+            if (install_pending && quiet_ms >= params_get(CTRL_PARAM_OTA_INSTALL_QUIET_MS) &&
+                time_us_64() - staged_us >= (uint64_t)OTA_INSTALL_GRACE_MS * 1000) {
+                printf("OTA: Installing %lu byte image - rebooting\n", (unsigned long)image_size);
+                sleep_ms(10);   // Let the message out
+                flash_ops_install(slot_offset,
+                                  (image_size + FLASH_OPS_SECTOR_SIZE - 1) & ~(uint32_t)(FLASH_OPS_SECTOR_SIZE - 1));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Over-the-Air Firmware Update for RB3E StageKit Bridge
+ *
+ * A new image is streamed over the control protocol into a staging
+ * slot below the LittleFS partition, one CRC-checked page per request.
+ * Chunks are sequential and acknowledged, so an interrupted upload
+ * resumes from ctrl_ota_status_t.received after a BEGIN with the same
+ * image. Once the whole image verifies from flash it is copied over
+ * the running firmware at the next quiet moment (between songs).
+ *
+ * Flash layout (defaults, see littlefs_hal.h):
+ *   0x000000  firmware (max OTA_SLOT_SIZE)
+ *   0x0E0000  staging slot (OTA_SLOT_SIZE)
+ *   0x1C0000  LittleFS (256 KB on 2 MB flash, 2 MB + import area on 4 MB)
+ */
+
+#ifndef _OTA_H_
+#define _OTA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// OTA Constants
+//--------------------------------------------------------------------
+
+// Staging slot size (0 = half of the flash below LittleFS)
+#ifndef OTA_SLOT_SIZE
+#define OTA_SLOT_SIZE           0
+#endif
+
+#define OTA_QUIET_MS            1000    // Default for CTRL_PARAM_OTA_QUIET_MS
+#define OTA_INSTALL_QUIET_MS    10000   // Default for CTRL_PARAM_OTA_INSTALL_QUIET_MS
+#define OTA_INSTALL_GRACE_MS    2000    // Stay staged this long so the uploader sees the result
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Place the staging slot and check the running image fits below it
+ */
+void ota_init(void);
+
+/**
+ * Start (or resume) an upload
+ *
+ * A BEGIN for the image already in progress or staged keeps its state,
+ * so the client continues from the status' received offset.
+ *
+ * @param req Image size, CRC and UF2 family
+ * @param status Filled with the resulting status
+ * @return CTRL_STATUS_OK, CTRL_STATUS_OUT_OF_RANGE (too large),
+ *         CTRL_STATUS_BAD_PARAM (wrong family), CTRL_STATUS_BUSY or CTRL_STATUS_NOT_READY (OTA unavailable)
+ */
+uint8_t ota_begin(const ctrl_ota_begin_t *req, ctrl_ota_status_t *status);
+
+/**
+ * Accept the next chunk (control callback - only copies to RAM)
+ *
+ * @return CTRL_STATUS_OK (also for a repeated chunk), CTRL_STATUS_BUSY
+ *         (previous page not written yet - resend), CTRL_STATUS_BAD_CRC,
+ *         CTRL_STATUS_BAD_LENGTH, CTRL_STATUS_OUT_OF_RANGE or
+ *         CTRL_STATUS_NOT_READY
+ */
+uint8_t ota_write(uint32_t offset, const uint8_t *data, uint16_t length, uint32_t crc32);
+
+/**
+ * Verify the received image; optionally install it once verified
+ *
+ * On a staged image this only changes whether it will be installed.
+ *
+ * @return CTRL_STATUS_OK, CTRL_STATUS_BUSY (last page still pending)
+ *         or CTRL_STATUS_NOT_READY (image incomplete)
+ */
+uint8_t ota_commit(bool install);
+
+/**
+ * Drop the upload or staged image
+ *
+ * @return CTRL_STATUS_OK or CTRL_STATUS_BUSY (a page is being written)
+ */
+uint8_t ota_abort(void);
+
+/**
+ * Get the update state
+ */
+void ota_get_status(ctrl_ota_status_t *out);
+
+/**
+ * Flash work scheduler - call from the main loop
+ *
+ * Does at most one erase, one page program or one verify step per
+ * call, and flash work only after quiet_ms reaches
+ * CTRL_PARAM_OTA_QUIET_MS. Installs (and never returns) once a staged
+ * image is armed and quiet_ms reaches CTRL_PARAM_OTA_INSTALL_QUIET_MS.
+ *
+ * @param quiet_ms Time since the lights last changed (0 while a show runs)
+ */
+void ota_task(uint32_t quiet_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OTA_H_ */
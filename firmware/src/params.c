@@ -0,0 +1,106 @@
+/*
+ * Runtime Parameters for RB3E StageKit Bridge
+ *
+ * Fixed table of bounded uint32 values. Reads and writes are single
+ * 32-bit accesses, so they are safe between the network callback and
+ * the main loop without locking.
+ */
+
+#include "params.h"
+#include "network.h"
+#include "usb_host.h"
+#include "source_arbiter.h"
+#include "ota.h"
+#include "link_quality.h"
+#include "console_watch.h"
+#include <stddef.h>
+
+//--------------------------------------------------------------------
+// Parameter Table
+//--------------------------------------------------------------------
+
+typedef struct {
+    uint16_t id;
+    uint32_t min;
+    uint32_t max;
+    volatile uint32_t value;
+} param_entry_t;
+
+static param_entry_t param_table[] = {
+    { CTRL_PARAM_SAFETY_TIMEOUT_MS,      500,   60000, SAFETY_TIMEOUT_MS },
+    { CTRL_PARAM_TELEMETRY_INTERVAL_MS,  500,   60000, TELEMETRY_INTERVAL_MS },
+    { CTRL_PARAM_LOOP_DELAY_ACTIVE_US,   0,     10000, LOOP_DELAY_ACTIVE_US },
+    { CTRL_PARAM_LOOP_DELAY_IDLE_US,     0,     10000, LOOP_DELAY_IDLE_US },
+    { CTRL_PARAM_WIFI_CHECK_INTERVAL_MS, 1000,  60000, WIFI_CHECK_INTERVAL_MS },
+    { CTRL_PARAM_USB_XFER_TIMEOUT_MS,    10,    2000,  USB_XFER_TIMEOUT_MS },
+    { CTRL_PARAM_SOURCE_LOCK_MS,         100,   60000, SOURCE_LOCK_TIMEOUT_MS },
+    { CTRL_PARAM_OTA_QUIET_MS,           0,     60000, OTA_QUIET_MS },
+    { CTRL_PARAM_OTA_INSTALL_QUIET_MS,   1000,  600000, OTA_INSTALL_QUIET_MS },
+    { CTRL_PARAM_LINK_ALERT_SCORE,       0,     100,   LINK_ALERT_SCORE },
+    { CTRL_PARAM_LINK_ROAM_SCORE,        0,     100,   LINK_ROAM_SCORE },
+    { CTRL_PARAM_ALIVE_TIMEOUT_MS,       500,   60000, ALIVE_TIMEOUT_MS },
+};
+
+#define PARAM_COUNT ((int)(sizeof(param_table) / sizeof(param_table[0])))
+
+static param_entry_t* find_param(uint16_t id)
+{
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        if (param_table[i].id == id) {
+            return &param_table[i];
+        }
+    }
+    return NULL;
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+uint32_t params_get(uint16_t id)
+{
+    param_entry_t *p = find_param(id);
+    return p ? p->value : 0;
+}
+
+uint8_t params_set(uint16_t id, uint32_t value)
+{
+    param_entry_t *p = find_param(id);
+    if (!p) {
+        return CTRL_STATUS_BAD_PARAM;
+    }
+
+    if (value < p->min || value > p->max) {
+        return CTRL_STATUS_OUT_OF_RANGE;
+    }
+
+    p->value = value;
+    return CTRL_STATUS_OK;
+}
+
+bool params_describe(uint16_t id, ctrl_param_t *out)
+{
+    param_entry_t *p = find_param(id);
+    if (!p) {
+        return false;
+    }
+
+    out->id = p->id;
+    out->value = p->value;
+    out->min = p->min;
+    out->max = p->max;
+    return true;
+}
+
+int params_count(void)
+{
+    return PARAM_COUNT;
+}
+
+uint16_t params_id_at(int index)
+{
+    if (index < 0 || index >= PARAM_COUNT) {
+        return 0;
+    }
+    return param_table[index].id;
+}
@@ -0,0 +1,75 @@
+/*
+ * Runtime Parameters for RB3E StageKit Bridge
+ *
+ * Tunables that used to be compile-time constants. Defaults match the
+ * previous values; the control protocol can change them at runtime.
+ */
+
+#ifndef _PARAMS_H_
+#define _PARAMS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Default Values
+//--------------------------------------------------------------------
+
+#define SAFETY_TIMEOUT_MS       5000    // Turn off lights if no packets
+#define LOOP_DELAY_ACTIVE_US    100     // 0.1ms when active
+#define LOOP_DELAY_IDLE_US      1000    // 1ms when idle
+#define WIFI_CHECK_INTERVAL_MS  10000   // WiFi connection check interval
+// TELEMETRY_INTERVAL_MS is in network.h, USB_XFER_TIMEOUT_MS in usb_host.h
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Get a runtime parameter
+ *
+ * @param id Parameter ID (CTRL_PARAM_*)
+ * @return Current value, or 0 for unknown IDs
+ */
+uint32_t params_get(uint16_t id);
+
+/**
+ * Set a runtime parameter
+ *
+ * @param id Parameter ID (CTRL_PARAM_*)
+ * @param value New value
+ * @return CTRL_STATUS_OK, CTRL_STATUS_BAD_PARAM or CTRL_STATUS_OUT_OF_RANGE
+ */
+uint8_t params_set(uint16_t id, uint32_t value);
+
+/**
+ * Describe a runtime parameter
+ *
+ * @param id Parameter ID (CTRL_PARAM_*)
+ * @param out Filled with id, value and limits
+ * @return true if the parameter exists
+ */
+bool params_describe(uint16_t id, ctrl_param_t *out);
+
+/**
+ * Get number of runtime parameters
+ */
+int params_count(void);
+
+/**
+ * Get parameter ID by table index (for listing)
+ *
+ * @return Parameter ID, or 0 if index is out of range
+ */
+uint16_t params_id_at(int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PARAMS_H_ */
@@ -0,0 +1,198 @@
+/*
+ * CYW43 Control-Plane Queue for RB3E StageKit Bridge
+ *
+ * Requests are plain state (the wanted LED level, an RSSI flag), so
+ * queueing is just "remember the newest": a heartbeat toggle that is
+ * still waiting when the next one arrives costs nothing. Only the main
+ * loop calls in here.
+ */
+
+#include "radio_ctrl.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include <stdio.h>
+
+// Operation ids (trace arg)
+#define RADIO_OP_LED    0
+#define RADIO_OP_RSSI   1
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+static bool led_steady = false;         // Heartbeat level
+static bool led_applied = false;        // Last level written to the LED
+static bool led_written = false;        // Level unknown until the first write
+
+// Pulse train: edges left, each half a period long
+static uint8_t pulse_edges = 0;
+static uint16_t pulse_half_ms = 0;
+static bool pulse_level = false;
+static absolute_time_t pulse_next_edge;
+
+static bool rssi_requested = false;
+static int32_t rssi_dbm = 0;
+
+// Statistics
+static uint32_t requests = 0;           // What would have been one ioctl each
+static uint32_t ops = 0;
+static uint32_t deferred_passes = 0;
+static uint32_t bus_us = 0;
+static uint32_t bus_max_us = 0;
+
+//--------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------
+
+static void step_pulse(void)
+{
+    while (pulse_edges > 0 && time_reached(pulse_next_edge)) {
+        pulse_edges--;
+        pulse_level = !pulse_level;
+        pulse_next_edge = delayed_by_ms(pulse_next_edge, pulse_half_ms);
+        requests++;
+    }
+}
+
+static bool wanted_led(void)
+{
+    return pulse_edges > 0 ? pulse_level : led_steady;
+}
+
+static void note_bus_time(uint32_t start_us)
+{
+    uint32_t elapsed = time_us_32() - start_us;
+    bus_us += elapsed;
+    if (elapsed > bus_max_us) {
+        bus_max_us = elapsed;
+    }
+    ops++;
+}
+
+static void write_led(bool on)
+{
+#if RB3E_STATUS_LED_GPIO >= 0
+    gpio_put(RB3E_STATUS_LED_GPIO, on);
+#else
+    TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_CYW43_CTRL, RADIO_OP_LED);
+    uint32_t start_us = time_us_32();
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, on);
+    note_bus_time(start_us);
+    TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_CYW43_CTRL, 0);
+#endif
+    led_applied = on;
+    led_written = true;
+}
+
+static void read_rssi(void)
+{
+    TRACE_BEGIN(TRACE_TRACK_MAIN, TRACE_EV_CYW43_CTRL, RADIO_OP_RSSI);
+    uint32_t start_us = time_us_32();
+    int32_t value;
+    if (cyw43_wifi_get_rssi(&cyw43_state, &value) == 0) {
+        rssi_dbm = value;
+    }
+    note_bus_time(start_us);
+    TRACE_END(TRACE_TRACK_MAIN, TRACE_EV_CYW43_CTRL, 0);
+    rssi_requested = false;
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void radio_ctrl_init(void)
+{
+#if RB3E_STATUS_LED_GPIO >= 0
+    gpio_init(RB3E_STATUS_LED_GPIO);
+    gpio_set_dir(RB3E_STATUS_LED_GPIO, GPIO_OUT);
+    printf("Status LED: GPIO %d\n", RB3E_STATUS_LED_GPIO);
+#else
+    printf("Status LED: CYW43 (written in idle windows)\n");
+#endif
+}
+
+void radio_ctrl_led_set(bool on)
+{
+    if (on != led_steady) {
+        led_steady = on;
+        requests++;
+    }
+}
+
+void radio_ctrl_led_pulse(uint8_t count, uint16_t period_ms)
+{
+    pulse_edges = (uint8_t)(count * 2);
+    pulse_half_ms = (uint16_t)(period_ms / 2);
+    pulse_level = false;
+    pulse_next_edge = get_absolute_time();
+}
+
+void radio_ctrl_request_rssi(void)
+{
+    rssi_requested = true;
+    requests++;
+}
+
+int32_t radio_ctrl_rssi(void)
+{
+    return rssi_dbm;
+}
+
+bool radio_ctrl_task(bool idle)
+{
+    step_pulse();
+
+    bool led = wanted_led();
+    bool led_due = !led_written || led != led_applied;
+
+#if RB3E_STATUS_LED_GPIO >= 0
+    // Not on the CYW43 bus - no reason to wait
+    if (led_due) {
+        write_led(led);
+        led_due = false;
+    }
+#endif
+
+    if (!led_due && !rssi_requested) {
+        return false;
+    }
+    if (!idle) {
+        deferred_passes++;
+        return false;
+    }
+
+    // One bus operation per pass keeps the window short
+    if (led_due) {
+        write_led(led);
+    } else {
+        read_rssi();
+    }
+    return true;
+}
+
+void radio_ctrl_flush(void)
+{
+    while (radio_ctrl_task(true)) {
+    }
+}
+
+void radio_ctrl_get_stats(ctrl_radio_stats_t *out)
+{
+    out->requests = requests;
+    out->ops = ops;
+    out->deferred_passes = deferred_passes;
+    out->bus_us = bus_us;
+    out->bus_max_us = bus_max_us;
+    out->led_gpio = RB3E_STATUS_LED_GPIO;
+}
+
+void radio_ctrl_reset_stats(void)
+{
+    requests = 0;
+    ops = 0;
+    deferred_passes = 0;
+    bus_us = 0;
+    bus_max_us = 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * CYW43 Control-Plane Queue for RB3E StageKit Bridge
+ *
+ * On the Pico W the onboard LED is a CYW43 GPIO, so every LED write is
+ * a blocking SPI ioctl on the same bus that carries WiFi packets, as is
+ * reading the RSSI. Callers only record what they want here; the
+ * requests are coalesced (the newest LED state wins, one RSSI read per
+ * request burst) and radio_ctrl_task() issues at most one of them per
+ * main loop pass that had nothing else to do.
+ *
+ * Build with -DRB3E_STATUS_LED_GPIO=<pin> to drive the status LED from a
+ * plain RP2040/RP2350 GPIO instead; LED writes then never touch the bus.
+ */
+
+#ifndef _RADIO_CTRL_H_
+#define _RADIO_CTRL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+
+// Status LED pin (-1 = onboard LED behind the CYW43)
+#ifndef RB3E_STATUS_LED_GPIO
+#define RB3E_STATUS_LED_GPIO    -1
+#endif
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Set up the LED pin (GPIO build) - call after cyw43_arch_init
+ */
+void radio_ctrl_init(void);
+
+/**
+ * Request the steady LED state (heartbeat)
+ *
+ * A pulse train from radio_ctrl_led_pulse() takes precedence until it
+ * ends, then the LED returns to this state.
+ */
+void radio_ctrl_led_set(bool on);
+
+/**
+ * Flash the LED without blocking the caller
+ *
+ * @param count Number of flashes
+ * @param period_ms Length of one on + off cycle
+ */
+void radio_ctrl_led_pulse(uint8_t count, uint16_t period_ms);
+
+/**
+ * Ask for a fresh RSSI reading (taken in the next idle window)
+ */
+void radio_ctrl_request_rssi(void);
+
+/**
+ * Latest RSSI reading in dBm (0 before the first one)
+ */
+int32_t radio_ctrl_rssi(void);
+
+/**
+ * Issue queued CYW43 operations - call once per main loop pass
+ *
+ * @param idle True when the pass handled no packets and none are waiting;
+ *             nothing touches the bus otherwise
+ * @return True if a CYW43 operation ran
+ */
+bool radio_ctrl_task(bool idle);
+
+/**
+ * Issue everything queued now (boot and error paths, which block anyway)
+ */
+void radio_ctrl_flush(void);
+
+/**
+ * Get bus usage counters
+ */
+void radio_ctrl_get_stats(ctrl_radio_stats_t *out);
+
+/**
+ * Clear bus usage counters
+ */
+void radio_ctrl_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RADIO_CTRL_H_ */
@@ -36,6 +36,9 @@ extern "C" {
 #define RB3E_EVENT_STAGEKIT     6
 #define RB3E_EVENT_BAND_INFO    7
 
+// Bridge extensions (never sent by RB3E itself)
+#define RB3E_EVENT_SCENE        0x80  // Complete Stage Kit state (stagekit_state_t)
+
 // Network Ports
 #define RB3E_LISTEN_PORT        21070
 #define RB3E_TELEMETRY_PORT     21071
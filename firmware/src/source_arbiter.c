@@ -0,0 +1,177 @@
+/*
+ * StageKit Source Arbitration for RB3E StageKit Bridge
+ *
+ * Runs entirely in the UDP receive callback; the main loop only reads.
+ */
+
+#include "source_arbiter.h"
+#include "params.h"
+#include "rb3e_protocol.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+typedef struct {
+    uint32_t addr;              // 0 = free slot
+    uint8_t priority;
+    bool priority_set;          // Configured - never replaced by a new sender
+    uint32_t accepted;
+    uint32_t rejected;
+    uint32_t last_seen_ms;
+} source_entry_t;
+
+static source_entry_t sources[SOURCE_MAX_TRACKED];
+static source_entry_t *active_source = NULL;
+static uint32_t lock_refresh_ms;
+static uint32_t source_switches = 0;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+static void format_addr(uint32_t addr, char *buf, size_t len)
+{
+    const uint8_t *b = (const uint8_t *)&addr;
+    snprintf(buf, len, "%d.%d.%d.%d", b[0], b[1], b[2], b[3]);
+}
+
+// Find a source, or take a free / least recently seen idle slot for it
+static source_entry_t* find_or_add(uint32_t addr, uint32_t now_ms)
+{
+    source_entry_t *victim = NULL;
+
+    for (int i = 0; i < SOURCE_MAX_TRACKED; i++) {
+        source_entry_t *s = &sources[i];
+        if (s->addr == addr) {
+            return s;
+        }
+        if (s == active_source || s->priority_set) {
+            continue;
+        }
+        if (s->addr == 0) {
+            if (!victim || victim->addr != 0) {
+                victim = s;
+            }
+        } else if (!victim || (victim->addr != 0 &&
+                   now_ms - s->last_seen_ms > now_ms - victim->last_seen_ms)) {
+            victim = s;
+        }
+    }
+
+    if (victim) {
+        memset(victim, 0, sizeof(*victim));
+        victim->addr = addr;
+        victim->priority = SOURCE_DEFAULT_PRIORITY;
+        victim->last_seen_ms = now_ms;
+    }
+    return victim;
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+bool source_arbiter_accept(uint32_t addr, uint8_t event_type)
+{
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    bool command = (event_type == RB3E_EVENT_STAGEKIT || event_type == RB3E_EVENT_SCENE);
+
+    // Lock expires after a quiet period
+    if (active_source &&
+        now_ms - lock_refresh_ms > params_get(CTRL_PARAM_SOURCE_LOCK_MS)) {
+        active_source = NULL;
+    }
+
+    source_entry_t *src = find_or_add(addr, now_ms);
+    if (src == NULL) {
+        // Table full of configured sources - unknown senders only get an idle bridge
+        return command ? (active_source == NULL) : true;
+    }
+    src->last_seen_ms = now_ms;
+
+    if (!command) {
+        if (src == active_source && event_type == RB3E_EVENT_ALIVE) {
+            lock_refresh_ms = now_ms;
+        }
+        return true;
+    }
+
+    if (active_source == NULL || active_source == src ||
+        src->priority > active_source->priority) {
+        if (active_source != src) {
+            char buf[16];
+            format_addr(addr, buf, sizeof(buf));
+            printf("Arbiter: Active source is now %s (priority %d)\n", buf, src->priority);
+            active_source = src;
+            source_switches++;
+        }
+        lock_refresh_ms = now_ms;
+        src->accepted++;
+        return true;
+    }
+
+    src->rejected++;
+    return false;
+}
+
+bool source_arbiter_set_priority(uint32_t addr, uint8_t priority)
+{
+    source_entry_t *src = find_or_add(addr, to_ms_since_boot(get_absolute_time()));
+    if (src == NULL) {
+        return false;
+    }
+
+    src->priority = priority;
+    src->priority_set = true;
+    return true;
+}
+
+uint32_t source_arbiter_active(void)
+{
+    source_entry_t *src = active_source;
+    if (src == NULL ||
+        to_ms_since_boot(get_absolute_time()) - lock_refresh_ms > params_get(CTRL_PARAM_SOURCE_LOCK_MS)) {
+        return 0;
+    }
+    return src->addr;
+}
+
+uint32_t source_arbiter_switches(void)
+{
+    return source_switches;
+}
+
+int source_arbiter_list(ctrl_source_t *out, int max)
+{
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    uint32_t active = source_arbiter_active();
+    int n = 0;
+
+    for (int i = 0; i < SOURCE_MAX_TRACKED && n < max; i++) {
+        const source_entry_t *s = &sources[i];
+        if (s->addr == 0) {
+            continue;
+        }
+        out[n].addr = s->addr;
+        out[n].priority = s->priority;
+        out[n].active = (s->addr == active) ? 1 : 0;
+        out[n].accepted = s->accepted;
+        out[n].rejected = s->rejected;
+        out[n].idle_ms = now_ms - s->last_seen_ms;
+        n++;
+    }
+    return n;
+}
+
+void source_arbiter_reset_stats(void)
+{
+    for (int i = 0; i < SOURCE_MAX_TRACKED; i++) {
+        sources[i].accepted = 0;
+        sources[i].rejected = 0;
+    }
+    source_switches = 0;
+}
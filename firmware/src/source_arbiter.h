@@ -0,0 +1,85 @@
+/*
+ * StageKit Source Arbitration for RB3E StageKit Bridge
+ *
+ * When several senders drive one bridge, only one of them (the active
+ * source) may control the lights. The lock is held while the active
+ * source keeps sending ALIVE or StageKit traffic and is released after
+ * CTRL_PARAM_SOURCE_LOCK_MS of silence. A source with a higher priority
+ * takes over immediately.
+ */
+
+#ifndef _SOURCE_ARBITER_H_
+#define _SOURCE_ARBITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Arbiter Constants
+//--------------------------------------------------------------------
+
+#define SOURCE_MAX_TRACKED      8       // Senders tracked at once (oldest idle one is replaced)
+#define SOURCE_LOCK_TIMEOUT_MS  3000    // Default for CTRL_PARAM_SOURCE_LOCK_MS
+#define SOURCE_DEFAULT_PRIORITY 0
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Decide whether a packet from a source may drive the lights
+ *
+ * Called from the UDP receive callback before any command is queued.
+ * StageKit and scene packets can take the lock; ALIVE only refreshes it.
+ *
+ * @param addr Sender IPv4 address (network byte order)
+ * @param event_type RB3E event type of the packet
+ * @return true if the packet should be processed
+ */
+bool source_arbiter_accept(uint32_t addr, uint8_t event_type);
+
+/**
+ * Set the priority of a source (tracked even before it sends)
+ *
+ * @param addr Sender IPv4 address (network byte order)
+ * @param priority Higher wins; equal priorities wait for the lock to expire
+ * @return true if the source could be tracked
+ */
+bool source_arbiter_set_priority(uint32_t addr, uint8_t priority);
+
+/**
+ * Get the source currently holding the lock
+ *
+ * @return IPv4 address (network byte order), or 0 if unlocked
+ */
+uint32_t source_arbiter_active(void);
+
+/**
+ * Get how often the lock has moved to another source
+ */
+uint32_t source_arbiter_switches(void);
+
+/**
+ * Get tracked sources
+ *
+ * @param out Array to fill
+ * @param max Capacity of out
+ * @return Number of entries written
+ */
+int source_arbiter_list(ctrl_source_t *out, int max);
+
+/**
+ * Reset per-source counters (sources and priorities are kept)
+ */
+void source_arbiter_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SOURCE_ARBITER_H_ */
@@ -0,0 +1,167 @@
+/*
+ * Stage Kit Shadow State
+ *
+ * Tracks what the Stage Kit is showing by applying the same
+ * left/right weight commands that are sent over USB.
+ * Header-only so host tools can share the exact semantics.
+ */
+
+#ifndef _STAGEKIT_STATE_H_
+#define _STAGEKIT_STATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "rb3e_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// LED bank indices (one LED pattern byte per color)
+#define SK_BANK_BLUE            0
+#define SK_BANK_GREEN           1
+#define SK_BANK_YELLOW          2
+#define SK_BANK_RED             3
+#define SK_BANK_COUNT           4
+
+// Commands needed to set every bank, strobe and fog individually
+#define SK_SCENE_FULL_COMMANDS  (SK_BANK_COUNT + 2)
+
+// Complete Stage Kit output state (packed - also used on the wire)
+typedef struct __attribute__((packed)) {
+    uint8_t banks[SK_BANK_COUNT];   // LED pattern per color bank
+    uint8_t strobe;                 // 0 = off, 1-4 = strobe speed
+    uint8_t fog;                    // 0 = off, 1 = on
+} stagekit_state_t;
+
+/**
+ * Apply a StageKit command to a shadow state
+ *
+ * @param state State to update
+ * @param left_weight LED pattern byte
+ * @param right_weight Command byte (color/strobe/fog)
+ */
+static inline void stagekit_state_apply(stagekit_state_t *state,
+                                        uint8_t left_weight, uint8_t right_weight)
+{
+    switch (right_weight) {
+        case SK_LED_BLUE:       state->banks[SK_BANK_BLUE] = left_weight; break;
+        case SK_LED_GREEN:      state->banks[SK_BANK_GREEN] = left_weight; break;
+        case SK_LED_YELLOW:     state->banks[SK_BANK_YELLOW] = left_weight; break;
+        case SK_LED_RED:        state->banks[SK_BANK_RED] = left_weight; break;
+        case SK_FOG_ON:         state->fog = 1; break;
+        case SK_FOG_OFF:        state->fog = 0; break;
+        case SK_STROBE_SPEED_1: state->strobe = 1; break;
+        case SK_STROBE_SPEED_2: state->strobe = 2; break;
+        case SK_STROBE_SPEED_3: state->strobe = 3; break;
+        case SK_STROBE_SPEED_4: state->strobe = 4; break;
+        case SK_STROBE_OFF:     state->strobe = 0; break;
+        case SK_ALL_OFF:        memset(state, 0, sizeof(*state)); break;
+        default:                break;  // Unknown command - no visible change
+    }
+}
+
+/**
+ * Check if two shadow states are identical
+ *
+ * @return 1 if equal, 0 otherwise
+ */
+static inline int stagekit_state_equal(const stagekit_state_t *a, const stagekit_state_t *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+/**
+ * Build the shortest command sequence that turns one state into another
+ *
+ * Either sends each differing field, or SK_ALL_OFF followed by every
+ * non-zero field of the target - whichever is shorter.
+ *
+ * @param from State the kit is showing (or will show)
+ * @param to Desired state
+ * @param left_out LED pattern bytes (SK_SCENE_FULL_COMMANDS entries)
+ * @param right_out Command bytes (SK_SCENE_FULL_COMMANDS entries)
+ * @return Number of commands written
+ */
+static inline int stagekit_state_diff(const stagekit_state_t *from, const stagekit_state_t *to,
+                                      uint8_t *left_out, uint8_t *right_out)
+{
+    static const uint8_t bank_commands[SK_BANK_COUNT] = {
+        SK_LED_BLUE, SK_LED_GREEN, SK_LED_YELLOW, SK_LED_RED
+    };
+    static const stagekit_state_t dark = {{0, 0, 0, 0}, 0, 0};
+
+    int changed = 0;
+    int lit = 0;
+    for (int b = 0; b < SK_BANK_COUNT; b++) {
+        changed += (from->banks[b] != to->banks[b]);
+        lit += (to->banks[b] != 0);
+    }
+    changed += (from->strobe != to->strobe) + (from->fog != to->fog);
+    lit += (to->strobe != 0) + (to->fog != 0);
+
+    // Blackout first when it beats clearing fields one by one
+    const stagekit_state_t *base = from;
+    int n = 0;
+    if (1 + lit < changed) {
+        left_out[n] = 0x00;
+        right_out[n] = SK_ALL_OFF;
+        n++;
+        base = &dark;
+    }
+
+    for (int b = 0; b < SK_BANK_COUNT; b++) {
+        if (base->banks[b] != to->banks[b]) {
+            left_out[n] = to->banks[b];
+            right_out[n] = bank_commands[b];
+            n++;
+        }
+    }
+    if (base->strobe != to->strobe) {
+        left_out[n] = 0x00;
+        right_out[n] = to->strobe ? (uint8_t)(SK_STROBE_SPEED_1 + to->strobe - 1) : SK_STROBE_OFF;
+        n++;
+    }
+    if (base->fog != to->fog) {
+        left_out[n] = 0x00;
+        right_out[n] = to->fog ? SK_FOG_ON : SK_FOG_OFF;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * Parse a bridge scene packet (RB3E header + stagekit_state_t)
+ *
+ * @param data Pointer to raw packet data
+ * @param len Length of packet data
+ * @param scene_out Parsed scene
+ * @return 1 if valid scene packet, 0 otherwise
+ */
+static inline int rb3e_parse_scene(const uint8_t *data, size_t len, stagekit_state_t *scene_out)
+{
+    if (len < sizeof(rb3e_header_t) + sizeof(stagekit_state_t)) {
+        return 0;
+    }
+
+    if (!rb3e_check_magic(data) || data[5] != RB3E_EVENT_SCENE) {
+        return 0;
+    }
+
+    memcpy(scene_out, data + sizeof(rb3e_header_t), sizeof(*scene_out));
+
+    // Reject values the Stage Kit has no command for
+    if (scene_out->strobe > 4 || scene_out->fog > 1) {
+        return 0;
+    }
+
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STAGEKIT_STATE_H_ */
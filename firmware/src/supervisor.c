@@ -0,0 +1,294 @@
+/*
+ * Subsystem Supervisor for RB3E StageKit Bridge
+ *
+ * Liveness checks run from a repeating timer interrupt so they keep
+ * working while the main loop is busy - or, in dual-core builds
+ * (RB3E_DUAL_CORE), from a loop on core 1, so they never preempt core 0
+ * at all. Restarts are only requested from there; they run in main loop
+ * context via supervisor_poll().
+ */
+
+#include "supervisor.h"
+#include "board.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+#if RB3E_DUAL_CORE
+#include "pico/multicore.h"
+#endif
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    uint32_t stall_timeout_ms;
+    supervisor_restart_fn restart;
+    volatile bool enabled;
+
+    volatile uint32_t token;            // Advanced by supervisor_kick()
+    uint32_t last_token;                // Token value at last progress
+    absolute_time_t last_progress;
+
+    volatile bool stalled;
+    absolute_time_t stall_time;
+    absolute_time_t last_restart_time;
+    volatile bool restart_requested;
+    volatile uint8_t attempts;          // Restarts in the current stall
+    volatile bool recovered;            // Set by timer, logged by poll
+
+    supervisor_stats_t stats;
+} supervisor_entry_t;
+
+static supervisor_entry_t entries[SUPERVISOR_SUBSYSTEM_COUNT];
+#if !RB3E_DUAL_CORE
+static repeating_timer_t check_timer;
+#endif
+static volatile int restarting_id = -1;  // Subsystem whose restart is running
+
+// Guards entry updates against the check. With the check in an IRQ
+// masking interrupts is enough; on core 1 it needs a hardware spin lock.
+#if RB3E_DUAL_CORE
+static spin_lock_t *entry_lock = NULL;
+
+static inline uint32_t entries_lock(void)
+{
+    return spin_lock_blocking(entry_lock);
+}
+
+static inline void entries_unlock(uint32_t save)
+{
+    spin_unlock(entry_lock, save);
+}
+#else
+static inline uint32_t entries_lock(void)
+{
+    return save_and_disable_interrupts();
+}
+
+static inline void entries_unlock(uint32_t save)
+{
+    restore_interrupts(save);
+}
+#endif
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+// Detect stalls and recoveries, feed the watchdog
+static void supervisor_check(void)
+{
+    absolute_time_t now = get_absolute_time();
+    bool healthy = true;
+
+    TRACE_BEGIN(TRACE_TRACK_TIMER, TRACE_EV_SUPERVISOR, 0);
+    uint32_t save = entries_lock();
+
+    for (int i = 0; i < SUPERVISOR_SUBSYSTEM_COUNT; i++) {
+        supervisor_entry_t *e = &entries[i];
+        if (!e->enabled) {
+            continue;
+        }
+
+        uint32_t token = e->token;
+        if (token != e->last_token) {
+            e->last_token = token;
+            e->last_progress = now;
+
+            if (e->stalled) {
+                uint32_t elapsed_us = (uint32_t)absolute_time_diff_us(e->stall_time, now);
+                e->stats.recoveries++;
+                e->stats.last_recovery_us = elapsed_us;
+                if (elapsed_us > e->stats.max_recovery_us) {
+                    e->stats.max_recovery_us = elapsed_us;
+                }
+                e->stalled = false;
+                e->restart_requested = false;
+                e->attempts = 0;
+                e->recovered = true;
+            }
+            continue;
+        }
+
+        int64_t idle_us = absolute_time_diff_us(e->last_progress, now);
+
+        if (!e->stalled) {
+            if (idle_us > (int64_t)e->stall_timeout_ms * 1000) {
+                e->stalled = true;
+                e->stall_time = now;
+                e->stats.stalls++;
+                if (e->restart) {
+                    e->restart_requested = true;
+                }
+            }
+        } else if (e->restart && !e->restart_requested &&
+                   e->attempts < SUPERVISOR_MAX_RESTARTS &&
+                   absolute_time_diff_us(e->last_restart_time, now) >
+                       (int64_t)e->stall_timeout_ms * 1000) {
+            // Previous restart did not bring it back - try again
+            e->restart_requested = true;
+        }
+
+        // Stuck with no soft remedy left - let the hardware watchdog fire
+        if (e->stalled && (!e->restart || e->attempts >= SUPERVISOR_MAX_RESTARTS)) {
+            healthy = false;
+        }
+    }
+
+    entries_unlock(save);
+
+    if (healthy) {
+        watchdog_update();
+    }
+
+    TRACE_END(TRACE_TRACK_TIMER, TRACE_EV_SUPERVISOR, healthy);
+}
+
+#if RB3E_DUAL_CORE
+static void supervisor_core1_entry(void)
+{
+    // Flash erase/program on core 0 parks this core in RAM (flash_ops.c)
+    multicore_lockout_victim_init();
+
+    while (true) {
+        sleep_ms(SUPERVISOR_CHECK_INTERVAL_MS);
+        supervisor_check();
+    }
+}
+#else
+static bool supervisor_check_cb(repeating_timer_t *rt)
+{
+    (void)rt;
+    supervisor_check();
+    return true;  // Keep repeating
+}
+#endif
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+void supervisor_register(supervisor_subsystem_t id, const char *name,
+                         uint32_t stall_timeout_ms, supervisor_restart_fn restart)
+{
+    if (id >= SUPERVISOR_SUBSYSTEM_COUNT) {
+        return;
+    }
+
+#if RB3E_DUAL_CORE
+    if (entry_lock == NULL) {
+        entry_lock = spin_lock_init(spin_lock_claim_unused(true));
+    }
+#endif
+
+    supervisor_entry_t *e = &entries[id];
+    memset(e, 0, sizeof(*e));
+    e->name = name;
+    e->stall_timeout_ms = stall_timeout_ms;
+    e->restart = restart;
+    e->last_progress = get_absolute_time();
+}
+
+void supervisor_set_enabled(supervisor_subsystem_t id, bool enabled)
+{
+    if (id >= SUPERVISOR_SUBSYSTEM_COUNT) {
+        return;
+    }
+
+    supervisor_entry_t *e = &entries[id];
+
+    uint32_t save = entries_lock();
+    if (enabled) {
+        // Fresh grace period, but keep a stall in progress so the
+        // recovery time is measured when the token resumes
+        e->last_token = e->token;
+        e->last_progress = get_absolute_time();
+    } else if (restarting_id != (int)id) {
+        e->stalled = false;
+        e->restart_requested = false;
+        e->attempts = 0;
+    }
+    e->enabled = enabled;
+    entries_unlock(save);
+}
+
+void supervisor_kick(supervisor_subsystem_t id)
+{
+    if (id < SUPERVISOR_SUBSYSTEM_COUNT) {
+        entries[id].token++;
+    }
+}
+
+bool supervisor_start(void)
+{
+    printf("Supervisor: Starting (check every %d ms on core %d, %d soft restarts max)\n",
+           SUPERVISOR_CHECK_INTERVAL_MS, RB3E_DUAL_CORE ? 1 : 0, SUPERVISOR_MAX_RESTARTS);
+
+#if RB3E_DUAL_CORE
+    multicore_launch_core1(supervisor_core1_entry);
+    return true;
+#else
+    // Negative interval = fixed period from callback start
+    return add_repeating_timer_ms(-SUPERVISOR_CHECK_INTERVAL_MS,
+                                  supervisor_check_cb, NULL, &check_timer);
+#endif
+}
+
+void supervisor_poll(void)
+{
+    for (int i = 0; i < SUPERVISOR_SUBSYSTEM_COUNT; i++) {
+        supervisor_entry_t *e = &entries[i];
+
+        if (e->recovered) {
+            e->recovered = false;
+            printf("Supervisor: %s recovered in %lu us\n",
+                   e->name, (unsigned long)e->stats.last_recovery_us);
+        }
+
+        if (!e->restart_requested) {
+            continue;
+        }
+
+        uint32_t save = entries_lock();
+        uint8_t attempt = e->attempts;
+        e->restart_requested = false;
+        e->attempts = attempt + 1;
+        e->last_restart_time = get_absolute_time();
+        entries_unlock(save);
+
+        printf("Supervisor: %s stalled - soft restart %d of %d\n",
+               e->name, attempt + 1, SUPERVISOR_MAX_RESTARTS);
+
+        restarting_id = i;
+        bool ok = e->restart(attempt);
+        restarting_id = -1;
+
+        e->stats.restarts++;
+        if (!ok) {
+            printf("Supervisor: %s restart failed\n", e->name);
+        }
+    }
+}
+
+const supervisor_stats_t* supervisor_get_stats(supervisor_subsystem_t id)
+{
+    if (id >= SUPERVISOR_SUBSYSTEM_COUNT) {
+        return NULL;
+    }
+    return &entries[id].stats;
+}
+
+void supervisor_reset_stats(void)
+{
+    uint32_t save = entries_lock();
+    for (int i = 0; i < SUPERVISOR_SUBSYSTEM_COUNT; i++) {
+        memset(&entries[i].stats, 0, sizeof(entries[i].stats));
+    }
+    entries_unlock(save);
+}
@@ -0,0 +1,119 @@
+/*
+ * Subsystem Supervisor for RB3E StageKit Bridge
+ *
+ * Tracks per-subsystem liveness tokens and restarts only the subsystem
+ * that stopped making progress. The hardware watchdog is fed from here
+ * and is left to fire only when the main loop itself is stuck or a
+ * subsystem cannot be recovered by soft restarts.
+ */
+
+#ifndef _SUPERVISOR_H_
+#define _SUPERVISOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Supervisor Constants
+//--------------------------------------------------------------------
+
+#define SUPERVISOR_CHECK_INTERVAL_MS    100     // Liveness check period (timer IRQ or core 1)
+#define SUPERVISOR_MAX_RESTARTS         3       // Soft restarts before hard reset
+
+//--------------------------------------------------------------------
+// Subsystems
+//--------------------------------------------------------------------
+
+typedef enum {
+    SUPERVISOR_MAIN_LOOP = 0,   // No soft restart - hardware watchdog only
+    SUPERVISOR_USB,             // TinyUSB host task / transfer path
+    SUPERVISOR_NETWORK,         // lwIP / CYW43 background processing
+    SUPERVISOR_SUBSYSTEM_COUNT
+} supervisor_subsystem_t;
+
+/**
+ * Soft restart handler for a subsystem
+ *
+ * Called from supervisor_poll() in main loop context.
+ *
+ * @param attempt Restart attempt within the current stall (0 = first),
+ *                handlers may escalate with higher attempts
+ * @return true if the restart was performed
+ */
+typedef bool (*supervisor_restart_fn)(uint8_t attempt);
+
+typedef struct {
+    uint32_t stalls;            // Times the liveness token stopped advancing
+    uint32_t restarts;          // Soft restarts performed
+    uint32_t recoveries;        // Stalls that ended with the token advancing again
+    uint32_t last_recovery_us;  // Stall detection to token advancing again
+    uint32_t max_recovery_us;
+} supervisor_stats_t;
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+/**
+ * Register a supervised subsystem
+ *
+ * Subsystems start disabled; enable them once they are running.
+ *
+ * @param id Subsystem identifier
+ * @param name Name for log output
+ * @param stall_timeout_ms Time without progress before the subsystem is stalled
+ * @param restart Soft restart handler, or NULL to rely on the hardware watchdog
+ */
+void supervisor_register(supervisor_subsystem_t id, const char *name,
+                         uint32_t stall_timeout_ms, supervisor_restart_fn restart);
+
+/**
+ * Enable or disable supervision of a subsystem
+ *
+ * Disabling abandons any stall in progress, except while the subsystem's
+ * own restart handler is running.
+ */
+void supervisor_set_enabled(supervisor_subsystem_t id, bool enabled);
+
+/**
+ * Advance a subsystem's liveness token
+ *
+ * Safe to call from interrupt context.
+ */
+void supervisor_kick(supervisor_subsystem_t id);
+
+/**
+ * Start periodic liveness checks and take over feeding the watchdog
+ *
+ * @return true if the check timer was started
+ */
+bool supervisor_start(void);
+
+/**
+ * Run pending soft restarts
+ *
+ * Must be called regularly from main loop.
+ */
+void supervisor_poll(void);
+
+/**
+ * Get supervisor statistics for a subsystem
+ *
+ * @return Pointer to statistics structure
+ */
+const supervisor_stats_t* supervisor_get_stats(supervisor_subsystem_t id);
+
+/**
+ * Reset statistics for all subsystems
+ */
+void supervisor_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SUPERVISOR_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Stage Kit Test Patterns
+ *
+ * Each step expands into a short list of StageKit commands which are
+ * sent one at a time as the USB transfer slot becomes free.
+ */
+
+#include "test_pattern.h"
+#include "control_protocol.h"
+#include "rb3e_protocol.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+
+//--------------------------------------------------------------------
+// State Variables
+//--------------------------------------------------------------------
+
+#define STEP_MAX_COMMANDS 5
+
+static const uint8_t bank_colors[SK_BANK_COUNT] = {
+    SK_LED_BLUE, SK_LED_GREEN, SK_LED_YELLOW, SK_LED_RED
+};
+
+static uint8_t active_pattern = CTRL_PATTERN_STOP;
+static uint32_t step_interval_ms;
+static uint32_t step_index;
+static absolute_time_t next_step_time;
+static absolute_time_t end_time;
+static bool has_end_time;
+
+// Commands of the current step still to be sent
+static uint8_t step_left[STEP_MAX_COMMANDS];
+static uint8_t step_right[STEP_MAX_COMMANDS];
+static int step_count = 0;
+static int step_sent = 0;
+
+//--------------------------------------------------------------------
+// Internal Functions
+//--------------------------------------------------------------------
+
+static void step_add(uint8_t left, uint8_t right)
+{
+    if (step_count < STEP_MAX_COMMANDS) {
+        step_left[step_count] = left;
+        step_right[step_count] = right;
+        step_count++;
+    }
+}
+
+// Expand the current step into commands
+static void build_step(void)
+{
+    step_count = 0;
+    step_sent = 0;
+
+    switch (active_pattern) {
+        case CTRL_PATTERN_BANK_CHASE: {
+            uint8_t bank = step_index % SK_BANK_COUNT;
+            uint8_t prev = (bank + SK_BANK_COUNT - 1) % SK_BANK_COUNT;
+            step_add(0x00, bank_colors[prev]);
+            step_add(0xFF, bank_colors[bank]);
+            break;
+        }
+        case CTRL_PATTERN_LED_SPIN: {
+            uint8_t led = (uint8_t)(1u << (step_index % 8));
+            for (int b = 0; b < SK_BANK_COUNT; b++) {
+                step_add(led, bank_colors[b]);
+            }
+            break;
+        }
+        case CTRL_PATTERN_STROBE:
+            step_add(0x00, SK_STROBE_SPEED_1 + (step_index % 4));
+            break;
+        case CTRL_PATTERN_ALL_ON:
+            if (step_index == 0) {
+                for (int b = 0; b < SK_BANK_COUNT; b++) {
+                    step_add(0xFF, bank_colors[b]);
+                }
+            }
+            break;
+        default:
+            // Stop: single all-off, then the pattern ends
+            step_add(0x00, SK_ALL_OFF);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------
+// Public API Implementation
+//--------------------------------------------------------------------
+
+bool test_pattern_start(uint8_t pattern, uint16_t step_ms, uint16_t duration_ms)
+{
+    if (pattern > CTRL_PATTERN_ALL_ON) {
+        return false;
+    }
+
+    printf("TestPattern: Starting pattern %d (step=%d ms, duration=%d ms)\n",
+           pattern, step_ms, duration_ms);
+
+    active_pattern = pattern;
+    step_interval_ms = step_ms ? step_ms : TEST_PATTERN_DEFAULT_STEP_MS;
+    step_index = 0;
+    next_step_time = delayed_by_ms(get_absolute_time(), step_interval_ms);
+    has_end_time = (duration_ms != 0);
+    end_time = make_timeout_time_ms(duration_ms);
+
+    build_step();
+    return true;
+}
+
+void test_pattern_cancel(void)
+{
+    active_pattern = CTRL_PATTERN_STOP;
+    step_count = 0;
+    step_sent = 0;
+}
+
+uint8_t test_pattern_active(void)
+{
+    return active_pattern;
+}
+
+bool test_pattern_task(test_pattern_send_fn send)
+{
+    if (step_sent >= step_count) {
+        if (active_pattern == CTRL_PATTERN_STOP) {
+            return false;
+        }
+
+        if (has_end_time && time_reached(end_time)) {
+            // Duration over - finish with an all-off step
+            active_pattern = CTRL_PATTERN_STOP;
+            build_step();
+        } else if (time_reached(next_step_time)) {
+            step_index++;
+            next_step_time = delayed_by_ms(next_step_time, step_interval_ms);
+            build_step();
+        } else {
+            return false;
+        }
+    }
+
+    if (step_sent < step_count &&
+        send(step_left[step_sent], step_right[step_sent])) {
+        step_sent++;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,59 @@
+/*
+ * Stage Kit Test Patterns
+ *
+ * Simple output patterns for checking wiring and lights without a
+ * console. Started through the control protocol, stepped by main loop.
+ */
+
+#ifndef _TEST_PATTERN_H_
+#define _TEST_PATTERN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_PATTERN_DEFAULT_STEP_MS    250
+
+// Sends one StageKit command, returns false if it could not be sent yet
+typedef bool (*test_pattern_send_fn)(uint8_t left_weight, uint8_t right_weight);
+
+/**
+ * Start a test pattern
+ *
+ * @param pattern CTRL_PATTERN_* (CTRL_PATTERN_STOP turns everything off)
+ * @param step_ms Time per step (0 = TEST_PATTERN_DEFAULT_STEP_MS)
+ * @param duration_ms Total run time (0 = until stopped)
+ * @return true if the pattern is known
+ */
+bool test_pattern_start(uint8_t pattern, uint16_t step_ms, uint16_t duration_ms);
+
+/**
+ * Stop the running pattern without sending anything
+ */
+void test_pattern_cancel(void);
+
+/**
+ * Get the running pattern
+ *
+ * @return CTRL_PATTERN_* or CTRL_PATTERN_STOP if none is running
+ */
+uint8_t test_pattern_active(void);
+
+/**
+ * Send the next due command of the running pattern
+ *
+ * Must be called regularly from main loop.
+ *
+ * @param send Function used to send a command
+ * @return true if a command was sent
+ */
+bool test_pattern_task(test_pattern_send_fn send);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TEST_PATTERN_H_ */
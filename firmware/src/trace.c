@@ -0,0 +1,222 @@
+/*
+ * Trace Event Recorder for RB3E StageKit Bridge
+ *
+ * Events are written with interrupts off on core 0, so the lwIP
+ * callbacks, timer IRQs and the main loop can all record without
+ * tearing an entry; dual-core builds also take a hardware spin lock for
+ * the core 1 supervisor. Readers stop the recorder first.
+ */
+
+#include "trace.h"
+#include "board.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Names (index = ID, stable in dumps)
+//--------------------------------------------------------------------
+
+static const char *const event_names[TRACE_EV_COUNT] = {
+    [TRACE_EV_UDP_STAGEKIT]     = "udp_stagekit",
+    [TRACE_EV_UDP_TELEMETRY]    = "udp_telemetry",
+    [TRACE_EV_PROBE]            = "probe",
+    [TRACE_EV_SOURCE_REJECTED]  = "source_rejected",
+    [TRACE_EV_APPLY_SCENE]      = "apply_scene",
+    [TRACE_EV_APPLY_COMMAND]    = "apply_command",
+    [TRACE_EV_CONTROL]          = "control_task",
+    [TRACE_EV_CUE_DISPATCH]     = "cue_dispatch",
+    [TRACE_EV_TELEMETRY]        = "telemetry",
+    [TRACE_EV_WIFI_CHECK]       = "wifi_check",
+    [TRACE_EV_SAFETY_OFF]       = "safety_off",
+    [TRACE_EV_CYW43_CTRL]       = "cyw43_ctrl",
+    [TRACE_EV_USB_XFER]         = "usb_xfer",
+    [TRACE_EV_USB_QUEUE]        = "usb_queue",
+    [TRACE_EV_USB_RECOVERY]     = "usb_recovery",
+    [TRACE_EV_USB_MOUNT]        = "usb_mount",
+    [TRACE_EV_CUE_ALARM]        = "cue_alarm",
+    [TRACE_EV_SUPERVISOR]       = "supervisor",
+    [TRACE_EV_FLASH_ERASE]      = "flash_erase",
+    [TRACE_EV_FLASH_PROG]       = "flash_prog",
+};
+
+static const char *const track_names[TRACE_TRACK_COUNT] = {
+    [TRACE_TRACK_MAIN]  = "Main loop",
+    [TRACE_TRACK_NET]   = "Network",
+    [TRACE_TRACK_USB]   = "USB",
+    [TRACE_TRACK_TIMER] = "Timers",
+    [TRACE_TRACK_FLASH] = "Flash",
+};
+
+#if RB3E_TRACE
+
+//--------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------
+
+volatile bool trace_running = false;
+
+static ctrl_trace_event_t events[TRACE_BUFFER_EVENTS];
+static uint32_t head = 0;               // Next slot to write
+static uint32_t count = 0;              // Valid events (<= TRACE_BUFFER_EVENTS)
+static uint32_t overwritten = 0;        // Ring mode: oldest events lost
+static uint8_t trace_mode = CTRL_TRACE_MODE_RING;
+
+#if RB3E_DUAL_CORE
+// Claimed by the first caller - always core 0, since core 1 only records
+// once trace_start() has run
+static spin_lock_t *events_lock = NULL;
+
+static uint32_t lock_events(void)
+{
+    if (events_lock == NULL) {
+        events_lock = spin_lock_init(spin_lock_claim_unused(true));
+    }
+    return spin_lock_blocking(events_lock);
+}
+
+static void unlock_events(uint32_t save)
+{
+    spin_unlock(events_lock, save);
+}
+#else
+static inline uint32_t lock_events(void)
+{
+    return save_and_disable_interrupts();
+}
+
+static inline void unlock_events(uint32_t save)
+{
+    restore_interrupts(save);
+}
+#endif
+
+//--------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------
+
+void trace_record(uint8_t type, uint8_t track, uint8_t name, uint32_t arg)
+{
+    uint32_t now = time_us_32();
+    uint32_t save = lock_events();
+
+    if (!trace_running) {
+        unlock_events(save);
+        return;
+    }
+
+    ctrl_trace_event_t *e = &events[head];
+    e->time_us = now;
+    e->type = type;
+    e->track = track;
+    e->name = name;
+    e->reserved = 0;
+    e->arg = arg;
+
+    head = (head + 1) % TRACE_BUFFER_EVENTS;
+    if (count < TRACE_BUFFER_EVENTS) {
+        count++;
+        if (count == TRACE_BUFFER_EVENTS && trace_mode == CTRL_TRACE_MODE_ONESHOT) {
+            trace_running = false;
+        }
+    } else {
+        overwritten++;
+    }
+
+    unlock_events(save);
+}
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+bool trace_start(uint8_t mode)
+{
+    uint32_t save = lock_events();
+    head = 0;
+    count = 0;
+    overwritten = 0;
+    trace_mode = mode;
+    trace_running = true;
+    unlock_events(save);
+    return true;
+}
+
+void trace_stop(void)
+{
+    trace_running = false;
+}
+
+void trace_get_status(ctrl_trace_status_t *out)
+{
+    uint32_t save = lock_events();
+    out->running = trace_running ? 1 : 0;
+    out->mode = trace_mode;
+    out->capacity = TRACE_BUFFER_EVENTS;
+    out->count = count;
+    out->overwritten = overwritten;
+    out->now_us = time_us_32();
+    unlock_events(save);
+}
+
+uint16_t trace_read(uint32_t index, ctrl_trace_event_t *out, uint16_t max)
+{
+    uint16_t n = 0;
+    uint32_t oldest = (head + TRACE_BUFFER_EVENTS - count) % TRACE_BUFFER_EVENTS;
+
+    while (n < max && index + n < count) {
+        out[n] = events[(oldest + index + n) % TRACE_BUFFER_EVENTS];
+        n++;
+    }
+    return n;
+}
+
+#else
+
+bool trace_start(uint8_t mode)
+{
+    (void)mode;
+    return false;
+}
+
+void trace_stop(void)
+{
+}
+
+void trace_get_status(ctrl_trace_status_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->now_us = time_us_32();
+}
+
+uint16_t trace_read(uint32_t index, ctrl_trace_event_t *out, uint16_t max)
+{
+    (void)index;
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+#endif
+
+uint16_t trace_get_names(uint8_t *out, uint16_t max)
+{
+    uint16_t pos = 2;
+
+    if (max < 2) {
+        return 0;
+    }
+    out[0] = TRACE_EV_COUNT;
+    out[1] = TRACE_TRACK_COUNT;
+
+    for (int i = 0; i < TRACE_EV_COUNT + TRACE_TRACK_COUNT; i++) {
+        const char *name = i < TRACE_EV_COUNT ? event_names[i] : track_names[i - TRACE_EV_COUNT];
+        size_t len = strlen(name) + 1;
+        if (pos + len > max) {
+            return 0;
+        }
+        memcpy(out + pos, name, len);
+        pos += (uint16_t)len;
+    }
+    return pos;
+}
@@ -0,0 +1,153 @@
+/*
+ * Trace Event Recorder for RB3E StageKit Bridge
+ *
+ * A RAM ring of small timestamped events (begin/end spans, instants and
+ * counters) on a handful of tracks, for seeing causality that counters
+ * hide - e.g. which packet waited behind a telemetry send. Dumped over
+ * the control protocol (rb3e_ctl trace dump) and converted to Chrome
+ * Trace / Perfetto JSON by tools/rb3e_trace2json.py.
+ *
+ * Recording costs one flag test when stopped and a short interrupt-off
+ * copy when running, so it can stay on through rehearsals. Build with
+ * RB3E_TRACE=0 to compile every trace point out.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// Configuration
+//--------------------------------------------------------------------
+
+#ifndef RB3E_TRACE
+#define RB3E_TRACE              1
+#endif
+
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS     2048    // 24 KB - about 30 s of a busy song
+#endif
+
+//--------------------------------------------------------------------
+// Tracks (one timeline row each)
+//--------------------------------------------------------------------
+
+typedef enum {
+    TRACE_TRACK_MAIN = 0,       // Main loop phases
+    TRACE_TRACK_NET,            // lwIP receive callbacks
+    TRACE_TRACK_USB,            // Control transfers in flight
+    TRACE_TRACK_TIMER,          // Alarm and repeating timer IRQs, core 1 supervisor
+    TRACE_TRACK_FLASH,          // Flash erase/program
+    TRACE_TRACK_COUNT
+} trace_track_t;
+
+//--------------------------------------------------------------------
+// Events (names in trace.c - append only, IDs are in dumps)
+//--------------------------------------------------------------------
+
+typedef enum {
+    TRACE_EV_UDP_STAGEKIT = 0,  // NET span, arg = length
+    TRACE_EV_UDP_TELEMETRY,     // NET span, arg = length
+    TRACE_EV_PROBE,             // NET instant, arg = probe id
+    TRACE_EV_SOURCE_REJECTED,   // NET instant, arg = sender address
+    TRACE_EV_APPLY_SCENE,       // MAIN span
+    TRACE_EV_APPLY_COMMAND,     // MAIN span, arg = left << 8 | right
+    TRACE_EV_CONTROL,           // MAIN span (deferred control requests)
+    TRACE_EV_CUE_DISPATCH,      // MAIN instant, arg = left << 8 | right
+    TRACE_EV_TELEMETRY,         // MAIN span
+    TRACE_EV_WIFI_CHECK,        // MAIN span
+    TRACE_EV_SAFETY_OFF,        // MAIN instant, arg = console_verdict_t
+    TRACE_EV_CYW43_CTRL,        // MAIN span, arg = 0 LED write / 1 RSSI read
+    TRACE_EV_USB_XFER,          // USB span submit -> complete, arg = left << 8 | right / result
+    TRACE_EV_USB_QUEUE,         // USB counter, arg = queued commands
+    TRACE_EV_USB_RECOVERY,      // USB instant, arg = recovery level
+    TRACE_EV_USB_MOUNT,         // USB instant, arg = 1 mounted / 0 unmounted
+    TRACE_EV_CUE_ALARM,         // TIMER instant, arg = lateness in us
+    TRACE_EV_SUPERVISOR,        // TIMER span, end arg = healthy
+    TRACE_EV_FLASH_ERASE,       // FLASH span, arg = sector / bytes
+    TRACE_EV_FLASH_PROG,        // FLASH span, arg = sector / bytes
+    TRACE_EV_COUNT
+} trace_event_id_t;
+
+//--------------------------------------------------------------------
+// Public API
+//--------------------------------------------------------------------
+
+#if RB3E_TRACE
+
+extern volatile bool trace_running;
+
+/**
+ * Append one event (use the TRACE_* macros)
+ */
+void trace_record(uint8_t type, uint8_t track, uint8_t name, uint32_t arg);
+
+#define TRACE_BEGIN(track, name, arg) \
+    do { if (trace_running) trace_record(CTRL_TRACE_BEGIN, (track), (name), (arg)); } while (0)
+#define TRACE_END(track, name, arg) \
+    do { if (trace_running) trace_record(CTRL_TRACE_END, (track), (name), (arg)); } while (0)
+#define TRACE_INSTANT(track, name, arg) \
+    do { if (trace_running) trace_record(CTRL_TRACE_INSTANT, (track), (name), (arg)); } while (0)
+#define TRACE_COUNTER(track, name, value) \
+    do { if (trace_running) trace_record(CTRL_TRACE_COUNTER, (track), (name), (value)); } while (0)
+
+#else
+
+#define TRACE_BEGIN(track, name, arg)       do { } while (0)
+#define TRACE_END(track, name, arg)         do { } while (0)
+#define TRACE_INSTANT(track, name, arg)     do { } while (0)
+#define TRACE_COUNTER(track, name, value)   do { } while (0)
+
+#endif
+
+/**
+ * Start recording (clears the buffer)
+ *
+ * @param mode CTRL_TRACE_MODE_RING (keep the newest) or
+ *             CTRL_TRACE_MODE_ONESHOT (stop when full)
+ * @return false if tracing is compiled out
+ */
+bool trace_start(uint8_t mode);
+
+/**
+ * Stop recording (the buffer is kept for reading)
+ */
+void trace_stop(void);
+
+/**
+ * Get recorder status
+ */
+void trace_get_status(ctrl_trace_status_t *out);
+
+/**
+ * Copy recorded events, oldest first
+ *
+ * @param index First event to copy (0 = oldest)
+ * @param out Destination
+ * @param max Events that fit in out
+ * @return Events copied (0 past the end)
+ */
+uint16_t trace_read(uint32_t index, ctrl_trace_event_t *out, uint16_t max);
+
+/**
+ * Pack the event and track names for dumps
+ *
+ * Layout: event count, track count, then NUL-terminated names (events
+ * in ID order, then tracks).
+ *
+ * @return Bytes written, 0 if they do not fit
+ */
+uint16_t trace_get_names(uint8_t *out, uint16_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TRACE_H_ */
@@ -6,7 +6,11 @@
 
 #include "usb_host.h"
 #include "rb3e_protocol.h"
+#include "supervisor.h"
+#include "params.h"
+#include "trace.h"
 #include "tusb.h"
+#include "host/hcd.h"
 #include "pico/stdlib.h"
 #include <stdio.h>
 #include <string.h>
@@ -19,21 +23,370 @@ static usb_state_t usb_state = USB_STATE_DISCONNECTED;
 static uint8_t stagekit_dev_addr = 0;
 static bool stagekit_is_santroller = false;
 static const char *usb_error = NULL;
+static usb_stats_t usb_stats = {0};
+static stagekit_state_t stagekit_shadow = {0};    // What the kit has acknowledged
 
 // Control transfer state - must be static/persistent for async transfers
 static uint8_t ctrl_buffer[8] __attribute__((aligned(4)));
 static volatile bool transfer_busy = false;
 static tusb_control_request_t ctrl_request;  // Must persist during async transfer
+static absolute_time_t transfer_deadline;
+static bool inflight_command = false;           // Transfer in flight is a SET_REPORT (not recovery)
+static uint8_t inflight_left, inflight_right;
+
+// Commands waiting for the transfer slot (FIFO, main loop / tuh_task context only)
+static uint8_t cmd_queue_left[USB_CMD_QUEUE_SIZE];
+static uint8_t cmd_queue_right[USB_CMD_QUEUE_SIZE];
+static uint8_t cmd_queue_head = 0;
+static uint8_t cmd_queue_count = 0;
+
+// Root hub port used for host mode (see CFG_TUSB_RHPORT0_MODE)
+#define USB_HOST_RHPORT 0
+
+// Recovery state - an "episode" starts at the first failed transfer and
+// ends at the first Stage Kit SET_REPORT that succeeds afterwards. Recovery
+// requests and a re-mount do not end it: a kit that ACKs CLEAR_FEATURE but
+// still wedges on SET_REPORT has to escalate
+static usb_recovery_stats_t recovery_stats = {0};
+static bool recovery_active = false;
+static uint8_t recovery_failures = 0;           // Consecutive failures in this episode
+static usb_recovery_level_t recovery_level;     // Highest level used in this episode
+static bool recovery_step_pending = false;      // Level chosen, run after tuh_task()
+static usb_recovery_level_t recovery_step;
+static absolute_time_t recovery_start_time;
+static bool remount_pending = false;            // Waiting for device after reset
+static absolute_time_t remount_deadline;
+static bool rearm_pending = false;              // Failed command to resend after the step
+static uint8_t rearm_left, rearm_right;
 
 //--------------------------------------------------------------------
 // Internal Functions
 //--------------------------------------------------------------------
 
+static void usb_recovery_escalate(void);
+static void cmd_queue_drain(void);
+static void cmd_queue_push_front(uint8_t left_weight, uint8_t right_weight);
+
+// Keep the command a failed or aborted transfer was carrying
+static void rearm_inflight_command(void)
+{
+    if (inflight_command) {
+        rearm_left = inflight_left;
+        rearm_right = inflight_right;
+        rearm_pending = true;
+        inflight_command = false;
+    }
+}
+
+static void usb_recovery_complete(void)
+{
+    if (!recovery_active) {
+        return;
+    }
+
+    uint32_t elapsed_us = (uint32_t)absolute_time_diff_us(recovery_start_time,
+                                                          get_absolute_time());
+    recovery_stats.recovered[recovery_level]++;
+    recovery_stats.last_recovery_us[recovery_level] = elapsed_us;
+    if (elapsed_us > recovery_stats.max_recovery_us[recovery_level]) {
+        recovery_stats.max_recovery_us[recovery_level] = elapsed_us;
+    }
+
+    printf("USB: Recovered at level %d after %lu us\n",
+           recovery_level, (unsigned long)elapsed_us);
+
+    recovery_active = false;
+    recovery_failures = 0;
+    remount_pending = false;
+}
+
 // Callback when control transfer completes
 static void ctrl_xfer_complete_cb(tuh_xfer_t *xfer)
 {
-    (void)xfer;
     transfer_busy = false;
+    TRACE_END(TRACE_TRACK_USB, TRACE_EV_USB_XFER, xfer->result);
+
+    if (xfer->result == XFER_RESULT_SUCCESS) {
+        if (inflight_command) {
+            stagekit_state_apply(&stagekit_shadow, inflight_left, inflight_right);
+            usb_recovery_complete();
+        }
+        inflight_command = false;
+        // Next queued command goes out immediately, not on the next loop pass
+        cmd_queue_drain();
+    } else {
+        recovery_stats.xfer_errors++;
+        printf("USB: Control transfer failed (result=%d)\n", xfer->result);
+        rearm_inflight_command();
+        usb_recovery_escalate();
+    }
+}
+
+// Queue ctrl_request/buffer as an async control transfer with a deadline
+static bool submit_control_xfer(uint8_t *buffer)
+{
+    transfer_busy = true;
+    transfer_deadline = make_timeout_time_ms(params_get(CTRL_PARAM_USB_XFER_TIMEOUT_MS));
+    inflight_command = (buffer != NULL);
+    if (inflight_command) {
+        inflight_left = buffer[2];
+        inflight_right = buffer[3];
+    }
+
+    tuh_xfer_t xfer = {
+        .daddr = stagekit_dev_addr,
+        .ep_addr = 0,
+        .setup = &ctrl_request,
+        .buffer = buffer,
+        .complete_cb = ctrl_xfer_complete_cb,
+        .user_data = 0
+    };
+
+    // Span runs submit -> completion; arg is the report (0 for recovery requests)
+    TRACE_BEGIN(TRACE_TRACK_USB, TRACE_EV_USB_XFER,
+                buffer ? (buffer[2] << 8) | buffer[3] : 0);
+    bool result = tuh_control_xfer(&xfer);
+
+    if (!result) {
+        // Transfer failed to queue - clear busy flag
+        transfer_busy = false;
+        inflight_command = false;
+        TRACE_END(TRACE_TRACK_USB, TRACE_EV_USB_XFER, XFER_RESULT_FAILED);
+    }
+
+    return result;
+}
+
+// Queue one StageKit SET_REPORT
+static bool submit_stagekit_command(uint8_t left_weight, uint8_t right_weight)
+{
+    // Santroller Stage Kit HID report format:
+    // [0] = 0x01 (Report ID)
+    // [1] = 0x5A (Command marker)
+    // [2] = left_weight (LED pattern)
+    // [3] = right_weight (Color/command)
+    ctrl_buffer[0] = 0x01;
+    ctrl_buffer[1] = 0x5A;
+    ctrl_buffer[2] = left_weight;
+    ctrl_buffer[3] = right_weight;
+
+    // USB Control Transfer setup (static struct for async safety):
+    // bmRequestType: 0x21 = Host to Device, Class, Interface
+    // bRequest: 0x09 = SET_REPORT
+    // wValue: (HID_REPORT_TYPE_OUTPUT << 8) | Report ID = 0x0200
+    // wIndex: Interface 0
+    ctrl_request.bmRequestType_bit.recipient = TUSB_REQ_RCPT_INTERFACE;
+    ctrl_request.bmRequestType_bit.type = TUSB_REQ_TYPE_CLASS;
+    ctrl_request.bmRequestType_bit.direction = TUSB_DIR_OUT;
+    ctrl_request.bRequest = SK_HID_SET_REPORT;
+    ctrl_request.wValue = (SK_HID_REPORT_TYPE_OUTPUT << 8) | 0x00;
+    ctrl_request.wIndex = 0;
+    ctrl_request.wLength = 4;
+
+    // Send async control transfer with completion callback and deadline
+    bool result = submit_control_xfer(ctrl_buffer);
+
+    // The shadow follows on completion - a failed or aborted transfer never reached the kit
+    if (result) {
+        usb_stats.commands_sent++;
+    } else {
+        printf("USB: Control transfer failed to queue\n");
+    }
+
+    return result;
+}
+
+static bool cmd_queue_push(uint8_t left_weight, uint8_t right_weight)
+{
+    if (cmd_queue_count >= USB_CMD_QUEUE_SIZE) {
+        return false;
+    }
+
+    uint8_t tail = (cmd_queue_head + cmd_queue_count) % USB_CMD_QUEUE_SIZE;
+    cmd_queue_left[tail] = left_weight;
+    cmd_queue_right[tail] = right_weight;
+    cmd_queue_count++;
+    TRACE_COUNTER(TRACE_TRACK_USB, TRACE_EV_USB_QUEUE, cmd_queue_count);
+    return true;
+}
+
+// Put a command back at the head, ahead of newer ones (drops the newest if full)
+static void cmd_queue_push_front(uint8_t left_weight, uint8_t right_weight)
+{
+    if (cmd_queue_count >= USB_CMD_QUEUE_SIZE) {
+        cmd_queue_count--;
+        usb_stats.commands_dropped++;
+    }
+
+    cmd_queue_head = (cmd_queue_head + USB_CMD_QUEUE_SIZE - 1) % USB_CMD_QUEUE_SIZE;
+    cmd_queue_left[cmd_queue_head] = left_weight;
+    cmd_queue_right[cmd_queue_head] = right_weight;
+    cmd_queue_count++;
+    TRACE_COUNTER(TRACE_TRACK_USB, TRACE_EV_USB_QUEUE, cmd_queue_count);
+}
+
+static void cmd_queue_clear(void)
+{
+    cmd_queue_head = 0;
+    cmd_queue_count = 0;
+}
+
+// Send the next queued command if the transfer slot is free and no
+// recovery step needs it
+static void cmd_queue_drain(void)
+{
+    if (cmd_queue_count == 0 || transfer_busy ||
+        recovery_step_pending || remount_pending || stagekit_dev_addr == 0) {
+        return;
+    }
+
+    if (submit_stagekit_command(cmd_queue_left[cmd_queue_head],
+                                cmd_queue_right[cmd_queue_head])) {
+        cmd_queue_head = (cmd_queue_head + 1) % USB_CMD_QUEUE_SIZE;
+        cmd_queue_count--;
+        TRACE_COUNTER(TRACE_TRACK_USB, TRACE_EV_USB_QUEUE, cmd_queue_count);
+    }
+}
+
+// Level 1: standard CLEAR_FEATURE(ENDPOINT_HALT) on EP0
+static void usb_recovery_clear_stall(void)
+{
+    if (stagekit_dev_addr == 0) {
+        return;
+    }
+
+    ctrl_request.bmRequestType_bit.recipient = TUSB_REQ_RCPT_ENDPOINT;
+    ctrl_request.bmRequestType_bit.type = TUSB_REQ_TYPE_STANDARD;
+    ctrl_request.bmRequestType_bit.direction = TUSB_DIR_OUT;
+    ctrl_request.bRequest = TUSB_REQ_CLEAR_FEATURE;
+    ctrl_request.wValue = TUSB_REQ_FEATURE_EDPT_HALT;
+    ctrl_request.wIndex = 0;
+    ctrl_request.wLength = 0;
+
+    if (!submit_control_xfer(NULL)) {
+        printf("USB: CLEAR_FEATURE failed to queue\n");
+    }
+}
+
+// Level 2: report a detach/attach so the stack resets the port and re-enumerates
+static void usb_recovery_port_reset(void)
+{
+    // Set first: the detach may be handled before this returns
+    remount_pending = true;
+    remount_deadline = make_timeout_time_ms(USB_REMOUNT_TIMEOUT_MS);
+
+    hcd_event_device_remove(USB_HOST_RHPORT, false);
+    hcd_event_device_attach(USB_HOST_RHPORT, false);
+}
+
+// Level 3: tear down and restart the whole host stack
+static void usb_recovery_reenumerate(void)
+{
+    // Set first: tuh_deinit() unmounts the kit
+    remount_pending = true;
+    remount_deadline = make_timeout_time_ms(USB_REMOUNT_TIMEOUT_MS);
+
+    tuh_deinit(USB_HOST_RHPORT);
+
+    stagekit_dev_addr = 0;
+    stagekit_is_santroller = false;
+    usb_state = USB_STATE_DISCONNECTED;
+    transfer_busy = false;
+    memset(&stagekit_shadow, 0, sizeof(stagekit_shadow));
+    cmd_queue_clear();
+
+    tuh_init(USB_HOST_RHPORT);
+}
+
+// Pick the next recovery level for the current episode
+// Runs from the completion callback too, so the action itself is deferred
+// until tuh_task() has returned (see usb_recovery_task)
+static void usb_recovery_escalate(void)
+{
+    if (!recovery_active) {
+        recovery_active = true;
+        recovery_failures = 0;
+        recovery_level = USB_RECOVERY_CLEAR_STALL;
+        recovery_start_time = get_absolute_time();
+    }
+
+    usb_recovery_level_t level = (recovery_failures < USB_RECOVERY_LEVELS) ?
+        (usb_recovery_level_t)recovery_failures : USB_RECOVERY_REENUMERATE;
+    recovery_failures++;
+
+    if (level > recovery_level) {
+        recovery_level = level;
+    }
+    recovery_stats.attempts[level]++;
+
+    printf("USB: Recovery level %d (failure %d)\n", level, recovery_failures);
+
+    TRACE_INSTANT(TRACE_TRACK_USB, TRACE_EV_USB_RECOVERY, level);
+    recovery_step = level;
+    recovery_step_pending = true;
+}
+
+// Abort transfers that missed their deadline, run pending recovery steps
+// and watch re-enumeration. Called after tuh_task() returns.
+static void usb_recovery_task(void)
+{
+    if (transfer_busy && time_reached(transfer_deadline)) {
+        recovery_stats.xfer_timeouts++;
+        printf("USB: Transfer timed out after %lu ms - aborting\n",
+               (unsigned long)params_get(CTRL_PARAM_USB_XFER_TIMEOUT_MS));
+
+        // Abort does not invoke the completion callback
+        tuh_edpt_abort_xfer(stagekit_dev_addr, 0);
+        transfer_busy = false;
+        TRACE_END(TRACE_TRACK_USB, TRACE_EV_USB_XFER, XFER_RESULT_TIMEOUT);
+        rearm_inflight_command();
+
+        usb_recovery_escalate();
+    }
+
+    if (remount_pending && time_reached(remount_deadline)) {
+        remount_pending = false;
+
+        if (recovery_level == USB_RECOVERY_REENUMERATE) {
+            // Host restart did not bring it back - assume it was unplugged
+            printf("USB: Device did not return after restart - giving up\n");
+            recovery_active = false;
+            recovery_failures = 0;
+        } else {
+            printf("USB: Device did not re-enumerate - escalating\n");
+            recovery_failures = USB_RECOVERY_REENUMERATE;
+            usb_recovery_escalate();
+        }
+    }
+
+    if (recovery_step_pending) {
+        recovery_step_pending = false;
+
+        switch (recovery_step) {
+            case USB_RECOVERY_CLEAR_STALL:
+                usb_recovery_clear_stall();
+                break;
+            case USB_RECOVERY_PORT_RESET:
+                usb_recovery_port_reset();
+                break;
+            default:
+                // The host restart empties the queue - keep the command being retried
+                if (!rearm_pending && cmd_queue_count > 0) {
+                    rearm_left = cmd_queue_left[cmd_queue_head];
+                    rearm_right = cmd_queue_right[cmd_queue_head];
+                    rearm_pending = true;
+                }
+                usb_recovery_reenumerate();
+                break;
+        }
+
+        // Re-arm: the dropped command goes out first once the slot is free
+        // (after a reset, once the kit is back). Its success ends the episode
+        if (rearm_pending) {
+            rearm_pending = false;
+            cmd_queue_push_front(rearm_left, rearm_right);
+        }
+    }
 }
 
 static bool is_santroller_stagekit(uint16_t vid, uint16_t pid, uint16_t bcd_device)
@@ -67,8 +420,13 @@ void tuh_mount_cb(uint8_t dev_addr)
                 printf("USB: Santroller Stage Kit detected!\n");
                 stagekit_dev_addr = dev_addr;
                 stagekit_is_santroller = true;
+                TRACE_INSTANT(TRACE_TRACK_USB, TRACE_EV_USB_MOUNT, 1);
                 usb_state = USB_STATE_CONFIGURED;
                 usb_error = NULL;
+
+                // Device is back after a port reset / host restart; the
+                // episode ends when a command gets through
+                remount_pending = false;
             } else {
                 printf("USB: Santroller device but not Stage Kit (bcd=0x%04x)\n",
                        desc.bcdDevice);
@@ -92,10 +450,28 @@ void tuh_umount_cb(uint8_t dev_addr)
         stagekit_dev_addr = 0;
         stagekit_is_santroller = false;
         usb_state = USB_STATE_DISCONNECTED;
+        memset(&stagekit_shadow, 0, sizeof(stagekit_shadow));
+
+        // Our own port reset keeps the queue (and the re-armed command) for the remount
+        if (!remount_pending) {
+            cmd_queue_clear();
+            rearm_pending = false;
+        }
 
         // Clear transfer busy flag to ensure clean state on reconnection
         // The completion callback may not fire if device was unplugged mid-transfer
+        if (transfer_busy) {
+            TRACE_END(TRACE_TRACK_USB, TRACE_EV_USB_XFER, XFER_RESULT_FAILED);
+        }
         transfer_busy = false;
+        inflight_command = false;
+        TRACE_INSTANT(TRACE_TRACK_USB, TRACE_EV_USB_MOUNT, 0);
+
+        // A real unplug ends any recovery episode; our own resets expect a remount
+        if (recovery_active && !remount_pending) {
+            recovery_active = false;
+            recovery_failures = 0;
+        }
 
         printf("USB: Stage Kit disconnected\n");
     }
@@ -145,6 +521,26 @@ void usb_host_init(void)
 void usb_host_task(void)
 {
     tuh_task();
+    usb_recovery_task();
+    cmd_queue_drain();
+
+    // Progress = task ran and the transfer path is not stuck in recovery
+    if (!recovery_active) {
+        supervisor_kick(SUPERVISOR_USB);
+    }
+}
+
+void usb_host_restart(void)
+{
+    printf("USB: Restarting host stack...\n");
+
+    recovery_active = false;
+    recovery_failures = 0;
+    recovery_step_pending = false;
+    remount_pending = false;
+    rearm_pending = false;
+
+    usb_recovery_reenumerate();
 }
 
 bool usb_send_stagekit_command(uint8_t left_weight, uint8_t right_weight)
@@ -153,57 +549,54 @@ bool usb_send_stagekit_command(uint8_t left_weight, uint8_t right_weight)
         return false;
     }
 
+    // Keep ordering behind a scene that is still being sent
+    if (cmd_queue_count > 0) {
+        if (!cmd_queue_push(left_weight, right_weight)) {
+            usb_stats.commands_dropped++;
+            return false;
+        }
+        return true;
+    }
+
     // Check if a transfer is already in progress - drop packet if busy
     // This prevents buffer corruption from concurrent transfers
     if (transfer_busy) {
+        usb_stats.commands_dropped++;
         return false;  // Silently drop - this is normal during rapid updates
     }
 
-    // Mark as busy before modifying buffers
-    transfer_busy = true;
-
-    // Santroller Stage Kit HID report format:
-    // [0] = 0x01 (Report ID)
-    // [1] = 0x5A (Command marker)
-    // [2] = left_weight (LED pattern)
-    // [3] = right_weight (Color/command)
-    ctrl_buffer[0] = 0x01;
-    ctrl_buffer[1] = 0x5A;
-    ctrl_buffer[2] = left_weight;
-    ctrl_buffer[3] = right_weight;
+    return submit_stagekit_command(left_weight, right_weight);
+}
 
-    // USB Control Transfer setup (static struct for async safety):
-    // bmRequestType: 0x21 = Host to Device, Class, Interface
-    // bRequest: 0x09 = SET_REPORT
-    // wValue: (HID_REPORT_TYPE_OUTPUT << 8) | Report ID = 0x0200
-    // wIndex: Interface 0
-    ctrl_request.bmRequestType_bit.recipient = TUSB_REQ_RCPT_INTERFACE;
-    ctrl_request.bmRequestType_bit.type = TUSB_REQ_TYPE_CLASS;
-    ctrl_request.bmRequestType_bit.direction = TUSB_DIR_OUT;
-    ctrl_request.bRequest = SK_HID_SET_REPORT;
-    ctrl_request.wValue = (SK_HID_REPORT_TYPE_OUTPUT << 8) | 0x00;
-    ctrl_request.wIndex = 0;
-    ctrl_request.wLength = 4;
+int usb_apply_stagekit_scene(const stagekit_state_t *scene)
+{
+    if (!stagekit_is_santroller || stagekit_dev_addr == 0) {
+        return -1;
+    }
 
-    // Send async control transfer with completion callback
-    tuh_xfer_t xfer = {
-        .daddr = stagekit_dev_addr,
-        .ep_addr = 0,
-        .setup = &ctrl_request,
-        .buffer = ctrl_buffer,
-        .complete_cb = ctrl_xfer_complete_cb,
-        .user_data = 0
-    };
+    // Diff against what the kit will hold once the transfer in flight lands
+    // (if it fails, it is re-armed ahead of these); anything still queued or
+    // waiting to be re-armed is superseded by the new scene
+    stagekit_state_t expected = stagekit_shadow;
+    if (transfer_busy && inflight_command) {
+        stagekit_state_apply(&expected, inflight_left, inflight_right);
+    }
 
-    bool result = tuh_control_xfer(&xfer);
+    uint8_t left[SK_SCENE_FULL_COMMANDS];
+    uint8_t right[SK_SCENE_FULL_COMMANDS];
+    int count = stagekit_state_diff(&expected, scene, left, right);
 
-    if (!result) {
-        // Transfer failed to queue - clear busy flag
-        transfer_busy = false;
-        printf("USB: Control transfer failed to queue\n");
+    cmd_queue_clear();
+    rearm_pending = false;
+    for (int i = 0; i < count; i++) {
+        cmd_queue_push(left[i], right[i]);
     }
 
-    return result;
+    usb_stats.scenes_applied++;
+    usb_stats.scene_commands_saved += SK_SCENE_FULL_COMMANDS - count;
+
+    cmd_queue_drain();
+    return count;
 }
 
 bool usb_stagekit_all_off(void)
@@ -227,3 +620,24 @@ const char* usb_get_error(void)
 {
     return usb_error;
 }
+
+const usb_recovery_stats_t* usb_get_recovery_stats(void)
+{
+    return &recovery_stats;
+}
+
+const usb_stats_t* usb_get_stats(void)
+{
+    return &usb_stats;
+}
+
+void usb_reset_stats(void)
+{
+    memset(&usb_stats, 0, sizeof(usb_stats));
+    memset(&recovery_stats, 0, sizeof(recovery_stats));
+}
+
+const stagekit_state_t* usb_get_stagekit_state(void)
+{
+    return &stagekit_shadow;
+}
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "stagekit_state.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +42,47 @@ typedef enum {
     USB_STATE_ERROR
 } usb_state_t;
 
+//--------------------------------------------------------------------
+// Transfer Recovery
+//--------------------------------------------------------------------
+
+#define USB_XFER_TIMEOUT_MS         100     // Default deadline for a single HID SET_REPORT
+#define USB_REMOUNT_TIMEOUT_MS      2000    // Deadline for re-enumeration after reset
+
+// Recovery levels, escalated on consecutive transfer failures
+typedef enum {
+    USB_RECOVERY_CLEAR_STALL = 0,   // Abort transfer, clear EP0 halt, re-arm
+    USB_RECOVERY_PORT_RESET,        // Detach/attach device (port reset + enumerate)
+    USB_RECOVERY_REENUMERATE,       // Restart TinyUSB host stack
+    USB_RECOVERY_LEVELS
+} usb_recovery_level_t;
+
+typedef struct {
+    uint32_t xfer_timeouts;                         // Transfers that missed their deadline
+    uint32_t xfer_errors;                           // Transfers completed with stall/failure
+    uint32_t attempts[USB_RECOVERY_LEVELS];         // Times each level was triggered
+    uint32_t recovered[USB_RECOVERY_LEVELS];        // Episodes resolved at each level
+    uint32_t last_recovery_us[USB_RECOVERY_LEVELS]; // Wedge-to-first-good-transfer time
+    uint32_t max_recovery_us[USB_RECOVERY_LEVELS];
+} usb_recovery_stats_t;
+
+//--------------------------------------------------------------------
+// Command Queue
+//--------------------------------------------------------------------
+
+// Commands waiting for the transfer slot - a scene needs at most
+// SK_SCENE_FULL_COMMANDS, the rest absorbs single commands behind it
+#ifndef USB_CMD_QUEUE_SIZE
+#define USB_CMD_QUEUE_SIZE          8
+#endif
+
+typedef struct {
+    uint32_t commands_sent;         // StageKit commands queued to the device
+    uint32_t commands_dropped;      // Rejected because a transfer was in flight
+    uint32_t scenes_applied;        // Scene updates accepted
+    uint32_t scene_commands_saved;  // Commands avoided versus sending full scenes
+} usb_stats_t;
+
 //--------------------------------------------------------------------
 // Public API
 //--------------------------------------------------------------------
@@ -59,6 +101,13 @@ void usb_host_init(void);
  */
 void usb_host_task(void);
 
+/**
+ * Restart the TinyUSB host stack
+ *
+ * Soft recovery used by the supervisor; the Stage Kit is re-enumerated.
+ */
+void usb_host_restart(void);
+
 /**
  * Send lighting command to Stage Kit
  *
@@ -68,6 +117,18 @@ void usb_host_task(void);
  */
 bool usb_send_stagekit_command(uint8_t left_weight, uint8_t right_weight);
 
+/**
+ * Set the complete Stage Kit state
+ *
+ * Replaces any queued commands with the shortest sequence that takes the
+ * kit from its current state to the scene. The commands are sent back
+ * to back as each transfer completes.
+ *
+ * @param scene Desired state of all banks, strobe and fog
+ * @return Number of commands queued, or -1 if no Stage Kit is connected
+ */
+int usb_apply_stagekit_scene(const stagekit_state_t *scene);
+
 /**
  * Turn off all Stage Kit lights
  *
@@ -98,6 +159,34 @@ usb_state_t usb_get_state(void);
  */
 const char* usb_get_error(void);
 
+/**
+ * Get transfer recovery statistics
+ *
+ * @return Pointer to recovery statistics structure
+ */
+const usb_recovery_stats_t* usb_get_recovery_stats(void);
+
+/**
+ * Get command statistics
+ *
+ * @return Pointer to statistics structure
+ */
+const usb_stats_t* usb_get_stats(void);
+
+/**
+ * Reset command and recovery statistics
+ */
+void usb_reset_stats(void);
+
+/**
+ * Get shadow of the Stage Kit output state
+ *
+ * Reflects every command the kit has acknowledged since it was mounted.
+ *
+ * @return Pointer to shadow state
+ */
+const stagekit_state_t* usb_get_stagekit_state(void);
+
 #ifdef __cplusplus
 }
 #endif
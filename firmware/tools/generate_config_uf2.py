@@ -10,7 +10,9 @@ Usage:
     python generate_config_uf2.py --ssid "YourNetwork" --password "YourPassword" --board pico2_w
 
 The generated UF2 file can be dragged onto the Pico's USB drive after the main
-firmware has been flashed.
+firmware has been flashed. The image is always the 256KB legacy layout in the
+last 256KB of flash: pico_w firmware mounts it in place, pico2_w firmware
+copies it into its larger partition on the next boot.
 """
 
 import argparse
@@ -23,9 +25,6 @@ LFS_BLOCK_SIZE = 4096
 LFS_BLOCK_COUNT = 64  # 256KB / 4KB
 LFS_FLASH_SIZE = LFS_BLOCK_SIZE * LFS_BLOCK_COUNT  # 256KB
 
-# Flash layout
-PICO_FLASH_SIZE = 2 * 1024 * 1024  # 2MB
-LFS_FLASH_OFFSET = PICO_FLASH_SIZE - LFS_FLASH_SIZE  # 0x1C0000
 
 # UF2 constants
 UF2_MAGIC_START0 = 0x0A324655  # "UF2\n"
@@ -43,10 +42,12 @@ BOARD_CONFIG = {
     'pico_w': {
         'family_id': UF2_FAMILY_RP2040,
         'flash_base': 0x10000000,
+        'flash_size': 2 * 1024 * 1024,
     },
     'pico2_w': {
         'family_id': UF2_FAMILY_RP2350_ARM,
         'flash_base': 0x10000000,
+        'flash_size': 4 * 1024 * 1024,
     },
 }
 
@@ -185,10 +186,11 @@ The generated UF2 should be flashed AFTER the main firmware UF2.
     flash_base = board_cfg['flash_base']
     family_id = board_cfg['family_id']
 
-    # Calculate flash address for LittleFS region
-    lfs_address = flash_base + LFS_FLASH_OFFSET
+    # Last 256KB of flash (0x1C0000 on pico_w, the import area on pico2_w)
+    lfs_offset = board_cfg['flash_size'] - LFS_FLASH_SIZE
+    lfs_address = flash_base + lfs_offset
 
-    print(f"LittleFS flash offset: 0x{LFS_FLASH_OFFSET:X}")
+    print(f"LittleFS flash offset: 0x{lfs_offset:X}")
     print(f"UF2 target address: 0x{lfs_address:X}")
 
     # Convert to UF2
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Compare bridge builds on live bridges: CYW43 arch modes (threadsafe
+background vs poll) or board profiles (pico_w vs pico2_w).
+
+Runs the same load against each bridge in turn: a dense cue list keeps
+the USB side busy, a stream of scene packets exercises the lighting
+path and rb3e_probe measures the network round trip. Afterwards the
+bridge's own cue timing (timer drift, USB dispatch), its main loop cost
+in CPU cycles and the probe's RTT figures are printed side by side,
+together with the mode and board each bridge reports in rb3e_ctl state.
+
+Flash one bridge built with -DRB3E_CYW43_ARCH=background and one with
+-DRB3E_CYW43_ARCH=poll, or one -DPICO_BOARD=pico_w and one pico2_w (or
+run rb3e_emulator and rb3e_emulator_poll on different --port-offset
+values) and pass both. The cue list is sized for the smallest cue
+capacity among the bridges, so every bridge plays the same show.
+
+Usage:
+    python rb3e_arch_bench.py bg=192.168.1.50 poll=192.168.1.51
+    python rb3e_arch_bench.py w=192.168.1.50 w2=192.168.1.52
+    python rb3e_arch_bench.py bg=127.0.0.1:21371 poll=127.0.0.1:21471 --tools build
+"""
+
+import argparse
+import re
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from pathlib import Path
+
+CTL_DEFAULT_PORT = 21071
+CUE_MAX_ENTRIES = 1024     # cue_player.h default, for bridges that do not report it
+
+RB3E_EVENT_SCENE = 0x80    # rb3e_protocol.h
+
+# Colour banks the cue list cycles through (SK_LED_* in rb3e_protocol.h)
+CUE_BANKS = [0x20, 0x40, 0x60, 0x80]
+
+
+def parse_target(text: str):
+    """label=ip[:port] -> (label, ip, port)"""
+    label, sep, address = text.partition('=')
+    if not sep:
+        label, address = text, text
+    ip, _, port = address.partition(':')
+    return label, ip, int(port) if port else CTL_DEFAULT_PORT
+
+
+def find_tool(tools_dir: Path, name: str) -> str:
+    for candidate in (tools_dir / name, tools_dir / f'{name}.exe'):
+        if candidate.exists():
+            return str(candidate)
+    return name
+
+
+def run_ctl(ctl: str, ip: str, port: int, *command) -> str:
+    result = subprocess.run([ctl, ip, '--port', str(port), *command],
+                            capture_output=True, text=True, timeout=30)
+    if result.returncode != 0:
+        raise RuntimeError(f"rb3e_ctl {' '.join(command)}: "
+                           f"{(result.stderr or result.stdout).strip()}")
+    return result.stdout
+
+
+def write_cue_list(path: Path, duration_s: float, step_ms: int, capacity: int) -> int:
+    """One colour command every step_ms, alternating on and off; returns the step used"""
+    # Long runs get a coarser step so the list still fits on the bridge
+    step_ms = max(step_ms, -(-int(duration_s * 1000) // capacity))
+    lines = ['# rb3e_arch_bench load']
+    count = int(duration_s * 1000 / step_ms)
+    for i in range(count):
+        bank = CUE_BANKS[i % len(CUE_BANKS)]
+        left = 0xFF if (i // len(CUE_BANKS)) % 2 == 0 else 0x00
+        lines.append(f'{i * step_ms} 0x{left:02x} 0x{bank:02x}')
+    path.write_text('\n'.join(lines) + '\n')
+    return step_ms
+
+
+def field(pattern: str, text: str, default=None):
+    match = re.search(pattern, text)
+    return match.group(1) if match else default
+
+
+def send_scenes(ip: str, port: int, rate: float, stop: threading.Event):
+    """RB3E scene packets at rate Hz, one bank lit at a time, until stop is set"""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        step = 0
+        next_time = time.monotonic()
+        while not stop.is_set():
+            banks = [0, 0, 0, 0]
+            banks[step % 4] = 0xFF >> (step // 4 % 8)
+            payload = bytes(banks) + bytes([0, 0])
+            sock.sendto(b'RB3E' + bytes([0, RB3E_EVENT_SCENE, len(payload), 0]) + payload,
+                        (ip, port))
+            step += 1
+            next_time += 1.0 / rate
+            stop.wait(max(0.0, next_time - time.monotonic()))
+
+
+def board_info(state: str) -> dict:
+    return {
+        'mode': field(r'Network mode\s*:\s*(\S+)', state, '?'),
+        'board': field(r'Board\s*:\s*([^,\s]+)', state, '?'),
+        'cores': int(field(r'Board\s*:.*?(\d+) core', state, 1)),
+        'cue_capacity': int(field(r'capacity\s*:.*?(\d+) cues', state, CUE_MAX_ENTRIES)),
+    }
+
+
+def bench_one(args, label: str, ip: str, port: int, cue_file: Path) -> dict:
+    state = run_ctl(args.ctl, ip, port, 'state')
+    result = {'label': label, **board_info(state)}
+
+    run_ctl(args.ctl, ip, port, 'reset-stats')
+    run_ctl(args.ctl, ip, port, 'cue-upload', str(cue_file))
+    run_ctl(args.ctl, ip, port, 'cue-go', '500')
+
+    stop = threading.Event()
+    scenes = None
+    if args.scene_rate > 0:
+        # RB3E packets arrive one port below the control port
+        scenes = threading.Thread(target=send_scenes,
+                                  args=(ip, port - 1, args.scene_rate, stop), daemon=True)
+        scenes.start()
+    try:
+        probe = subprocess.run([args.probe, ip, '--port', str(port),
+                                '--rate', str(args.rate),
+                                '--duration', str(args.duration),
+                                '--interval', str(args.duration)],
+                               capture_output=True, text=True,
+                               timeout=args.duration + 30)
+    finally:
+        stop.set()
+        if scenes:
+            scenes.join()
+
+    status = run_ctl(args.ctl, ip, port, 'cue-status')
+    run_ctl(args.ctl, ip, port, 'cue-stop')
+    state = run_ctl(args.ctl, ip, port, 'state')
+
+    if probe.returncode != 0:
+        raise RuntimeError(f"rb3e_probe: {(probe.stderr or probe.stdout).strip()}")
+
+    out = probe.stdout
+    result.update({
+        'sent': int(field(r'Total: (\d+) sent', out, 0)),
+        'lost': int(field(r'sent, (\d+) lost', out, 0)),
+        'rtt_p50': float(field(r'RTT ms\s*:.*?p50 ([\d.]+)', out, 'nan')),
+        'rtt_p99': float(field(r'RTT ms\s*:.*?p99 ([\d.]+)', out, 'nan')),
+        'rtt_max': float(field(r'RTT ms\s*:.*?max ([\d.]+)', out, 'nan')),
+        'jitter': float(field(r'Jitter ms: ([\d.]+)', out, 'nan')),
+        'bridge_max': int(field(r'bridge processing max (\d+)', out, 0)),
+        'cues': int(field(r'Played\s*:\s*(\d+)', status, 0)),
+        'late': int(field(r'Played\s*:.*?(\d+) late', status, 0)),
+        'drift_max': int(field(r'Timer drift\s*:.*?(\d+) us max', status, 0)),
+        'dispatch_max': int(field(r'USB dispatch\s*:.*?(\d+) us max', status, 0)),
+        'scene_avg': int(field(r'scene apply avg (\d+)', state, 0)),
+        'scene_max_us': float(field(r'scene apply avg \d+ max \d+ \( ([\d.]+) us', state, 'nan')),
+        'loop_max_us': float(field(r'loop pass max \d+ \( ([\d.]+) us', state, 'nan')),
+    })
+    return result
+
+
+def print_table(results):
+    columns = [
+        ('bridge', 'label', '{}'),
+        ('board', 'board', '{}'),
+        ('cores', 'cores', '{}'),
+        ('mode', 'mode', '{}'),
+        ('lost', 'lost', '{}'),
+        ('rtt p50', 'rtt_p50', '{:.2f}'),
+        ('rtt p99', 'rtt_p99', '{:.2f}'),
+        ('rtt max', 'rtt_max', '{:.2f}'),
+        ('jitter', 'jitter', '{:.2f}'),
+        ('proc max us', 'bridge_max', '{}'),
+        ('cues', 'cues', '{}'),
+        ('late', 'late', '{}'),
+        ('drift max us', 'drift_max', '{}'),
+        ('usb max us', 'dispatch_max', '{}'),
+        ('scene cyc', 'scene_avg', '{}'),
+        ('scene max us', 'scene_max_us', '{:.1f}'),
+        ('loop max us', 'loop_max_us', '{:.1f}'),
+    ]
+    cells = [[fmt.format(r[key]) for _, key, fmt in columns] for r in results]
+    widths = [max(len(title), *(len(row[i]) for row in cells))
+              for i, (title, _, _) in enumerate(columns)]
+
+    print('  '.join(title.rjust(w) for (title, _, _), w in zip(columns, widths)))
+    for row in cells:
+        print('  '.join(cell.rjust(w) for cell, w in zip(row, widths)))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare CYW43 arch modes or board profiles on live RB3E bridges',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  %(prog)s bg=192.168.1.50 poll=192.168.1.51
+  %(prog)s w=192.168.1.50 w2=192.168.1.52
+  %(prog)s bg=127.0.0.1:21371 poll=127.0.0.1:21471 --tools build --duration 30
+
+RTT columns are milliseconds. "proc max" is the bridge's own worst
+handling time for a probe, "drift max" how late the cue timer fired and
+"usb max" the worst cue-to-USB-submit delay. "scene cyc" is the average
+cost of applying one scene in CPU cycles (comparable across clock
+speeds), "loop max" the longest main loop pass.
+"""
+    )
+    parser.add_argument('targets', nargs='+',
+                        help='Bridges to compare as label=ip[:port]')
+    parser.add_argument('--tools', type=Path, default=Path('.'),
+                        help='Directory containing rb3e_ctl and rb3e_probe (default: .)')
+    parser.add_argument('--duration', type=float, default=20.0,
+                        help='Seconds of load per bridge (default: 20)')
+    parser.add_argument('--rate', type=float, default=100.0,
+                        help='Probe rate in Hz (default: 100)')
+    parser.add_argument('--cue-step', type=int, default=10,
+                        help='Milliseconds between cue commands (default: 10)')
+    parser.add_argument('--scene-rate', type=float, default=50.0,
+                        help='Scene packets per second, 0 = none (default: 50)')
+
+    args = parser.parse_args()
+    args.ctl = find_tool(args.tools, 'rb3e_ctl')
+    args.probe = find_tool(args.tools, 'rb3e_probe')
+
+    targets = [parse_target(text) for text in args.targets]
+    try:
+        capacity = min(board_info(run_ctl(args.ctl, ip, port, 'state'))['cue_capacity']
+                       for _, ip, port in targets)
+    except (OSError, RuntimeError, subprocess.TimeoutExpired) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        cue_file = Path(tmp) / 'bench.cues'
+        step_ms = write_cue_list(cue_file, args.duration, args.cue_step, capacity)
+        if step_ms != args.cue_step:
+            print(f"Cue step raised to {step_ms} ms to fit {capacity} cues")
+
+        for label, ip, port in targets:
+            print(f"{label}: {ip}:{port} for {args.duration:.0f} s...", flush=True)
+            try:
+                results.append(bench_one(args, label, ip, port, cue_file))
+            except (OSError, RuntimeError, subprocess.TimeoutExpired) as e:
+                print(f"Error: {label}: {e}", file=sys.stderr)
+                sys.exit(1)
+
+    print()
+    print_table(results)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,173 @@
+// rb3e_async_bench - Scheduling overhead of the RB3E_Async coroutine layer
+//
+// Usage: rb3e_async_bench [--scripts N] [--awaits N] [--events N] [--port N]
+//
+//   --scripts N       Concurrent effect scripts ( default 1000 )
+//   --awaits N        Awaits per script for the yield and timer runs ( default 1000 )
+//   --events N        RB3E events sent over loopback for the event run ( default 200 )
+//   --port N          Loopback port for the event run ( default 21170 )
+//
+// Each run spawns N scripts on one RB3E_EventLoop and reports wall time per
+// await ( suspend, queue, resume ):
+//   yield   co_await loop.Yield()            ready queue only
+//   timer   co_await loop.Sleep( 0 )         through the timer heap
+//   event   co_await loop.NextEvent( ... )   every script woken by every event
+//   nested  co_await Child()                 a nested RB3E_Task started and finished
+// For the event run all events are queued in the socket before the loop
+// starts, so the figure is dispatch cost, not network latency.
+
+#include "RB3E_Async.h"
+
+#include <cstdlib>
+#include <vector>
+
+#define BENCH_DEFAULT_SCRIPTS  1000
+#define BENCH_DEFAULT_AWAITS   1000
+#define BENCH_DEFAULT_EVENTS   200
+#define BENCH_DEFAULT_PORT     21170
+
+static uint64_t g_awaits = 0;
+
+static RB3E_Task YieldScript( RB3E_EventLoop& loop, int awaits ) {
+  for( int i = 0; i < awaits; i++ ) {
+    co_await loop.Yield();
+    g_awaits++;
+  }
+}
+
+static RB3E_Task TimerScript( RB3E_EventLoop& loop, int awaits ) {
+  for( int i = 0; i < awaits; i++ ) {
+    co_await loop.Sleep( 0 );
+    g_awaits++;
+  }
+}
+
+static RB3E_Task EventScript( RB3E_EventLoop& loop, RB3E_Network& net, int events ) {
+  for( int i = 0; i < events; i++ ) {
+    co_await loop.NextEvent( net, RB3E_EVENT_STAGEKIT );
+    g_awaits++;
+  }
+}
+
+// Ends the event run once every wakeup happened, or after a second without progress
+static RB3E_Task EventWatchdog( RB3E_EventLoop& loop, uint64_t expected ) {
+  uint64_t last = 0;
+  int64_t progress_ns = RB3E_EventLoop::Now();
+  while( g_awaits < expected ) {
+    co_await loop.Sleep( 1 );
+    if( g_awaits != last ) {
+      last = g_awaits;
+      progress_ns = RB3E_EventLoop::Now();
+    } else if( RB3E_EventLoop::Now() - progress_ns > 1000000000 ) {
+      loop.Stop();
+    }
+  }
+}
+
+static RB3E_Task Child() {
+  g_awaits++;
+  co_return;
+}
+
+static RB3E_Task NestedScript( int awaits ) {
+  for( int i = 0; i < awaits; i++ ) {
+    co_await Child();
+  }
+}
+
+static void Report( const char* name, int scripts, int64_t elapsed_ns ) {
+  std::cout << std::left << std::setw( 8 ) << name << std::right
+            << std::setw( 8 ) << scripts << " scripts "
+            << std::setw( 10 ) << g_awaits << " awaits "
+            << std::fixed << std::setprecision( 1 )
+            << std::setw( 9 ) << elapsed_ns / 1e6 << " ms "
+            << std::setw( 8 ) << ( g_awaits ? (double)elapsed_ns / g_awaits : 0.0 ) << " ns/await"
+            << std::endl;
+}
+
+template<typename Spawner>
+static bool RunBench( const char* name, int scripts, Spawner spawn ) {
+  RB3E_EventLoop loop;
+  g_awaits = 0;
+  for( int s = 0; s < scripts; s++ ) {
+    loop.Spawn( spawn( loop ) );
+  }
+
+  int64_t start_ns = RB3E_EventLoop::Now();
+  bool finished = loop.Run();
+  Report( name, scripts, RB3E_EventLoop::Now() - start_ns );
+  return finished;
+}
+
+static void Usage() {
+  std::cerr << "Usage: rb3e_async_bench [--scripts N] [--awaits N] [--events N] [--port N]" << std::endl;
+}
+
+int main( int argc, char** argv ) {
+  int scripts = BENCH_DEFAULT_SCRIPTS;
+  int awaits = BENCH_DEFAULT_AWAITS;
+  int events = BENCH_DEFAULT_EVENTS;
+  uint16_t port = BENCH_DEFAULT_PORT;
+
+  for( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    bool has_value = ( i + 1 < argc );
+    if( arg == "--scripts" && has_value ) {
+      scripts = atoi( argv[ ++i ] );
+    } else if( arg == "--awaits" && has_value ) {
+      awaits = atoi( argv[ ++i ] );
+    } else if( arg == "--events" && has_value ) {
+      events = atoi( argv[ ++i ] );
+    } else if( arg == "--port" && has_value ) {
+      port = (uint16_t)atoi( argv[ ++i ] );
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+
+  if( scripts <= 0 || awaits <= 0 || events <= 0 ) {
+    Usage();
+    return 1;
+  }
+
+  RunBench( "yield", scripts, [ & ]( RB3E_EventLoop& loop ) { return YieldScript( loop, awaits ); } );
+  RunBench( "timer", scripts, [ & ]( RB3E_EventLoop& loop ) { return TimerScript( loop, awaits ); } );
+  RunBench( "nested", scripts, [ & ]( RB3E_EventLoop& ) { return NestedScript( awaits ); } );
+
+  // Queue every event first; the receive buffer must hold them all
+  RB3E_Network receiver;
+  RB3E_Network sender;
+  std::string any_source = "0.0.0.0";
+  std::string loopback = "127.0.0.1";
+  if( !receiver.StartReceiver( any_source, port ) || !sender.StartSender( loopback, port ) ) {
+    return 2;
+  }
+  int rcvbuf = 4 * 1024 * 1024;
+  setsockopt( receiver.GetSocket(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof( rcvbuf ) );
+
+  for( int e = 0; e < events; e++ ) {
+    sender.SendLightEvent( (uint8_t)e, RB3E_BANK_BLUE );
+  }
+  usleep( 100000 );
+
+  // Scripts register on the loop's first pass, before it reads the socket
+  const uint64_t expected = (uint64_t)scripts * events;
+  RB3E_EventLoop loop;
+  g_awaits = 0;
+  for( int s = 0; s < scripts; s++ ) {
+    loop.Spawn( EventScript( loop, receiver, events ) );
+  }
+  loop.Spawn( EventWatchdog( loop, expected ) );
+
+  int64_t start_ns = RB3E_EventLoop::Now();
+  loop.Run();
+  Report( "event", scripts, RB3E_EventLoop::Now() - start_ns );
+  if( g_awaits != expected ) {
+    std::cerr << "Only " << g_awaits << " of " << expected
+              << " event wakeups - the receive buffer overflowed, try fewer --events." << std::endl;
+    return 3;
+  }
+
+  return 0;
+}
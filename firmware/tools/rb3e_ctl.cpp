@@ -0,0 +1,1080 @@
+// rb3e_ctl - command line client for the bridge control protocol ( port 21071 )
+//
+// Usage: rb3e_ctl <bridge_ip> [--port N] <command> [args]
+//
+//   ping                              Round trip check
+//   params                            List runtime parameters with limits
+//   get <param>                       Read a parameter ( name or id )
+//   set <param> <value>               Write a parameter
+//   state                             Stage Kit shadow state and counters
+//   test <pattern> [step_ms] [dur_ms] Run a test pattern ( stop, chase, spin, strobe, on )
+//   reset-stats                       Clear all counters on the bridge
+//   scene <b> <g> <y> <r> [strobe] [fog]
+//                                     Set the whole kit in one packet ( sent to the StageKit port )
+//   cue-upload <file>                 Upload a cue list ( lines of "<time_ms> <left> <right>" )
+//   cue-go [delay_ms] [position_ms]   Start the uploaded list delay_ms from now
+//   cue-stop                          Stop playback ( lights off )
+//   cue-status                        Playback position and timing statistics
+//   cue-clear                         Free the uploaded list ( after cue-stop )
+//   sources                           Senders seen by the bridge and which one holds the lock
+//   priority <sender_ip> <0-255>      Let a sender take over the lights ( higher wins )
+//   trace-start [ring|once]           Start the event recorder ( ring keeps the newest events )
+//   trace-stop                        Stop recording
+//   trace-status                      Recorder state and fill level
+//   trace-dump <file>                 Save the recorded events ( convert with rb3e_trace2json.py )
+//   pools                             Memory pool usage per block size
+//   ota-upload <file> [stage]         Send a firmware image ( .uf2 or .bin ), installed between songs
+//                                     ( stage: keep it staged until ota-install )
+//   ota-install                       Install the staged image at the next quiet moment
+//   ota-status                        Update progress and flash scheduling counters
+//   ota-abort                         Drop the upload or staged image
+
+#include "RB3E_Network.h"
+#include "control_protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#define CTL_DEFAULT_PORT     21071
+#define CTL_TIMEOUT_MS       500
+#define CTL_RETRIES          3
+#define CTL_STAGEKIT_PORT    21070
+#define CTL_OTA_BUSY_MAX_MS  500    // Longest back-off while the bridge holds flash writes
+
+// UF2 block ( https://github.com/microsoft/uf2 )
+#define UF2_MAGIC_START0     0x0A324655
+#define UF2_MAGIC_START1     0x9E5D5157
+#define UF2_MAGIC_END        0x0AB16F30
+#define UF2_FLAG_NOT_MAIN    0x00000001
+#define UF2_FLAG_FAMILY      0x00002000
+#define UF2_FLASH_BASE       0x10000000
+#define UF2_FAMILY_RP2040    0xe48bff56
+#define UF2_FAMILY_RP2350    0xe48bff59    // ARM secure, the family the Pico 2 W build carries
+#define UF2_FLASH_RP2040     0x200000      // Pico W
+#define UF2_FLASH_RP2350     0x400000      // Pico 2 W
+
+struct ParamName {
+  uint16_t    id;
+  const char* name;
+};
+
+static const ParamName param_names[] = {
+  { CTRL_PARAM_SAFETY_TIMEOUT_MS,      "safety_timeout_ms" },
+  { CTRL_PARAM_TELEMETRY_INTERVAL_MS,  "telemetry_interval_ms" },
+  { CTRL_PARAM_LOOP_DELAY_ACTIVE_US,   "loop_delay_active_us" },
+  { CTRL_PARAM_LOOP_DELAY_IDLE_US,     "loop_delay_idle_us" },
+  { CTRL_PARAM_WIFI_CHECK_INTERVAL_MS, "wifi_check_interval_ms" },
+  { CTRL_PARAM_USB_XFER_TIMEOUT_MS,    "usb_xfer_timeout_ms" },
+  { CTRL_PARAM_SOURCE_LOCK_MS,         "source_lock_ms" },
+  { CTRL_PARAM_OTA_QUIET_MS,           "ota_quiet_ms" },
+  { CTRL_PARAM_OTA_INSTALL_QUIET_MS,   "ota_install_quiet_ms" },
+  { CTRL_PARAM_LINK_ALERT_SCORE,       "link_alert_score" },
+  { CTRL_PARAM_LINK_ROAM_SCORE,        "link_roam_score" },
+  { CTRL_PARAM_ALIVE_TIMEOUT_MS,       "alive_timeout_ms" },
+};
+
+struct PatternName {
+  uint8_t     id;
+  const char* name;
+};
+
+static const PatternName pattern_names[] = {
+  { CTRL_PATTERN_STOP,       "stop" },
+  { CTRL_PATTERN_BANK_CHASE, "chase" },
+  { CTRL_PATTERN_LED_SPIN,   "spin" },
+  { CTRL_PATTERN_STROBE,     "strobe" },
+  { CTRL_PATTERN_ALL_ON,     "on" },
+};
+
+static const char* StatusName( uint8_t status ) {
+  switch( status ) {
+    case CTRL_STATUS_OK:           return "ok";
+    case CTRL_STATUS_UNKNOWN_MSG:  return "unknown message";
+    case CTRL_STATUS_BAD_LENGTH:   return "bad length";
+    case CTRL_STATUS_BAD_PARAM:    return "unknown parameter";
+    case CTRL_STATUS_OUT_OF_RANGE: return "out of range";
+    case CTRL_STATUS_BUSY:         return "busy";
+    case CTRL_STATUS_BAD_CRC:      return "CRC mismatch";
+    case CTRL_STATUS_NOT_READY:    return "not ready";
+    case CTRL_STATUS_NO_MEMORY:    return "out of memory";
+    default:                       return "error";
+  }
+}
+
+static const char* LookupParamName( uint16_t id ) {
+  for( const ParamName& p : param_names ) {
+    if( p.id == id ) {
+      return p.name;
+    }
+  }
+  return "?";
+}
+
+static bool ParseParam( const char* text, uint16_t& id ) {
+  for( const ParamName& p : param_names ) {
+    if( strcmp( p.name, text ) == 0 ) {
+      id = p.id;
+      return true;
+    }
+  }
+
+  char* end = NULL;
+  unsigned long value = strtoul( text, &end, 0 );
+  if( end == text || *end != '\0' || value > 0xFFFF ) {
+    return false;
+  }
+  id = (uint16_t)value;
+  return true;
+}
+
+// Send one request and wait for the matching response
+// Returns false on timeout; status and payload are filled on success
+static bool Transact( RB3E_Network& net, uint8_t msg_id, const void* payload, uint16_t length,
+                      uint8_t& status, std::vector<uint8_t>& response, double& rtt_ms ) {
+  static uint16_t seq = (uint16_t)std::chrono::steady_clock::now().time_since_epoch().count();
+
+  uint8_t request[ sizeof( ctrl_header_t ) + CTRL_MAX_PAYLOAD ];
+  uint8_t reply[ sizeof( ctrl_header_t ) + CTRL_MAX_PAYLOAD ];
+
+  for( int attempt = 0; attempt < CTL_RETRIES; attempt++ ) {
+    seq++;
+    ctrl_build_header( (ctrl_header_t*)request, msg_id, seq, 0, length );
+    if( length > 0 ) {
+      memcpy( request + sizeof( ctrl_header_t ), payload, length );
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if( !net.SendRaw( request, sizeof( ctrl_header_t ) + length ) ) {
+      std::cerr << "Send failed." << std::endl;
+      return false;
+    }
+
+    int remaining_ms = CTL_TIMEOUT_MS;
+    while( remaining_ms > 0 ) {
+      int received = net.ReceiveRaw( reply, sizeof( reply ), remaining_ms );
+      if( received <= 0 ) {
+        break;
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      const ctrl_header_t* hdr = (const ctrl_header_t*)reply;
+      if( ctrl_check_header( reply, received ) &&
+          hdr->msg_id == ( msg_id | CTRL_MSG_RESPONSE ) && hdr->seq == seq ) {
+        status = hdr->status;
+        response.assign( reply + sizeof( ctrl_header_t ), reply + sizeof( ctrl_header_t ) + hdr->length );
+        rtt_ms = std::chrono::duration<double, std::milli>( now - start ).count();
+        return true;
+      }
+
+      // Stale reply from an earlier attempt - keep waiting
+      remaining_ms = CTL_TIMEOUT_MS - (int)std::chrono::duration_cast<std::chrono::milliseconds>( now - start ).count();
+    }
+  }
+
+  std::cerr << "No response from bridge." << std::endl;
+  return false;
+}
+
+static void PrintParam( const ctrl_param_t& param ) {
+  std::cout << std::left << std::setw( 24 ) << LookupParamName( param.id )
+            << std::right << std::setw( 8 ) << param.value
+            << "  [" << param.min << " .. " << param.max << "]" << std::endl;
+}
+
+static std::string FormatAddress( uint32_t addr ) {
+  if( addr == 0 ) {
+    return "none";
+  }
+  struct in_addr in;
+  in.s_addr = addr;
+  return inet_ntoa( in );
+}
+
+static void PrintRadioStats( const ctrl_radio_stats_t& radio ) {
+  uint32_t saved = radio.requests > radio.ops ? radio.requests - radio.ops : 0;
+  uint32_t avg_us = radio.ops ? radio.bus_us / radio.ops : 0;
+  std::cout << "Status LED   : ";
+  if( radio.led_gpio < 0 ) {
+    std::cout << "CYW43" << std::endl;
+  } else {
+    std::cout << "GPIO " << +radio.led_gpio << std::endl;
+  }
+  std::cout << "CYW43 ioctls : " << radio.ops << " of " << radio.requests << " requested, "
+            << radio.bus_us << " us on the bus ( max " << radio.bus_max_us << " us ), "
+            << radio.deferred_passes << " busy passes waited" << std::endl;
+  std::cout << "  saved      : " << saved << " ioctls";
+  if( radio.ops ) {
+    std::cout << ", about " << saved * avg_us << " us of bus time";
+  }
+  std::cout << std::endl;
+}
+
+static void PrintBoard( const ctrl_board_t& board ) {
+  static const char* board_names[] = { "host", "pico_w", "pico2_w" };
+  const char* name = board.board < 3 ? board_names[ board.board ] : "unknown";
+  double mhz = board.sys_clk_khz ? board.sys_clk_khz / 1000.0 : 1.0;
+  std::cout << "Board        : " << name << ", " << +board.cores << " core"
+            << ( board.cores == 1 ? "" : "s" ) << ", " << board.sys_clk_khz / 1000 << " MHz, cycles from "
+            << ( board.cycle_counter ? "DWT counter" : "us timer" ) << std::endl;
+  std::cout << "  capacity   : USB queue " << board.usb_queue << ", " << board.cue_entries << " cues, "
+            << board.trace_events << " trace events, " << board.pool_bytes / 1024 << " KB pool, "
+            << board.fs_bytes / 1024 << " KB filesystem" << std::endl;
+  std::cout << "  cycles     : scene apply avg "
+            << ( board.scenes ? board.scene_cycles / board.scenes : 0 ) << " max " << board.scene_cycles_max
+            << " ( " << std::fixed << std::setprecision( 1 ) << board.scene_cycles_max / mhz << " us ), "
+            << "loop pass max " << board.loop_cycles_max
+            << " ( " << board.loop_cycles_max / mhz << " us ) over " << board.loop_passes << " passes" << std::endl;
+}
+
+static void PrintFilesystem( const ctrl_fs_t& fs ) {
+  std::cout << "Filesystem   : " << fs.size / 1024 << " KB at 0x" << std::hex << std::uppercase << fs.offset
+            << std::dec << ", ";
+  if( fs.mounted ) {
+    std::cout << fs.used / 1024 << " KB used, mounted in " << fs.mount_us << " us" << std::endl;
+  } else {
+    std::cout << "not mounted" << std::endl;
+  }
+  if( fs.import_size ) {
+    std::cout << "  import     : " << fs.import_size / 1024 << " KB at 0x" << std::hex << std::uppercase
+              << fs.import_offset << std::dec << ", ";
+    if( fs.imported ) {
+      std::cout << fs.imported_files << " files imported at boot in " << fs.import_us << " us" << std::endl;
+    } else {
+      std::cout << "empty at boot" << std::endl;
+    }
+  }
+}
+
+static std::string LinkScore( uint8_t score ) {
+  return score == CTRL_LINK_NO_DATA ? std::string( "--" ) : std::to_string( score );
+}
+
+static void PrintLink( const ctrl_link_t& link ) {
+  std::cout << "Link quality : " << +link.score << ( link.alert ? " ( ALERT )" : "" )
+            << " - rssi " << LinkScore( link.rssi_score ) << ", alive " << LinkScore( link.alive_score )
+            << ", jitter " << LinkScore( link.jitter_score ) << ", sends " << LinkScore( link.send_score )
+            << std::endl;
+  std::cout << "  inputs     : " << link.rssi_dbm << " dBm, ";
+  if( link.alive_interval_ms ) {
+    std::cout << "ALIVE every " << link.alive_interval_ms << " ms ( " << link.alive_loss_pm / 10.0
+              << "% missed ), ";
+  } else {
+    std::cout << "no ALIVE cadence, ";
+  }
+  std::cout << "jitter " << link.jitter_us / 1000.0 << " ms, " << link.send_fail_pm / 10.0
+            << "% sends failed" << std::endl;
+  std::cout << "  actions    : " << link.alerts << " alerts, " << link.roam_scans << " roam scans, "
+            << link.roams << " roams" << std::endl;
+}
+
+static void PrintConsole( const ctrl_console_t& console ) {
+  static const char* game_states[] = { "unknown", "menus", "in game" };
+
+  std::cout << "Console      : " << ( console.game_state <= CTRL_CONSOLE_IN_GAME ? game_states[ console.game_state ] : "?" )
+            << ", ";
+  if( console.alive_period_ms ) {
+    std::cout << "ALIVE every " << console.alive_period_ms << " ms" << ( console.alive_trusted ? "" : " ( learning )" );
+  } else {
+    std::cout << "no ALIVE cadence";
+  }
+  std::cout << std::endl;
+  std::cout << "  blackouts  : " << console.timeout_blackouts << " timeout, " << console.menu_blackouts
+            << " menus, " << console.alive_lost_blackouts << " ALIVE lost, " << console.holds
+            << " avoided while the console was live" << std::endl;
+}
+
+static void PrintState( const ctrl_state_t& state ) {
+  static const char* bank_names[ SK_BANK_COUNT ] = { "blue", "green", "yellow", "red" };
+
+  std::cout << "Stage Kit    : " << ( state.usb_connected ? "connected" : "not connected" ) << std::endl;
+  for( int i = 0; i < SK_BANK_COUNT; i++ ) {
+    std::cout << "  " << std::left << std::setw( 11 ) << bank_names[ i ] << ": "
+              << std::bitset<8>( state.stagekit.banks[ i ] ) << std::endl;
+  }
+  std::cout << "  strobe     : " << +state.stagekit.strobe << std::endl;
+  std::cout << "  fog        : " << ( state.stagekit.fog ? "on" : "off" ) << std::endl;
+  std::cout << "Test pattern : " << +state.test_pattern << std::endl;
+  std::cout << "Uptime       : " << state.uptime_ms / 1000 << " s" << std::endl;
+  std::cout << "WiFi RSSI    : " << state.wifi_rssi << " dBm" << std::endl;
+  std::cout << "Network mode : " << ( state.cyw43_arch == CTRL_CYW43_ARCH_POLL ? "poll" : "background" ) << std::endl;
+  PrintRadioStats( state.radio );
+  PrintBoard( state.board );
+  PrintFilesystem( state.fs );
+  PrintLink( state.link );
+  PrintConsole( state.console );
+  std::cout << "Packets      : " << state.packets_received << " received, "
+            << state.packets_processed << " processed, "
+            << state.packets_invalid << " invalid" << std::endl;
+  std::cout << "Telemetry    : " << state.telemetry_sent << " sent, "
+            << state.discovery_received << " discoveries, "
+            << state.probes_answered << " probes" << std::endl;
+  std::cout << "USB commands : " << state.usb_commands_sent << " sent, "
+            << state.usb_commands_dropped << " dropped, "
+            << state.usb_xfer_timeouts << " timeouts, "
+            << state.usb_xfer_errors << " errors" << std::endl;
+  std::cout << "Scenes       : " << state.scenes_applied << " applied, "
+            << state.scene_commands_saved << " commands saved" << std::endl;
+  std::cout << "Control      : " << state.control_requests << " requests" << std::endl;
+  std::cout << "Source       : " << FormatAddress( state.active_source ) << " ( "
+            << state.packets_rejected << " packets rejected from others, " << state.source_switches
+            << " switches )" << std::endl;
+}
+
+// Read "<time_ms> <left> <right>" lines ( absolute times, '#' comments ) into delta-time cues
+static bool LoadCueFile( const std::string& path, std::vector<ctrl_cue_t>& cues ) {
+  std::ifstream file( path );
+  if( !file ) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  uint64_t last_ms = 0;
+  int line_number = 0;
+  while( std::getline( file, line ) ) {
+    line_number++;
+    size_t comment = line.find( '#' );
+    if( comment != std::string::npos ) {
+      line.erase( comment );
+    }
+
+    std::istringstream fields( line );
+    std::string time_text, left_text, right_text;
+    if( !( fields >> time_text ) ) {
+      continue;  // Blank line
+    }
+    if( !( fields >> left_text >> right_text ) ) {
+      std::cerr << path << ":" << line_number << ": expected <time_ms> <left> <right>" << std::endl;
+      return false;
+    }
+
+    uint64_t time_ms = strtoull( time_text.c_str(), NULL, 0 );
+    if( time_ms < last_ms ) {
+      std::cerr << path << ":" << line_number << ": times must not go backwards" << std::endl;
+      return false;
+    }
+
+    // Split long gaps with delay-only cues
+    uint64_t gap_ms = time_ms - last_ms;
+    while( gap_ms > 0xFFFF ) {
+      cues.push_back( { 0xFFFF, 0x00, CTRL_CUE_WAIT } );
+      gap_ms -= 0xFFFF;
+    }
+
+    ctrl_cue_t cue;
+    cue.delta_ms = (uint16_t)gap_ms;
+    cue.left_weight = (uint8_t)strtoul( left_text.c_str(), NULL, 0 );
+    cue.right_weight = (uint8_t)strtoul( right_text.c_str(), NULL, 0 );
+    cues.push_back( cue );
+    last_ms = time_ms;
+  }
+
+  return true;
+}
+
+static void PrintCueStatus( const ctrl_cue_status_t& status ) {
+  static const char* state_names[] = { "empty", "ready", "armed", "playing" };
+
+  std::cout << "State        : " << ( status.state < 4 ? state_names[ status.state ] : "?" ) << std::endl;
+  std::cout << "Cues         : " << status.next_index << " / " << status.count
+            << " ( position " << status.position_ms << " ms )" << std::endl;
+  std::cout << "Played       : " << status.cues_played << " ( " << status.cues_late << " late, "
+            << status.overruns << " overruns )" << std::endl;
+  std::cout << "Timer drift  : " << status.timer_late_last_us << " us last, "
+            << status.timer_late_max_us << " us max" << std::endl;
+  std::cout << "USB dispatch : " << status.dispatch_last_us << " us last, "
+            << status.dispatch_max_us << " us max" << std::endl;
+}
+
+static void PrintSources( const std::vector<uint8_t>& response ) {
+  size_t count = response.size() / sizeof( ctrl_source_t );
+  if( count == 0 ) {
+    std::cout << "No senders seen" << std::endl;
+    return;
+  }
+
+  for( size_t i = 0; i < count; i++ ) {
+    ctrl_source_t source;
+    memcpy( &source, response.data() + i * sizeof( ctrl_source_t ), sizeof( source ) );
+    std::cout << ( source.active ? "* " : "  " )
+              << std::left << std::setw( 16 ) << FormatAddress( source.addr ) << std::right
+              << " priority " << std::setw( 3 ) << +source.priority
+              << "  accepted " << std::setw( 8 ) << source.accepted
+              << "  rejected " << std::setw( 8 ) << source.rejected
+              << "  idle " << source.idle_ms << " ms" << std::endl;
+  }
+}
+
+static void PrintTraceStatus( const ctrl_trace_status_t& status ) {
+  std::cout << "Recorder     : " << ( status.running ? "running" : "stopped" )
+            << " ( " << ( status.mode == CTRL_TRACE_MODE_ONESHOT ? "one-shot" : "ring" ) << " )" << std::endl;
+  std::cout << "Events       : " << status.count << " / " << status.capacity;
+  if( status.overwritten > 0 ) {
+    std::cout << " ( " << status.overwritten << " older overwritten )";
+  }
+  std::cout << std::endl;
+}
+
+static void PrintPools( const std::vector<uint8_t>& response ) {
+  std::cout << "Block   Count  In use   Peak    Allocs  Failures  Fallbacks" << std::endl;
+  for( size_t offset = 0; offset + sizeof( ctrl_pool_t ) <= response.size(); offset += sizeof( ctrl_pool_t ) ) {
+    ctrl_pool_t pool;
+    memcpy( &pool, response.data() + offset, sizeof( pool ) );
+    std::cout << std::setw( 5 ) << pool.block_size
+              << std::setw( 8 ) << pool.block_count
+              << std::setw( 8 ) << pool.in_use
+              << std::setw( 7 ) << pool.high_water
+              << std::setw( 10 ) << pool.allocs
+              << std::setw( 10 ) << pool.failures
+              << std::setw( 11 ) << pool.fallbacks << std::endl;
+  }
+}
+
+// Stop the recorder, read every event and write an RB3T dump; a running
+// recorder is restarted afterwards so it keeps catching the rehearsal.
+// Returns false on a transport or file error; bridge errors are left in status
+static bool DumpTrace( RB3E_Network& net, const std::string& path, uint8_t& status ) {
+  std::vector<uint8_t> response;
+  double rtt_ms = 0.0;
+
+  if( !Transact( net, CTRL_MSG_TRACE_STATUS, NULL, 0, status, response, rtt_ms ) ) {
+    return false;
+  }
+  if( status != CTRL_STATUS_OK || response.size() < sizeof( ctrl_trace_status_t ) ) {
+    return true;
+  }
+  ctrl_trace_status_t before;
+  memcpy( &before, response.data(), sizeof( before ) );
+
+  ctrl_trace_control_t control;
+  control.action = CTRL_TRACE_STOP;
+  control.mode = before.mode;
+  if( !Transact( net, CTRL_MSG_TRACE_CONTROL, &control, sizeof( control ), status, response, rtt_ms ) ) {
+    return false;
+  }
+  if( status != CTRL_STATUS_OK || response.size() < sizeof( ctrl_trace_status_t ) ) {
+    return true;
+  }
+  ctrl_trace_status_t stopped;
+  memcpy( &stopped, response.data(), sizeof( stopped ) );
+
+  if( !Transact( net, CTRL_MSG_TRACE_NAMES, NULL, 0, status, response, rtt_ms ) ) {
+    return false;
+  }
+  if( status != CTRL_STATUS_OK ) {
+    return true;
+  }
+  std::vector<uint8_t> names = response;
+
+  // Reads are acknowledged, so a lost packet is simply resent by Transact()
+  std::vector<ctrl_trace_event_t> events;
+  while( events.size() < stopped.count ) {
+    ctrl_trace_read_t read;
+    read.index = (uint32_t)events.size();
+    read.count = 0;
+    if( !Transact( net, CTRL_MSG_TRACE_READ, &read, sizeof( read ), status, response, rtt_ms ) ) {
+      return false;
+    }
+    if( status != CTRL_STATUS_OK || response.size() < sizeof( read ) ) {
+      return true;
+    }
+    memcpy( &read, response.data(), sizeof( read ) );
+    if( read.count == 0 || response.size() < sizeof( read ) + read.count * sizeof( ctrl_trace_event_t ) ) {
+      break;
+    }
+    const ctrl_trace_event_t* chunk = (const ctrl_trace_event_t*)( response.data() + sizeof( read ) );
+    events.insert( events.end(), chunk, chunk + read.count );
+  }
+
+  ctrl_trace_file_t header;
+  memcpy( header.magic, CTRL_TRACE_FILE_MAGIC, sizeof( header.magic ) );
+  header.version = CTRL_TRACE_FILE_VERSION;
+  header.names_length = (uint16_t)names.size();
+  header.count = (uint32_t)events.size();
+  header.overwritten = stopped.overwritten;
+
+  std::ofstream file( path, std::ios::binary );
+  file.write( (const char*)&header, sizeof( header ) );
+  file.write( (const char*)names.data(), names.size() );
+  file.write( (const char*)events.data(), events.size() * sizeof( ctrl_trace_event_t ) );
+  if( !file ) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+  std::cout << "Saved " << events.size() << " events to " << path << std::endl;
+
+  if( before.running ) {
+    control.action = CTRL_TRACE_START;
+    if( !Transact( net, CTRL_MSG_TRACE_CONTROL, &control, sizeof( control ), status, response, rtt_ms ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void PrintOtaStatus( const ctrl_ota_status_t& status ) {
+  static const char* state_names[] = { "idle", "receiving", "verifying", "staged", "verify failed" };
+
+  std::cout << "State        : " << ( status.state < 5 ? state_names[ status.state ] : "?" );
+  if( status.install_pending ) {
+    std::cout << " ( install when quiet )";
+  }
+  std::cout << std::endl;
+  std::cout << "Image        : " << status.image_size << " bytes, CRC " << std::hex << std::setfill( '0' )
+            << std::setw( 8 ) << status.image_crc << std::dec << std::setfill( ' ' ) << std::endl;
+  std::cout << "Progress     : " << status.received << " received, " << status.written << " written" << std::endl;
+  std::cout << "Staging slot : 0x" << std::hex << status.slot_offset << std::dec
+            << " ( " << status.slot_size / 1024 << " KB )" << std::endl;
+  std::cout << "Scheduling   : " << status.busy_replies << " busy replies, " << status.deferred_passes
+            << " deferred passes, " << status.flash_max_us << " us longest flash stall" << std::endl;
+}
+
+// Flash size of a board family, 0 for families that are not a board image
+// ( absolute and data blocks in RP2350 UF2s )
+static uint32_t Uf2FlashSize( uint32_t family ) {
+  switch( family ) {
+    case UF2_FAMILY_RP2040:
+      return UF2_FLASH_RP2040;
+    case UF2_FAMILY_RP2350:
+      return UF2_FLASH_RP2350;
+    default:
+      return 0;
+  }
+}
+
+// Read a UF2 ( main flash blocks of the board family only, gaps filled with 0xFF )
+// or a raw .bin starting at flash offset 0. family is 0 when the file does not name one
+static bool LoadFirmware( const std::string& path, std::vector<uint8_t>& image, uint32_t& family ) {
+  std::ifstream file( path, std::ios::binary );
+  if( !file ) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  std::vector<uint8_t> data( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+  family = 0;
+  uint32_t magic[ 2 ] = { 0, 0 };
+  if( data.size() >= sizeof( magic ) ) {
+    memcpy( magic, data.data(), sizeof( magic ) );
+  }
+  if( magic[ 0 ] != UF2_MAGIC_START0 || magic[ 1 ] != UF2_MAGIC_START1 ) {
+    image = data;
+    return !image.empty();
+  }
+
+  image.clear();
+  uint32_t flash_size = UF2_FLASH_RP2350;
+  size_t skipped = 0;
+  for( size_t at = 0; at + 512 <= data.size(); at += 512 ) {
+    uint32_t block[ 8 ];
+    uint32_t magic_end;
+    memcpy( block, &data[ at ], sizeof( block ) );
+    memcpy( &magic_end, &data[ at + 508 ], sizeof( magic_end ) );
+    if( block[ 0 ] != UF2_MAGIC_START0 || block[ 1 ] != UF2_MAGIC_START1 || magic_end != UF2_MAGIC_END ||
+        block[ 4 ] > 476 ) {
+      std::cerr << path << ": bad UF2 block at " << at << std::endl;
+      return false;
+    }
+    uint32_t flags = block[ 2 ], address = block[ 3 ], length = block[ 4 ];
+    if( flags & UF2_FLAG_NOT_MAIN ) {
+      continue;
+    }
+    // The first board family named sets the image; blocks of any other family
+    // ( the absolute block picotool appends, data partitions ) are not part of it
+    if( flags & UF2_FLAG_FAMILY ) {
+      if( family == 0 && Uf2FlashSize( block[ 7 ] ) != 0 ) {
+        family = block[ 7 ];
+        flash_size = Uf2FlashSize( family );
+      }
+      if( block[ 7 ] != family ) {
+        skipped++;
+        continue;
+      }
+    }
+    if( address < UF2_FLASH_BASE || address - UF2_FLASH_BASE > flash_size - length ) {
+      std::cerr << path << ": block at 0x" << std::hex << address << std::dec << " is not in flash" << std::endl;
+      return false;
+    }
+
+    size_t offset = address - UF2_FLASH_BASE;
+    if( image.size() < offset + length ) {
+      image.resize( offset + length, 0xFF );
+    }
+    memcpy( &image[ offset ], &data[ at + 32 ], length );
+  }
+
+  if( skipped ) {
+    std::cout << path << ": skipped " << skipped << " blocks of other UF2 families" << std::endl;
+  }
+  if( image.empty() ) {
+    std::cerr << path << ": no flash blocks" << std::endl;
+  }
+  return !image.empty();
+}
+
+// Send a request again while the bridge answers BUSY, backing off up to CTL_OTA_BUSY_MAX_MS
+static bool TransactUntilAccepted( RB3E_Network& net, uint8_t msg_id, const void* payload, uint16_t length,
+                                   uint8_t& status, std::vector<uint8_t>& response, uint32_t& busy ) {
+  double rtt_ms = 0.0;
+  int wait_ms = 1;
+  while( Transact( net, msg_id, payload, length, status, response, rtt_ms ) ) {
+    if( status != CTRL_STATUS_BUSY ) {
+      return true;
+    }
+    busy++;
+    std::this_thread::sleep_for( std::chrono::milliseconds( wait_ms ) );
+    wait_ms = std::min( wait_ms * 2, CTL_OTA_BUSY_MAX_MS );
+  }
+  return false;
+}
+
+// Stream the image from wherever the bridge's upload stands, then verify it.
+// Returns false on a transport error; bridge errors are left in status
+static bool UploadFirmware( RB3E_Network& net, const std::vector<uint8_t>& image, uint32_t family,
+                            bool install, uint8_t& status ) {
+  std::vector<uint8_t> response;
+  uint32_t busy = 0;
+
+  ctrl_ota_begin_t begin;
+  begin.image_size = (uint32_t)image.size();
+  begin.image_crc = ctrl_crc32( 0, image.data(), image.size() );
+  begin.family_id = family;
+  if( !TransactUntilAccepted( net, CTRL_MSG_OTA_BEGIN, &begin, sizeof( begin ), status, response, busy ) ) {
+    return false;
+  }
+  if( status != CTRL_STATUS_OK || response.size() < sizeof( ctrl_ota_status_t ) ) {
+    return true;
+  }
+  ctrl_ota_status_t ota;
+  memcpy( &ota, response.data(), sizeof( ota ) );
+  if( ota.received > 0 ) {
+    std::cout << "Resuming at " << ota.received << " of " << image.size() << " bytes" << std::endl;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  uint32_t offset = ota.received;
+  while( ota.state == CTRL_OTA_STATE_RECEIVING && offset < image.size() ) {
+    uint8_t chunk[ sizeof( ctrl_ota_data_t ) + CTRL_OTA_CHUNK ];
+    ctrl_ota_data_t data;
+    data.offset = offset;
+    data.length = (uint16_t)std::min<size_t>( CTRL_OTA_CHUNK, image.size() - offset );
+    data.crc32 = ctrl_crc32( 0, &image[ offset ], data.length );
+    memcpy( chunk, &data, sizeof( data ) );
+    memcpy( chunk + sizeof( data ), &image[ offset ], data.length );
+
+    if( !TransactUntilAccepted( net, CTRL_MSG_OTA_DATA, chunk, sizeof( data ) + data.length, status, response, busy ) ) {
+      return false;
+    }
+    if( status != CTRL_STATUS_OK ) {
+      return true;
+    }
+
+    offset += data.length;
+    if( offset % ( 64 * 1024 ) == 0 || offset == image.size() ) {
+      std::cout << "\r" << offset / 1024 << " / " << image.size() / 1024 << " KB" << std::flush;
+    }
+  }
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  std::cout << std::endl << "Sent in " << std::fixed << std::setprecision( 1 ) << seconds << " s ( "
+            << busy << " busy replies while the bridge held flash writes )" << std::endl;
+
+  // The last page may still be waiting for a quiet moment
+  ctrl_ota_commit_t commit;
+  commit.install = install ? 1 : 0;
+  if( !TransactUntilAccepted( net, CTRL_MSG_OTA_COMMIT, &commit, sizeof( commit ), status, response, busy ) ) {
+    return false;
+  }
+  if( status != CTRL_STATUS_OK ) {
+    return true;
+  }
+
+  double rtt_ms = 0.0;
+  do {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    if( !Transact( net, CTRL_MSG_OTA_STATUS, NULL, 0, status, response, rtt_ms ) ) {
+      return false;
+    }
+    if( status != CTRL_STATUS_OK || response.size() < sizeof( ota ) ) {
+      return true;
+    }
+    memcpy( &ota, response.data(), sizeof( ota ) );
+  } while( ota.state == CTRL_OTA_STATE_VERIFYING );
+
+  if( ota.state != CTRL_OTA_STATE_STAGED ) {
+    std::cerr << "Bridge could not verify the staged image." << std::endl;
+    status = CTRL_STATUS_BAD_CRC;
+    return true;
+  }
+  std::cout << "Verified on the bridge; " << ( install ? "installs after the lights have been quiet for a while"
+                                                       : "staged, run ota-install to install it" ) << std::endl;
+  return true;
+}
+
+static void Usage() {
+  std::cerr << "Usage: rb3e_ctl <bridge_ip> [--port N] <command> [args]" << std::endl;
+  std::cerr << "Commands:" << std::endl;
+  std::cerr << "  ping" << std::endl;
+  std::cerr << "  params" << std::endl;
+  std::cerr << "  get <param>" << std::endl;
+  std::cerr << "  set <param> <value>" << std::endl;
+  std::cerr << "  state" << std::endl;
+  std::cerr << "  test <stop|chase|spin|strobe|on> [step_ms] [duration_ms]" << std::endl;
+  std::cerr << "  reset-stats" << std::endl;
+  std::cerr << "  scene <blue> <green> <yellow> <red> [strobe 0-4] [fog 0-1]" << std::endl;
+  std::cerr << "  cue-upload <file>" << std::endl;
+  std::cerr << "  cue-go [delay_ms] [position_ms]" << std::endl;
+  std::cerr << "  cue-stop" << std::endl;
+  std::cerr << "  cue-status" << std::endl;
+  std::cerr << "  cue-clear" << std::endl;
+  std::cerr << "  sources" << std::endl;
+  std::cerr << "  priority <sender_ip> <0-255>" << std::endl;
+  std::cerr << "  trace-start [ring|once]" << std::endl;
+  std::cerr << "  trace-stop" << std::endl;
+  std::cerr << "  trace-status" << std::endl;
+  std::cerr << "  trace-dump <file>" << std::endl;
+  std::cerr << "  pools" << std::endl;
+  std::cerr << "  ota-upload <file.uf2|file.bin> [stage]" << std::endl;
+  std::cerr << "  ota-install" << std::endl;
+  std::cerr << "  ota-status" << std::endl;
+  std::cerr << "  ota-abort" << std::endl;
+}
+
+int main( int argc, char** argv ) {
+  std::vector<std::string> args;
+  uint16_t port = CTL_DEFAULT_PORT;
+
+  for( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if( arg == "--port" && i + 1 < argc ) {
+      port = (uint16_t)atoi( argv[ ++i ] );
+    } else {
+      args.push_back( arg );
+    }
+  }
+
+  if( args.size() < 2 ) {
+    Usage();
+    return 1;
+  }
+
+  std::string bridge_ip = args[ 0 ];
+  std::string command = args[ 1 ];
+
+  // Scenes are StageKit traffic, fire-and-forget on the RB3E port ( shifted
+  // along with --port, for emulated bridges on offset ports )
+  if( command == "scene" ) {
+    if( args.size() < 6 ) {
+      Usage();
+      return 1;
+    }
+
+    RB3E_EventScene scene;
+    for( int i = 0; i < 4; i++ ) {
+      scene.Banks[ i ] = (uint8_t)strtoul( args[ 2 + i ].c_str(), NULL, 0 );
+    }
+    scene.Strobe = args.size() > 6 ? (uint8_t)atoi( args[ 6 ].c_str() ) : 0;
+    scene.Fog = args.size() > 7 ? (uint8_t)atoi( args[ 7 ].c_str() ) : 0;
+
+    RB3E_Network sk_net;
+    if( !sk_net.StartSender( bridge_ip, (uint16_t)( CTL_STAGEKIT_PORT + port - CTL_DEFAULT_PORT ) ) || !sk_net.SendSceneEvent( scene ) ) {
+      std::cerr << "Send failed." << std::endl;
+      return 2;
+    }
+    return 0;
+  }
+
+  RB3E_Network net;
+  if( !net.StartSender( bridge_ip, port ) ) {
+    return 1;
+  }
+
+  uint8_t status = CTRL_STATUS_OK;
+  std::vector<uint8_t> response;
+  double rtt_ms = 0.0;
+
+  if( command == "ping" ) {
+    if( !Transact( net, CTRL_MSG_PING, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    std::cout << "Reply from " << bridge_ip << ": " << std::fixed << std::setprecision( 2 ) << rtt_ms << " ms" << std::endl;
+
+  } else if( command == "params" ) {
+    if( !Transact( net, CTRL_MSG_PARAM_LIST, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    for( size_t offset = 0; offset + sizeof( ctrl_param_t ) <= response.size(); offset += sizeof( ctrl_param_t ) ) {
+      ctrl_param_t param;
+      memcpy( &param, response.data() + offset, sizeof( param ) );
+      PrintParam( param );
+    }
+
+  } else if( command == "get" || command == "set" ) {
+    ctrl_param_value_t req;
+    uint16_t param_id;
+    if( args.size() < ( command == "set" ? 4u : 3u ) || !ParseParam( args[ 2 ].c_str(), param_id ) ) {
+      Usage();
+      return 1;
+    }
+    req.id = param_id;
+
+    bool ok;
+    if( command == "get" ) {
+      ctrl_param_id_t get_req;
+      get_req.id = req.id;
+      ok = Transact( net, CTRL_MSG_PARAM_GET, &get_req, sizeof( get_req ), status, response, rtt_ms );
+    } else {
+      req.value = (uint32_t)strtoul( args[ 3 ].c_str(), NULL, 0 );
+      ok = Transact( net, CTRL_MSG_PARAM_SET, &req, sizeof( req ), status, response, rtt_ms );
+    }
+    if( !ok ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK && response.size() >= sizeof( ctrl_param_t ) ) {
+      ctrl_param_t param;
+      memcpy( &param, response.data(), sizeof( param ) );
+      PrintParam( param );
+    }
+
+  } else if( command == "state" ) {
+    if( !Transact( net, CTRL_MSG_GET_STATE, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK && response.size() >= sizeof( ctrl_state_t ) ) {
+      ctrl_state_t state;
+      memcpy( &state, response.data(), sizeof( state ) );
+      PrintState( state );
+    }
+
+  } else if( command == "test" ) {
+    if( args.size() < 3 ) {
+      Usage();
+      return 1;
+    }
+
+    ctrl_test_pattern_t req;
+    req.pattern = 0xFF;
+    for( const PatternName& p : pattern_names ) {
+      if( args[ 2 ] == p.name ) {
+        req.pattern = p.id;
+      }
+    }
+    if( req.pattern == 0xFF ) {
+      Usage();
+      return 1;
+    }
+    req.step_ms = args.size() > 3 ? (uint16_t)atoi( args[ 3 ].c_str() ) : 0;
+    req.duration_ms = args.size() > 4 ? (uint16_t)atoi( args[ 4 ].c_str() ) : 0;
+
+    if( !Transact( net, CTRL_MSG_TEST_PATTERN, &req, sizeof( req ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "reset-stats" ) {
+    if( !Transact( net, CTRL_MSG_RESET_STATS, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "cue-upload" ) {
+    std::vector<ctrl_cue_t> cues;
+    if( args.size() < 3 || !LoadCueFile( args[ 2 ], cues ) ) {
+      Usage();
+      return 1;
+    }
+
+    ctrl_cue_begin_t begin;
+    begin.count = (uint16_t)cues.size();
+    if( cues.empty() || cues.size() > 0xFFFF ) {
+      std::cerr << "Cue list must hold 1 to 65535 cues." << std::endl;
+      return 1;
+    }
+    if( !Transact( net, CTRL_MSG_CUE_BEGIN, &begin, sizeof( begin ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+    // Each chunk is acknowledged, so a lost packet is simply resent by Transact()
+    for( size_t index = 0; status == CTRL_STATUS_OK && index < cues.size(); index += CTRL_CUE_MAX_PER_PACKET ) {
+      uint8_t chunk[ sizeof( ctrl_cue_data_t ) + CTRL_CUE_MAX_PER_PACKET * sizeof( ctrl_cue_t ) ];
+      ctrl_cue_data_t data;
+      data.index = (uint16_t)index;
+      data.count = (uint8_t)std::min<size_t>( CTRL_CUE_MAX_PER_PACKET, cues.size() - index );
+      memcpy( chunk, &data, sizeof( data ) );
+      memcpy( chunk + sizeof( data ), &cues[ index ], data.count * sizeof( ctrl_cue_t ) );
+
+      if( !Transact( net, CTRL_MSG_CUE_DATA, chunk, sizeof( data ) + data.count * sizeof( ctrl_cue_t ),
+                     status, response, rtt_ms ) ) {
+        return 2;
+      }
+    }
+
+    if( status == CTRL_STATUS_OK ) {
+      ctrl_cue_commit_t commit;
+      commit.crc32 = ctrl_crc32( 0, (const uint8_t*)cues.data(), cues.size() * sizeof( ctrl_cue_t ) );
+      if( !Transact( net, CTRL_MSG_CUE_COMMIT, &commit, sizeof( commit ), status, response, rtt_ms ) ) {
+        return 2;
+      }
+    }
+    if( status == CTRL_STATUS_OK ) {
+      std::cout << "Uploaded " << cues.size() << " cues ( " << cues.size() * sizeof( ctrl_cue_t ) << " bytes )" << std::endl;
+    }
+
+  } else if( command == "cue-go" ) {
+    uint32_t delay_ms = args.size() > 2 ? (uint32_t)strtoul( args[ 2 ].c_str(), NULL, 0 ) : 0;
+
+    ctrl_cue_go_t go;
+    go.start_ms = 0;
+    go.position_ms = args.size() > 3 ? (uint32_t)strtoul( args[ 3 ].c_str(), NULL, 0 ) : 0;
+
+    // Translate the delay into bridge uptime ( half the RTT is the one-way estimate )
+    if( delay_ms > 0 ) {
+      if( !Transact( net, CTRL_MSG_GET_STATE, NULL, 0, status, response, rtt_ms ) ) {
+        return 2;
+      }
+      if( status != CTRL_STATUS_OK || response.size() < sizeof( ctrl_state_t ) ) {
+        std::cerr << "Cannot read bridge uptime." << std::endl;
+        return 2;
+      }
+      ctrl_state_t state;
+      memcpy( &state, response.data(), sizeof( state ) );
+      go.start_ms = state.uptime_ms + (uint32_t)( rtt_ms / 2.0 ) + delay_ms;
+    }
+
+    if( !Transact( net, CTRL_MSG_CUE_GO, &go, sizeof( go ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "cue-stop" ) {
+    if( !Transact( net, CTRL_MSG_CUE_STOP, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "cue-status" ) {
+    if( !Transact( net, CTRL_MSG_CUE_STATUS, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK && response.size() >= sizeof( ctrl_cue_status_t ) ) {
+      ctrl_cue_status_t cue_status;
+      memcpy( &cue_status, response.data(), sizeof( cue_status ) );
+      PrintCueStatus( cue_status );
+    }
+
+  } else if( command == "cue-clear" ) {
+    // A zero-length list hands its blocks back to the pool
+    ctrl_cue_begin_t begin;
+    begin.count = 0;
+    if( !Transact( net, CTRL_MSG_CUE_BEGIN, &begin, sizeof( begin ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "sources" ) {
+    if( !Transact( net, CTRL_MSG_SOURCE_LIST, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK ) {
+      PrintSources( response );
+    }
+
+  } else if( command == "priority" ) {
+    struct in_addr sender;
+    if( args.size() < 4 || inet_aton( args[ 2 ].c_str(), &sender ) == 0 ) {
+      Usage();
+      return 1;
+    }
+    ctrl_source_priority_t req;
+    req.addr = sender.s_addr;
+    req.priority = (uint8_t)std::min( 255ul, strtoul( args[ 3 ].c_str(), NULL, 0 ) );
+    if( !Transact( net, CTRL_MSG_SOURCE_PRIORITY, &req, sizeof( req ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "trace-start" || command == "trace-stop" || command == "trace-status" ) {
+    bool ok;
+    if( command == "trace-status" ) {
+      ok = Transact( net, CTRL_MSG_TRACE_STATUS, NULL, 0, status, response, rtt_ms );
+    } else {
+      ctrl_trace_control_t req;
+      req.action = command == "trace-start" ? CTRL_TRACE_START : CTRL_TRACE_STOP;
+      req.mode = CTRL_TRACE_MODE_RING;
+      if( args.size() > 2 && args[ 2 ] == "once" ) {
+        req.mode = CTRL_TRACE_MODE_ONESHOT;
+      } else if( args.size() > 2 && args[ 2 ] != "ring" ) {
+        Usage();
+        return 1;
+      }
+      ok = Transact( net, CTRL_MSG_TRACE_CONTROL, &req, sizeof( req ), status, response, rtt_ms );
+    }
+    if( !ok ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK && response.size() >= sizeof( ctrl_trace_status_t ) ) {
+      ctrl_trace_status_t trace_status;
+      memcpy( &trace_status, response.data(), sizeof( trace_status ) );
+      PrintTraceStatus( trace_status );
+    }
+
+  } else if( command == "trace-dump" ) {
+    if( args.size() < 3 ) {
+      Usage();
+      return 1;
+    }
+    if( !DumpTrace( net, args[ 2 ], status ) ) {
+      return 2;
+    }
+
+  } else if( command == "pools" ) {
+    if( !Transact( net, CTRL_MSG_POOL_STATS, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK ) {
+      PrintPools( response );
+    }
+
+  } else if( command == "ota-upload" ) {
+    std::vector<uint8_t> image;
+    uint32_t family = 0;
+    if( args.size() < 3 || ( args.size() > 3 && args[ 3 ] != "stage" ) || !LoadFirmware( args[ 2 ], image, family ) ) {
+      Usage();
+      return 1;
+    }
+    if( !UploadFirmware( net, image, family, args.size() == 3, status ) ) {
+      return 2;
+    }
+
+  } else if( command == "ota-install" ) {
+    ctrl_ota_commit_t commit;
+    commit.install = 1;
+    if( !Transact( net, CTRL_MSG_OTA_COMMIT, &commit, sizeof( commit ), status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else if( command == "ota-status" ) {
+    if( !Transact( net, CTRL_MSG_OTA_STATUS, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+    if( status == CTRL_STATUS_OK && response.size() >= sizeof( ctrl_ota_status_t ) ) {
+      ctrl_ota_status_t ota;
+      memcpy( &ota, response.data(), sizeof( ota ) );
+      PrintOtaStatus( ota );
+    }
+
+  } else if( command == "ota-abort" ) {
+    if( !Transact( net, CTRL_MSG_OTA_ABORT, NULL, 0, status, response, rtt_ms ) ) {
+      return 2;
+    }
+
+  } else {
+    Usage();
+    return 1;
+  }
+
+  if( status != CTRL_STATUS_OK ) {
+    std::cerr << "Bridge returned: " << StatusName( status ) << std::endl;
+    return 3;
+  }
+
+  return 0;
+}
@@ -0,0 +1,442 @@
+#!/usr/bin/env python3
+"""
+Push runtime parameters or firmware to every bridge on the network at once.
+
+Bridges are found the way the dashboard finds them, on the telemetry
+port (21071): a control PING is broadcast and every bridge answers it,
+and the telemetry broadcast that undiscovered bridges send every few
+seconds supplies their MAC and name. --announce also sends the
+dashboard's {"type":"discovery"} so bridges that report to a dashboard
+show up with a name; they then send telemetry here instead of to the
+dashboard for 30 seconds.
+
+Each bridge is handled by rb3e_ctl in a pool of --jobs workers, so a
+rollout takes about as long as the slowest bridge rather than the sum of
+all of them. Failed bridges are retried; bridges that finished are
+recorded in the --state file, and running the same command again only
+visits the ones that did not. Firmware uploads also resume on the bridge
+itself from the last acknowledged chunk.
+
+Parameters set this way live in RAM and return to their defaults when a
+bridge restarts.
+
+Usage:
+    python rb3e_fleet.py discover
+    python rb3e_fleet.py set safety_timeout_ms=3000 source_lock_ms=1500
+    python rb3e_fleet.py ota rb3e_stagekit_pico_w.uf2 --jobs 8
+    python rb3e_fleet.py ota build.uf2 --stage --target 192.168.1.50 --target 192.168.1.51
+"""
+
+import argparse
+import hashlib
+import json
+import re
+import select
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from pathlib import Path
+
+CTL_DEFAULT_PORT = 21071
+CTL_MAGIC = b'RB3C'         # control_protocol.h
+CTL_VERSION = 1
+CTL_MSG_PING = 0x01
+CTL_MSG_RESPONSE = 0x80
+CTL_HEADER = struct.Struct('<4sBBHBBH')
+
+DISCOVERY_PACKET = b'{"type":"discovery"}'
+
+
+class Bridge:
+    def __init__(self, ip: str, port: int):
+        self.ip = ip
+        self.port = port
+        self.id = ''            # MAC, from telemetry
+        self.name = ''
+        self.telemetry = {}
+
+    @property
+    def address(self) -> str:
+        return f'{self.ip}:{self.port}'
+
+    @property
+    def key(self) -> str:
+        return self.id or self.address
+
+    @property
+    def label(self) -> str:
+        return f'{self.name} ({self.address})' if self.name else self.address
+
+
+def parse_target(text: str):
+    """ip[:port] -> (ip, port)"""
+    ip, _, port = text.partition(':')
+    return ip, int(port) if port else CTL_DEFAULT_PORT
+
+
+def find_tool(tools_dir: Path, name: str) -> str:
+    for candidate in (tools_dir / name, tools_dir / f'{name}.exe'):
+        if candidate.exists():
+            return str(candidate)
+    return name
+
+
+def ping_packet(seq: int) -> bytes:
+    return CTL_HEADER.pack(CTL_MAGIC, CTL_VERSION, CTL_MSG_PING, seq & 0xFFFF, 0, 0, 0)
+
+
+def open_telemetry_socket(bind: str):
+    """Share port 21071 with a dashboard on this host; None if that fails"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    try:
+        sock.bind((bind, CTL_DEFAULT_PORT))
+    except OSError as e:
+        print(f"Telemetry port {CTL_DEFAULT_PORT} unavailable ({e}); bridges will have no names",
+              file=sys.stderr)
+        sock.close()
+        return None
+    sock.setblocking(False)
+    return sock
+
+
+def discover(args) -> list:
+    bridges = {}
+
+    def seen(ip: str, port: int) -> Bridge:
+        return bridges.setdefault((ip, port), Bridge(ip, port))
+
+    for text in args.target:
+        seen(*parse_target(text))
+
+    ping = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    ping.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    ping.setblocking(False)
+    telemetry = open_telemetry_socket(args.bind) if args.discover else None
+    sockets = [s for s in (ping, telemetry) if s is not None]
+
+    destinations = [parse_target(t) for t in args.target]
+    if args.discover:
+        destinations.append((args.broadcast, args.port))
+        if args.announce and telemetry is not None:
+            telemetry.sendto(DISCOVERY_PACKET, (args.broadcast, CTL_DEFAULT_PORT))
+
+    # UDP - repeat the ping every half second of the listening window
+    deadline = time.monotonic() + args.listen
+    next_ping = 0.0
+    seq = 0
+    while time.monotonic() < deadline:
+        now = time.monotonic()
+        if now >= next_ping:
+            for destination in destinations:
+                try:
+                    ping.sendto(ping_packet(seq), destination)
+                except OSError:
+                    pass
+            seq += 1
+            next_ping = now + 0.5
+
+        if args.expect and sum(1 for b in bridges.values() if b.id or not telemetry) >= args.expect:
+            break
+
+        readable, _, _ = select.select(sockets, [], [], min(0.1, max(0.0, deadline - now)))
+        for sock in readable:
+            try:
+                data, (ip, port) = sock.recvfrom(2048)
+            except OSError:
+                continue
+
+            if data[:4] == CTL_MAGIC and len(data) >= CTL_HEADER.size:
+                msg_id = CTL_HEADER.unpack_from(data)[2]
+                if msg_id == (CTL_MSG_PING | CTL_MSG_RESPONSE):
+                    seen(ip, port)
+            elif data[:1] == b'{':
+                try:
+                    info = json.loads(data)
+                except ValueError:
+                    continue
+                if not isinstance(info, dict) or 'id' not in info:
+                    continue    # Our own (or a dashboard's) discovery packet
+                # Telemetry leaves from the bridge's control port
+                bridge = seen(ip, port)
+                bridge.id = str(info['id'])
+                bridge.name = str(info.get('name', ''))
+                bridge.telemetry = info
+
+    for sock in sockets:
+        sock.close()
+
+    # A bridge heard only through telemetry never answered a ping; still try it
+    return sorted(bridges.values(), key=lambda b: (socket.inet_aton(b.ip), b.port))
+
+
+def print_bridges(bridges):
+    columns = [('address', lambda b: b.address),
+               ('id', lambda b: b.id or '-'),
+               ('name', lambda b: b.name or '-'),
+               ('usb', lambda b: b.telemetry.get('usb_status', '-')),
+               ('rssi', lambda b: str(b.telemetry.get('wifi_signal', '-'))),
+               ('uptime s', lambda b: str(b.telemetry.get('uptime', '-')))]
+    cells = [[get(b) for _, get in columns] for b in bridges]
+    widths = [max(len(title), *(len(row[i]) for row in cells)) if cells else len(title)
+              for i, (title, _) in enumerate(columns)]
+    print('  '.join(title.ljust(w) for (title, _), w in zip(columns, widths)).rstrip())
+    for row in cells:
+        print('  '.join(cell.ljust(w) for cell, w in zip(row, widths)).rstrip())
+
+
+class RolloutState:
+    """Bridges that finished a job, keyed by MAC (or address if unknown)"""
+
+    def __init__(self, path: Path, job: str, fresh: bool):
+        self.path = path
+        self.job = job
+        self.done = {}
+        self.lock = threading.Lock()
+        if fresh or not path.exists():
+            return
+        try:
+            saved = json.loads(path.read_text())
+        except (OSError, ValueError):
+            return
+        if saved.get('job') == job:
+            self.done = saved.get('done', {})
+        else:
+            print(f"{path}: previous rollout was \"{saved.get('job')}\", starting over")
+
+    def finished(self, bridge: Bridge) -> bool:
+        if bridge.key in self.done:
+            return True
+        return any(entry.get('address') == bridge.address for entry in self.done.values())
+
+    def record(self, bridge: Bridge, seconds: float):
+        with self.lock:
+            self.done[bridge.key] = {'address': bridge.address, 'name': bridge.name,
+                                     'seconds': round(seconds, 1)}
+            temp = self.path.with_suffix(self.path.suffix + '.tmp')
+            temp.write_text(json.dumps({'job': self.job, 'done': self.done}, indent=2) + '\n')
+            temp.replace(self.path)
+
+
+print_lock = threading.Lock()
+
+
+def report(bridge: Bridge, text: str):
+    with print_lock:
+        print(f'{bridge.label}: {text}', flush=True)
+
+
+def run_ctl(args, bridge: Bridge, *command, progress=None) -> str:
+    """Run rb3e_ctl, handing each \\r or \\n terminated output line to progress"""
+    proc = subprocess.Popen([args.ctl, bridge.ip, '--port', str(bridge.port), *command],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    timer = threading.Timer(args.timeout, proc.kill)
+    timer.start()
+    output = []
+    try:
+        pending = b''
+        while True:
+            chunk = proc.stdout.read1(4096)
+            if not chunk:
+                break
+            pending += chunk
+            *lines, pending = re.split(rb'[\r\n]', pending)
+            for line in lines:
+                text = line.decode(errors='replace').strip()
+                if text and not text.startswith('RB3E_Network :'):   # Socket log lines
+                    output.append(text)
+                    if progress is not None:
+                        progress(text)
+        errors = proc.stderr.read().decode(errors='replace').strip()
+        proc.wait()
+    finally:
+        timer.cancel()
+
+    if proc.returncode != 0:
+        reason = errors or (output[-1] if output else f'exit code {proc.returncode}')
+        if proc.returncode < 0:
+            reason = f'no result after {args.timeout:.0f} s'
+        raise RuntimeError(f"{' '.join(command[:2])}: {reason}")
+    return '\n'.join(output)
+
+
+def push_params(args, bridge: Bridge):
+    for name, value in args.assignments:
+        run_ctl(args, bridge, 'set', name, value)
+
+
+def push_firmware(args, bridge: Bridge):
+    last = [-1]
+
+    def progress(text: str):
+        match = re.match(r'(\d+) / (\d+) KB', text)
+        if match is None:
+            report(bridge, text)
+            return
+        sent, total = int(match.group(1)), max(1, int(match.group(2)))
+        percent = sent * 100 // total
+        if percent // 25 != last[0] // 25 or sent == total:
+            last[0] = percent
+            report(bridge, f'{sent} / {total} KB ({percent}%)')
+
+    command = ['ota-upload', str(args.file)] + (['stage'] if args.stage else [])
+    run_ctl(args, bridge, *command, progress=progress)
+
+
+def roll_out(args, bridge: Bridge, state: RolloutState) -> dict:
+    start = time.monotonic()
+    error = ''
+    for attempt in range(args.retries + 1):
+        if attempt > 0:
+            report(bridge, f'retry {attempt} of {args.retries} ({error})')
+            time.sleep(min(2 ** attempt, 10))
+        try:
+            args.action(args, bridge)
+        except (OSError, RuntimeError) as e:
+            error = str(e)
+            continue
+        seconds = time.monotonic() - start
+        state.record(bridge, seconds)
+        report(bridge, f'done in {seconds:.1f} s')
+        return {'bridge': bridge, 'ok': True, 'seconds': seconds}
+
+    report(bridge, f'FAILED: {error}')
+    return {'bridge': bridge, 'ok': False, 'seconds': time.monotonic() - start, 'error': error}
+
+
+def job_description(args) -> str:
+    if args.command == 'set':
+        return 'set ' + ' '.join(f'{n}={v}' for n, v in sorted(args.assignments))
+    digest = hashlib.sha256(args.file.read_bytes()).hexdigest()[:16]
+    return f"ota {digest}{' stage' if args.stage else ''}"
+
+
+def parse_assignment(text: str):
+    name, sep, value = text.partition('=')
+    if not sep or not name or not value:
+        raise argparse.ArgumentTypeError(f'expected name=value, got "{text}"')
+    return name, value
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Discover RB3E bridges and push parameters or firmware to all of them',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  %(prog)s discover --announce
+  %(prog)s set safety_timeout_ms=3000 --tools build-tools
+  %(prog)s ota rb3e_stagekit_pico_w.uf2 --jobs 8 --retries 3
+  %(prog)s ota build.uf2 --no-discover --target 192.168.1.50 --target 192.168.1.51:21171
+
+Run the same command again after a partial failure: bridges listed as
+done in the state file are skipped and uploads continue where they
+stopped. --fresh forgets the state file.
+"""
+    )
+    parser.add_argument('command', choices=['discover', 'set', 'ota'],
+                        help='discover: list bridges, set: write parameters, ota: upload firmware')
+    parser.add_argument('items', nargs='*',
+                        help='set: name=value ..., ota: firmware file (.uf2 or .bin)')
+    parser.add_argument('--target', action='append', default=[], metavar='IP[:PORT]',
+                        help='Bridge to include even if it does not answer the broadcast (repeatable)')
+    parser.add_argument('--no-discover', dest='discover', action='store_false',
+                        help='Only use the --target bridges')
+    parser.add_argument('--announce', action='store_true',
+                        help='Send the dashboard discovery packet so every bridge reports its name')
+    parser.add_argument('--broadcast', default='255.255.255.255',
+                        help='Broadcast address for discovery (default: 255.255.255.255)')
+    parser.add_argument('--port', type=int, default=CTL_DEFAULT_PORT,
+                        help=f'Control port to broadcast to (default: {CTL_DEFAULT_PORT})')
+    parser.add_argument('--bind', default='',
+                        help='Local address for the telemetry listener (default: all)')
+    parser.add_argument('--listen', type=float, default=6.0,
+                        help='Seconds to collect answers; telemetry comes every 5 s (default: 6)')
+    parser.add_argument('--expect', type=int, default=0,
+                        help='Stop listening once this many bridges are known')
+    parser.add_argument('--jobs', type=int, default=4,
+                        help='Bridges handled at the same time (default: 4)')
+    parser.add_argument('--retries', type=int, default=2,
+                        help='Extra attempts per bridge (default: 2)')
+    parser.add_argument('--timeout', type=float, default=600.0,
+                        help='Seconds one rb3e_ctl run may take (default: 600)')
+    parser.add_argument('--stage', action='store_true',
+                        help='ota: keep the image staged until rb3e_ctl ota-install')
+    parser.add_argument('--state', type=Path, default=Path('rb3e_fleet.state.json'),
+                        help='Progress file for resuming (default: rb3e_fleet.state.json)')
+    parser.add_argument('--fresh', action='store_true',
+                        help='Ignore the state file and visit every bridge')
+    parser.add_argument('--tools', type=Path, default=Path('.'),
+                        help='Directory containing rb3e_ctl (default: .)')
+
+    args = parser.parse_args()
+    args.ctl = find_tool(args.tools, 'rb3e_ctl')
+
+    if args.command == 'set':
+        if not args.items:
+            parser.error('set needs at least one name=value')
+        try:
+            args.assignments = [parse_assignment(t) for t in args.items]
+        except argparse.ArgumentTypeError as e:
+            parser.error(str(e))
+        args.action = push_params
+    elif args.command == 'ota':
+        if len(args.items) != 1:
+            parser.error('ota needs exactly one firmware file')
+        args.file = Path(args.items[0])
+        if not args.file.is_file():
+            parser.error(f'{args.file}: no such file')
+        args.action = push_firmware
+    elif args.items:
+        parser.error('discover takes no arguments')
+    if not args.discover and not args.target:
+        parser.error('--no-discover needs at least one --target')
+    if args.jobs < 1:
+        parser.error('--jobs must be at least 1')
+
+    print(f"Discovering bridges for {args.listen:.0f} s...", flush=True)
+    bridges = discover(args)
+    if args.command == 'discover':
+        print_bridges(bridges)
+        return
+    if not bridges:
+        print("Error: no bridges found", file=sys.stderr)
+        sys.exit(1)
+
+    state = RolloutState(args.state, job_description(args), args.fresh)
+    todo = [b for b in bridges if not state.finished(b)]
+    skipped = len(bridges) - len(todo)
+    print(f"{len(bridges)} bridges, {skipped} already done, {len(todo)} to go "
+          f"with {min(args.jobs, max(1, len(todo)))} workers", flush=True)
+
+    start = time.monotonic()
+    results = []
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(roll_out, args, b, state) for b in todo]
+        for future in as_completed(futures):
+            results.append(future.result())
+    elapsed = time.monotonic() - start
+
+    failed = [r for r in results if not r['ok']]
+    print()
+    if results:
+        slowest = max(results, key=lambda r: r['seconds'])
+        total = sum(r['seconds'] for r in results)
+        print(f"{len(results) - len(failed)} of {len(results)} succeeded in {elapsed:.1f} s "
+              f"(slowest {slowest['bridge'].label} {slowest['seconds']:.1f} s, "
+              f"{total:.1f} s one after another)")
+    for r in failed:
+        print(f"  {r['bridge'].label}: {r['error']}")
+    if failed:
+        print(f"Run the same command again to retry the {len(failed)} failed bridges "
+              f"(progress in {args.state})")
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,352 @@
+// rb3e_impair - UDP impairment proxy for testing the bridge under bad WiFi
+//
+// Usage: rb3e_impair <bridge_ip> [options]
+//
+// Senders target this host instead of the bridge; datagrams are forwarded both
+// ways with loss, burst loss, jitter, reordering and duplication applied. Run one
+// instance per port ( 21070 StageKit, 21071 telemetry / control ).
+//
+//   --listen N        Local port senders send to ( default 21070 )
+//   --bridge-port N   Bridge port to forward to ( default = listen port )
+//   --direction D     up ( to bridge ), down ( from bridge ) or both ( default both )
+//   --loss P          Random loss, percent per packet
+//   --burst-start P   Chance per packet of a loss burst starting, percent
+//   --burst-len N     Mean burst length in packets ( default 5 )
+//   --delay MS        Fixed one-way delay
+//   --jitter MS       Extra random delay 0..MS ( packet order is kept )
+//   --reorder P       Percent of packets held back an extra --reorder-ms so later ones overtake
+//   --reorder-ms MS   Hold back time for reordered packets ( default 20 )
+//   --duplicate P     Percent of packets sent twice
+//   --seed N          RNG seed ( default 1 ) - same seed and traffic give the same decisions
+//   --log FILE        CSV of every decision: time_ms,dir,size,action,delay_ms
+//   --stats S         Print counters every S seconds ( default 10, 0 = only at exit )
+//
+// Each direction has its own RNG, so the decisions for one direction do not
+// depend on how much traffic flows the other way.
+
+#include "RB3E_Network.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <vector>
+
+#define IMPAIR_DEFAULT_PORT        21070
+#define IMPAIR_DEFAULT_BURST_LEN   5
+#define IMPAIR_DEFAULT_REORDER_MS  20
+#define IMPAIR_DEFAULT_STATS_S     10
+#define IMPAIR_MAX_DATAGRAM        2048
+
+enum Direction {
+  DIR_UP   = 0,   // Sender to bridge
+  DIR_DOWN = 1,   // Bridge to sender
+};
+
+static const char* direction_names[] = { "up", "down" };
+
+struct ImpairConfig {
+  bool   enabled[ 2 ]  = { true, true };
+  double loss          = 0.0;   // Probabilities 0..1
+  double burst_start   = 0.0;
+  double burst_len     = IMPAIR_DEFAULT_BURST_LEN;
+  double delay_ms      = 0.0;
+  double jitter_ms     = 0.0;
+  double reorder       = 0.0;
+  double reorder_ms    = IMPAIR_DEFAULT_REORDER_MS;
+  double duplicate     = 0.0;
+  uint32_t seed        = 1;
+};
+
+struct ImpairStats {
+  uint64_t received;
+  uint64_t forwarded;
+  uint64_t lost_random;
+  uint64_t lost_burst;
+  uint64_t bursts;
+  uint64_t reordered;
+  uint64_t duplicated;
+};
+
+// One direction's impairment state
+struct ImpairChannel {
+  std::mt19937 rng;
+  bool         in_burst;
+  int64_t      last_release_ns;   // Keeps jittered packets in order
+  ImpairStats  stats;
+};
+
+struct PendingPacket {
+  int64_t              release_ns;
+  uint64_t             order;     // Tie breaker - FIFO for equal release times
+  Direction            dir;
+  std::vector<uint8_t> data;
+
+  bool operator>( const PendingPacket& other ) const {
+    return release_ns != other.release_ns ? release_ns > other.release_ns : order > other.order;
+  }
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal( int ) {
+  g_stop = 1;
+}
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static double Uniform( std::mt19937& rng ) {
+  return std::uniform_real_distribution<double>( 0.0, 1.0 )( rng );
+}
+
+static void PrintStats( const ImpairChannel* channels ) {
+  for( int d = 0; d < 2; d++ ) {
+    const ImpairStats& s = channels[ d ].stats;
+    std::cout << std::left << std::setw( 5 ) << direction_names[ d ] << std::right
+              << " received " << s.received
+              << "  forwarded " << s.forwarded
+              << "  lost " << s.lost_random << " random + " << s.lost_burst << " in " << s.bursts << " bursts"
+              << "  reordered " << s.reordered
+              << "  duplicated " << s.duplicated << std::endl;
+  }
+}
+
+static void Usage() {
+  std::cerr << "Usage: rb3e_impair <bridge_ip> [--listen N] [--bridge-port N] [--direction up|down|both]" << std::endl;
+  std::cerr << "                   [--loss P] [--burst-start P] [--burst-len N] [--delay MS] [--jitter MS]" << std::endl;
+  std::cerr << "                   [--reorder P] [--reorder-ms MS] [--duplicate P] [--seed N] [--log FILE] [--stats S]" << std::endl;
+}
+
+int main( int argc, char** argv ) {
+  std::string bridge_ip;
+  uint16_t listen_port = IMPAIR_DEFAULT_PORT;
+  uint16_t bridge_port = 0;
+  double stats_s = IMPAIR_DEFAULT_STATS_S;
+  std::string log_path;
+  ImpairConfig config;
+
+  for( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    bool has_value = ( i + 1 < argc );
+    if( arg == "--listen" && has_value ) {
+      listen_port = (uint16_t)atoi( argv[ ++i ] );
+    } else if( arg == "--bridge-port" && has_value ) {
+      bridge_port = (uint16_t)atoi( argv[ ++i ] );
+    } else if( arg == "--direction" && has_value ) {
+      std::string dir = argv[ ++i ];
+      config.enabled[ DIR_UP ] = ( dir == "up" || dir == "both" );
+      config.enabled[ DIR_DOWN ] = ( dir == "down" || dir == "both" );
+    } else if( arg == "--loss" && has_value ) {
+      config.loss = atof( argv[ ++i ] ) / 100.0;
+    } else if( arg == "--burst-start" && has_value ) {
+      config.burst_start = atof( argv[ ++i ] ) / 100.0;
+    } else if( arg == "--burst-len" && has_value ) {
+      config.burst_len = atof( argv[ ++i ] );
+    } else if( arg == "--delay" && has_value ) {
+      config.delay_ms = atof( argv[ ++i ] );
+    } else if( arg == "--jitter" && has_value ) {
+      config.jitter_ms = atof( argv[ ++i ] );
+    } else if( arg == "--reorder" && has_value ) {
+      config.reorder = atof( argv[ ++i ] ) / 100.0;
+    } else if( arg == "--reorder-ms" && has_value ) {
+      config.reorder_ms = atof( argv[ ++i ] );
+    } else if( arg == "--duplicate" && has_value ) {
+      config.duplicate = atof( argv[ ++i ] ) / 100.0;
+    } else if( arg == "--seed" && has_value ) {
+      config.seed = (uint32_t)strtoul( argv[ ++i ], NULL, 0 );
+    } else if( arg == "--log" && has_value ) {
+      log_path = argv[ ++i ];
+    } else if( arg == "--stats" && has_value ) {
+      stats_s = atof( argv[ ++i ] );
+    } else if( bridge_ip.empty() && arg[ 0 ] != '-' ) {
+      bridge_ip = arg;
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+
+  if( bridge_ip.empty() || config.burst_len < 1.0 ) {
+    Usage();
+    return 1;
+  }
+  if( bridge_port == 0 ) {
+    bridge_port = listen_port;
+  }
+
+  std::ofstream log;
+  if( !log_path.empty() ) {
+    log.open( log_path );
+    if( !log ) {
+      std::cerr << "Cannot write " << log_path << std::endl;
+      return 1;
+    }
+    log << "time_ms,dir,size,action,delay_ms" << std::endl;
+  }
+
+  // Sender side: bound to the listen port. Bridge side: ephemeral port, replies come back to it.
+  RB3E_Network client_side;
+  RB3E_Network bridge_side;
+  std::string any_source = "0.0.0.0";
+  if( !client_side.StartReceiver( any_source, listen_port ) || !bridge_side.StartSender( bridge_ip, bridge_port ) ) {
+    return 2;
+  }
+
+  signal( SIGINT, OnSignal );
+  signal( SIGTERM, OnSignal );
+
+  ImpairChannel channels[ 2 ];
+  for( int d = 0; d < 2; d++ ) {
+    channels[ d ].rng.seed( config.seed + d );
+    channels[ d ].in_burst = false;
+    channels[ d ].last_release_ns = 0;
+    channels[ d ].stats = ImpairStats();
+  }
+
+  std::priority_queue<PendingPacket, std::vector<PendingPacket>, std::greater<PendingPacket>> pending;
+  uint64_t order = 0;
+  struct sockaddr_in client_address;
+  bool have_client = false;
+
+  const int64_t start_ns = NowNs();
+  const int64_t stats_ns = (int64_t)( stats_s * 1e9 );
+  int64_t next_stats_ns = start_ns + stats_ns;
+
+  std::cout << "Proxying :" << listen_port << " -> " << bridge_ip << ":" << bridge_port
+            << " ( seed " << config.seed << " )" << std::endl;
+
+  uint8_t buffer[ IMPAIR_MAX_DATAGRAM ];
+
+  while( !g_stop ) {
+    int64_t now_ns = NowNs();
+
+    // Release everything due
+    while( !pending.empty() && pending.top().release_ns <= now_ns ) {
+      const PendingPacket& p = pending.top();
+      bool sent = ( p.dir == DIR_UP ) ? bridge_side.SendRaw( p.data.data(), p.data.size() )
+                                      : client_side.SendRawTo( p.data.data(), p.data.size(), client_address );
+      if( sent ) {
+        channels[ p.dir ].stats.forwarded++;
+      }
+      pending.pop();
+    }
+
+    if( stats_ns > 0 && now_ns >= next_stats_ns ) {
+      PrintStats( channels );
+      next_stats_ns += stats_ns;
+    }
+
+    // Sleep until the next release or traffic
+    int64_t wait_ns = 100000000;
+    if( !pending.empty() ) {
+      wait_ns = std::min( wait_ns, pending.top().release_ns - now_ns );
+    }
+    struct pollfd fds[ 2 ];
+    fds[ DIR_UP ].fd = client_side.GetSocket();
+    fds[ DIR_DOWN ].fd = bridge_side.GetSocket();
+    for( int d = 0; d < 2; d++ ) {
+      fds[ d ].events = POLLIN;
+      fds[ d ].revents = 0;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = wait_ns / 1000000000;
+    timeout.tv_nsec = wait_ns % 1000000000;
+    if( ppoll( fds, 2, &timeout, NULL ) <= 0 ) {
+      continue;
+    }
+
+    for( int d = 0; d < 2; d++ ) {
+      if( !( fds[ d ].revents & POLLIN ) ) {
+        continue;
+      }
+
+      Direction dir = (Direction)d;
+      struct sockaddr_in from;
+      RB3E_Network& socket = ( dir == DIR_UP ) ? client_side : bridge_side;
+      int received = socket.ReceiveRaw( buffer, sizeof( buffer ), 0, &from );
+      if( received <= 0 ) {
+        continue;
+      }
+      if( dir == DIR_UP ) {
+        client_address = from;
+        have_client = true;
+      } else if( !have_client ) {
+        continue;   // Nobody to reply to yet
+      }
+
+      ImpairChannel& ch = channels[ dir ];
+      ch.stats.received++;
+      int64_t arrival_ns = NowNs();
+      const char* action = "forward";
+      double delay_ms = 0.0;
+      int copies = 1;
+
+      if( config.enabled[ dir ] ) {
+        // Gilbert-Elliott: bursts start with burst_start and last burst_len packets on average
+        if( ch.in_burst ) {
+          if( Uniform( ch.rng ) < 1.0 / config.burst_len ) {
+            ch.in_burst = false;
+          }
+        } else if( config.burst_start > 0.0 && Uniform( ch.rng ) < config.burst_start ) {
+          ch.in_burst = true;
+          ch.stats.bursts++;
+        }
+
+        if( ch.in_burst ) {
+          action = "lost_burst";
+          ch.stats.lost_burst++;
+          copies = 0;
+        } else if( Uniform( ch.rng ) < config.loss ) {
+          action = "lost";
+          ch.stats.lost_random++;
+          copies = 0;
+        } else {
+          delay_ms = config.delay_ms + config.jitter_ms * Uniform( ch.rng );
+          if( Uniform( ch.rng ) < config.duplicate ) {
+            copies = 2;
+            action = "duplicate";
+            ch.stats.duplicated++;
+          }
+          if( Uniform( ch.rng ) < config.reorder ) {
+            delay_ms += config.reorder_ms;
+            action = ( copies == 2 ) ? "reorder_duplicate" : "reorder";
+            ch.stats.reordered++;
+          }
+        }
+      }
+
+      if( copies > 0 ) {
+        int64_t release_ns = arrival_ns + (int64_t)( delay_ms * 1e6 );
+        bool reordered = ( strncmp( action, "reorder", 7 ) == 0 );
+        if( !reordered ) {
+          // Jitter alone never reorders - WiFi delivers in order, just late
+          release_ns = std::max( release_ns, ch.last_release_ns );
+          ch.last_release_ns = release_ns;
+        }
+        for( int c = 0; c < copies; c++ ) {
+          PendingPacket p;
+          p.release_ns = release_ns;
+          p.order = order++;
+          p.dir = dir;
+          p.data.assign( buffer, buffer + received );
+          pending.push( p );
+        }
+        delay_ms = ( release_ns - arrival_ns ) / 1e6;
+      }
+
+      if( log.is_open() ) {
+        log << std::fixed << std::setprecision( 3 ) << ( arrival_ns - start_ns ) / 1e6 << ","
+            << direction_names[ dir ] << "," << received << "," << action << "," << delay_ms << "\n";
+      }
+    }
+  }
+
+  std::cout << std::endl;
+  PrintStats( channels );
+  return 0;
+}
@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""
+Write synthetic link-quality traces and run them through the emulator.
+
+Each scenario models what the bridge sees over WiFi during a session:
+RSSI read once a second, the active source's ALIVE packets, StageKit
+packets quantized to game frames, and a telemetry send every five
+seconds. Impairments drop, delay and fail some of them. Every scenario
+also states what the estimator must conclude (alert or not, roam or
+not), as "expect" lines the emulator checks - see emulator/emu_link.c
+for the format.
+
+Scenarios:
+    healthy       Strong signal, steady song - no alert ever
+    fading        Walking out of range - alert, then one roam scan
+    interference  Good RSSI but bursts of loss and delay - alert, no roam,
+                  recovers when the burst ends
+    console_off   Source stops sending, link fine - no alert
+    dead_ap       Access point dies - alert within seconds, roam scan soon after
+
+The traces are deterministic for a given --seed.
+
+Usage:
+    python rb3e_link_trace.py --out link_traces
+    python rb3e_link_trace.py --emulator build-tools/emulator/rb3e_emulator
+    python rb3e_link_trace.py --emulator build-tools/emulator/rb3e_emulator --scenario fading -v
+"""
+
+import argparse
+import random
+import subprocess
+import sys
+from pathlib import Path
+
+ALIVE_PERIOD_MS = 1000
+RSSI_PERIOD_MS = 1000
+TELEMETRY_PERIOD_MS = 5000
+FRAME_MS = 1000.0 / 60
+BEAT_MS = 125
+
+
+class Link:
+    """Impairments over time: each attribute is a function of t (ms)."""
+
+    def __init__(self, rssi=lambda t: -55, loss=lambda t: 0.0,
+                 delay_ms=lambda t: 0, send_fail=lambda t: 0.0,
+                 source=lambda t: True):
+        self.rssi = rssi
+        self.loss = loss
+        self.delay_ms = delay_ms
+        self.send_fail = send_fail
+        self.source = source
+
+
+def ramp(t, start, end, a, b):
+    """Linear from a at start to b at end, held outside."""
+    if t <= start:
+        return a
+    if t >= end:
+        return b
+    return a + (b - a) * (t - start) / (end - start)
+
+
+def window(start, end, value, otherwise=0):
+    return lambda t: value if start <= t < end else otherwise
+
+
+def generate(link, length_ms, rng):
+    """Return (ms, text) events for a session over the given link."""
+    events = []
+
+    for t in range(0, length_ms, RSSI_PERIOD_MS):
+        events.append((t, f"rssi {round(link.rssi(t) + rng.uniform(-2, 2))}"))
+
+    for t in range(0, length_ms, ALIVE_PERIOD_MS):
+        if link.source(t) and rng.random() >= link.loss(t):
+            arrival = t + rng.uniform(0, 5) + rng.uniform(0, link.delay_ms(t))
+            events.append((round(arrival), "alive"))
+
+    # A song: sixteenth notes with rests, sent on game frames
+    t = 0.0
+    while t < length_ms:
+        if link.source(t) and rng.random() < 0.85 and rng.random() >= link.loss(t):
+            frame = round(t / FRAME_MS) * FRAME_MS
+            arrival = frame + rng.uniform(0, 2) + rng.uniform(0, link.delay_ms(t))
+            events.append((round(arrival), "stagekit"))
+        t += BEAT_MS
+
+    for t in range(TELEMETRY_PERIOD_MS, length_ms, TELEMETRY_PERIOD_MS):
+        events.append((t, "send fail" if rng.random() < link.send_fail(t) else "send ok"))
+
+    return events
+
+
+def scenario_healthy(rng):
+    link = Link(rssi=lambda t: -55)
+    expects = [(t, "expect ok") for t in range(10000, 120001, 10000)]
+    expects += [(120000, "expect alerts 0"), (120000, "expect roams 0"),
+                (120000, "expect score 80 100")]
+    return generate(link, 120000, rng), expects
+
+
+def scenario_fading(rng):
+    # -55 dBm to -90 dBm between 30 s and 80 s; loss follows the signal down
+    def loss(t):
+        return ramp(t, 55000, 80000, 0.0, 0.7)
+
+    link = Link(rssi=lambda t: ramp(t, 30000, 80000, -55, -90), loss=loss,
+                delay_ms=lambda t: ramp(t, 55000, 80000, 0, 60),
+                send_fail=lambda t: ramp(t, 60000, 80000, 0.0, 0.8))
+    expects = [(25000, "expect ok"), (25000, "expect score 80 100"),
+               (90000, "expect alert"), (115000, "expect alerts 1"),
+               (115000, "expect roams 1")]
+    return generate(link, 115000, rng), expects
+
+
+def scenario_interference(rng):
+    link = Link(rssi=lambda t: -58,
+                loss=window(40000, 70000, 0.5),
+                delay_ms=window(40000, 70000, 80),
+                send_fail=window(40000, 70000, 0.5))
+    expects = [(35000, "expect ok"), (72000, "expect alerts 1"),
+               (100000, "expect ok"), (100000, "expect alerts 1"),
+               (100000, "expect roams 0")]
+    return generate(link, 100000, rng), expects
+
+
+def scenario_console_off(rng):
+    link = Link(rssi=lambda t: -57, source=lambda t: t < 30000)
+    expects = [(t, "expect ok") for t in (25000, 31000, 33000, 35000, 40000, 50000, 60000)]
+    expects += [(60000, "expect alerts 0")]
+    return generate(link, 60000, rng), expects
+
+
+def scenario_dead_ap(rng):
+    dead = 40000
+    link = Link(rssi=lambda t: -55 if t < dead else -92,
+                loss=lambda t: 0.0 if t < dead else 1.0,
+                send_fail=lambda t: 0.0 if t < dead else 1.0)
+    expects = [(dead - 1000, "expect ok"), (dead + 8000, "expect alert"),
+               (dead + 20000, "expect roams 1")]
+    return generate(link, dead + 20000, rng), expects
+
+
+SCENARIOS = {
+    'healthy': scenario_healthy,
+    'fading': scenario_fading,
+    'interference': scenario_interference,
+    'console_off': scenario_console_off,
+    'dead_ap': scenario_dead_ap,
+}
+
+
+def write_trace(path, name, events, expects):
+    # Expectations sort after the events at the same time
+    lines = sorted(events, key=lambda e: e[0])
+    merged = sorted([(t, 0, text) for t, text in lines] +
+                    [(t, 1, text) for t, text in expects])
+    with open(path, 'w') as f:
+        f.write(f"# rb3e_link_trace.py scenario: {name}\n")
+        for t, _, text in merged:
+            f.write(f"{t} {text}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Generate synthetic link-quality traces and check the estimator',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__.split('Usage:')[0])
+    parser.add_argument('--out', default='link_traces',
+                        help='Directory for the trace files (default link_traces)')
+    parser.add_argument('--scenario', action='append', choices=sorted(SCENARIOS),
+                        help='Only this scenario (repeatable; default all)')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed (default 1)')
+    parser.add_argument('--emulator', help='rb3e_emulator binary: run each trace with --link-trace')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='Show the emulator output, not just the result')
+    args = parser.parse_args()
+
+    out = Path(args.out)
+    out.mkdir(parents=True, exist_ok=True)
+    names = args.scenario or list(SCENARIOS)
+
+    failed = []
+    for name in names:
+        rng = random.Random(f"{args.seed}:{name}")
+        events, expects = SCENARIOS[name](rng)
+        path = out / f"{name}.trace"
+        write_trace(path, name, events, expects)
+
+        if not args.emulator:
+            print(f"{path}: {len(events)} events, {len(expects)} expectations")
+            continue
+
+        result = subprocess.run([args.emulator, '--link-trace', str(path)],
+                                capture_output=True, text=True)
+        if args.verbose or result.returncode != 0:
+            sys.stdout.write(result.stdout)
+            sys.stderr.write(result.stderr)
+        status = {0: 'PASS', 1: 'FAIL'}.get(result.returncode, 'ERROR')
+        print(f"{name:14s} {status}")
+        if result.returncode != 0:
+            failed.append(name)
+
+    if failed:
+        print(f"{len(failed)} of {len(names)} scenarios failed: {', '.join(failed)}")
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
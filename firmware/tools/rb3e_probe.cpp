@@ -0,0 +1,369 @@
+// rb3e_probe - WiFi latency qualification against a bridge ( port 21071 )
+//
+// Usage: rb3e_probe <bridge_ip> [options]
+//
+//   --port N          Control port ( default 21071 )
+//   --rate HZ         Probes per second ( default 50 )
+//   --duration S      Run time in seconds, 0 = until interrupted ( default 60 )
+//   --interval S      Report interval in seconds ( default 5 )
+//   --size BYTES      Extra padding per probe, to test larger packets ( default 0 )
+//   --timeout MS      Reply deadline before a probe counts as lost ( default 1000 )
+//   --realtime        Receive with RB3E_Network real-time mode ( SCHED_FIFO, mlockall, busy poll )
+//   --cpu N           CPU to pin to in real-time mode
+//
+// Reply times are kernel arrival times where the kernel provides them, so time a
+// reply spent queued on this host is left out ( and shown as its own histogram ).
+// Jitter is the mean change in RTT between consecutive replies ( as in RFC 3550 ).
+// Run once with and once without --realtime to see what the host contributes.
+//
+// The bridge stamps each probe when its receive callback runs and again just
+// before the reply is sent. Round trip minus that bridge time is the WiFi part.
+// One-way times assume the fastest round trip in each interval was symmetric,
+// which also cancels the drift between the host and bridge clocks.
+
+#include "RB3E_Network.h"
+#include "control_protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#define PROBE_DEFAULT_PORT     21071
+#define PROBE_DEFAULT_RATE     50
+#define PROBE_DEFAULT_DURATION 60
+#define PROBE_DEFAULT_INTERVAL 5
+#define PROBE_DEFAULT_TIMEOUT  1000
+
+struct ProbeRecord {
+  int64_t  send_ns;
+  int64_t  recv_ns;      // 0 = no reply ( yet )
+  uint64_t bridge_rx_us;
+  uint64_t bridge_tx_us;
+};
+
+struct ProbeSummary {
+  size_t              sent;
+  size_t              lost;
+  std::vector<double> rtt_ms;
+  std::vector<double> wifi_ms;    // RTT minus bridge processing
+  std::vector<double> up_ms;      // Host to bridge
+  std::vector<double> down_ms;    // Bridge to host
+  double              jitter_ms;
+  double              bridge_max_us;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal( int ) {
+  g_stop = 1;
+}
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static double Percentile( std::vector<double> values, double pct ) {
+  if( values.empty() ) {
+    return 0.0;
+  }
+  std::sort( values.begin(), values.end() );
+  size_t index = (size_t)( pct / 100.0 * ( values.size() - 1 ) + 0.5 );
+  return values[ std::min( index, values.size() - 1 ) ];
+}
+
+// Summarize probes [first, last) - all of them are resolved ( answered or past the deadline )
+static ProbeSummary Summarize( const std::vector<ProbeRecord>& probes, size_t first, size_t last ) {
+  ProbeSummary summary = {};
+  summary.sent = last - first;
+
+  // Clock offset ( bridge - host ) from the fastest exchange
+  double offset_us = 0.0;
+  double best_rtt_ns = -1.0;
+  for( size_t i = first; i < last; i++ ) {
+    const ProbeRecord& p = probes[ i ];
+    if( p.recv_ns == 0 ) {
+      continue;
+    }
+    double rtt_ns = (double)( p.recv_ns - p.send_ns );
+    if( best_rtt_ns < 0.0 || rtt_ns < best_rtt_ns ) {
+      best_rtt_ns = rtt_ns;
+      offset_us = ( ( (double)p.bridge_rx_us - p.send_ns / 1000.0 ) +
+                    ( (double)p.bridge_tx_us - p.recv_ns / 1000.0 ) ) / 2.0;
+    }
+  }
+
+  double last_rtt_ms = -1.0;
+  double jitter_sum_ms = 0.0;
+  size_t jitter_count = 0;
+
+  for( size_t i = first; i < last; i++ ) {
+    const ProbeRecord& p = probes[ i ];
+    if( p.recv_ns == 0 ) {
+      summary.lost++;
+      continue;
+    }
+    double bridge_us = (double)( p.bridge_tx_us - p.bridge_rx_us );
+    double rtt_ms = ( p.recv_ns - p.send_ns ) / 1e6;
+    summary.rtt_ms.push_back( rtt_ms );
+    summary.wifi_ms.push_back( rtt_ms - bridge_us / 1000.0 );
+    summary.up_ms.push_back( ( p.bridge_rx_us - offset_us - p.send_ns / 1000.0 ) / 1000.0 );
+    summary.down_ms.push_back( ( p.recv_ns / 1000.0 - ( p.bridge_tx_us - offset_us ) ) / 1000.0 );
+    summary.bridge_max_us = std::max( summary.bridge_max_us, bridge_us );
+
+    if( last_rtt_ms >= 0.0 ) {
+      jitter_sum_ms += std::fabs( rtt_ms - last_rtt_ms );
+      jitter_count++;
+    }
+    last_rtt_ms = rtt_ms;
+  }
+
+  summary.jitter_ms = jitter_count ? jitter_sum_ms / jitter_count : 0.0;
+
+  return summary;
+}
+
+static void PrintIntervalHeader() {
+  std::cout << "  time    sent  lost%   rtt min    p50    p95    p99    max  jitter  |  up p50    p95  down p50    p95  | bridge max"
+            << std::endl;
+}
+
+static void PrintInterval( double t_s, const ProbeSummary& s ) {
+  std::cout << std::fixed << std::setprecision( 1 )
+            << std::setw( 6 ) << t_s << "s "
+            << std::setw( 6 ) << s.sent << " "
+            << std::setw( 5 ) << ( s.sent ? 100.0 * s.lost / s.sent : 0.0 ) << "  "
+            << std::setprecision( 2 )
+            << std::setw( 8 ) << Percentile( s.rtt_ms, 0 ) << " "
+            << std::setw( 6 ) << Percentile( s.rtt_ms, 50 ) << " "
+            << std::setw( 6 ) << Percentile( s.rtt_ms, 95 ) << " "
+            << std::setw( 6 ) << Percentile( s.rtt_ms, 99 ) << " "
+            << std::setw( 6 ) << Percentile( s.rtt_ms, 100 ) << " "
+            << std::setw( 7 ) << s.jitter_ms << "  | "
+            << std::setw( 7 ) << Percentile( s.up_ms, 50 ) << " "
+            << std::setw( 6 ) << Percentile( s.up_ms, 95 ) << " "
+            << std::setw( 9 ) << Percentile( s.down_ms, 50 ) << " "
+            << std::setw( 6 ) << Percentile( s.down_ms, 95 ) << "  | "
+            << std::setprecision( 0 ) << std::setw( 7 ) << s.bridge_max_us << " us"
+            << std::endl;
+}
+
+static void PrintHistogram( const std::vector<double>& rtt_ms ) {
+  static const double edges_ms[] = { 2, 5, 10, 20, 50, 100, 200, 500 };
+  const size_t bucket_count = sizeof( edges_ms ) / sizeof( edges_ms[ 0 ] ) + 1;
+  size_t buckets[ bucket_count ] = {};
+
+  for( double v : rtt_ms ) {
+    size_t b = 0;
+    while( b < bucket_count - 1 && v >= edges_ms[ b ] ) {
+      b++;
+    }
+    buckets[ b ]++;
+  }
+
+  std::cout << "RTT distribution:" << std::endl;
+  for( size_t b = 0; b < bucket_count; b++ ) {
+    double lo = ( b == 0 ) ? 0.0 : edges_ms[ b - 1 ];
+    std::ostringstream label;
+    if( b < bucket_count - 1 ) {
+      label << lo << "-" << edges_ms[ b ] << " ms";
+    } else {
+      label << ">= " << lo << " ms";
+    }
+    double pct = rtt_ms.empty() ? 0.0 : 100.0 * buckets[ b ] / rtt_ms.size();
+    std::cout << "  " << std::left << std::setw( 12 ) << label.str() << std::right
+              << std::setw( 8 ) << buckets[ b ] << " "
+              << std::fixed << std::setprecision( 1 ) << std::setw( 6 ) << pct << "%  "
+              << std::string( (size_t)( pct / 2 ), '#' ) << std::endl;
+  }
+}
+
+static void Usage() {
+  std::cerr << "Usage: rb3e_probe <bridge_ip> [--port N] [--rate HZ] [--duration S] [--interval S]"
+            << " [--size BYTES] [--timeout MS] [--realtime [--cpu N]]" << std::endl;
+}
+
+int main( int argc, char** argv ) {
+  std::string bridge_ip;
+  uint16_t port = PROBE_DEFAULT_PORT;
+  double rate_hz = PROBE_DEFAULT_RATE;
+  double duration_s = PROBE_DEFAULT_DURATION;
+  double interval_s = PROBE_DEFAULT_INTERVAL;
+  size_t padding = 0;
+  int timeout_ms = PROBE_DEFAULT_TIMEOUT;
+  bool realtime = false;
+  RB3E_RealtimeConfig realtime_config;
+
+  for( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    bool has_value = ( i + 1 < argc );
+    if( arg == "--port" && has_value ) {
+      port = (uint16_t)atoi( argv[ ++i ] );
+    } else if( arg == "--rate" && has_value ) {
+      rate_hz = atof( argv[ ++i ] );
+    } else if( arg == "--duration" && has_value ) {
+      duration_s = atof( argv[ ++i ] );
+    } else if( arg == "--interval" && has_value ) {
+      interval_s = atof( argv[ ++i ] );
+    } else if( arg == "--size" && has_value ) {
+      padding = (size_t)atoi( argv[ ++i ] );
+    } else if( arg == "--timeout" && has_value ) {
+      timeout_ms = atoi( argv[ ++i ] );
+    } else if( arg == "--realtime" ) {
+      realtime = true;
+    } else if( arg == "--cpu" && has_value ) {
+      realtime_config.cpu = atoi( argv[ ++i ] );
+    } else if( bridge_ip.empty() && arg[ 0 ] != '-' ) {
+      bridge_ip = arg;
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+
+  if( bridge_ip.empty() || rate_hz <= 0.0 || interval_s <= 0.0 || timeout_ms <= 0 ||
+      padding > CTRL_MAX_PAYLOAD - sizeof( ctrl_probe_t ) ) {
+    Usage();
+    return 1;
+  }
+
+  RB3E_Network net;
+  if( !net.StartSender( bridge_ip, port ) ) {
+    return 2;
+  }
+
+  // Everything below runs on this thread, so it is the receive thread
+  if( realtime && !net.EnableRealtime( realtime_config ) ) {
+    std::cerr << "Real-time mode only partly enabled ( run as root or grant CAP_SYS_NICE / CAP_IPC_LOCK )." << std::endl;
+  }
+
+  signal( SIGINT, OnSignal );
+
+  const int64_t period_ns = (int64_t)( 1e9 / rate_hz );
+  const int64_t interval_ns = (int64_t)( interval_s * 1e9 );
+  const int64_t timeout_ns = (int64_t)timeout_ms * 1000000;
+  const int64_t start_ns = NowNs();
+  const int64_t end_ns = ( duration_s > 0.0 ) ? start_ns + (int64_t)( duration_s * 1e9 ) : INT64_MAX;
+
+  std::vector<ProbeRecord> probes;
+  std::vector<uint8_t> request( sizeof( ctrl_header_t ) + sizeof( ctrl_probe_t ) + padding, 0 );
+  uint8_t reply[ sizeof( ctrl_header_t ) + CTRL_MAX_PAYLOAD ];
+
+  int64_t next_send_ns = start_ns;
+  size_t reported = 0;          // Probes already included in an interval report
+  int64_t interval_end_ns = start_ns + interval_ns;
+  size_t late = 0;
+
+  std::cout << "Probing " << bridge_ip << ":" << port << " at " << rate_hz << " Hz, "
+            << request.size() << " byte packets, "
+            << ( net.IsRealtime() ? "real-time" : "normal" ) << " mode" << std::endl;
+  PrintIntervalHeader();
+
+  while( true ) {
+    int64_t now_ns = NowNs();
+    bool sending = ( !g_stop && now_ns < end_ns );
+
+    if( sending && now_ns >= next_send_ns ) {
+      ProbeRecord record = {};
+      record.send_ns = NowNs();
+
+      ctrl_probe_t probe = {};
+      probe.probe_id = (uint32_t)probes.size();
+      probe.host_send_ns = (uint64_t)record.send_ns;
+      ctrl_build_header( (ctrl_header_t*)request.data(), CTRL_MSG_PROBE, (uint16_t)probe.probe_id, 0,
+                         (uint16_t)( request.size() - sizeof( ctrl_header_t ) ) );
+      memcpy( request.data() + sizeof( ctrl_header_t ), &probe, sizeof( probe ) );
+
+      probes.push_back( record );
+      if( !net.SendRaw( request.data(), request.size() ) ) {
+        std::cerr << "Send failed." << std::endl;
+      }
+
+      // Fixed schedule - a slow iteration does not shift later probes
+      next_send_ns += period_ns;
+      if( next_send_ns < now_ns ) {
+        next_send_ns = now_ns + period_ns;
+      }
+    }
+
+    // Report each interval once every probe in it is answered or past its deadline
+    while( reported < probes.size() &&
+           ( now_ns >= interval_end_ns + timeout_ns || ( !sending && now_ns >= probes.back().send_ns + timeout_ns ) ) ) {
+      size_t last = reported;
+      while( last < probes.size() && probes[ last ].send_ns < interval_end_ns ) {
+        last++;
+      }
+      if( last > reported ) {
+        PrintInterval( ( interval_end_ns - start_ns ) / 1e9, Summarize( probes, reported, last ) );
+      }
+      reported = last;
+      interval_end_ns += interval_ns;
+    }
+
+    if( !sending && reported == probes.size() ) {
+      break;
+    }
+
+    int64_t wait_ns = sending ? next_send_ns - NowNs() : 10000000;
+    int wait_ms = (int)std::max<int64_t>( 0, wait_ns / 1000000 );
+    int received = net.ReceiveRaw( reply, sizeof( reply ), wait_ms );
+    if( received <= 0 ) {
+      continue;
+    }
+
+    // Use the kernel arrival time - time spent queued in our socket is host delay, not WiFi
+    int64_t recv_ns = NowNs() - net.GetQueueDelayNs();
+    const ctrl_header_t* hdr = (const ctrl_header_t*)reply;
+    if( !ctrl_check_header( reply, received ) || hdr->msg_id != ( CTRL_MSG_PROBE | CTRL_MSG_RESPONSE ) ||
+        hdr->length < sizeof( ctrl_probe_t ) ) {
+      continue;
+    }
+
+    ctrl_probe_t probe;
+    memcpy( &probe, reply + sizeof( ctrl_header_t ), sizeof( probe ) );
+    if( probe.probe_id >= probes.size() ) {
+      continue;
+    }
+
+    ProbeRecord& record = probes[ probe.probe_id ];
+    if( record.recv_ns != 0 ) {
+      continue;   // Duplicate
+    }
+    if( recv_ns - record.send_ns > timeout_ns ) {
+      late++;     // Already counted as lost
+      continue;
+    }
+    record.recv_ns = recv_ns;
+    record.bridge_rx_us = probe.bridge_rx_us;
+    record.bridge_tx_us = probe.bridge_tx_us;
+  }
+
+  net.Stop();
+
+  if( probes.empty() ) {
+    return 0;
+  }
+
+  ProbeSummary total = Summarize( probes, 0, probes.size() );
+  std::cout << std::endl << "Total: " << total.sent << " sent, " << total.lost << " lost ( "
+            << std::fixed << std::setprecision( 2 ) << 100.0 * total.lost / total.sent << "% ), "
+            << late << " late replies" << std::endl;
+  std::cout << "RTT ms   : min " << Percentile( total.rtt_ms, 0 )
+            << "  p50 " << Percentile( total.rtt_ms, 50 )
+            << "  p95 " << Percentile( total.rtt_ms, 95 )
+            << "  p99 " << Percentile( total.rtt_ms, 99 )
+            << "  max " << Percentile( total.rtt_ms, 100 ) << std::endl;
+  std::cout << "Jitter ms: " << total.jitter_ms << " ( " << ( net.IsRealtime() ? "real-time" : "normal" )
+            << " mode )" << std::endl;
+  std::cout << "WiFi ms  : p50 " << Percentile( total.wifi_ms, 50 )
+            << "  p99 " << Percentile( total.wifi_ms, 99 )
+            << "  ( bridge processing max " << std::setprecision( 0 ) << total.bridge_max_us << " us )" << std::endl;
+  PrintHistogram( total.rtt_ms );
+  net.DumpQueueDelayHistogram();
+
+  return ( total.lost == total.sent ) ? 3 : 0;
+}
@@ -0,0 +1,399 @@
+// rb3e_relay - Fan RB3E events from one console out to many listeners
+//
+// Usage: rb3e_relay [options] --to DEST [--to DEST ...]
+//
+// The console sends to this host; every event is forwarded to each destination
+// whose filter accepts it. Datagrams are forwarded unchanged, so bridges,
+// dashboards and recorders see exactly what the console sent ( from this host ).
+//
+//   --listen N        Local port the console sends to ( default 21070 )
+//   --source IP       Only relay events from this console
+//   --to DEST         Add a destination ( repeatable )
+//   --config FILE     Destinations, one DEST per line ( '#' starts a comment )
+//   --stats S         Print counters every S seconds ( default 10, 0 = only at exit )
+//   --realtime        Receive with RB3E_Network real-time mode ( SCHED_FIFO, mlockall, busy poll )
+//   --cpu N           CPU to pin to in real-time mode
+//
+// DEST is ip[:port][/types][@rate]
+//   port              Default 21070
+//   types             Comma separated: all, alive, state, song, score, stagekit, band, scene
+//                     ( song = name, artist and shortname; default all )
+//   rate              Most events per second to this destination ( token bucket, default unlimited )
+//
+//   rb3e_relay --to 192.168.1.50/stagekit,scene --to 192.168.1.20:21070/song,state,score@20
+//
+// Everything that arrives together is sent together: one receive drains the
+// socket, then every copy for every destination goes out through
+// RB3E_Network::SendRawBatch ( sendmmsg ), in arrival order per destination.
+
+#include "RB3E_Network.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#define RELAY_DEFAULT_LISTEN   21070
+#define RELAY_DEFAULT_PORT     21070
+#define RELAY_DEFAULT_STATS_S  10
+#define RELAY_MAX_DATAGRAM     2048
+#define RELAY_RECEIVE_BATCH    32       // Datagrams drained per wakeup
+#define RELAY_BURST_S          0.1      // Token bucket depth, in seconds of rate
+
+struct DestinationStats {
+  uint64_t forwarded;
+  uint64_t filtered;
+  uint64_t limited;
+  uint64_t failed;
+};
+
+struct Destination {
+  std::string        spec;
+  struct sockaddr_in address;
+  std::bitset<256>   types;
+  double             rate_hz;           // 0 = unlimited
+  double             tokens;
+  int64_t            refill_ns;
+  DestinationStats   stats;
+};
+
+struct RelayStats {
+  uint64_t received;
+  uint64_t invalid;                     // Not an RB3E event
+  uint64_t wrong_source;
+  uint64_t batches;
+  uint64_t sent;
+};
+
+struct EventGroup {
+  const char*          name;
+  std::vector<uint8_t> types;
+};
+
+static const EventGroup event_groups[] = {
+  { "alive",    { RB3E_EVENT_ALIVE } },
+  { "state",    { RB3E_EVENT_STATE } },
+  { "song",     { RB3E_EVENT_SONG_NAME, RB3E_EVENT_SONG_ARTIST, RB3E_EVENT_SONG_SHORTNAME } },
+  { "score",    { RB3E_EVENT_SCORE } },
+  { "stagekit", { RB3E_EVENT_STAGEKIT } },
+  { "band",     { RB3E_EVENT_BAND_INFO } },
+  { "scene",    { RB3E_EVENT_SCENE } },
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal( int ) {
+  g_stop = 1;
+}
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static bool ParseTypes( const std::string& text, std::bitset<256>& types ) {
+  std::istringstream list( text );
+  std::string name;
+  while( std::getline( list, name, ',' ) ) {
+    if( name == "all" ) {
+      types.set();
+      continue;
+    }
+    bool found = false;
+    for( const EventGroup& group : event_groups ) {
+      if( name == group.name ) {
+        for( uint8_t type : group.types ) {
+          types.set( type );
+        }
+        found = true;
+      }
+    }
+    if( !found ) {
+      return false;
+    }
+  }
+  return types.any();
+}
+
+// ip[:port][/types][@rate]
+static bool ParseDestination( const std::string& spec, Destination& dest ) {
+  std::string address = spec;
+  std::string types = "all";
+  double rate_hz = 0.0;
+
+  size_t at = address.find( '@' );
+  if( at != std::string::npos ) {
+    rate_hz = atof( address.c_str() + at + 1 );
+    if( rate_hz <= 0.0 ) {
+      return false;
+    }
+    address.erase( at );
+  }
+
+  size_t slash = address.find( '/' );
+  if( slash != std::string::npos ) {
+    types = address.substr( slash + 1 );
+    address.erase( slash );
+  }
+
+  uint16_t port = RELAY_DEFAULT_PORT;
+  size_t colon = address.find( ':' );
+  if( colon != std::string::npos ) {
+    port = (uint16_t)atoi( address.c_str() + colon + 1 );
+    address.erase( colon );
+  }
+
+  dest = Destination();
+  dest.spec = spec;
+  dest.address.sin_family = AF_INET;
+  dest.address.sin_port = htons( port );
+  if( port == 0 || inet_pton( AF_INET, address.c_str(), &dest.address.sin_addr ) != 1 ) {
+    return false;
+  }
+  if( !ParseTypes( types, dest.types ) ) {
+    return false;
+  }
+
+  dest.rate_hz = rate_hz;
+  dest.tokens = std::max( 1.0, rate_hz * RELAY_BURST_S );
+  dest.refill_ns = NowNs();
+  return true;
+}
+
+static bool LoadConfig( const std::string& path, std::vector<Destination>& destinations ) {
+  std::ifstream file( path );
+  if( !file ) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while( std::getline( file, line ) ) {
+    line_number++;
+    size_t comment = line.find( '#' );
+    if( comment != std::string::npos ) {
+      line.erase( comment );
+    }
+
+    std::istringstream fields( line );
+    std::string spec;
+    if( !( fields >> spec ) ) {
+      continue;  // Blank line
+    }
+
+    Destination dest;
+    if( !ParseDestination( spec, dest ) ) {
+      std::cerr << path << ":" << line_number << ": bad destination '" << spec << "'" << std::endl;
+      return false;
+    }
+    destinations.push_back( dest );
+  }
+  return true;
+}
+
+// Token bucket - refills at rate_hz, holds RELAY_BURST_S worth
+static bool TakeToken( Destination& dest, int64_t now_ns ) {
+  if( dest.rate_hz <= 0.0 ) {
+    return true;
+  }
+
+  double depth = std::max( 1.0, dest.rate_hz * RELAY_BURST_S );
+  dest.tokens = std::min( depth, dest.tokens + ( now_ns - dest.refill_ns ) * 1e-9 * dest.rate_hz );
+  dest.refill_ns = now_ns;
+
+  if( dest.tokens < 1.0 ) {
+    return false;
+  }
+  dest.tokens -= 1.0;
+  return true;
+}
+
+static void PrintStats( const RelayStats& relay, const std::vector<Destination>& destinations ) {
+  std::cout << "received " << relay.received
+            << "  invalid " << relay.invalid
+            << "  wrong source " << relay.wrong_source
+            << "  sent " << relay.sent;
+  if( relay.batches > 0 ) {
+    std::cout << "  ( " << std::fixed << std::setprecision( 1 ) << (double)relay.sent / relay.batches
+              << " per batch )";
+  }
+  std::cout << std::endl;
+
+  for( const Destination& dest : destinations ) {
+    const DestinationStats& s = dest.stats;
+    std::cout << "  " << std::left << std::setw( 40 ) << dest.spec << std::right
+              << " forwarded " << s.forwarded
+              << "  filtered " << s.filtered
+              << "  rate limited " << s.limited
+              << "  failed " << s.failed << std::endl;
+  }
+}
+
+static void Usage() {
+  std::cerr << "Usage: rb3e_relay [--listen N] [--source IP] [--to DEST ...] [--config FILE] [--stats S]" << std::endl;
+  std::cerr << "                  [--realtime [--cpu N]]" << std::endl;
+  std::cerr << "  DEST = ip[:port][/types][@rate], types = all,alive,state,song,score,stagekit,band,scene" << std::endl;
+}
+
+int main( int argc, char** argv ) {
+  uint16_t listen_port = RELAY_DEFAULT_LISTEN;
+  std::string source_ip;
+  double stats_s = RELAY_DEFAULT_STATS_S;
+  bool realtime = false;
+  RB3E_RealtimeConfig realtime_config;
+  std::vector<Destination> destinations;
+
+  for( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    bool has_value = ( i + 1 < argc );
+    if( arg == "--listen" && has_value ) {
+      listen_port = (uint16_t)atoi( argv[ ++i ] );
+    } else if( arg == "--source" && has_value ) {
+      source_ip = argv[ ++i ];
+    } else if( arg == "--to" && has_value ) {
+      Destination dest;
+      if( !ParseDestination( argv[ ++i ], dest ) ) {
+        std::cerr << "Bad destination '" << argv[ i ] << "'" << std::endl;
+        Usage();
+        return 1;
+      }
+      destinations.push_back( dest );
+    } else if( arg == "--config" && has_value ) {
+      if( !LoadConfig( argv[ ++i ], destinations ) ) {
+        return 1;
+      }
+    } else if( arg == "--stats" && has_value ) {
+      stats_s = atof( argv[ ++i ] );
+    } else if( arg == "--realtime" ) {
+      realtime = true;
+    } else if( arg == "--cpu" && has_value ) {
+      realtime_config.cpu = atoi( argv[ ++i ] );
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+
+  if( destinations.empty() ) {
+    Usage();
+    return 1;
+  }
+
+  struct in_addr source_address = { 0 };
+  if( !source_ip.empty() && inet_pton( AF_INET, source_ip.c_str(), &source_address ) != 1 ) {
+    Usage();
+    return 1;
+  }
+
+  // Receive on the listen port; send from a second socket so a full send
+  // buffer blocks instead of dropping. "0.0.0.0" enables SO_BROADCAST, so a
+  // destination may be a broadcast address.
+  RB3E_Network receiver;
+  RB3E_Network sender;
+  std::string any_address = "0.0.0.0";
+  if( !receiver.StartReceiver( any_address, listen_port ) || !sender.StartSender( any_address, RELAY_DEFAULT_PORT ) ) {
+    return 2;
+  }
+
+  // Everything below runs on this thread, so it is the receive thread
+  if( realtime && !receiver.EnableRealtime( realtime_config ) ) {
+    std::cerr << "Real-time mode only partly enabled ( run as root or grant CAP_SYS_NICE / CAP_IPC_LOCK )." << std::endl;
+  }
+
+  signal( SIGINT, OnSignal );
+  signal( SIGTERM, OnSignal );
+
+  std::cout << "Relaying :" << listen_port << " to " << destinations.size() << " destination(s)" << std::endl;
+
+  // Sized once - nothing is allocated per packet
+  static uint8_t buffers[ RELAY_RECEIVE_BATCH ][ RELAY_MAX_DATAGRAM ];
+  int lengths[ RELAY_RECEIVE_BATCH ];
+  std::vector<RB3E_Datagram> batch;
+  std::vector<size_t> batch_owner;
+  batch.reserve( RELAY_RECEIVE_BATCH * destinations.size() );
+  batch_owner.reserve( RELAY_RECEIVE_BATCH * destinations.size() );
+
+  RelayStats relay = RelayStats();
+  const int64_t stats_ns = (int64_t)( stats_s * 1e9 );
+  int64_t next_stats_ns = NowNs() + stats_ns;
+
+  while( !g_stop ) {
+    if( stats_ns > 0 && NowNs() >= next_stats_ns ) {
+      PrintStats( relay, destinations );
+      next_stats_ns += stats_ns;
+    }
+
+    // Wait for the first datagram, then take whatever else is already queued
+    int count = 0;
+    while( count < RELAY_RECEIVE_BATCH ) {
+      struct sockaddr_in from;
+      int received = receiver.ReceiveRaw( buffers[ count ], RELAY_MAX_DATAGRAM, count == 0 ? 100 : 0, &from );
+      if( received <= 0 ) {
+        break;
+      }
+      relay.received++;
+
+      if( source_address.s_addr != 0 && from.sin_addr.s_addr != source_address.s_addr ) {
+        relay.wrong_source++;
+        continue;
+      }
+      const RB3E_EventHeader* header = (const RB3E_EventHeader*)buffers[ count ];
+      if( received < (int)sizeof( RB3E_EventHeader ) ||
+          ntohl( header->ProtocolMagic ) != RB3E_NETWORK_MAGICKEY ) {
+        relay.invalid++;
+        continue;
+      }
+      lengths[ count++ ] = received;
+    }
+    if( count == 0 ) {
+      continue;
+    }
+
+    // Datagram-major, so each destination sees events in arrival order
+    int64_t now_ns = NowNs();
+    batch.clear();
+    batch_owner.clear();
+    for( int p = 0; p < count; p++ ) {
+      uint8_t type = ( (const RB3E_EventHeader*)buffers[ p ] )->PacketType;
+      for( size_t d = 0; d < destinations.size(); d++ ) {
+        Destination& dest = destinations[ d ];
+        if( !dest.types.test( type ) ) {
+          dest.stats.filtered++;
+          continue;
+        }
+        if( !TakeToken( dest, now_ns ) ) {
+          dest.stats.limited++;
+          continue;
+        }
+
+        RB3E_Datagram datagram;
+        datagram.data = buffers[ p ];
+        datagram.length = lengths[ p ];
+        datagram.target = dest.address;
+        batch.push_back( datagram );
+        batch_owner.push_back( d );
+      }
+    }
+
+    if( batch.empty() ) {
+      continue;
+    }
+
+    relay.sent += sender.SendRawBatch( batch.data(), batch.size() );
+    relay.batches++;
+    for( size_t i = 0; i < batch.size(); i++ ) {
+      DestinationStats& s = destinations[ batch_owner[ i ] ].stats;
+      if( batch[ i ].sent ) {
+        s.forwarded++;
+      } else {
+        s.failed++;
+      }
+    }
+  }
+
+  std::cout << std::endl;
+  PrintStats( relay, destinations );
+  return 0;
+}
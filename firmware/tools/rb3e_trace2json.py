@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Convert RB3E StageKit Bridge trace dumps to Chrome Trace / Perfetto JSON.
+
+Dumps come from the bridge (rb3e_ctl trace dump <file>) or the Linux
+emulator (rb3e_emulator --trace <file>). Each dump becomes one process
+in the timeline with a thread per track (main loop, network, USB,
+timers, flash). Open the output in https://ui.perfetto.dev or
+chrome://tracing.
+
+Usage:
+    python rb3e_trace2json.py bridge.rb3t -o bridge.json
+    python rb3e_trace2json.py stage-left.rb3t stage-right.rb3t -o show.json
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+from pathlib import Path
+
+# Dump layout (must match ctrl_trace_file_t / ctrl_trace_event_t in control_protocol.h)
+FILE_MAGIC = b'RB3T'
+FILE_VERSION = 1
+FILE_HEADER = struct.Struct('<4sHHII')     # magic, version, names_length, count, overwritten
+EVENT = struct.Struct('<IBBBBI')            # time_us, type, track, name, reserved, arg
+
+TYPE_BEGIN = ord('B')
+TYPE_END = ord('E')
+TYPE_INSTANT = ord('i')
+TYPE_COUNTER = ord('C')
+
+
+def decode_weights(arg: int) -> dict:
+    return {'left': f'0x{(arg >> 8) & 0xFF:02x}', 'right': f'0x{arg & 0xFF:02x}'}
+
+
+def decode_addr(arg: int) -> dict:
+    # Stored in network byte order as read on a little-endian CPU
+    return {'source': socket.inet_ntoa(struct.pack('<I', arg))}
+
+
+# Friendlier args for events whose value packs something (see trace.h)
+ARG_DECODERS = {
+    ('usb_xfer', TYPE_BEGIN): decode_weights,
+    ('usb_xfer', TYPE_END): lambda arg: {'result': arg},
+    ('apply_command', TYPE_BEGIN): decode_weights,
+    ('cue_dispatch', TYPE_INSTANT): decode_weights,
+    ('source_rejected', TYPE_INSTANT): decode_addr,
+    ('cue_alarm', TYPE_INSTANT): lambda arg: {'late_us': arg},
+    ('supervisor', TYPE_END): lambda arg: {'healthy': bool(arg)},
+    ('flash_prog', TYPE_END): lambda arg: {'bytes': arg},
+    ('usb_recovery', TYPE_INSTANT): lambda arg: {'level': arg},
+    ('usb_mount', TYPE_INSTANT): lambda arg: {'mounted': bool(arg)},
+    ('probe', TYPE_INSTANT): lambda arg: {'probe_id': arg},
+}
+
+
+def read_dump(path: Path):
+    """Return (event names, track names, overwritten, [(time_us, type, track, name, arg)])"""
+    data = path.read_bytes()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError('file too short')
+
+    magic, version, names_length, count, overwritten = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC:
+        raise ValueError('not an RB3E trace dump')
+    if version != FILE_VERSION:
+        raise ValueError(f'unsupported dump version {version}')
+
+    pos = FILE_HEADER.size
+    names = data[pos:pos + names_length]
+    pos += names_length
+    if len(names) < 2:
+        raise ValueError('missing name table')
+
+    n_events, n_tracks = names[0], names[1]
+    strings = names[2:].split(b'\0')
+    if len(strings) < n_events + n_tracks:
+        raise ValueError('truncated name table')
+    strings = [s.decode('ascii', 'replace') for s in strings]
+    event_names = strings[:n_events]
+    track_names = strings[n_events:n_events + n_tracks]
+
+    if len(data) < pos + count * EVENT.size:
+        print(f"Warning: {path}: dump truncated, using the events present", file=sys.stderr)
+        count = (len(data) - pos) // EVENT.size
+
+    events = []
+    for i in range(count):
+        time_us, ev_type, track, name, _, arg = EVENT.unpack_from(data, pos + i * EVENT.size)
+        events.append((time_us, ev_type, track, name, arg))
+
+    return event_names, track_names, overwritten, events
+
+
+def unwrap_times(events):
+    """Extend the 32-bit microsecond clock across wraps (every ~71 minutes)"""
+    out = []
+    base = 0
+    last = None
+    for time_us, *rest in events:
+        if last is not None and time_us < last and last - time_us > 0x80000000:
+            base += 1 << 32
+        last = time_us
+        out.append((base + time_us, *rest))
+    return out
+
+
+def convert(path: Path, pid: int, trace_events: list) -> dict:
+    event_names, track_names, overwritten, events = read_dump(path)
+    events = unwrap_times(events)
+
+    def name_of(index: int) -> str:
+        return event_names[index] if index < len(event_names) else f'event_{index}'
+
+    trace_events.append({'ph': 'M', 'pid': pid, 'name': 'process_name',
+                         'args': {'name': path.stem}})
+    for tid, track in enumerate(track_names):
+        trace_events.append({'ph': 'M', 'pid': pid, 'tid': tid, 'name': 'thread_name',
+                             'args': {'name': track}})
+        trace_events.append({'ph': 'M', 'pid': pid, 'tid': tid, 'name': 'thread_sort_index',
+                             'args': {'sort_index': tid}})
+
+    open_spans = {}         # (track, name) -> nesting depth
+    unmatched = 0
+    for time_us, ev_type, track, name_id, arg in events:
+        name = name_of(name_id)
+        decoder = ARG_DECODERS.get((name, ev_type))
+        args = decoder(arg) if decoder else ({'arg': arg} if arg else {})
+        key = (track, name_id)
+
+        if ev_type == TYPE_BEGIN:
+            open_spans[key] = open_spans.get(key, 0) + 1
+            trace_events.append({'ph': 'B', 'pid': pid, 'tid': track, 'ts': time_us,
+                                 'name': name, 'args': args})
+        elif ev_type == TYPE_END:
+            # Ends whose begin was overwritten in the ring would close the wrong span
+            if open_spans.get(key, 0) == 0:
+                unmatched += 1
+                continue
+            open_spans[key] -= 1
+            trace_events.append({'ph': 'E', 'pid': pid, 'tid': track, 'ts': time_us,
+                                 'name': name, 'args': args})
+        elif ev_type == TYPE_INSTANT:
+            trace_events.append({'ph': 'i', 's': 't', 'pid': pid, 'tid': track,
+                                 'ts': time_us, 'name': name, 'args': args})
+        elif ev_type == TYPE_COUNTER:
+            trace_events.append({'ph': 'C', 'pid': pid, 'tid': track, 'ts': time_us,
+                                 'name': name, 'args': {name: arg}})
+
+    # Spans still open when recording stopped end at the last event
+    if events:
+        last_us = events[-1][0]
+        for (track, name_id), depth in open_spans.items():
+            for _ in range(depth):
+                trace_events.append({'ph': 'E', 'pid': pid, 'tid': track, 'ts': last_us,
+                                     'name': name_of(name_id), 'args': {'unfinished': True}})
+
+    span_us = events[-1][0] - events[0][0] if events else 0
+    return {'events': len(events), 'overwritten': overwritten,
+            'unmatched': unmatched, 'span_s': span_us / 1e6}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert RB3E trace dumps to Chrome Trace / Perfetto JSON',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  %(prog)s bridge.rb3t -o bridge.json
+  %(prog)s stage-left.rb3t stage-right.rb3t -o show.json
+
+Open the result in https://ui.perfetto.dev or chrome://tracing.
+"""
+    )
+    parser.add_argument('dumps', nargs='+', type=Path,
+                        help='Trace dumps from rb3e_ctl trace dump or rb3e_emulator --trace')
+    parser.add_argument('--output', '-o', default='trace.json',
+                        help='Output JSON file (default: trace.json)')
+
+    args = parser.parse_args()
+
+    trace_events = []
+    for pid, path in enumerate(args.dumps, start=1):
+        try:
+            info = convert(path, pid, trace_events)
+        except (OSError, ValueError) as e:
+            print(f"Error: {path}: {e}", file=sys.stderr)
+            sys.exit(1)
+
+        print(f"{path}: {info['events']} events over {info['span_s']:.3f} s", end='')
+        if info['overwritten']:
+            print(f", {info['overwritten']} older events overwritten", end='')
+        if info['unmatched']:
+            print(f", {info['unmatched']} ends without a begin dropped", end='')
+        print()
+
+    output_path = Path(args.output)
+    output_path.write_text(json.dumps({'traceEvents': trace_events,
+                                       'displayTimeUnit': 'ms'}))
+    print(f"Generated: {output_path}")
+
+
+if __name__ == '__main__':
+    main()